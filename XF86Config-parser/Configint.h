@@ -76,42 +76,73 @@ typedef struct
 LexRec, *LexPtr;
 
 
+/*
+ * scanner state for one config; see Scan.c
+ */
+
+typedef struct __xconfigparserrec
+{
+    FILE *file;          /* config being read through stdio, or NULL */
+    const char *mem;     /* mapped or caller-owned config, or NULL */
+    size_t memLen;
+    size_t memPos;       /* offset of the next line in mem */
+    int memMapped;       /* mem must be munmap()ed */
+    const char *buf;     /* current line; not NUL terminated */
+    int lineLen;         /* length of the current line */
+    int pos;             /* current readers position */
+    char *lineBuf;       /* line buffer when reading file */
+    int lineBufLen;
+    char *rbuf;          /* buffer for tokens */
+    int rbufLen;
+    int pushToken;
+    int eolSeen;         /* private state to handle comments */
+    LexRec val;          /* value of the last token */
+    int lineNo;          /* linenumber */
+    char *section;       /* name of current section being parsed */
+    char *path;          /* path to config file */
+    int useArena;        /* read configs into an arena of their own */
+}
+XConfigParserRec;
+
+
 #include "configProcs.h"
 #include <stdlib.h>
 
-#define TEST_FREE(a) \
-    if (a) {         \
-        free (a);    \
-         a = NULL;   \
+#define TEST_FREE(a)        \
+    if (a) {                \
+        xconfigFree(a);     \
+         a = NULL;          \
     }
 
 
 #define PARSE_PROLOGUE(typeptr,typerec)                         \
     typeptr ptr;                                                \
-    if ((ptr = (typeptr) calloc(1, sizeof(typerec))) == NULL) { \
-        return NULL;                                            \
-    }                                                           \
-    memset(ptr, 0, sizeof(typerec));
+    ptr = (typeptr) xconfigAlloc(sizeof(typerec));
+
 
+/*
+ * HANDLE_LIST appends the result of func to ptr->field; the caller
+ * declares "GenericListPtr <field>Tail = NULL;" to make that O(1).
+ */
 
 #define HANDLE_LIST(field,func,type)                                    \
 {                                                                       \
-    type p = func();                                                    \
+    type p = func(parser);                                              \
     if (p == NULL) {                                                    \
         CLEANUP (&ptr);                                                 \
         return (NULL);                                                  \
     } else {                                                            \
-        xconfigAddListItem((GenericListPtr*)(&ptr->field),              \
-                           (GenericListPtr) p);                         \
+        xconfigAppendListItem((GenericListPtr*)(&ptr->field),           \
+                              &field##Tail, (GenericListPtr) p);        \
     }                                                                   \
 }
 
 
-#define Error(a,b)                            \
-    do {                                      \
-        xconfigErrorMsg(ParseErrorMsg, a, b); \
-        CLEANUP (&ptr);                       \
-        return NULL;                          \
+#define Error(a,b)                                            \
+    do {                                                      \
+        xconfigParserErrorMsg(parser, ParseErrorMsg, a, b);   \
+        CLEANUP (&ptr);                                       \
+        return NULL;                                          \
     } while (0)
 
 
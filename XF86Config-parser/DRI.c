@@ -30,7 +30,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec DRITab[] =
 {
@@ -44,27 +43,28 @@ static XConfigSymTabRec DRITab[] =
 #define CLEANUP xconfigFreeBuffersList
 
 XConfigBuffersPtr
-xconfigParseBuffers (void)
+xconfigParseBuffers (XConfigParserPtr parser)
 {
     int token;
     PARSE_PROLOGUE (XConfigBuffersPtr, XConfigBuffersRec);
 
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER) {
+    if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER) {
         Error("Buffers count expected", NULL);
     }
-    ptr->count = val.num;
+    ptr->count = parser->val.num;
 
-    if (xconfigGetSubToken (&(ptr->comment)) != NUMBER) {
+    if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER) {
         Error("Buffers size expected", NULL);
     }
-    ptr->size = val.num;
+    ptr->size = parser->val.num;
 
-    if ((token = xconfigGetSubToken (&(ptr->comment))) == STRING) {
-        ptr->flags = val.str;
-        if ((token = xconfigGetToken (NULL)) == COMMENT)
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+    if ((token = xconfigGetSubToken (parser, &(ptr->comment))) == STRING) {
+        ptr->flags = parser->val.str;
+        if ((token = xconfigGetToken (parser, NULL)) == COMMENT)
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
         else
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(parser, token);
     }
 
     return ptr;
@@ -75,28 +75,29 @@ xconfigParseBuffers (void)
 #define CLEANUP xconfigFreeDRI
 
 XConfigDRIPtr
-xconfigParseDRISection (void)
+xconfigParseDRISection (XConfigParserPtr parser)
 {
     int token;
+    GenericListPtr buffersTail = NULL;
     PARSE_PROLOGUE (XConfigDRIPtr, XConfigDRIRec);
 
     /* Zero is a valid value for this. */
     ptr->group = -1;
-    while ((token = xconfigGetToken (DRITab)) != ENDSECTION) {
+    while ((token = xconfigGetToken (parser, DRITab)) != ENDSECTION) {
     switch (token)
         {
         case GROUP:
-        if ((token = xconfigGetSubToken (&(ptr->comment))) == STRING)
-            ptr->group_name = val.str;
+        if ((token = xconfigGetSubToken (parser, &(ptr->comment))) == STRING)
+            ptr->group_name = parser->val.str;
         else if (token == NUMBER)
-            ptr->group = val.num;
+            ptr->group = parser->val.num;
         else
             Error (GROUP_MSG, NULL);
         break;
         case MODE:
-        if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+        if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
             Error (NUMBER_MSG, "Mode");
-        ptr->mode = val.num;
+        ptr->mode = parser->val.num;
         break;
         case BUFFERS:
         HANDLE_LIST (buffers, xconfigParseBuffers,
@@ -106,10 +107,11 @@ xconfigParseDRISection (void)
         Error (UNEXPECTED_EOF_MSG, NULL);
         break;
         case COMMENT:
-        ptr->comment = xconfigAddComment(ptr->comment, val.str);
+        ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                               parser->val.str);
         break;
         default:
-        Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+        Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
         break;
         }
     }
@@ -135,7 +137,7 @@ xconfigFreeDRI (XConfigDRIPtr *ptr)
     
     xconfigFreeBuffersList (&((*ptr)->buffers));
     TEST_FREE ((*ptr)->comment);
-    free (*ptr);
+    xconfigFree (*ptr);
     *ptr = NULL;
 }
 
@@ -152,7 +154,7 @@ xconfigFreeBuffersList (XConfigBuffersPtr *ptr)
         TEST_FREE ((*ptr)->comment);
         prev = *ptr;
         *ptr  = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
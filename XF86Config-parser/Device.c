@@ -61,7 +61,6 @@
 
 #include <ctype.h>
 
-extern LexRec val;
 
 static
 XConfigSymTabRec DeviceTab[] =
@@ -94,7 +93,7 @@ XConfigSymTabRec DeviceTab[] =
 #define CLEANUP xconfigFreeDeviceList
 
 XConfigDevicePtr
-xconfigParseDeviceSection (void)
+xconfigParseDeviceSection (XConfigParserPtr parser)
 {
     int i;
     int has_ident = FALSE;
@@ -106,148 +105,149 @@ xconfigParseDeviceSection (void)
     ptr->chiprev = -1;
     ptr->irq = -1;
     ptr->screen = -1;
-    while ((token = xconfigGetToken (DeviceTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, DeviceTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = parser->val.str;
             has_ident = TRUE;
             break;
         case VENDOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Vendor");
-            ptr->vendor = val.str;
+            ptr->vendor = parser->val.str;
             break;
         case BOARD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Board");
-            ptr->board = val.str;
+            ptr->board = parser->val.str;
             break;
         case CHIPSET:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Chipset");
-            ptr->chipset = val.str;
+            ptr->chipset = parser->val.str;
             break;
         case CARD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Card");
-            ptr->card = val.str;
+            ptr->card = parser->val.str;
             break;
         case DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->driver = val.str;
+            ptr->driver = parser->val.str;
             break;
         case RAMDAC:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Ramdac");
-            ptr->ramdac = val.str;
+            ptr->ramdac = parser->val.str;
             break;
         case DACSPEED:
             for (i = 0; i < CONF_MAXDACSPEEDS; i++)
                 ptr->dacSpeeds[i] = 0;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
             {
                 Error (DACSPEED_MSG, CONF_MAXDACSPEEDS);
             }
             else
             {
-                ptr->dacSpeeds[0] = (int) (val.realnum * 1000.0 + 0.5);
+                ptr->dacSpeeds[0] = (int) (parser->val.realnum * 1000.0 + 0.5);
                 for (i = 1; i < CONF_MAXDACSPEEDS; i++)
                 {
-                    if (xconfigGetSubToken (&(ptr->comment)) == NUMBER)
+                    if (xconfigGetSubToken (parser, &(ptr->comment)) == NUMBER)
                         ptr->dacSpeeds[i] = (int)
-                            (val.realnum * 1000.0 + 0.5);
+                            (parser->val.realnum * 1000.0 + 0.5);
                     else
                     {
-                        xconfigUnGetToken (token);
+                        xconfigUnGetToken (parser, token);
                         break;
                     }
                 }
             }
             break;
         case VIDEORAM:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "VideoRam");
-            ptr->videoram = val.num;
+            ptr->videoram = parser->val.num;
             break;
         case BIOSBASE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "BIOSBase");
-            ptr->bios_base = val.num;
+            ptr->bios_base = parser->val.num;
             break;
         case MEMBASE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "MemBase");
-            ptr->mem_base = val.num;
+            ptr->mem_base = parser->val.num;
             break;
         case IOBASE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "IOBase");
-            ptr->io_base = val.num;
+            ptr->io_base = parser->val.num;
             break;
         case CLOCKCHIP:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "ClockChip");
-            ptr->clockchip = val.str;
+            ptr->clockchip = parser->val.str;
             break;
         case CHIPID:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "ChipID");
-            ptr->chipid = val.num;
+            ptr->chipid = parser->val.num;
             break;
         case CHIPREV:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "ChipRev");
-            ptr->chiprev = val.num;
+            ptr->chiprev = parser->val.num;
             break;
 
         case CLOCKS:
-            token = xconfigGetSubToken(&(ptr->comment));
+            token = xconfigGetSubToken(parser, &(ptr->comment));
             for( i = ptr->clocks;
                 token == NUMBER && i < CONF_MAXCLOCKS; i++ ) {
-                ptr->clock[i] = (int)(val.realnum * 1000.0 + 0.5);
-                token = xconfigGetSubToken(&(ptr->comment));
+                ptr->clock[i] = (int)(parser->val.realnum * 1000.0 + 0.5);
+                token = xconfigGetSubToken(parser, &(ptr->comment));
             }
             ptr->clocks = i;
-            xconfigUnGetToken (token);
+            xconfigUnGetToken (parser, token);
             break;
         case TEXTCLOCKFRQ:
-            if ((token = xconfigGetSubToken(&(ptr->comment))) != NUMBER)
+            if ((token = xconfigGetSubToken(parser, &(ptr->comment))) != NUMBER)
                 Error (NUMBER_MSG, "TextClockFreq");
-            ptr->textclockfreq = (int)(val.realnum * 1000.0 + 0.5);
+            ptr->textclockfreq = (int)(parser->val.realnum * 1000.0 + 0.5);
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
         case BUSID:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "BusID");
-            ptr->busid = val.str;
+            ptr->busid = parser->val.str;
             break;
         case IRQ:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (QUOTE_MSG, "IRQ");
-            ptr->irq = val.num;
+            ptr->irq = parser->val.num;
             break;
         case SCREEN:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Screen");
-            ptr->screen = val.num;
+            ptr->screen = parser->val.num;
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -351,24 +351,26 @@ xconfigFreeDeviceList (XConfigDevicePtr *ptr)
 
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
 int
-xconfigValidateDevice (XConfigPtr p)
+xconfigValidateDevice (XConfigParserPtr parser, XConfigPtr p)
 {
     XConfigDevicePtr device = p->devices;
 
     if (!device) {
-        xconfigErrorMsg(ValidationErrorMsg, "At least one Device section "
+        xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                              "At least one Device section "
                      "is required.");
         return (FALSE);
     }
 
     while (device) {
         if (!device->driver) {
-            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DRIVER_MSG,
+            xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                  UNDEFINED_DRIVER_MSG,
                          device->identifier);
             return (FALSE);
         }
@@ -411,7 +413,7 @@ static int isPci(const char* busID, const char **retID)
     s = strdup(busID);
     p = strtok(s, ":");
     if (p == NULL || *p == 0) {
-	free(s);
+	xconfigFree(s);
 	return FALSE;
     }
     if (!xconfigNameCompare(p, "pci") || !xconfigNameCompare(p, "agp")) {
@@ -419,7 +421,7 @@ static int isPci(const char* busID, const char **retID)
 	    *retID = busID + strlen(p) + 1;
         ret = TRUE;
     }
-    free(s);
+    xconfigFree(s);
     return ret;
 }
 
@@ -448,7 +450,7 @@ int xconfigParsePciBusString(const char *busID,
     s = strdup(id);
     p = strtok(s, ":");
     if (p == NULL || *p == 0) {
-	free(s);
+	xconfigFree(s);
 	return FALSE;
     }
     d = strpbrk(p, "@");
@@ -456,14 +458,14 @@ int xconfigParsePciBusString(const char *busID,
 	*(d++) = 0;
 	for (i = 0; d[i] != 0; i++) {
 	    if (!isdigit(d[i])) {
-		free(s);
+		xconfigFree(s);
 		return FALSE;
 	    }
 	}
     }
     for (i = 0; p[i] != 0; i++) {
 	if (!isdigit(p[i])) {
-	    free(s);
+	    xconfigFree(s);
 	    return FALSE;
 	}
     }
@@ -472,12 +474,12 @@ int xconfigParsePciBusString(const char *busID,
 	*bus += atoi(d) << 8;
     p = strtok(NULL, ":");
     if (p == NULL || *p == 0) {
-	free(s);
+	xconfigFree(s);
 	return FALSE;
     }
     for (i = 0; p[i] != 0; i++) {
 	if (!isdigit(p[i])) {
-	    free(s);
+	    xconfigFree(s);
 	    return FALSE;
 	}
     }
@@ -485,17 +487,17 @@ int xconfigParsePciBusString(const char *busID,
     *func = 0;
     p = strtok(NULL, ":");
     if (p == NULL || *p == 0) {
-	free(s);
+	xconfigFree(s);
 	return TRUE;
     }
     for (i = 0; p[i] != 0; i++) {
 	if (!isdigit(p[i])) {
-	    free(s);
+	    xconfigFree(s);
 	    return FALSE;
 	}
     }
     *func = atoi(p);
-    free(s);
+    xconfigFree(s);
     return TRUE;
 }
 
@@ -35,7 +35,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec ExtensionsTab[] =
 {
@@ -47,25 +46,26 @@ static XConfigSymTabRec ExtensionsTab[] =
 #define CLEANUP xconfigFreeExtensions
 
 XConfigExtensionsPtr
-xconfigParseExtensionsSection (void)
+xconfigParseExtensionsSection (XConfigParserPtr parser)
 {
     int token;
     
     PARSE_PROLOGUE (XConfigExtensionsPtr, XConfigExtensionsRec);
 
-    while ((token = xconfigGetToken (ExtensionsTab)) != ENDSECTION) {
+    while ((token = xconfigGetToken (parser, ExtensionsTab)) != ENDSECTION) {
         switch (token) {
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -98,6 +98,6 @@ xconfigFreeExtensions (XConfigExtensionsPtr *ptr)
 
     xconfigFreeOptionList (&((*ptr)->options));
     TEST_FREE ((*ptr)->comment);
-    free (*ptr);
+    xconfigFree (*ptr);
     *ptr = NULL;
 }
@@ -61,7 +61,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec FilesTab[] =
 {
@@ -83,7 +82,7 @@ prependRoot (char *pathname)
 #define CLEANUP xconfigFreeFiles
 
 XConfigFilesPtr
-xconfigParseFilesSection (void)
+xconfigParseFilesSection (XConfigParserPtr parser)
 {
     int i, j;
     int k, l;
@@ -91,21 +90,22 @@ xconfigParseFilesSection (void)
     int token;
     PARSE_PROLOGUE (XConfigFilesPtr, XConfigFilesRec)
 
-    while ((token = xconfigGetToken (FilesTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, FilesTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case FONTPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "FontPath");
             j = FALSE;
-            str = prependRoot (val.str);
+            str = prependRoot (parser->val.str);
             if (ptr->fontpath == NULL)
             {
-                ptr->fontpath = malloc (1);
+                ptr->fontpath = xconfigAlloc (1);
                 ptr->fontpath[0] = '\0';
                 i = strlen (str) + 1;
             }
@@ -118,26 +118,26 @@ xconfigParseFilesSection (void)
                     j = TRUE;
                 }
             }
-            ptr->fontpath = realloc (ptr->fontpath, i);
+            ptr->fontpath = xconfigRealloc (ptr->fontpath, i);
             if (j)
                 strcat (ptr->fontpath, ",");
 
             strcat (ptr->fontpath, str);
-            free (val.str);
+            xconfigFree (parser->val.str);
             break;
         case RGBPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "RGBPath");
-            ptr->rgbpath = val.str;
+            ptr->rgbpath = parser->val.str;
             break;
         case MODULEPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "ModulePath");
             l = FALSE;
-            str = prependRoot (val.str);
+            str = prependRoot (parser->val.str);
             if (ptr->modulepath == NULL)
             {
-                ptr->modulepath = malloc (1);
+                ptr->modulepath = xconfigAlloc (1);
                 ptr->modulepath[0] = '\0';
                 k = strlen (str) + 1;
             }
@@ -150,21 +150,21 @@ xconfigParseFilesSection (void)
                     l = TRUE;
                 }
             }
-            ptr->modulepath = realloc (ptr->modulepath, k);
+            ptr->modulepath = xconfigRealloc (ptr->modulepath, k);
             if (l)
                 strcat (ptr->modulepath, ",");
 
             strcat (ptr->modulepath, str);
-            free (val.str);
+            xconfigFree (parser->val.str);
             break;
         case INPUTDEVICES:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "InputDevices");
             l = FALSE;
-            str = prependRoot (val.str);
+            str = prependRoot (parser->val.str);
             if (ptr->inputdevs == NULL)
             {
-                ptr->inputdevs = malloc (1);
+                ptr->inputdevs = xconfigAlloc (1);
                 ptr->inputdevs[0] = '\0';
                 k = strlen (str) + 1;
             }
@@ -177,23 +177,23 @@ xconfigParseFilesSection (void)
                     l = TRUE;
                 }
             }
-            ptr->inputdevs = realloc (ptr->inputdevs, k);
+            ptr->inputdevs = xconfigRealloc (ptr->inputdevs, k);
             if (l)
                 strcat (ptr->inputdevs, ",");
 
             strcat (ptr->inputdevs, str);
-            free (val.str);
+            xconfigFree (parser->val.str);
             break;
         case LOGFILEPATH:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "LogFile");
-            ptr->logfile = val.str;
+            ptr->logfile = parser->val.str;
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -277,6 +277,6 @@ xconfigFreeFiles (XConfigFilesPtr *p)
     TEST_FREE ((*p)->fontpath);
     TEST_FREE ((*p)->comment);
 
-    free (*p);
+    xconfigFree (*p);
     *p = NULL;
 }
@@ -61,7 +61,6 @@
 #include <math.h>
 #include "common-utils.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec ServerFlagsTab[] =
 {
@@ -86,12 +85,12 @@ static XConfigSymTabRec ServerFlagsTab[] =
 #define CLEANUP xconfigFreeFlags
 
 XConfigFlagsPtr
-xconfigParseFlagsSection (void)
+xconfigParseFlagsSection (XConfigParserPtr parser)
 {
     int token;
     PARSE_PROLOGUE (XConfigFlagsPtr, XConfigFlagsRec)
 
-    while ((token = xconfigGetToken (ServerFlagsTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, ServerFlagsTab)) != ENDSECTION)
     {
         int hasvalue = FALSE;
         int strvalue = FALSE;
@@ -99,7 +98,8 @@ xconfigParseFlagsSection (void)
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
             /* 
              * these old keywords are turned into standard generic options.
@@ -130,15 +130,16 @@ xconfigParseFlagsSection (void)
                         char *valstr = NULL;
                         if (hasvalue)
                         {
-                            tokentype = xconfigGetSubToken(&(ptr->comment));
+                            tokentype = xconfigGetSubToken(parser,
+                                                           &(ptr->comment));
                             if (strvalue) {
                                 if (tokentype != STRING)
                                     Error (QUOTE_MSG, ServerFlagsTab[i].name);
-                                valstr = val.str;
+                                valstr = parser->val.str;
                             } else {
                                 if (tokentype != NUMBER)
                                     Error (NUMBER_MSG, ServerFlagsTab[i].name);
-                                snprintf(buff, 16, "%d", val.num);
+                                snprintf(buff, 16, "%d", parser->val.num);
                                 valstr = buff;
                             }
                         }
@@ -150,14 +151,14 @@ xconfigParseFlagsSection (void)
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
 
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -182,28 +183,247 @@ xconfigPrintServerFlagsSection (FILE * f, XConfigFlagsPtr flags)
     fprintf (f, "EndSection\n\n");
 }
 
+/*
+ * Option index.
+ *
+ * Once a list reaches OPTION_INDEX_THRESHOLD options, the helpers that
+ * add options to it hang a hash index of the option names off it, and
+ * xconfigFindOption() and the duplicate checks of xconfigAddNewOption()
+ * and xconfigParserParseOption() look names up there, and append at
+ * the index's tail, instead of walking the list.  The list itself
+ * still holds the options in order, so printing them is unaffected.
+ *
+ * Each indexed option points at the index (opt->index), and the index
+ * belongs to the list whose first option it points back at.  The
+ * xconfig*Option*() helpers keep the index up to date as options are
+ * added, removed, merged and freed; freeing an indexed option with
+ * xconfigFreeOptionList() drops the index, even if the option was
+ * unlinked by hand first.  Options appended by hand after the last
+ * indexed one are found by walking on from there.  Looking an option
+ * up never changes the index, so a list can be searched from several
+ * threads at once.
+ */
+
+#define OPTION_INDEX_THRESHOLD 8
+
+typedef struct __xconfigoptionindexrec {
+    XConfigOptionPtr head;      /* the first option on the list */
+    XConfigOptionPtr tail;      /* the last option indexed */
+    XConfigOptionPtr *slots;
+    unsigned int *keys;         /* xconfigNameHash() of each slot's name */
+    unsigned int mask;
+    int count;
+    int dups;                   /* some options are hidden by earlier ones */
+} XConfigOptionIndexRec, *XConfigOptionIndexPtr;
+
+/* Return the index of the list starting at head, if it has one */
+
+static XConfigOptionIndexPtr optionListIndex(XConfigOptionPtr head)
+{
+    if (head && head->index && head->index->head == head)
+        return head->index;
+    return NULL;
+}
+
+/* Return the slot holding the option named name, or an empty slot */
+
+static unsigned int optionSlot(XConfigOptionIndexPtr index,
+                               unsigned int key, const char *name)
+{
+    unsigned int i;
+
+    for (i = key & index->mask; index->slots[i]; i = (i + 1) & index->mask) {
+        if (index->keys[i] == key &&
+            xconfigNameCompare(index->slots[i]->name, name) == 0)
+            break;
+    }
+    return i;
+}
+
+static void dropOptionIndex(XConfigOptionIndexPtr index);
+
+static void indexOption(XConfigOptionIndexPtr index, XConfigOptionPtr opt)
+{
+    unsigned int i, key = xconfigNameHash(opt->name, 0);
+
+    /* an index left behind when the list's head was changed by hand */
+    if (opt->index && opt->index != index)
+        dropOptionIndex(opt->index);
+
+    if ((unsigned int) (index->count + 1) * 2 > index->mask + 1) {
+        XConfigOptionPtr *oldSlots = index->slots;
+        unsigned int *oldKeys = index->keys;
+        unsigned int j, size = (index->mask + 1) * 2;
+
+        index->slots = xconfigAllocBeside(index, size * sizeof(*oldSlots));
+        index->keys = xconfigAllocBeside(index, size * sizeof(*oldKeys));
+        index->mask = size - 1;
+        for (j = 0; j < size / 2; j++) {
+            if (oldSlots[j]) {
+                i = optionSlot(index, oldKeys[j], oldSlots[j]->name);
+                index->slots[i] = oldSlots[j];
+                index->keys[i] = oldKeys[j];
+            }
+        }
+        xconfigFree(oldSlots);
+        xconfigFree(oldKeys);
+    }
+
+    i = optionSlot(index, key, opt->name);
+    if (index->slots[i]) {
+        index->dups = TRUE;
+    } else {
+        index->slots[i] = opt;
+        index->keys[i] = key;
+        index->count++;
+        opt->index = index;
+    }
+    index->tail = opt;
+}
+
+/* Remove opt from the slots, shifting back any entries probed past it */
+
+static void unindexOption(XConfigOptionIndexPtr index, XConfigOptionPtr opt)
+{
+    unsigned int i, j, home;
+
+    for (i = xconfigNameHash(opt->name, 0) & index->mask;
+         index->slots[i] != opt; i = (i + 1) & index->mask) {
+        if (!index->slots[i]) {
+            /* renamed by hand; look everywhere */
+            for (i = 0; index->slots[i] != opt; i++)
+                ;
+            break;
+        }
+    }
+
+    for (j = (i + 1) & index->mask; index->slots[j];
+         j = (j + 1) & index->mask) {
+        home = index->keys[j] & index->mask;
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        index->slots[i] = index->slots[j];
+        index->keys[i] = index->keys[j];
+        i = j;
+    }
+    index->slots[i] = NULL;
+    index->count--;
+    opt->index = NULL;
+}
+
+static void dropOptionIndex(XConfigOptionIndexPtr index)
+{
+    unsigned int i;
+
+    for (i = 0; i <= index->mask; i++) {
+        if (index->slots[i] && index->slots[i]->index == index)
+            index->slots[i]->index = NULL;
+    }
+    xconfigFree(index->slots);
+    xconfigFree(index->keys);
+    xconfigFree(index);
+}
+
+static void buildOptionIndex(XConfigOptionPtr head)
+{
+    XConfigOptionIndexPtr index;
+    XConfigOptionPtr opt;
+
+    index = xconfigAllocBeside(head, sizeof(XConfigOptionIndexRec));
+    index->slots = xconfigAllocBeside(head, 4 * OPTION_INDEX_THRESHOLD *
+                                      sizeof(XConfigOptionPtr));
+    index->keys = xconfigAllocBeside(head, 4 * OPTION_INDEX_THRESHOLD *
+                                     sizeof(unsigned int));
+    index->mask = 4 * OPTION_INDEX_THRESHOLD - 1;
+    index->head = head;
+
+    for (opt = head; opt; opt = opt->next)
+        indexOption(index, opt);
+}
+
+/*
+ * Return the first option on the list named name, or NULL; if there is
+ * none and pLast is given, the last option on the list is returned in
+ * *pLast, and the length of the list (if it has no index) in *pCount.
+ */
+
+static XConfigOptionPtr lookupOption(XConfigOptionPtr head, const char *name,
+                                     XConfigOptionPtr *pLast, int *pCount)
+{
+    XConfigOptionIndexPtr index = optionListIndex(head);
+    XConfigOptionPtr opt, last = NULL;
+    unsigned int i;
+    int n = 0;
+
+    if (index) {
+        i = optionSlot(index, xconfigNameHash(name, 0), name);
+        if (index->slots[i])
+            return index->slots[i];
+        /* options appended by hand come after the indexed ones */
+        last = index->tail;
+        head = last->next;
+    }
+
+    for (opt = head; opt; opt = opt->next, n++) {
+        if (xconfigNameCompare(opt->name, name) == 0)
+            return opt;
+        last = opt;
+    }
+
+    if (pLast)
+        *pLast = last;
+    if (pCount)
+        *pCount = n;
+
+    return NULL;
+}
+
+/*
+ * Append opt, which is not on the list, after last, the last option
+ * on the list found by lookupOption(); n is the length it returned.
+ */
+
+static void appendOption(XConfigOptionPtr *pHead, XConfigOptionPtr last,
+                         int n, XConfigOptionPtr opt)
+{
+    XConfigOptionIndexPtr index = optionListIndex(*pHead);
+
+    xconfigAppendListItem((GenericListPtr *)(pHead), (GenericListPtr *)&last,
+                          (GenericListPtr)opt);
+
+    if (index) {
+        while (index->tail->next)
+            indexOption(index, index->tail->next);
+    } else if (n + 1 >= OPTION_INDEX_THRESHOLD) {
+        buildOptionIndex(*pHead);
+    }
+}
+
 void
 xconfigAddNewOption (XConfigOptionPtr *pHead, const char *name,
                      const char *val)
 {
     XConfigOptionPtr new;
-    XConfigOptionPtr old = NULL;
+    XConfigOptionPtr old;
+    XConfigOptionPtr last = NULL;
+    int n = 0;
 
     /* Don't allow duplicates */
-    if (*pHead != NULL &&
-        ((old = xconfigFindOption(*pHead, name)) != NULL)) {
+    old = lookupOption(*pHead, name, &last, &n);
+
+    if (old != NULL) {
         TEST_FREE(old->name);
         TEST_FREE(old->val);
         new = old;
     } else {
-        new = calloc(1, sizeof (XConfigOptionRec));
+        new = xconfigAlloc(sizeof (XConfigOptionRec));
         new->next = NULL;
     }
     new->name = xconfigStrdup(name);
     new->val = xconfigStrdup(val);
     
     if (old == NULL) {
-        xconfigAddListItem((GenericListPtr *)(pHead), (GenericListPtr)new);
+        appendOption(pHead, last, n, new);
     }
 }
 
@@ -215,7 +435,7 @@ xconfigFreeFlags (XConfigFlagsPtr *flags)
 
     xconfigFreeOptionList (&((*flags)->options));
     TEST_FREE((*flags)->comment);
-    free (*flags);
+    xconfigFree (*flags);
     *flags = NULL;
 }
 
@@ -244,12 +464,14 @@ xconfigFreeOptionList (XConfigOptionPtr *opt)
 
     while (*opt)
     {
+        if ((*opt)->index)
+            dropOptionIndex((*opt)->index);
         TEST_FREE ((*opt)->name);
         TEST_FREE ((*opt)->val);
         TEST_FREE ((*opt)->comment);
         prev = *opt;
         *opt = (*opt)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -274,7 +496,7 @@ xconfigNewOption(const char *name, const char *value)
 {
     XConfigOptionPtr opt;
 
-    opt = calloc(1, sizeof (XConfigOptionRec));
+    opt = xconfigAlloc(sizeof (XConfigOptionRec));
     if (!opt)
         return NULL;
 
@@ -288,12 +510,41 @@ xconfigNewOption(const char *name, const char *value)
 void
 xconfigRemoveOption(XConfigOptionPtr *pHead, XConfigOptionPtr opt)
 {
-    xconfigRemoveListItem((GenericListPtr *)pHead, (GenericListPtr)opt);
+    XConfigOptionIndexPtr index = optionListIndex(*pHead);
+    XConfigOptionPtr p, prev = NULL;
+
+    for (p = *pHead; p && p != opt; p = p->next)
+        prev = p;
+
+    if (p) {
+        if (prev)
+            prev->next = opt->next;
+        else
+            *pHead = opt->next;
+    }
+
+    if (index && p && !index->dups) {
+        if (opt->index == index)
+            unindexOption(index, opt);
+        if (index->tail == opt)
+            index->tail = prev;
+        if (index->head == opt)
+            index->head = *pHead;
+        /* the new first option may not have been indexed */
+        if (!index->head || index->head->index != index)
+            dropOptionIndex(index);
+    } else {
+        /* an option hidden by this one may be found now */
+        if (index)
+            dropOptionIndex(index);
+        if (opt->index)
+            dropOptionIndex(opt->index);
+    }
 
     TEST_FREE(opt->name);
     TEST_FREE(opt->val);
     TEST_FREE(opt->comment);
-    free(opt);
+    xconfigFree(opt);
 }
 
 XConfigOptionPtr
@@ -313,13 +564,7 @@ xconfigNextOption(XConfigOptionPtr list)
 XConfigOptionPtr
 xconfigFindOption (XConfigOptionPtr list, const char *name)
 {
-    while (list)
-    {
-        if (xconfigNameCompare (list->name, name) == 0)
-            return (list);
-        list = list->next;
-    }
-    return (NULL);
+    return lookupOption(list, name, NULL, NULL);
 }
 
 /*
@@ -377,6 +622,13 @@ XConfigOptionPtr
 xconfigOptionListMerge (XConfigOptionPtr head, XConfigOptionPtr tail)
 {
     XConfigOptionPtr a, b, ap = NULL, bp = NULL;
+    int n = 0;
+
+    /* the lists are spliced by hand below, so drop their indices */
+    if (optionListIndex(head))
+        dropOptionIndex(head->index);
+    if (optionListIndex(tail))
+        dropOptionIndex(tail->index);
 
     a = tail;
     b = head;
@@ -410,11 +662,17 @@ xconfigOptionListMerge (XConfigOptionPtr head, XConfigOptionPtr tail)
 
     if (head) {
         for (a = head; a->next; a = a->next)
-            ;
+            n++;
         a->next = tail;
     } else 
         head = tail;
 
+    for (a = tail; a; a = a->next)
+        n++;
+
+    if (n + 1 >= OPTION_INDEX_THRESHOLD)
+        buildOptionIndex(head);
+
     return (head);
 }
 
@@ -425,7 +683,7 @@ xconfigULongToString(unsigned long i)
     int l;
 
     l = (int)(ceil(log10((double)i) + 2.5));
-    s = malloc(l);
+    s = xconfigAlloc(l);
     if (!s)
         return NULL;
     sprintf(s, "%lu", i);
@@ -433,57 +691,66 @@ xconfigULongToString(unsigned long i)
 }
 
 XConfigOptionPtr
-xconfigParseOption(XConfigOptionPtr head)
+xconfigParserParseOption(XConfigParserPtr parser, XConfigOptionPtr head)
 {
     XConfigOptionPtr option, cnew, old;
+    XConfigOptionPtr last = NULL;
     char *name, *comment = NULL;
-    int token;
+    int token, n = 0;
 
-    if ((token = xconfigGetSubToken(&comment)) != STRING) {
-        xconfigErrorMsg(ParseErrorMsg, BAD_OPTION_MSG);
+    if ((token = xconfigGetSubToken(parser, &comment)) != STRING) {
+        xconfigParserErrorMsg(parser, ParseErrorMsg, BAD_OPTION_MSG);
         if (comment)
-            free(comment);
+            xconfigFree(comment);
         return (head);
     }
 
-    name = val.str;
-    if ((token = xconfigGetSubToken(&comment)) == STRING) {
-        option = xconfigNewOption(name, val.str);
+    name = parser->val.str;
+    if ((token = xconfigGetSubToken(parser, &comment)) == STRING) {
+        option = xconfigNewOption(name, parser->val.str);
         option->comment = comment;
-        if ((token = xconfigGetToken(NULL)) == COMMENT)
-            option->comment = xconfigAddComment(option->comment, val.str);
+        if ((token = xconfigGetToken(parser, NULL)) == COMMENT)
+            option->comment = xconfigParserAddComment(parser, option->comment,
+                                                      parser->val.str);
         else
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(parser, token);
     }
     else {
         option = xconfigNewOption(name, NULL);
         option->comment = comment;
         if (token == COMMENT)
-            option->comment = xconfigAddComment(option->comment, val.str);
+            option->comment = xconfigParserAddComment(parser, option->comment,
+                                                      parser->val.str);
         else
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(parser, token);
     }
 
-    old = NULL;
-
     /* Don't allow duplicates */
-    if (head != NULL && (old = xconfigFindOption(head, name)) != NULL) {
+    old = lookupOption(head, name, &last, &n);
+
+    if (old != NULL) {
         cnew = old;
-        free(option->name);
+        xconfigFree(option->name);
         TEST_FREE(option->val);
         TEST_FREE(option->comment);
-        free(option);
+        xconfigFree(option);
     }
     else
         cnew = option;
     
     if (old == NULL) {
-        xconfigAddListItem((GenericListPtr *)(&head), (GenericListPtr)cnew);
+        appendOption(&head, last, n, cnew);
     }
 
     return head;
 }
 
+XConfigOptionPtr
+xconfigParseOption(XConfigOptionPtr head)
+{
+    return xconfigParserParseOption(xconfigGetDefaultParser(), head);
+}
+
 void
 xconfigPrintOptionList(FILE *fp, XConfigOptionPtr list, int tabs)
 {
@@ -26,8 +26,13 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
+#include <dirent.h>
+#include <limits.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <glob.h>
 
 
 #include "xf86Parser.h"
@@ -36,12 +41,29 @@
 #define MOUSE_IDENTIFER "Mouse0"
 #define KEYBOARD_IDENTIFER "Keyboard0"
 
+#define PROC_ROOT "/proc"
+
+#define FONT_PATH_COUNT 19
+
 #define SCREEN_IDENTIFIER "Screen%d"
 #define DEVICE_IDENTIFIER "Device%d"
 #define MONITOR_IDENTIFIER "Monitor%d"
 
 
-static int is_file(const char *filename);
+static int xfs_running(GenerateOptions *gop);
+
+static char *find_pkgconfig_file(const char *package, struct stat *stat_buf);
+static char *pkgconfig_stamp(const char *filename,
+                             const struct stat *stat_buf);
+static char *read_pkgconfig_variable(const char *filename,
+                                     const char *variable);
+static char *get_cached_xserver_value(GenerateOptions *gop,
+                                      const char *stampName,
+                                      const char *stamp, const char *name);
+static void set_cached_xserver_value(GenerateOptions *gop,
+                                     const char *stampName,
+                                     const char *stamp, const char *name,
+                                     const char *value);
 
 static void add_font_path(GenerateOptions *gop, XConfigPtr config);
 static void add_modules(GenerateOptions *gop, XConfigPtr config);
@@ -97,9 +119,11 @@ XConfigScreenPtr xconfigGenerateAddScreen(XConfigPtr config,
                                           int bus, int domain, int slot,
                                           char *boardname, int count)
 {
-    XConfigScreenPtr screen, s;
+    XConfigScreenPtr screen;
     XConfigDevicePtr device;
     XConfigMonitorPtr monitor;
+    GenericListPtr tail = NULL;
+    XConfigArenaPtr prevArena = xconfigSetArena(config->arena);
 
     monitor = xconfigAddMonitor(config, count);
     device = add_device(config, bus, domain, slot, boardname, count);
@@ -121,12 +145,12 @@ XConfigScreenPtr xconfigGenerateAddScreen(XConfigPtr config,
 
     /* append to the end of the screen list */
 
-    if (!config->screens) {
-        config->screens = screen;
-    } else {
-        for (s = config->screens; s->next; s = s->next);
-        s->next = screen;
-    }
+    xconfigAppendListItem((GenericListPtr *)(&config->screens), &tail,
+                          (GenericListPtr)screen);
+
+    xconfigIndexAdd(config, XCONFIG_INDEX_SCREEN, screen, FALSE);
+
+    xconfigSetArena(prevArena);
 
     return screen;
 
@@ -177,32 +201,118 @@ void xconfigGenerateAssignScreenAdjacencies(XConfigLayoutPtr layout)
 
 
 /*
- * is_file()
+ * xfs_running() - return TRUE if a process named "xfs" is running.
+ * On Linux this scans <proc_root>/<pid>/comm directly rather than
+ * forking a shell and ps(1); the other platforms have no comm file,
+ * so they still ask ps.
  */
 
-static int is_file(const char *filename)
+static int xfs_running(GenerateOptions *gop)
 {
-    return (access(filename, F_OK) == 0);
+#if defined(NV_SUNOS) || defined(NV_BSD)
+    int ret;
+
+#if defined(NV_SUNOS)
+    ret = system("ps -e -o fname | grep -v grep | egrep \"^xfs$\" > /dev/null");
+#else
+    ret = system("ps -e -o comm | grep -v grep | egrep \"^xfs$\" > /dev/null");
+#endif
+    return (ret != -1 && WIFEXITED(ret) && WEXITSTATUS(ret) == 0);
+#else
+    const char *root = gop->proc_root ? gop->proc_root : PROC_ROOT;
+    struct dirent *ent;
+    char comm[8], *p;
+    int procfd, fd, found = FALSE;
+    ssize_t n;
+    DIR *dir;
+
+    procfd = open(root, O_RDONLY | O_DIRECTORY);
+    if (procfd < 0) return FALSE;
+
+    dir = fdopendir(procfd);
+    if (!dir) {
+        close(procfd);
+        return FALSE;
+    }
+
+    while (!found && (ent = readdir(dir)) != NULL) {
+
+        /* only the numeric entries are processes */
+
+        for (p = ent->d_name; isdigit((unsigned char) *p); p++);
+        if (p == ent->d_name || *p != '\0') continue;
+
+        /* open "<pid>/comm" relative to the proc root */
+
+        {
+            char path[sizeof(ent->d_name) + sizeof("/comm")];
+
+            snprintf(path, sizeof(path), "%s/comm", ent->d_name);
+            fd = openat(procfd, path, O_RDONLY);
+        }
+        if (fd < 0) continue; /* the process exited */
+
+        n = read(fd, comm, sizeof(comm));
+        close(fd);
 
-} /* is_file() */
+        found = ((n == 3 || (n == 4 && comm[3] == '\n')) &&
+                 strncmp(comm, "xfs", 3) == 0);
+    }
+
+    closedir(dir);
+
+    return found;
+#endif
+
+} /* xfs_running() */
 
 
 /*
  * find_libdir() - attempt to find the X server library path; this is
- * either
+ * either the libdir variable of the xorg-server pkg-config package
+ * (read from xorg-server.pc, or as a fallback from
  *
  *     `pkg-config --variable=libdir xorg-server`
  *
- * or
+ * ) or
  *
  *     [X PROJECT ROOT]/lib
+ *
+ * The libdir found through pkg-config is cached along with the
+ * results of probing the X server, stamped with the xorg-server.pc
+ * file it came from and the pkg-config environment.
  */
 
 static char *find_libdir(GenerateOptions *gop)
 {
     struct stat stat_buf;
     FILE *stream = NULL;
-    char *s, *libdir = NULL;
+    char *s, *pcfile, *stamp, *libdir = NULL;
+
+    pcfile = find_pkgconfig_file("xorg-server", &stat_buf);
+    stamp = pkgconfig_stamp(pcfile, &stat_buf);
+
+    libdir = get_cached_xserver_value(gop, "LIBDIR_STAMP", stamp, "LIBDIR");
+    if (libdir) {
+        if ((stat(libdir, &stat_buf) == 0) && S_ISDIR(stat_buf.st_mode)) {
+            goto done;
+        }
+        xconfigFree(libdir);
+        libdir = NULL;
+    }
+
+    if (pcfile) {
+        libdir = read_pkgconfig_variable(pcfile, "libdir");
+    }
+    if (libdir) {
+        if ((stat(libdir, &stat_buf) == 0) && S_ISDIR(stat_buf.st_mode)) {
+            set_cached_xserver_value(gop, "LIBDIR_STAMP", stamp,
+                                     "LIBDIR", libdir);
+            goto done;
+        }
+        xconfigFree(libdir);
+        libdir = NULL;
+    }
 
     /*
      * run the pkg-config command and read the output; if the output
@@ -237,12 +347,22 @@ static char *find_libdir(GenerateOptions *gop)
 
         pclose(stream);
 
-        if (libdir) return libdir;
+        if (libdir) {
+            set_cached_xserver_value(gop, "LIBDIR_STAMP", stamp,
+                                     "LIBDIR", libdir);
+            goto done;
+        }
     }
 
     /* otherwise, just fallback to [X PROJECT ROOT]/lib */
 
-    return xconfigStrcat(gop->x_project_root, "/lib", NULL);
+    libdir = xconfigStrcat(gop->x_project_root, "/lib", NULL);
+
+ done:
+    xconfigFree(pcfile);
+    xconfigFree(stamp);
+
+    return libdir;
 
 } /* find_libdir() */
 
@@ -253,19 +373,26 @@ static char *find_libdir(GenerateOptions *gop)
  * temporarily chop off the ":unscaled" appendage, and check for the
  * file "fonts.dir" in the directory.  If fonts.dir exists, append the
  * path to config->files->fontpath.
+ *
+ * The LIBDIR entries are checked with fstatat(2) relative to a single
+ * descriptor for the libdir, and the matching entries are collected
+ * first so that the font path can be built in one allocation.
  */
 
 static void add_font_path(GenerateOptions *gop, XConfigPtr config)
 {
-    int i, ret;
-    char *path, *p, *orig, *fonts_dir, *libdir;
+    int i, libfd, dirlen, found[FONT_PATH_COUNT];
+    size_t len, libdirlen = 0;
+    char probe[PATH_MAX], *libdir, *fontpath, *p;
+    const char *path;
+    struct stat st;
 
     /*
      * The below font path has been constructed from various examples
      * and uses some suggests from the Font De-uglification HOWTO
      */
 
-    static const char *__font_paths[] = {
+    static const char *__font_paths[FONT_PATH_COUNT] = {
         "LIBDIR/X11/fonts/local/",
         "LIBDIR/X11/fonts/misc/:unscaled",
         "LIBDIR/X11/fonts/100dpi/:unscaled",
@@ -285,7 +412,6 @@ static void add_font_path(GenerateOptions *gop, XConfigPtr config)
         "/usr/local/share/fonts/ttfonts",
         "/usr/share/fonts/default/Type1",
         "/usr/lib/openoffice/share/fonts/truetype",
-        NULL
     };
 
     /*
@@ -293,71 +419,91 @@ static void add_font_path(GenerateOptions *gop, XConfigPtr config)
      *
      * XXX should we check the port the font server is using?
      */
-#if defined(NV_SUNOS)
-    ret = system("ps -e -o fname | grep -v grep | egrep \"^xfs$\" > /dev/null");
-#elif defined(NV_BSD)
-    ret = system("ps -e -o comm | grep -v grep | egrep \"^xfs$\" > /dev/null");
-#else
-    ret = system("ps -C xfs 2>&1 > /dev/null");
-#endif
-    if (WEXITSTATUS(ret) == 0) {
+
+    if (xfs_running(gop)) {
         config->files->fontpath = xconfigStrdup("unix/:7100");
-    } else {
+        return;
+    }
 
-        /* get the X server libdir */
+    /* get the X server libdir */
 
-        libdir = find_libdir(gop);
+    libdir = find_libdir(gop);
+    libfd = libdir ? open(libdir, O_RDONLY | O_DIRECTORY) : -1;
+    if (libdir) libdirlen = strlen(libdir);
 
-        for (i = 0; __font_paths[i]; i++) {
-            path = xconfigStrdup(__font_paths[i]);
+    /*
+     * check each entry for a fonts.dir, and total up the length of
+     * the resulting font path as we go
+     */
 
-            /* replace LIBDIR with libdir */
+    len = 0;
 
-            if (strncmp(path, "LIBDIR", 6) == 0) {
-                p = xconfigStrcat(libdir, path + 6, NULL);
-                free(path);
-                path = p;
-            }
+    for (i = 0; i < FONT_PATH_COUNT; i++) {
 
-            /* temporarily chop off any ":unscaled" appendage */
+        found[i] = FALSE;
+        path = __font_paths[i];
 
-            p = strchr(path, ':');
-            if (p) *p = '\0';
+        /* LIBDIR entries are looked up relative to the libdir */
 
-            /* skip this entry if the fonts.dir does not exist */
+        if (strncmp(path, "LIBDIR/", 7) == 0) {
+            if (libfd < 0) continue;
+            path += 7;
+        }
 
-            fonts_dir = xconfigStrcat(path, "/fonts.dir", NULL);
-            if (!is_file(fonts_dir)) {
-                /* does not exist */
-                free(path);
-                free(fonts_dir);
-                continue;
-            }
-            free(fonts_dir);
+        /* leave off any ":unscaled" appendage */
 
-            /* add the ":unscaled" back */
+        dirlen = strcspn(path, ":");
 
-            if (p) *p = ':';
+        if (snprintf(probe, sizeof(probe), "%.*s/fonts.dir",
+                     dirlen, path) >= (int) sizeof(probe)) continue;
 
-            /*
-             * either use this path as the fontpath, or append to the
-             * existing fontpath
-             */
+        /* skip this entry if the fonts.dir does not exist */
 
-            if (config->files->fontpath) {
-                orig = config->files->fontpath;
-                config->files->fontpath = xconfigStrcat(orig, ",", path, NULL);
-                free(orig);
-                free(path);
-            } else {
-                config->files->fontpath = path;
-            }
+        if (fstatat(libfd < 0 ? AT_FDCWD : libfd, probe, &st, 0) != 0) {
+            continue;
         }
 
-        /* free the libdir string */
+        found[i] = TRUE;
+
+        len += strlen(__font_paths[i]) + 1;
+        if (path != __font_paths[i]) len += libdirlen - 6;
+    }
+
+    if (libfd >= 0) close(libfd);
+
+    /*
+     * build the comma-separated font path from the entries that
+     * exist, replacing LIBDIR with libdir
+     */
+
+    if (len) {
+        fontpath = p = xconfigAlloc(len);
+
+        for (i = 0; i < FONT_PATH_COUNT; i++) {
+            if (!found[i]) continue;
+
+            if (p != fontpath) *p++ = ',';
+
+            path = __font_paths[i];
+            if (strncmp(path, "LIBDIR", 6) == 0) {
+                memcpy(p, libdir, libdirlen);
+                p += libdirlen;
+                path += 6;
+            }
+
+            len = strlen(path);
+            memcpy(p, path, len);
+            p += len;
+        }
+        *p = '\0';
 
-        free(libdir);
+        config->files->fontpath = fontpath;
     }
+
+    /* free the libdir string */
+
+    xconfigFree(libdir);
+
 } /* add_font_path() */
 
 
@@ -415,7 +561,8 @@ static void add_modules(GenerateOptions *gop, XConfigPtr config)
 
 XConfigMonitorPtr xconfigAddMonitor(XConfigPtr config, int count)
 {
-    XConfigMonitorPtr monitor, m;
+    XConfigMonitorPtr monitor;
+    GenericListPtr tail = NULL;
 
     /* XXX need to query resman for the EDID */
 
@@ -441,12 +588,10 @@ XConfigMonitorPtr xconfigAddMonitor(XConfigPtr config, int count)
 
     /* append to the end of the monitor list */
 
-    if (!config->monitors) {
-        config->monitors = monitor;
-    } else {
-        for (m = config->monitors; m->next; m = m->next);
-        m->next = monitor;
-    }
+    xconfigAppendListItem((GenericListPtr *)(&config->monitors), &tail,
+                          (GenericListPtr)monitor);
+
+    xconfigIndexAdd(config, XCONFIG_INDEX_MONITOR, monitor, FALSE);
 
     return monitor;
 
@@ -461,7 +606,8 @@ XConfigMonitorPtr xconfigAddMonitor(XConfigPtr config, int count)
 static XConfigDevicePtr add_device(XConfigPtr config, int bus, int domain,
                                    int slot, char *boardname, int count)
 {
-    XConfigDevicePtr device, d;
+    XConfigDevicePtr device;
+    GenericListPtr tail = NULL;
 
     device = xconfigAlloc(sizeof(XConfigDeviceRec));
 
@@ -484,12 +630,10 @@ static XConfigDevicePtr add_device(XConfigPtr config, int bus, int domain,
 
     /* append to the end of the device list */
 
-    if (!config->devices) {
-        config->devices = device;
-    } else {
-        for (d = config->devices; d->next; d = d->next);
-        d->next = device;
-    }
+    xconfigAppendListItem((GenericListPtr *)(&config->devices), &tail,
+                          (GenericListPtr)device);
+
+    xconfigIndexAdd(config, XCONFIG_INDEX_DEVICE, device, FALSE);
 
     return device;
 
@@ -566,7 +710,8 @@ static void add_inputref(XConfigPtr config, XConfigLayoutPtr layout,
 
     inputRef = xconfigAlloc(sizeof(XConfigInputrefRec));
     inputRef->input_name = xconfigStrdup(name);
-    inputRef->input = xconfigFindInput(inputRef->input_name, config->inputs);
+    inputRef->input = xconfigIndexFind(config, XCONFIG_INDEX_INPUT,
+                                       inputRef->input_name);
     inputRef->options = NULL;
     xconfigAddNewOption(&inputRef->options, coreKeyword, NULL);
     inputRef->next = layout->inputs;
@@ -772,96 +917,315 @@ static const MouseEntry *find_closest_mouse_entry(const char *device,
 
 
 /*
- * find_config_entry() - scan the specified filename for the specified
- * keyword; return the value that the keyword is assigned to, or NULL
- * if any error occurs.
+ * Shell variable files.
+ *
+ * Files such as /etc/sysconfig/mouse are shell fragments of NAME=value
+ * assignments.  Each file is read and parsed once into a list of
+ * variables, which is kept for the rest of the process, so that
+ * looking up several variables in the same file does not read it
+ * again.  The cache is shared by all threads.
  */
 
-static char *find_config_entry(const char *filename, const char *keyword)
+typedef struct __ShellVarRec {
+    struct __ShellVarRec *next;
+    char *name;
+    char *value;
+} ShellVarRec, *ShellVarPtr;
+
+typedef struct __ShellVarFileRec {
+    struct __ShellVarFileRec *next;
+    char *filename;
+    ShellVarPtr vars;
+} ShellVarFileRec, *ShellVarFilePtr;
+
+static ShellVarFilePtr shellVarFiles = NULL;
+static pthread_mutex_t shellVarLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*
+ * read_file() - read the whole file into a NUL terminated buffer;
+ * returns NULL if the file cannot be read.
+ */
+
+static char *read_file(const char *filename)
 {
-    int fd = -1;
-    char *data = NULL;
-    char *value = NULL;
-    char *buf = NULL;
-    char *tmp, *start, *c, *end;
     struct stat stat_buf;
-    size_t len;
+    char *buf = NULL;
+    size_t len = 0;
+    ssize_t ret;
+    int fd;
 
-    if ((fd = open(filename, O_RDONLY)) == -1) goto done;
+    if ((fd = open(filename, O_RDONLY)) == -1) return NULL;
 
-    if (fstat(fd, &stat_buf) == -1) goto done;
+    if ((fstat(fd, &stat_buf) == -1) ||
+        !(buf = malloc(stat_buf.st_size + 1))) {
+        close(fd);
+        return NULL;
+    }
 
-    if ((data = mmap(0, stat_buf.st_size, PROT_READ, MAP_SHARED,
-                     fd, 0)) == (void *) -1) goto done;
+    while (len < (size_t) stat_buf.st_size) {
+        ret = read(fd, buf + len, stat_buf.st_size - len);
+        if (ret == -1 && errno == EINTR) continue;
+        if (ret <= 0) break;
+        len += ret;
+    }
 
-    /*
-     * create a sysmem copy of the buffer, so that we can explicitly
-     * NULL terminate it
-     */
+    close(fd);
+    buf[len] = '\0';
 
-    buf = malloc(stat_buf.st_size + 1);
+    return buf;
 
-    if (!buf) goto done;
+} /* read_file() */
 
-    memcpy(buf, data, stat_buf.st_size);
-    buf[stat_buf.st_size] = '\0';
 
-    /* search for the keyword */
 
-    start = buf;
+/*
+ * parse_shell_value() - parse the shell word at *s, removing quotes
+ * and backslash escapes the way the shell would; the result is
+ * written over the input, which it is never longer than.  Returns
+ * the start of the value and advances *s past the end of the word;
+ * the character found there is returned in *end, as it may have been
+ * overwritten by the value's terminating NUL.
+ */
 
-    while (TRUE) {
-        tmp = strstr(start, keyword);
-        if (!tmp) goto done;
+static char *parse_shell_value(char **s, char *end)
+{
+    char *in = *s, *out = *s, *value = *s;
+    char quote = '\0';
+
+    while (*in) {
+        if (quote == '\'') {
+            if (*in == '\'') quote = '\0';
+            else *out++ = *in;
+            in++;
+        } else if (*in == '\\') {
+            in++;
+            if (*in == '\n') {
+                in++;                   /* line continuation */
+            } else if (*in && (!quote || strchr("$`\"\\", *in))) {
+                *out++ = *in++;
+            } else {
+                *out++ = '\\';
+            }
+        } else if (quote == '"') {
+            if (*in == '"') quote = '\0';
+            else *out++ = *in;
+            in++;
+        } else if (*in == '"' || *in == '\'') {
+            quote = *in++;
+        } else if (*in == ' ' || *in == '\t' || *in == '\n' ||
+                   *in == ';') {
+            /* '#' is not at the start of a word here, so not a comment */
+            break;
+        } else {
+            *out++ = *in++;
+        }
+    }
 
-        /*
-         * make sure this line is not commented out: search back from
-         * tmp: if we hit a "#" before a newline, then this line is
-         * commented out and we should search again
-         */
+    *s = in;
+    *end = *in;
+    *out = '\0';
+
+    return value;
+
+} /* parse_shell_value() */
+
+
+
+/*
+ * get_shell_var() - return the value of the named variable, or NULL.
+ */
+
+static const char *get_shell_var(ShellVarPtr vars, const char *name)
+{
+    for (; vars; vars = vars->next) {
+        if (strcmp(vars->name, name) == 0) return vars->value;
+    }
+    return NULL;
+
+} /* get_shell_var() */
+
+
+
+/*
+ * set_shell_var() - assign value to the named variable, appending it
+ * to the list if it is not there yet; returns FALSE if out of memory.
+ */
+
+static int set_shell_var(ShellVarPtr *vars, const char *name,
+                         const char *value)
+{
+    ShellVarPtr *pVar, var;
+    char *copy;
+
+    for (pVar = vars; (var = *pVar); pVar = &var->next) {
+        if (strcmp(var->name, name) == 0) break;
+    }
+
+    if (!var) {
+        var = calloc(1, sizeof(ShellVarRec));
+        if (!var || !(var->name = strdup(name))) {
+            free(var);
+            return FALSE;
+        }
+        *pVar = var;
+    }
+
+    if (!(copy = strdup(value))) return FALSE;
+
+    free(var->value);
+    var->value = copy;
+
+    return TRUE;
+
+} /* set_shell_var() */
+
+
+
+static void free_shell_vars(ShellVarPtr vars)
+{
+    ShellVarPtr next;
+
+    for (; vars; vars = next) {
+        next = vars->next;
+        free(vars->name);
+        free(vars->value);
+        free(vars);
+    }
+
+} /* free_shell_vars() */
 
-        c = tmp;
-        while ((c >= start) && (*c != '\n') && (*c != '#')) c--;
 
-        if (*c == '#') {
-            /* keyword was commented out... search again */
-            start = tmp+1;
+
+/*
+ * skip_shell_command() - return the start of the command after the one
+ * at s: past the next ';' or newline that is not quoted, escaped or in
+ * a comment, or the end of the string.
+ */
+
+static char *skip_shell_command(char *s)
+{
+    int wordStart = TRUE;
+
+    while (*s) {
+        if (*s == '\\') {
+            if (*++s) s++;
+        } else if (*s == '\'') {
+            for (s++; *s && *s != '\''; s++);
+            if (*s) s++;
+        } else if (*s == '"') {
+            for (s++; *s && *s != '"'; s++) {
+                if (*s == '\\' && s[1]) s++;
+            }
+            if (*s) s++;
+        } else if (*s == '#' && wordStart) {
+            s += strcspn(s, "\n");
+        } else if (*s == ';' || *s == '\n') {
+            return s + 1;
         } else {
-            /* keyword is not commented out */
-            break;
+            wordStart = (*s == ' ' || *s == '\t');
+            s++;
+            continue;
         }
+        wordStart = FALSE;
     }
 
-    start = tmp + strlen(keyword);
-    end = strchr(start, '\n');
-    if (!end) goto done;
+    return s;
 
-    /* there must be something between the start and the end */
+} /* skip_shell_command() */
 
-    if (start == end) goto done;
 
-    /* take what is between as the value */
 
-    len = end - start;
-    value = xconfigAlloc(len + 1);
-    strncpy(value, start, len);
-    value[len] = '\0';
+/*
+ * parse_shell_vars() - parse the NAME=value assignments in buf, which
+ * is modified in the process; as in the shell, a later assignment to
+ * a variable replaces an earlier one.  Commands may be separated by
+ * newlines or ';'; comments and commands other than assignments are
+ * skipped.
+ */
 
-    /* if the first and last characters are quotation marks, remove them */
+static ShellVarPtr parse_shell_vars(char *buf)
+{
+    ShellVarPtr vars = NULL;
+    char *s = buf, *name, *value, *eol, end;
+    size_t nameLen;
 
-    if ((value[0] == '\"') && (value[len-1] == '\"')) {
-        tmp = xconfigAlloc(len - 1);
-        strncpy(tmp, value + 1, len - 2);
-        tmp[len-2] = '\0';
-        free(value);
-        value = tmp;
+    while (*s) {
+
+        while (*s == ' ' || *s == '\t') s++;
+
+        if (strncmp(s, "export", 6) == 0 && (s[6] == ' ' || s[6] == '\t')) {
+            s += 6;
+            while (*s == ' ' || *s == '\t') s++;
+        }
+
+        name = s;
+        while (*s == '_' || isalnum((unsigned char) *s)) s++;
+        nameLen = s - name;
+
+        if (nameLen && !isdigit((unsigned char) *name) && *s == '=') {
+            s++;
+            eol = s;
+            value = parse_shell_value(&eol, &end);
+            name[nameLen] = '\0';
+
+            if (!set_shell_var(&vars, name, value)) break;
+
+            /* the value may have spanned lines; resume after it */
+            *eol = end;
+            s = eol;
+        }
+
+        s = skip_shell_command(s);
     }
 
- done:
+    return vars;
+
+} /* parse_shell_vars() */
+
 
-    if (buf) free(buf);
-    if (data) munmap(data, stat_buf.st_size);
-    if (fd != -1) close(fd);
+
+/*
+ * find_config_entry() - look up the shell variable 'name' in the
+ * specified file; returns a copy of its value, or NULL if the file
+ * cannot be read or the variable is not set or empty.
+ */
+
+static char *find_config_entry(const char *filename, const char *name)
+{
+    ShellVarFilePtr file;
+    const char *var;
+    char *value = NULL;
+
+    pthread_mutex_lock(&shellVarLock);
+
+    for (file = shellVarFiles; file; file = file->next) {
+        if (strcmp(file->filename, filename) == 0) break;
+    }
+
+    if (!file) {
+        file = calloc(1, sizeof(ShellVarFileRec));
+        if (file && (file->filename = strdup(filename))) {
+            char *buf = read_file(filename);
+            if (buf) {
+                file->vars = parse_shell_vars(buf);
+                free(buf);
+            }
+            file->next = shellVarFiles;
+            shellVarFiles = file;
+        } else {
+            free(file);
+            file = NULL;
+        }
+    }
+
+    var = file ? get_shell_var(file->vars, name) : NULL;
+    if (var && var[0]) {
+        value = xconfigStrdup(var);
+    }
+
+    pthread_mutex_unlock(&shellVarLock);
 
     return value;
 
@@ -869,6 +1233,258 @@ static char *find_config_entry(const char *filename, const char *keyword)
 
 
 
+/*
+ * pkg-config files.
+ *
+ * Rather than running pkg-config, a package's .pc file can be read
+ * directly: find_pkgconfig_file() searches the directories that
+ * pkg-config would, and read_pkgconfig_variable() evaluates the
+ * variable definitions (name=value lines) in the file.  As in
+ * pkg-config, ${name} expands to a variable defined earlier in the
+ * file (or to ${pcfiledir}, the directory the file is in, or
+ * ${pc_sysrootdir}) and "$$" to a literal '$'.
+ *
+ * If $PKG_CONFIG_SYSROOT_DIR is set, absolute paths in the values are
+ * taken to be relative to it, as pkgconf does, unless they already
+ * start with it.
+ */
+
+#define PKGCONFIG_DEFAULT_PATH \
+    "/usr/local/lib/pkgconfig:/usr/local/share/pkgconfig:" \
+    "/usr/lib64/pkgconfig:/usr/lib/pkgconfig:/usr/share/pkgconfig:" \
+    "/usr/local/libdata/pkgconfig:/usr/libdata/pkgconfig:" \
+    "/usr/X11R6/lib/pkgconfig"
+
+/* multiarch directories, searched if the package is not found above */
+#define PKGCONFIG_MULTIARCH_GLOB "/usr/lib/*-*/pkgconfig"
+
+
+
+/*
+ * expand_pkgconfig_value() - expand the variable references in value;
+ * returns NULL if it refers to an undefined variable.
+ */
+
+static char *expand_pkgconfig_value(ShellVarPtr vars, const char *value)
+{
+    char *result = xconfigStrdup(""), *tmp, *name;
+    const char *s, *end, *var;
+
+    for (s = value; *s; s = end) {
+        if (s[0] == '$' && s[1] == '$') {
+            var = "$";
+            end = s + 2;
+        } else if (s[0] == '$' && s[1] == '{' &&
+                   (end = strchr(s + 2, '}')) != NULL) {
+            name = xconfigStrdup(s + 2);
+            name[end - (s + 2)] = '\0';
+            var = get_shell_var(vars, name);
+            xconfigFree(name);
+            if (!var) {
+                xconfigFree(result);
+                return NULL;
+            }
+            end++;
+        } else {
+            /* copy up to the next '$' */
+            for (end = s + 1; *end && *end != '$'; end++);
+            name = xconfigStrdup(s);
+            name[end - s] = '\0';
+            tmp = xconfigStrcat(result, name, NULL);
+            xconfigFree(name);
+            xconfigFree(result);
+            result = tmp;
+            continue;
+        }
+
+        tmp = xconfigStrcat(result, var, NULL);
+        xconfigFree(result);
+        result = tmp;
+    }
+
+    return result;
+
+} /* expand_pkgconfig_value() */
+
+
+
+/*
+ * read_pkgconfig_variable() - evaluate the given .pc file and return
+ * the value of the variable, or NULL if the file cannot be read or
+ * does not define the variable.
+ */
+
+static char *read_pkgconfig_variable(const char *filename,
+                                     const char *variable)
+{
+    const char *sysroot = getenv("PKG_CONFIG_SYSROOT_DIR");
+    ShellVarPtr vars = NULL;
+    char *buf, *line, *next, *s, *name, *value, *result = NULL;
+    size_t len;
+
+    if (sysroot && (sysroot[0] == '\0' || strcmp(sysroot, "/") == 0)) {
+        sysroot = NULL;
+    }
+
+    if (!(buf = read_file(filename))) return NULL;
+
+    /*
+     * pkg-config predefines the directory holding the .pc file, and
+     * the sysroot
+     */
+
+    value = xconfigStrdup(filename);
+    if ((s = strrchr(value, '/'))) *s = '\0';
+    set_shell_var(&vars, "pcfiledir", value);
+    xconfigFree(value);
+
+    set_shell_var(&vars, "pc_sysrootdir", sysroot ? sysroot : "/");
+
+    for (line = buf; line; line = next) {
+
+        next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+
+        /* strip comments and surrounding whitespace */
+
+        if ((s = strchr(line, '#'))) *s = '\0';
+        while (isspace((unsigned char) *line)) line++;
+        s = line + strlen(line);
+        while (s > line && isspace((unsigned char) s[-1])) *--s = '\0';
+
+        /* only variable definitions matter here, not "Field: value" */
+
+        for (s = line; *s == '_' || *s == '.' || isalnum((unsigned char) *s);
+             s++);
+        name = s;
+        while (*s == ' ' || *s == '\t') s++;
+        if (name == line || *s != '=') continue;
+
+        *name = '\0';
+        s++;
+        while (isspace((unsigned char) *s)) s++;
+
+        value = expand_pkgconfig_value(vars, s);
+        if (!value || !set_shell_var(&vars, line, value)) {
+            xconfigFree(value);
+            break;
+        }
+        xconfigFree(value);
+    }
+
+    if ((value = (char *) get_shell_var(vars, variable)) != NULL) {
+        len = sysroot ? strlen(sysroot) : 0;
+        if (sysroot && value[0] == '/' &&
+            !(strncmp(value, sysroot, len) == 0 &&
+              (value[len] == '/' || value[len] == '\0'))) {
+            result = xconfigStrcat(sysroot, value, NULL);
+        } else {
+            result = xconfigStrdup(value);
+        }
+    }
+
+    free_shell_vars(vars);
+    free(buf);
+
+    return result;
+
+} /* read_pkgconfig_variable() */
+
+
+
+/*
+ * find_pkgconfig_file() - find the named package's .pc file, searching
+ * $PKG_CONFIG_PATH, then $PKG_CONFIG_LIBDIR or the default pkg-config
+ * directories; as in pkg-config, the first file found is the one used.
+ * Returns its path, with its stat(2) information in stat_buf, or NULL.
+ */
+
+static char *find_pkgconfig_file(const char *package, struct stat *stat_buf)
+{
+    const char *envPath = getenv("PKG_CONFIG_PATH");
+    const char *envLibdir = getenv("PKG_CONFIG_LIBDIR");
+    char *path, *dir, *save = NULL, *filename, *found = NULL;
+    glob_t g;
+    size_t i;
+
+    path = xconfigStrcat(envPath ? envPath : "", ":",
+                         envLibdir ? envLibdir : PKGCONFIG_DEFAULT_PATH,
+                         NULL);
+
+    for (dir = strtok_r(path, ":", &save); dir && !found;
+         dir = strtok_r(NULL, ":", &save)) {
+        filename = xconfigStrcat(dir, "/", package, ".pc", NULL);
+        if ((stat(filename, stat_buf) == 0) && S_ISREG(stat_buf->st_mode)) {
+            found = filename;
+        } else {
+            xconfigFree(filename);
+        }
+    }
+    xconfigFree(path);
+
+    if (!found && !envLibdir &&
+        (glob(PKGCONFIG_MULTIARCH_GLOB, 0, NULL, &g) == 0)) {
+        for (i = 0; i < g.gl_pathc && !found; i++) {
+            filename = xconfigStrcat(g.gl_pathv[i], "/", package, ".pc",
+                                     NULL);
+            if ((stat(filename, stat_buf) == 0) &&
+                S_ISREG(stat_buf->st_mode)) {
+                found = filename;
+            } else {
+                xconfigFree(filename);
+            }
+        }
+        globfree(&g);
+    }
+
+    return found;
+
+} /* find_pkgconfig_file() */
+
+
+
+/*
+ * pkgconfig_stamp() - describe what a variable read from the given .pc
+ * file (NULL if none was found) depends on: the file's path, inode,
+ * size and modification time, and the pkg-config environment that led
+ * to it and may change its values.
+ */
+
+static char *pkgconfig_stamp(const char *filename,
+                             const struct stat *stat_buf)
+{
+    static const char *envNames[] = {
+        "PKG_CONFIG_PATH", "PKG_CONFIG_LIBDIR", "PKG_CONFIG_SYSROOT_DIR",
+    };
+    char ids[96], *stamp, *tmp;
+    const char *env;
+    size_t i;
+
+    if (filename) {
+        snprintf(ids, sizeof(ids), "%lu:%lld:%lld.%09ld:",
+                 (unsigned long) stat_buf->st_ino,
+                 (long long) stat_buf->st_size,
+                 (long long) stat_buf->st_mtim.tv_sec,
+                 (long) stat_buf->st_mtim.tv_nsec);
+        stamp = xconfigStrcat(ids, filename, NULL);
+    } else {
+        stamp = xconfigStrdup("none");
+    }
+
+    for (i = 0; i < sizeof(envNames) / sizeof(envNames[0]); i++) {
+        if ((env = getenv(envNames[i])) != NULL) {
+            tmp = xconfigStrcat(stamp, ";", envNames[i], "=", env, NULL);
+            xconfigFree(stamp);
+            stamp = tmp;
+        }
+    }
+
+    return stamp;
+
+} /* pkgconfig_stamp() */
+
+
+
 /*
  * xconfigGeneratePrintPossibleMice() - print the mouse table to stdout
  */
@@ -931,9 +1547,9 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
     if (!entry) {
         char *protocol, *device, *emulate3;
 
-        device = find_config_entry("/etc/sysconfig/mouse", "DEVICE=");
-        protocol = find_config_entry("/etc/sysconfig/mouse", "XMOUSETYPE=");
-        emulate3 = find_config_entry("/etc/sysconfig/mouse", "XEMU3=");
+        device = find_config_entry("/etc/sysconfig/mouse", "DEVICE");
+        protocol = find_config_entry("/etc/sysconfig/mouse", "XMOUSETYPE");
+        emulate3 = find_config_entry("/etc/sysconfig/mouse", "XEMU3");
 
         if (device || protocol || emulate3) {
             entry = find_closest_mouse_entry(device, protocol, emulate3);
@@ -948,8 +1564,8 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
     if (!entry) {
         char *protocol, *device;
 
-        protocol = find_config_entry("/etc/conf.d/gpm", "MOUSE=");
-        device = find_config_entry("/etc/conf.d/gpm", "MOUSEDEV=");
+        protocol = find_config_entry("/etc/conf.d/gpm", "MOUSE");
+        device = find_config_entry("/etc/conf.d/gpm", "MOUSEDEV");
 
         if (protocol && device) {
             MouseEntry *e = xconfigAlloc(sizeof(MouseEntry));
@@ -1022,6 +1638,7 @@ int xconfigAddMouse(GenerateOptions *gop, XConfigPtr config)
 
     input->next = config->inputs;
     config->inputs = input;
+    xconfigIndexAdd(config, XCONFIG_INDEX_INPUT, input, TRUE);
 
     return TRUE;
 
@@ -1208,10 +1825,10 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
      */
 
     if (!entry) {
-        value = find_config_entry("/etc/sysconfig/keyboard", "KEYTABLE=");
+        value = find_config_entry("/etc/sysconfig/keyboard", "KEYTABLE");
         entry = find_keyboard_entry(value);
         if (value) {
-            free(value);
+            xconfigFree(value);
         }
         if (entry) {
             comment = "data in \"/etc/sysconfig/keyboard\"";
@@ -1268,6 +1885,7 @@ int xconfigAddKeyboard(GenerateOptions *gop, XConfigPtr config)
 
     input->next = config->inputs;
     config->inputs = input;
+    xconfigIndexAdd(config, XCONFIG_INDEX_INPUT, input, TRUE);
 
     return TRUE;
 
@@ -1423,6 +2041,247 @@ static int get_xserver_information(const char *versionString,
 #endif
 
 
+/*
+ * X server probe cache.
+ *
+ * Running `X -version` costs a fork and an exec of the X server, so
+ * the information inferred from it can be kept in
+ * gop->xserver_cache_file as shell variable assignments, along with
+ * the X libdir found through pkg-config.  Like the GPU cache, it is
+ * only used when a file is given ('--xserver-cache-file'), so that a
+ * plain run never writes outside of the X config file.  Each group
+ * of values has a stamp of what it was derived from: XSERVER_STAMP
+ * holds the path, inode, size and modification time of the X binary
+ * the probe ran, and LIBDIR_STAMP those of the xorg-server.pc file
+ * and the pkg-config environment (see pkgconfig_stamp()).  A group
+ * whose stamp no longer matches is ignored, and rewritten without
+ * disturbing the other groups.
+ */
+
+/*
+ * xserver_cache_stamp() - find the X binary that `X -version` would
+ * run, searching the same PATH, and describe its identity; returns
+ * NULL if there is no X binary.
+ */
+
+static char *xserver_cache_stamp(GenerateOptions *gop)
+{
+    const char *envPath = getenv("PATH");
+    char *path, *dir, *save = NULL, *bin, *resolved = NULL, *stamp = NULL;
+    struct stat stat_buf;
+
+    path = xconfigStrcat(gop->x_project_root, ":", EXTRA_PATH, ":",
+                         envPath ? envPath : "", NULL);
+
+    for (dir = strtok_r(path, ":", &save); dir && !resolved;
+         dir = strtok_r(NULL, ":", &save)) {
+        bin = xconfigStrcat(dir, "/", XSERVER_BIN_NAME, NULL);
+        if ((stat(bin, &stat_buf) == 0) && S_ISREG(stat_buf.st_mode) &&
+            (access(bin, X_OK) == 0)) {
+            resolved = realpath(bin, NULL);
+        }
+        xconfigFree(bin);
+    }
+    xconfigFree(path);
+
+    if (resolved && (stat(resolved, &stat_buf) == 0)) {
+        char ids[96];
+        snprintf(ids, sizeof(ids), "%lu:%lld:%lld.%09ld:",
+                 (unsigned long) stat_buf.st_ino,
+                 (long long) stat_buf.st_size,
+                 (long long) stat_buf.st_mtim.tv_sec,
+                 (long) stat_buf.st_mtim.tv_nsec);
+        stamp = xconfigStrcat(ids, resolved, NULL);
+    }
+    free(resolved);
+
+    return stamp;
+
+} /* xserver_cache_stamp() */
+
+
+
+/*
+ * load_xserver_cache() - read the cache file; returns its variables,
+ * or NULL if there is no cache file.
+ */
+
+static ShellVarPtr load_xserver_cache(const char *filename)
+{
+    ShellVarPtr vars;
+    char *buf;
+
+    if (!filename || !(buf = read_file(filename))) return NULL;
+
+    vars = parse_shell_vars(buf);
+    free(buf);
+
+    return vars;
+
+} /* load_xserver_cache() */
+
+
+
+/*
+ * cache_stamp_matches() - whether the values stamped by the variable
+ * stampName were cached for the given stamp.
+ */
+
+static int cache_stamp_matches(ShellVarPtr vars, const char *stampName,
+                               const char *stamp)
+{
+    const char *cached = get_shell_var(vars, stampName);
+
+    return stamp && cached && (strcmp(cached, stamp) == 0);
+
+} /* cache_stamp_matches() */
+
+
+
+/*
+ * write_quoted() - write s as a single quoted shell word.
+ */
+
+static void write_quoted(FILE *stream, const char *s)
+{
+    fputc('\'', stream);
+    for (; *s; s++) {
+        if (*s == '\'') fputs("'\\''", stream);
+        else fputc(*s, stream);
+    }
+    fputc('\'', stream);
+
+} /* write_quoted() */
+
+
+
+/*
+ * save_xserver_cache() - replace the cache file with the variables
+ * in vars.  The cache is only an optimization, so failures are
+ * silently ignored; the file is written under a temporary name and
+ * renamed into place, so that readers never see a partial file.
+ */
+
+static void save_xserver_cache(const char *filename, ShellVarPtr vars)
+{
+    char *tmpname, *slash;
+    FILE *stream;
+    int fd;
+
+    /* create the directory holding the cache, if needed */
+
+    slash = strrchr(filename, '/');
+    if (slash && slash != filename) {
+        char *dir = xconfigStrdup(filename);
+        dir[slash - filename] = '\0';
+        mkdir(dir, 0755);
+        xconfigFree(dir);
+    }
+
+    tmpname = xconfigStrcat(filename, ".XXXXXX", NULL);
+
+    if ((fd = mkstemp(tmpname)) == -1) goto done;
+
+    if (!(stream = fdopen(fd, "w"))) {
+        close(fd);
+        unlink(tmpname);
+        goto done;
+    }
+
+    fprintf(stream, "# X server information cached by nvidia-xconfig; "
+            "this file may be removed at any time\n");
+    for (; vars; vars = vars->next) {
+        fprintf(stream, "%s=", vars->name);
+        write_quoted(stream, vars->value);
+        fputc('\n', stream);
+    }
+
+    if ((fclose(stream) != 0) || (chmod(tmpname, 0644) != 0) ||
+        (rename(tmpname, filename) != 0)) {
+        unlink(tmpname);
+    }
+
+ done:
+    xconfigFree(tmpname);
+
+} /* save_xserver_cache() */
+
+
+
+/*
+ * get_cached_xserver_value() - return a copy of the named value from
+ * the X server cache, or NULL if it is not cached, or was cached under
+ * a stampName other than stamp.
+ */
+
+static char *get_cached_xserver_value(GenerateOptions *gop,
+                                      const char *stampName,
+                                      const char *stamp, const char *name)
+{
+    ShellVarPtr cache = load_xserver_cache(gop->xserver_cache_file);
+    const char *value;
+    char *ret = NULL;
+
+    if (cache_stamp_matches(cache, stampName, stamp) &&
+        (value = get_shell_var(cache, name)) != NULL) {
+        ret = xconfigStrdup(value);
+    }
+
+    free_shell_vars(cache);
+
+    return ret;
+
+} /* get_cached_xserver_value() */
+
+
+
+/*
+ * set_cached_xserver_value() - cache the named value, stamped with
+ * stamp in the variable stampName, keeping everything else in the
+ * cache.
+ */
+
+static void set_cached_xserver_value(GenerateOptions *gop,
+                                     const char *stampName,
+                                     const char *stamp, const char *name,
+                                     const char *value)
+{
+    ShellVarPtr cache;
+
+    if (!gop->xserver_cache_file) return;
+
+    cache = load_xserver_cache(gop->xserver_cache_file);
+
+    if (set_shell_var(&cache, stampName, stamp) &&
+        set_shell_var(&cache, name, value)) {
+        save_xserver_cache(gop->xserver_cache_file, cache);
+    }
+
+    free_shell_vars(cache);
+
+} /* set_cached_xserver_value() */
+
+
+
+/*
+ * get_cached_bool() - look up the named "0"/"1" variable; returns
+ * FALSE if it is missing or malformed.
+ */
+
+static int get_cached_bool(ShellVarPtr vars, const char *name, int *value)
+{
+    const char *s = get_shell_var(vars, name);
+
+    if (!s || (s[0] != '0' && s[0] != '1') || s[1] != '\0') return FALSE;
+
+    *value = (s[0] == '1');
+
+    return TRUE;
+
+} /* get_cached_bool() */
+
+
+
 void xconfigGetXServerInUse(GenerateOptions *gop)
 {
     FILE *stream = NULL;
@@ -1430,6 +2289,35 @@ void xconfigGetXServerInUse(GenerateOptions *gop)
     int isXorg;
     int len, found;
     char *cmd, *ptr, *ret;
+    char *stamp = NULL;
+    ShellVarPtr cache = NULL;
+
+    gop->supports_extension_section = FALSE;
+    gop->autoloads_glx = FALSE;
+    gop->xinerama_plus_composite_works = FALSE;
+
+    /*
+     * use the results of an earlier probe of the same X binary; the
+     * rest of the cache is kept when the probe results are replaced
+     */
+
+    if (gop->xserver_cache_file) {
+        stamp = xserver_cache_stamp(gop);
+        cache = load_xserver_cache(gop->xserver_cache_file);
+    }
+
+    if (cache_stamp_matches(cache, "XSERVER_STAMP", stamp) &&
+        get_cached_bool(cache, "IS_XORG", &isXorg) &&
+        get_cached_bool(cache, "AUTOLOADS_GLX", &gop->autoloads_glx) &&
+        get_cached_bool(cache, "SUPPORTS_EXTENSION_SECTION",
+                        &gop->supports_extension_section) &&
+        get_cached_bool(cache, "XINERAMA_PLUS_COMPOSITE_WORKS",
+                        &gop->xinerama_plus_composite_works)) {
+        gop->xserver = isXorg ? X_IS_XORG : X_IS_XF86;
+        free_shell_vars(cache);
+        xconfigFree(stamp);
+        return;
+    }
 
     gop->supports_extension_section = FALSE;
     gop->autoloads_glx = FALSE;
@@ -1471,13 +2359,29 @@ void xconfigGetXServerInUse(GenerateOptions *gop)
             } else {
                 xserver = X_IS_XF86;
             }
+
+            if (stamp &&
+                set_shell_var(&cache, "XSERVER_STAMP", stamp) &&
+                set_shell_var(&cache, "IS_XORG", isXorg ? "1" : "0") &&
+                set_shell_var(&cache, "AUTOLOADS_GLX",
+                              gop->autoloads_glx ? "1" : "0") &&
+                set_shell_var(&cache, "SUPPORTS_EXTENSION_SECTION",
+                              gop->supports_extension_section ? "1" : "0") &&
+                set_shell_var(&cache, "XINERAMA_PLUS_COMPOSITE_WORKS",
+                              gop->xinerama_plus_composite_works ?
+                              "1" : "0")) {
+                save_xserver_cache(gop->xserver_cache_file, cache);
+            }
         } else {
             xconfigErrorMsg(WarnMsg, "Unable to parse X.Org version string.");
         }
+
+        /* Close the popen()'ed stream. */
+        pclose(stream);
     }
-    /* Close the popen()'ed stream. */
-    pclose(stream);
-    free(cmd);
+    xconfigFree(cmd);
+    free_shell_vars(cache);
+    xconfigFree(stamp);
 
     if (xserver == -1) {
         char *xorgpath;
@@ -1488,7 +2392,7 @@ void xconfigGetXServerInUse(GenerateOptions *gop)
         } else {
             xserver = X_IS_XF86;
         }
-        free(xorgpath);
+        xconfigFree(xorgpath);
     }
 
     gop->xserver=xserver;
@@ -1507,6 +2411,7 @@ void xconfigGenerateLoadDefaultOptions(GenerateOptions *gop)
     memset(gop, 0, sizeof(GenerateOptions));
 
     gop->x_project_root = xconfigGetDefaultProjectRoot();
+    gop->proc_root = PROC_ROOT;
 
     /* XXX What to default the following to?
        gop->xserver
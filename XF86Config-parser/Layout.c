@@ -60,7 +60,6 @@
 #include "Configint.h"
 #include <string.h>
 
-extern LexRec val;
 
 static XConfigSymTabRec LayoutTab[] =
 {
@@ -91,38 +90,41 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName);
 #define CLEANUP xconfigFreeLayoutList
 
 XConfigLayoutPtr
-xconfigParseLayoutSection (void)
+xconfigParseLayoutSection (XConfigParserPtr parser)
 {
     int has_ident = FALSE;
+    GenericListPtr inactivesTail = NULL, adjacenciesTail = NULL;
+    GenericListPtr inputsTail = NULL;
     int token;
     PARSE_PROLOGUE (XConfigLayoutPtr, XConfigLayoutRec)
 
-    while ((token = xconfigGetToken (LayoutTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, LayoutTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = parser->val.str;
             has_ident = TRUE;
             break;
         case INACTIVE:
             {
                 XConfigInactivePtr iptr;
 
-                iptr = calloc (1, sizeof (XConfigInactiveRec));
+                iptr = xconfigAlloc(sizeof (XConfigInactiveRec));
                 iptr->next = NULL;
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                     Error (INACTIVE_MSG, NULL);
-                iptr->device_name = val.str;
-                xconfigAddListItem((GenericListPtr *)(&ptr->inactives),
-                                   (GenericListPtr) iptr);
+                iptr->device_name = parser->val.str;
+                xconfigAppendListItem((GenericListPtr *)(&ptr->inactives),
+                                      &inactivesTail, (GenericListPtr) iptr);
             }
             break;
         case SCREEN:
@@ -130,23 +132,25 @@ xconfigParseLayoutSection (void)
                 XConfigAdjacencyPtr aptr;
                 int absKeyword = 0;
 
-                aptr = calloc (1, sizeof (XConfigAdjacencyRec));
+                aptr = xconfigAlloc(sizeof (XConfigAdjacencyRec));
                 aptr->next = NULL;
                 aptr->scrnum = -1;
                 aptr->where = CONF_ADJ_OBSOLETE;
                 aptr->x = 0;
                 aptr->y = 0;
                 aptr->refscreen = NULL;
-                if ((token = xconfigGetSubToken (&(ptr->comment))) == NUMBER)
-                    aptr->scrnum = val.num;
+                if ((token = xconfigGetSubToken (parser,
+                                                 &(ptr->comment))) == NUMBER)
+                    aptr->scrnum = parser->val.num;
                 else
-                    xconfigUnGetToken (token);
-                token = xconfigGetSubToken(&(ptr->comment));
+                    xconfigUnGetToken (parser, token);
+                token = xconfigGetSubToken(parser, &(ptr->comment));
                 if (token != STRING)
                     Error (SCREEN_MSG, NULL);
-                aptr->screen_name = val.str;
+                aptr->screen_name = parser->val.str;
 
-                token = xconfigGetSubTokenWithTab(&(ptr->comment), AdjTab);
+                token = xconfigGetSubTokenWithTab(parser, &(ptr->comment),
+                                                  AdjTab);
                 switch (token)
                 {
                 case RIGHTOF:
@@ -172,8 +176,8 @@ xconfigParseLayoutSection (void)
                     Error (UNEXPECTED_EOF_MSG, NULL);
                     break;
                 default:
-                    xconfigUnGetToken (token);
-                    token = xconfigGetSubToken(&(ptr->comment));
+                    xconfigUnGetToken (parser, token);
+                    token = xconfigGetSubToken(parser, &(ptr->comment));
                     if (token == STRING)
                         aptr->where = CONF_ADJ_OBSOLETE;
                     else
@@ -183,19 +187,19 @@ xconfigParseLayoutSection (void)
                 {
                 case CONF_ADJ_ABSOLUTE:
                     if (absKeyword) 
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        token = xconfigGetSubToken(parser, &(ptr->comment));
                     if (token == NUMBER)
                     {
-                        aptr->x = val.num;
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        aptr->x = parser->val.num;
+                        token = xconfigGetSubToken(parser, &(ptr->comment));
                         if (token != NUMBER)
                             Error(INVALID_SCR_MSG, NULL);
-                        aptr->y = val.num;
+                        aptr->y = parser->val.num;
                     } else {
                         if (absKeyword)
                             Error(INVALID_SCR_MSG, NULL);
                         else
-                            xconfigUnGetToken (token);
+                            xconfigUnGetToken (parser, token);
                     }
                     break;
                 case CONF_ADJ_RIGHTOF:
@@ -203,72 +207,73 @@ xconfigParseLayoutSection (void)
                 case CONF_ADJ_ABOVE:
                 case CONF_ADJ_BELOW:
                 case CONF_ADJ_RELATIVE:
-                    token = xconfigGetSubToken(&(ptr->comment));
+                    token = xconfigGetSubToken(parser, &(ptr->comment));
                     if (token != STRING)
                         Error(INVALID_SCR_MSG, NULL);
-                    aptr->refscreen = val.str;
+                    aptr->refscreen = parser->val.str;
                     if (aptr->where == CONF_ADJ_RELATIVE)
                     {
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        token = xconfigGetSubToken(parser, &(ptr->comment));
                         if (token != NUMBER)
                             Error(INVALID_SCR_MSG, NULL);
-                        aptr->x = val.num;
-                        token = xconfigGetSubToken(&(ptr->comment));
+                        aptr->x = parser->val.num;
+                        token = xconfigGetSubToken(parser, &(ptr->comment));
                         if (token != NUMBER)
                             Error(INVALID_SCR_MSG, NULL);
-                        aptr->y = val.num;
+                        aptr->y = parser->val.num;
                     }
                     break;
                 case CONF_ADJ_OBSOLETE:
                     /* top */
-                    aptr->top_name = val.str;
+                    aptr->top_name = parser->val.str;
 
                     /* bottom */
-                    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                    if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                         Error (SCREEN_MSG, NULL);
-                    aptr->bottom_name = val.str;
+                    aptr->bottom_name = parser->val.str;
 
                     /* left */
-                    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                    if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                         Error (SCREEN_MSG, NULL);
-                    aptr->left_name = val.str;
+                    aptr->left_name = parser->val.str;
 
                     /* right */
-                    if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                    if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                         Error (SCREEN_MSG, NULL);
-                    aptr->right_name = val.str;
+                    aptr->right_name = parser->val.str;
 
                 }
-                xconfigAddListItem((GenericListPtr *)(&ptr->adjacencies),
-                                   (GenericListPtr) aptr);
+                xconfigAppendListItem((GenericListPtr *)(&ptr->adjacencies),
+                                      &adjacenciesTail, (GenericListPtr) aptr);
             }
             break;
         case INPUTDEVICE:
             {
                 XConfigInputrefPtr iptr;
 
-                iptr = calloc (1, sizeof (XConfigInputrefRec));
+                iptr = xconfigAlloc(sizeof (XConfigInputrefRec));
                 iptr->next = NULL;
                 iptr->options = NULL;
-                if (xconfigGetSubToken(&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken(parser, &(ptr->comment)) != STRING)
                     Error (INPUTDEV_MSG, NULL);
-                iptr->input_name = val.str;
-                while ((token = xconfigGetSubToken(&(ptr->comment))) == STRING) {
-                    xconfigAddNewOption(&iptr->options, val.str, NULL);
+                iptr->input_name = parser->val.str;
+                while ((token = xconfigGetSubToken(parser,
+                                                   &(ptr->comment))) == STRING) {
+                    xconfigAddNewOption(&iptr->options, parser->val.str, NULL);
                 }
-                xconfigUnGetToken(token);
-                xconfigAddListItem((GenericListPtr *)(&ptr->inputs),
-                                   (GenericListPtr) iptr);
+                xconfigUnGetToken(parser, token);
+                xconfigAppendListItem((GenericListPtr *)(&ptr->inputs),
+                                      &inputsTail, (GenericListPtr) iptr);
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -370,7 +375,7 @@ xconfigFreeLayoutList (XConfigLayoutPtr *ptr)
         xconfigFreeInputrefList (&((*ptr)->inputs));
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -392,7 +397,7 @@ xconfigFreeAdjacencyList (XConfigAdjacencyPtr *ptr)
 
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 
 }
@@ -411,7 +416,7 @@ xconfigFreeInputrefList (XConfigInputrefPtr *ptr)
         xconfigFreeOptionList (&((*ptr)->options));
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 
 }
@@ -422,7 +427,7 @@ if (str[0] != '\0') \
 screen = xconfigFindScreen (str, p->conf_screen_lst); \
 if (!screen) \
 { \
-    xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_SCREEN_MSG, \
+    xconfigParserErrorMsg(parser, ValidationErrorMsg, UNDEFINED_SCREEN_MSG, \
                    str, layout->identifier); \
     return (FALSE); \
 } \
@@ -431,7 +436,7 @@ else \
 }
 
 int
-xconfigValidateLayout (XConfigPtr p)
+xconfigValidateLayout (XConfigParserPtr parser, XConfigPtr p)
 {
     XConfigLayoutPtr layout = p->layouts;
     XConfigAdjacencyPtr adj;
@@ -454,10 +459,12 @@ xconfigValidateLayout (XConfigPtr p)
         while (adj)
         {
             /* the first one can't be "" but all others can */
-            screen = xconfigFindScreen (adj->screen_name, p->screens);
+            screen = xconfigIndexFind (p, XCONFIG_INDEX_SCREEN,
+                                       adj->screen_name);
             if (!screen)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_SCREEN_MSG,
+                xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                      UNDEFINED_SCREEN_MSG,
                              adj->screen_name, layout->identifier);
                 return (FALSE);
             }
@@ -479,11 +486,12 @@ xconfigValidateLayout (XConfigPtr p)
         iptr = layout->inactives;
         while (iptr)
         {
-            device = xconfigFindDevice (iptr->device_name,
-                                     p->devices);
+            device = xconfigIndexFind (p, XCONFIG_INDEX_DEVICE,
+                                       iptr->device_name);
             if (!device)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DEVICE_MSG,
+                xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                      UNDEFINED_DEVICE_MSG,
                              iptr->device_name, layout->identifier);
                 return (FALSE);
             }
@@ -501,11 +509,12 @@ xconfigValidateLayout (XConfigPtr p)
         inputRef = layout->inputs;
         while (inputRef)
         {
-            input = xconfigFindInput (inputRef->input_name,
-                                   p->inputs);
+            input = xconfigIndexFind (p, XCONFIG_INDEX_INPUT,
+                                      inputRef->input_name);
             if (!input)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_INPUT_MSG,
+                xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                      UNDEFINED_INPUT_MSG,
                              inputRef->input_name, layout->identifier);
                 return (FALSE);
             }
@@ -574,7 +583,7 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName)
      */
     
     if (screenName) {
-        screen = xconfigFindScreen(screenName, config->screens);
+        screen = xconfigIndexFind(config, XCONFIG_INDEX_SCREEN, screenName);
         if (!screen) {
             xconfigErrorMsg(ErrorMsg, "No Screen section called \"%s\"\n",
                             screenName);
@@ -590,11 +599,11 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName)
     
     /* allocate the new layout section */
     
-    layout = calloc(1, sizeof(XConfigLayoutRec));
+    layout = xconfigAlloc(sizeof(XConfigLayoutRec));
     
     layout->identifier = xconfigStrdup("Default Layout");
     
-    adj = calloc(1, sizeof(XConfigAdjacencyRec));
+    adj = xconfigAlloc(sizeof(XConfigAdjacencyRec));
     adj->scrnum = -1;
     adj->screen = screen;
     adj->screen_name = xconfigStrdup(screen->identifier);
@@ -605,7 +614,7 @@ static int addImpliedLayout(XConfigPtr config, const char *screenName)
     
     /* validate the Layout here to setup all the pointers */
 
-    if (!xconfigValidateLayout(config)) return FALSE;
+    if (!xconfigValidateLayout(NULL, config)) return FALSE;
 
     return TRUE;
 }
@@ -55,12 +55,12 @@ static void xconfigAddRemovedOptionComment(char **existing_comments,
 
     if (value) {
         len = 32 + strlen(name) + strlen(value);
-        str = malloc(len);
+        str = xconfigAlloc(len);
         if (!str) return;
         snprintf(str, len, "# Removed Option \"%s\" \"%s\"", name, value);
     } else {
         len = 32 + strlen(name);
-        str = malloc(len);
+        str = xconfigAlloc(len);
         if (!str) return;
         snprintf(str, len, "# Removed Option \"%s\"", name);
     }
@@ -195,7 +195,7 @@ static int xconfigMergeFlags(XConfigPtr dstConfig, XConfigPtr srcConfig)
         /* Flag section was not found, create a new one */
         if (!dstConfig->flags) {
             dstConfig->flags =
-                (XConfigFlagsPtr) calloc(1, sizeof(XConfigFlagsRec));
+                (XConfigFlagsPtr) xconfigAlloc(sizeof(XConfigFlagsRec));
             if (!dstConfig->flags) return 0;
         }
         
@@ -228,12 +228,12 @@ static void xconfigMergeMonitors(XConfigMonitorPtr dstMonitor,
 
     /* Update vendor */
     
-    free(dstMonitor->vendor);
+    xconfigFree(dstMonitor->vendor);
     dstMonitor->vendor = xconfigStrdup(srcMonitor->vendor);
     
     /* Update modelname */
     
-    free(dstMonitor->modelname);
+    xconfigFree(dstMonitor->modelname);
     dstMonitor->modelname = xconfigStrdup(srcMonitor->modelname);
     
     /* Update horizontal sync */
@@ -271,6 +271,7 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     XConfigMonitorPtr dstMonitor;
     XConfigMonitorPtr srcMonitor;
+    GenericListPtr dstTail = NULL;
 
 
     /* Make sure all monitors in the src config are also in the dst config */
@@ -279,19 +280,21 @@ static int xconfigMergeAllMonitors(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcMonitor;
          srcMonitor = srcMonitor->next) {
 
-        dstMonitor =
-            xconfigFindMonitor(srcMonitor->identifier, dstConfig->monitors);
+        dstMonitor = xconfigIndexFind(dstConfig, XCONFIG_INDEX_MONITOR,
+                                      srcMonitor->identifier);
 
         /* Monitor section was not found, create a new one and add it */
         if (!dstMonitor) {
             dstMonitor =
-                (XConfigMonitorPtr) calloc(1, sizeof(XConfigMonitorRec));
+                (XConfigMonitorPtr) xconfigAlloc(sizeof(XConfigMonitorRec));
             if (!dstMonitor) return 0;
 
             dstMonitor->identifier = xconfigStrdup(srcMonitor->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->monitors),
-                               (GenericListPtr)dstMonitor);
+            xconfigAppendListItem((GenericListPtr *)(&dstConfig->monitors),
+                                  &dstTail, (GenericListPtr)dstMonitor);
+            xconfigIndexAdd(dstConfig, XCONFIG_INDEX_MONITOR, dstMonitor,
+                            FALSE);
         }
 
         /* Do the merge */
@@ -316,22 +319,22 @@ static void xconfigMergeDevices(XConfigDevicePtr dstDevice,
 
     /* Update driver */
     
-    free(dstDevice->driver);
+    xconfigFree(dstDevice->driver);
     dstDevice->driver = xconfigStrdup(srcDevice->driver);
     
     /* Update vendor */
     
-    free(dstDevice->vendor);
+    xconfigFree(dstDevice->vendor);
     dstDevice->vendor = xconfigStrdup(srcDevice->vendor);
     
     /* Update bus ID */
     
-    free(dstDevice->busid);
+    xconfigFree(dstDevice->busid);
     dstDevice->busid = xconfigStrdup(srcDevice->busid);
     
     /* Update board */
     
-    free(dstDevice->board);
+    xconfigFree(dstDevice->board);
     dstDevice->board = xconfigStrdup(srcDevice->board);
     
     /* Update chip info */
@@ -361,6 +364,7 @@ static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     XConfigDevicePtr dstDevice;
     XConfigDevicePtr srcDevice;
+    GenericListPtr dstTail = NULL;
 
 
     /* Make sure all monitors in the src config are also in the dst config */
@@ -369,19 +373,20 @@ static int xconfigMergeAllDevices(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcDevice;
          srcDevice = srcDevice->next) {
 
-        dstDevice =
-            xconfigFindDevice(srcDevice->identifier, dstConfig->devices);
+        dstDevice = xconfigIndexFind(dstConfig, XCONFIG_INDEX_DEVICE,
+                                     srcDevice->identifier);
         
         /* Device section was not found, create a new one and add it */
         if (!dstDevice) {
             dstDevice =
-                (XConfigDevicePtr) calloc(1, sizeof(XConfigDeviceRec));
+                (XConfigDevicePtr) xconfigAlloc(sizeof(XConfigDeviceRec));
             if (!dstDevice) return 0;
 
             dstDevice->identifier = xconfigStrdup(srcDevice->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->devices),
-                               (GenericListPtr)dstDevice);
+            xconfigAppendListItem((GenericListPtr *)(&dstConfig->devices),
+                                  &dstTail, (GenericListPtr)dstDevice);
+            xconfigIndexAdd(dstConfig, XCONFIG_INDEX_DEVICE, dstDevice, FALSE);
         }
 
         /* Do the merge */
@@ -467,6 +472,7 @@ static int xconfigMergeDisplays(XConfigScreenPtr dstScreen,
     XConfigDisplayPtr dstDisplay;
     XConfigDisplayPtr srcDisplay;
     XConfigModePtr srcMode, dstMode, lastDstMode;
+    GenericListPtr dstTail = NULL;
 
     /* Free all the displays in the destination screen */
 
@@ -524,8 +530,8 @@ static int xconfigMergeDisplays(XConfigScreenPtr dstScreen,
             srcMode = srcMode->next;
         }
 
-        xconfigAddListItem((GenericListPtr *)(&dstScreen->displays),
-                           (GenericListPtr)dstDisplay);
+        xconfigAppendListItem((GenericListPtr *)(&dstScreen->displays),
+                              &dstTail, (GenericListPtr)dstDisplay);
     }
 
     return 1;
@@ -549,18 +555,18 @@ static void xconfigMergeScreens(XConfigScreenPtr dstScreen,
 {
     /* Use the right device */
     
-    free(dstScreen->device_name);
+    xconfigFree(dstScreen->device_name);
     dstScreen->device_name = xconfigStrdup(srcScreen->device_name);
-    dstScreen->device =
-        xconfigFindDevice(dstScreen->device_name, dstConfig->devices);
+    dstScreen->device = xconfigIndexFind(dstConfig, XCONFIG_INDEX_DEVICE,
+                                         dstScreen->device_name);
     
 
     /* Use the right monitor */
     
-    free(dstScreen->monitor_name);
+    xconfigFree(dstScreen->monitor_name);
     dstScreen->monitor_name = xconfigStrdup(srcScreen->monitor_name);
-    dstScreen->monitor =
-        xconfigFindMonitor(dstScreen->monitor_name, dstConfig->monitors);
+    dstScreen->monitor = xconfigIndexFind(dstConfig, XCONFIG_INDEX_MONITOR,
+                                          dstScreen->monitor_name);
     
 
     /* Update the right default depth */
@@ -591,6 +597,7 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     XConfigScreenPtr srcScreen;
     XConfigScreenPtr dstScreen;
+    GenericListPtr dstTail = NULL;
 
 
     /* Make sure all src screens are in the dst config */
@@ -599,19 +606,20 @@ static int xconfigMergeAllScreens(XConfigPtr dstConfig, XConfigPtr srcConfig)
          srcScreen;
          srcScreen = srcScreen->next) {
 
-        dstScreen =
-            xconfigFindScreen(srcScreen->identifier, dstConfig->screens);
+        dstScreen = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                     srcScreen->identifier);
 
         /* Screen section was not found, create a new one and add it */
         if (!dstScreen) {
             dstScreen =
-                (XConfigScreenPtr) calloc(1, sizeof(XConfigScreenRec));
+                (XConfigScreenPtr) xconfigAlloc(sizeof(XConfigScreenRec));
             if (!dstScreen) return 0;
 
             dstScreen->identifier = xconfigStrdup(srcScreen->identifier);
 
-            xconfigAddListItem((GenericListPtr *)(&dstConfig->screens),
-                               (GenericListPtr)dstScreen);
+            xconfigAppendListItem((GenericListPtr *)(&dstConfig->screens),
+                                  &dstTail, (GenericListPtr)dstScreen);
+            xconfigIndexAdd(dstConfig, XCONFIG_INDEX_SCREEN, dstScreen, FALSE);
         }
 
         /* Do the merge */
@@ -655,7 +663,7 @@ static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
         /* Copy the adjacency */
         
         dstAdj =
-            (XConfigAdjacencyPtr) calloc(1, sizeof(XConfigAdjacencyRec));
+            (XConfigAdjacencyPtr) xconfigAlloc(sizeof(XConfigAdjacencyRec));
 
         dstAdj->scrnum = srcAdj->scrnum;
         dstAdj->screen_name = xconfigStrdup(srcAdj->screen_name);
@@ -668,16 +676,16 @@ static int xconfigMergeLayout(XConfigPtr dstConfig, XConfigPtr srcConfig)
         dstAdj->y = srcAdj->y;
         dstAdj->refscreen = xconfigStrdup(srcAdj->refscreen);
 
-        dstAdj->screen =
-            xconfigFindScreen(dstAdj->screen_name, dstConfig->screens);
-        dstAdj->top =
-            xconfigFindScreen(dstAdj->top_name, dstConfig->screens);
-        dstAdj->bottom =
-            xconfigFindScreen(dstAdj->bottom_name, dstConfig->screens);
-        dstAdj->left =
-            xconfigFindScreen(dstAdj->left_name, dstConfig->screens);
-        dstAdj->right =
-            xconfigFindScreen(dstAdj->right_name, dstConfig->screens);
+        dstAdj->screen = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                          dstAdj->screen_name);
+        dstAdj->top = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                       dstAdj->top_name);
+        dstAdj->bottom = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                          dstAdj->bottom_name);
+        dstAdj->left = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                        dstAdj->left_name);
+        dstAdj->right = xconfigIndexFind(dstConfig, XCONFIG_INDEX_SCREEN,
+                                         dstAdj->right_name);
 
         /* Add adjacency at the end of the list */
         
@@ -726,7 +734,7 @@ static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
         /* Extension section was not found, create a new one */
         if (!dstConfig->extensions) {
             dstConfig->extensions =
-                (XConfigExtensionsPtr) calloc(1, sizeof(XConfigExtensionsRec));
+                (XConfigExtensionsPtr) xconfigAlloc(sizeof(XConfigExtensionsRec));
             if (!dstConfig->extensions) return 0;
         }
 
@@ -754,8 +762,11 @@ static int  xconfigMergeExtensions(XConfigPtr dstConfig, XConfigPtr srcConfig)
  *       mostly, only new display configuration information should be
  *       copied from the source X config to the destination X config.
  *
+ *       Everything added to dstConfig is allocated from its arena, if
+ *       it has one.
+ *
  */
-int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
+static int mergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
 {
     /* Make sure the X config is valid */
     // make_xconfig_usable(dstConfig);
@@ -804,4 +815,22 @@ int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
 
     return 1;
 
+} /* mergeConfigs() */
+
+
+int xconfigMergeConfigs(XConfigPtr dstConfig, XConfigPtr srcConfig)
+{
+    XConfigArenaPtr prevArena = xconfigSetArena(dstConfig->arena);
+    int builtIndex = xconfigBuildNameIndex(dstConfig);
+    int ret;
+
+    ret = mergeConfigs(dstConfig, srcConfig);
+
+    if (builtIndex) {
+        xconfigDropNameIndex(dstConfig);
+    }
+    xconfigSetArena(prevArena);
+
+    return ret;
+
 } /* xconfigMergeConfigs() */
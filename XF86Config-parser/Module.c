@@ -59,7 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec SubModuleTab[] =
 {
@@ -81,7 +80,8 @@ static XConfigSymTabRec ModuleTab[] =
 #define CLEANUP xconfigFreeModules
 
 XConfigLoadPtr
-xconfigParseModuleSubSection (XConfigLoadPtr head, char *name)
+xconfigParseModuleSubSection (XConfigParserPtr parser, XConfigLoadPtr head,
+                              GenericListPtr *pTail, char *name)
 {
     int token;
     PARSE_PROLOGUE (XConfigLoadPtr, XConfigLoadRec)
@@ -91,76 +91,84 @@ xconfigParseModuleSubSection (XConfigLoadPtr head, char *name)
     ptr->opt  = NULL;
     ptr->next = NULL;
 
-    while ((token = xconfigGetToken (SubModuleTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (parser, SubModuleTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case OPTION:
-            ptr->opt = xconfigParseOption(ptr->opt);
+            ptr->opt = xconfigParserParseOption(parser, ptr->opt);
             break;
         case EOF_TOKEN:
-            xconfigErrorMsg(ParseErrorMsg, UNEXPECTED_EOF_MSG);
-            free(ptr);
+            xconfigParserErrorMsg(parser, ParseErrorMsg, UNEXPECTED_EOF_MSG);
+            xconfigFree(ptr);
             return NULL;
         default:
-            xconfigErrorMsg(ParseErrorMsg, INVALID_KEYWORD_MSG,
-                         xconfigTokenString());
-            free(ptr);
+            xconfigParserErrorMsg(parser, ParseErrorMsg, INVALID_KEYWORD_MSG,
+                         xconfigTokenString(parser));
+            xconfigFree(ptr);
             return NULL;
             break;
         }
 
     }
 
-    xconfigAddListItem((GenericListPtr *)(&head), (GenericListPtr)ptr);
+    xconfigAppendListItem((GenericListPtr *)(&head), pTail,
+                          (GenericListPtr)ptr);
     return head;
 }
 
 XConfigModulePtr
-xconfigParseModuleSection (void)
+xconfigParseModuleSection (XConfigParserPtr parser)
 {
     int token;
+    GenericListPtr loadsTail = NULL, disablesTail = NULL;
     PARSE_PROLOGUE (XConfigModulePtr, XConfigModuleRec)
 
-    while ((token = xconfigGetToken (ModuleTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, ModuleTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case LOAD:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Load");
-            xconfigAddNewLoadDirective (&ptr->loads, val.str,
-                                        XCONFIG_LOAD_MODULE, NULL, TRUE);
+            xconfigParserAddNewLoadDirective (parser, &ptr->loads,
+                                              &loadsTail, parser->val.str,
+                                              XCONFIG_LOAD_MODULE, NULL, TRUE);
             break;
         case LOAD_DRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "LoadDriver");
-            xconfigAddNewLoadDirective (&ptr->loads, val.str,
-                                        XCONFIG_LOAD_DRIVER, NULL, TRUE);
+            xconfigParserAddNewLoadDirective (parser, &ptr->loads,
+                                              &loadsTail, parser->val.str,
+                                              XCONFIG_LOAD_DRIVER, NULL, TRUE);
             break;
         case DISABLE:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Disable");
-            xconfigAddNewLoadDirective (&ptr->disables, val.str,
-                                        XCONFIG_DISABLE_MODULE, NULL, TRUE);
+            xconfigParserAddNewLoadDirective (parser, &ptr->disables,
+                                              &disablesTail, parser->val.str,
+                                              XCONFIG_DISABLE_MODULE, NULL, TRUE);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                         Error (QUOTE_MSG, "SubSection");
             ptr->loads =
-                xconfigParseModuleSubSection (ptr->loads, val.str);
+                xconfigParseModuleSubSection (parser, ptr->loads,
+                                              &loadsTail, parser->val.str);
             break;
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -231,27 +239,43 @@ xconfigPrintModuleSection (FILE * cf, XConfigModulePtr ptr)
 }
 
 void
-xconfigAddNewLoadDirective (XConfigLoadPtr *pHead, char *name, int type,
-                            XConfigOptionPtr opts, int do_token)
+xconfigParserAddNewLoadDirective (XConfigParserPtr parser,
+                                  XConfigLoadPtr *pHead, GenericListPtr *pTail,
+                                  char *name, int type,
+                                  XConfigOptionPtr opts, int do_token)
 {
     XConfigLoadPtr new;
     int token;
 
-    new = calloc (1, sizeof (XConfigLoadRec));
+    new = xconfigAlloc(sizeof (XConfigLoadRec));
     new->name = name;
     new->type = type;
     new->opt  = opts;
     new->next = NULL;
 
     if (do_token) {
-        if ((token = xconfigGetToken(NULL)) == COMMENT) {
-            new->comment = xconfigAddComment(new->comment, val.str);
+        if ((token = xconfigGetToken(parser, NULL)) == COMMENT) {
+            new->comment = xconfigParserAddComment(parser, new->comment,
+                                                   parser->val.str);
         } else {
-            xconfigUnGetToken(token);
+            xconfigUnGetToken(parser, token);
         }
     }
 
-    xconfigAddListItem((GenericListPtr *)pHead, (GenericListPtr)new);
+    if (pTail) {
+        xconfigAppendListItem((GenericListPtr *)pHead, pTail,
+                              (GenericListPtr)new);
+    } else {
+        xconfigAddListItem((GenericListPtr *)pHead, (GenericListPtr)new);
+    }
+}
+
+void
+xconfigAddNewLoadDirective (XConfigLoadPtr *pHead, char *name, int type,
+                            XConfigOptionPtr opts, int do_token)
+{
+    xconfigParserAddNewLoadDirective(xconfigGetDefaultParser(), pHead, NULL,
+                                     name, type, opts, do_token);
 }
 
 void
@@ -262,7 +286,7 @@ xconfigRemoveLoadDirective(XConfigLoadPtr *pHead, XConfigLoadPtr load)
     TEST_FREE(load->name);
     TEST_FREE(load->comment);
     xconfigFreeOptionList(&(load->opt));
-    free(load);
+    xconfigFree(load);
 }
 
 static void
@@ -276,7 +300,7 @@ FreeModule(XConfigLoadPtr lptr)
         TEST_FREE (lptr->comment);
         prev = lptr;
         lptr = lptr->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -290,6 +314,6 @@ xconfigFreeModules (XConfigModulePtr *ptr)
     FreeModule((*ptr)->disables);
     
     TEST_FREE ((*ptr)->comment);
-    free (*ptr);
+    xconfigFree (*ptr);
     *ptr = NULL;
 }
@@ -0,0 +1,267 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * NameIndex.c
+ *
+ * A hash index of the Screen, Device, Monitor, InputDevice, Modes and
+ * VideoAdaptor sections of a config, keyed on the identifier as
+ * xconfigNameCompare() sees it (case, blanks and underscores do not
+ * matter).
+ *
+ * The index is only kept while the parser itself resolves references
+ * (validation, sanitizing and merging), and the parser's own helpers
+ * add to it as they add sections.  Outside of that, callers are free
+ * to edit the section lists directly, so no index is kept.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+
+
+/* all indexed records start with these two fields */
+
+typedef struct {
+    void *next;
+    char *identifier;
+} NamedListRec, *NamedListPtr;
+
+typedef struct {
+    unsigned int hash;
+    int kind;
+    NamedListPtr item;
+} NameIndexEntryRec, *NameIndexEntryPtr;
+
+struct __xconfignameindexrec {
+    NameIndexEntryPtr slots;
+    unsigned int mask;
+    int count;
+};
+
+
+/*
+ * findEntry() - return the entry for name, or the empty slot where it
+ * would go.
+ */
+
+static NameIndexEntryPtr findEntry(XConfigNameIndexPtr index, int kind,
+                                   unsigned int hash, const char *name)
+{
+    unsigned int i = hash & index->mask;
+    NameIndexEntryPtr e;
+
+    while (1) {
+        e = &index->slots[i];
+        if (!e->item ||
+            ((e->hash == hash) && (e->kind == kind) &&
+             (xconfigNameCompare(name, e->item->identifier) == 0))) {
+            return e;
+        }
+        i = (i + 1) & index->mask;
+    }
+}
+
+
+static int growIndex(XConfigNameIndexPtr index, unsigned int size)
+{
+    NameIndexEntryPtr old = index->slots;
+    unsigned int i, oldSize = old ? index->mask + 1 : 0;
+
+    index->slots = calloc(size, sizeof(NameIndexEntryRec));
+    if (!index->slots) {
+        index->slots = old;
+        return FALSE;
+    }
+    index->mask = size - 1;
+
+    for (i = 0; i < oldSize; i++) {
+        if (old[i].item) {
+            unsigned int j = old[i].hash & index->mask;
+            while (index->slots[j].item) {
+                j = (j + 1) & index->mask;
+            }
+            index->slots[j] = old[i];
+        }
+    }
+
+    free(old);
+
+    return TRUE;
+}
+
+
+/*
+ * addEntry() - index item.  The xconfigFind*() functions return the
+ * first match in list order, and so does the index: an item appended
+ * to its list does not replace an entry of the same name, one that
+ * was put at the head of its list does.  Items without an identifier
+ * cannot be looked up by name and are not indexed.
+ */
+
+static int addEntry(XConfigNameIndexPtr index, int kind, NamedListPtr item,
+                    int atHead)
+{
+    unsigned int hash;
+    NameIndexEntryPtr e;
+
+    if (!item->identifier) {
+        return TRUE;
+    }
+
+    hash = xconfigNameHash(item->identifier, kind);
+
+    if ((unsigned int) (index->count + 1) * 2 > index->mask + 1) {
+        if (!growIndex(index, (index->mask + 1) * 2)) {
+            return FALSE;
+        }
+    }
+
+    e = findEntry(index, kind, hash, item->identifier);
+    if (!e->item) {
+        e->hash = hash;
+        e->kind = kind;
+        e->item = item;
+        index->count++;
+    } else if (atHead) {
+        e->item = item;
+    }
+
+    return TRUE;
+}
+
+
+static int addList(XConfigNameIndexPtr index, int kind, void *list)
+{
+    NamedListPtr item;
+
+    for (item = list; item; item = item->next) {
+        if (!addEntry(index, kind, item, FALSE)) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+
+/*
+ * xconfigBuildNameIndex() - index the sections of p, unless p already
+ * has an index.  Returns TRUE if an index was built, in which case the
+ * caller is to drop it with xconfigDropNameIndex() when done.  If the
+ * index cannot be allocated, lookups fall back to walking the lists.
+ */
+
+int xconfigBuildNameIndex(XConfigPtr p)
+{
+    XConfigNameIndexPtr index;
+
+    if (p->nameIndex) {
+        return FALSE;
+    }
+
+    index = calloc(1, sizeof(*index));
+    if (!index) {
+        return FALSE;
+    }
+
+    if (!growIndex(index, 64) ||
+        !addList(index, XCONFIG_INDEX_SCREEN, p->screens) ||
+        !addList(index, XCONFIG_INDEX_DEVICE, p->devices) ||
+        !addList(index, XCONFIG_INDEX_MONITOR, p->monitors) ||
+        !addList(index, XCONFIG_INDEX_INPUT, p->inputs) ||
+        !addList(index, XCONFIG_INDEX_MODES, p->modes) ||
+        !addList(index, XCONFIG_INDEX_VIDEOADAPTOR, p->videoadaptors)) {
+        free(index->slots);
+        free(index);
+        return FALSE;
+    }
+
+    p->nameIndex = index;
+
+    return TRUE;
+
+} /* xconfigBuildNameIndex() */
+
+
+
+void xconfigDropNameIndex(XConfigPtr p)
+{
+    if (!p->nameIndex) return;
+
+    free(p->nameIndex->slots);
+    free(p->nameIndex);
+    p->nameIndex = NULL;
+
+} /* xconfigDropNameIndex() */
+
+
+
+/*
+ * xconfigIndexAdd() - record a section that has just been added to
+ * one of p's lists: appended, or inserted at the head if atHead.
+ */
+
+void xconfigIndexAdd(XConfigPtr p, XConfigIndexKind kind, void *item,
+                     int atHead)
+{
+    if (!p->nameIndex || !item) return;
+
+    if (!addEntry(p->nameIndex, kind, item, atHead)) {
+        xconfigDropNameIndex(p);
+    }
+
+} /* xconfigIndexAdd() */
+
+
+
+/*
+ * xconfigIndexFind() - look up the section of the given kind named
+ * name; equivalent to the corresponding xconfigFind*() on p's list.
+ */
+
+void *xconfigIndexFind(XConfigPtr p, XConfigIndexKind kind, const char *name)
+{
+    XConfigNameIndexPtr index = p->nameIndex;
+
+    if (index) {
+        unsigned int hash = xconfigNameHash(name, kind);
+        return findEntry(index, kind, hash, name)->item;
+    }
+
+    switch (kind) {
+    case XCONFIG_INDEX_SCREEN:
+        return xconfigFindScreen(name, p->screens);
+    case XCONFIG_INDEX_DEVICE:
+        return xconfigFindDevice(name, p->devices);
+    case XCONFIG_INDEX_MONITOR:
+        return xconfigFindMonitor(name, p->monitors);
+    case XCONFIG_INDEX_INPUT:
+        return xconfigFindInput(name, p->inputs);
+    case XCONFIG_INDEX_MODES:
+        return xconfigFindModes(name, p->modes);
+    case XCONFIG_INDEX_VIDEOADAPTOR:
+        return xconfigFindVideoAdaptor(name, p->videoadaptors);
+    }
+
+    return NULL;
+
+} /* xconfigIndexFind() */
@@ -59,7 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec PointerTab[] =
 {
@@ -93,37 +92,39 @@ static XConfigSymTabRec ZMapTab[] =
 #define CLEANUP xconfigFreeInputList
 
 XConfigInputPtr
-xconfigParsePointerSection (void)
+xconfigParsePointerSection (XConfigParserPtr parser)
 {
     char *s, *s1, *s2;
     int l;
     int token;
     PARSE_PROLOGUE (XConfigInputPtr, XConfigInputRec)
 
-    while ((token = xconfigGetToken (PointerTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, PointerTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case PROTOCOL:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Protocol");
-            xconfigAddNewOption(&ptr->options, "Protocol", val.str);
+            xconfigAddNewOption(&ptr->options, "Protocol", parser->val.str);
             break;
         case PDEVICE:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Device");
-            xconfigAddNewOption(&ptr->options, "Device", val.str);
+            xconfigAddNewOption(&ptr->options, "Device", parser->val.str);
             break;
         case EMULATE3:
             xconfigAddNewOption(&ptr->options, "Emulate3Buttons", NULL);
             break;
         case EM3TIMEOUT:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER ||
+                parser->val.num < 0)
                 Error (POSITIVE_INT_MSG, "Emulate3Timeout");
-            s = xconfigULongToString(val.num);
+            s = xconfigULongToString(parser->val.num);
             xconfigAddNewOption(&ptr->options, "Emulate3Timeout", s);
             TEST_FREE(s);
             break;
@@ -131,30 +132,34 @@ xconfigParsePointerSection (void)
             xconfigAddNewOption(&ptr->options, "ChordMiddle", NULL);
             break;
         case PBUTTONS:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER ||
+                parser->val.num < 0)
                 Error (POSITIVE_INT_MSG, "Buttons");
-            s = xconfigULongToString(val.num);
+            s = xconfigULongToString(parser->val.num);
             xconfigAddNewOption(&ptr->options, "Buttons", s);
             TEST_FREE(s);
             break;
         case BAUDRATE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER ||
+                parser->val.num < 0)
                 Error (POSITIVE_INT_MSG, "BaudRate");
-            s = xconfigULongToString(val.num);
+            s = xconfigULongToString(parser->val.num);
             xconfigAddNewOption(&ptr->options, "BaudRate", s);
             TEST_FREE(s);
             break;
         case SAMPLERATE:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER ||
+                parser->val.num < 0)
                 Error (POSITIVE_INT_MSG, "SampleRate");
-            s = xconfigULongToString(val.num);
+            s = xconfigULongToString(parser->val.num);
             xconfigAddNewOption(&ptr->options, "SampleRate", s);
             TEST_FREE(s);
             break;
         case PRESOLUTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER || val.num < 0)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER ||
+                parser->val.num < 0)
                 Error (POSITIVE_INT_MSG, "Resolution");
-            s = xconfigULongToString(val.num);
+            s = xconfigULongToString(parser->val.num);
             xconfigAddNewOption(&ptr->options, "Resolution", s);
             TEST_FREE(s);
             break;
@@ -165,20 +170,20 @@ xconfigParsePointerSection (void)
             xconfigAddNewOption(&ptr->options, "ClearRTS", NULL);
             break;
         case ZAXISMAPPING:
-            switch (xconfigGetToken(ZMapTab)) {
+            switch (xconfigGetToken(parser, ZMapTab)) {
             case NUMBER:
-                if (val.num < 0)
+                if (parser->val.num < 0)
                     Error (ZAXISMAPPING_MSG, NULL);
-                s1 = xconfigULongToString(val.num);
-                if (xconfigGetSubToken (&(ptr->comment)) != NUMBER ||
-                    val.num < 0)
+                s1 = xconfigULongToString(parser->val.num);
+                if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER ||
+                    parser->val.num < 0)
                     Error (ZAXISMAPPING_MSG, NULL);
-                s2 = xconfigULongToString(val.num);
+                s2 = xconfigULongToString(parser->val.num);
                 l = strlen(s1) + 1 + strlen(s2) + 1;
-                s = malloc(l);
+                s = xconfigAlloc(l);
                 sprintf(s, "%s %s", s1, s2);
-                free(s1);
-                free(s2);
+                xconfigFree(s1);
+                xconfigFree(s2);
                 break;
             case XAXIS:
                 s = xconfigStrdup("x");
@@ -199,7 +204,7 @@ xconfigParsePointerSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
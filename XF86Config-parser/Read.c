@@ -57,7 +57,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec TopLevelTab[] =
 {
@@ -76,181 +75,186 @@ static XConfigSymTabRec TopLevelTab[] =
 
 #define READ_HANDLE_LIST(field,func,type)                               \
 {                                                                       \
-    type p = func();                                                    \
+    type p = func(parser);                                              \
     if (p == NULL) {                                                    \
         xconfigFreeConfig(&ptr);                                        \
         return XCONFIG_RETURN_PARSE_ERROR;                              \
     } else {                                                            \
-        xconfigAddListItem((GenericListPtr *)(&ptr->field),             \
-                           (GenericListPtr) p);                         \
+        xconfigAppendListItem((GenericListPtr *)(&ptr->field),          \
+                              &field##Tail, (GenericListPtr) p);        \
     }                                                                   \
 }
 
-#define READ_ERROR(a,b)                       \
-    do {                                      \
-        xconfigErrorMsg(ParseErrorMsg, a, b); \
-        xconfigFreeConfig(&ptr);              \
-        return XCONFIG_RETURN_PARSE_ERROR;    \
+#define READ_ERROR(a,b)                                       \
+    do {                                                      \
+        xconfigParserErrorMsg(parser, ParseErrorMsg, a, b);   \
+        xconfigFreeConfig(&ptr);                              \
+        return XCONFIG_RETURN_PARSE_ERROR;                    \
     } while (0)
 
 
 
-/*
- * xconfigReadConfigFile() - read the open XConfig file, returning the
- * parsed data as XConfigPtr.
- */
-
-XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
+static XConfigError readConfigFile(XConfigParserPtr parser,
+                                   XConfigPtr *configPtr,
+                                   XConfigArenaPtr arena)
 {
     int token;
     XConfigPtr ptr = NULL;
+    GenericListPtr inputsTail = NULL, videoadaptorsTail = NULL;
+    GenericListPtr devicesTail = NULL, monitorsTail = NULL, modesTail = NULL;
+    GenericListPtr screensTail = NULL, inputclassesTail = NULL;
+    GenericListPtr layoutsTail = NULL, vendorsTail = NULL;
 
     *configPtr = NULL;
 
     ptr = xconfigAlloc(sizeof(XConfigRec));
+    ptr->arena = arena;
     
-    while ((token = xconfigGetToken(TopLevelTab)) != EOF_TOKEN) {
+    while ((token = xconfigGetToken(parser, TopLevelTab)) != EOF_TOKEN) {
         
         switch (token) {
             
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
             
         case SECTION:
-            if (xconfigGetSubToken(&(ptr->comment)) != STRING) {
-                xconfigErrorMsg(ParseErrorMsg, QUOTE_MSG, "Section");
+            if (xconfigGetSubToken(parser, &(ptr->comment)) != STRING) {
+                xconfigParserErrorMsg(parser, ParseErrorMsg, QUOTE_MSG,
+                                      "Section");
                 xconfigFreeConfig(&ptr);
                 return XCONFIG_RETURN_PARSE_ERROR;
             }
             
-            xconfigSetSection(val.str);
+            xconfigSetSection(parser, parser->val.str);
             
-            if (xconfigNameCompare(val.str, "files") == 0)
+            if (xconfigNameCompare(parser->val.str, "files") == 0)
             {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(files, xconfigParseFilesSection());
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
+                READ_HANDLE_RETURN(files, xconfigParseFilesSection(parser));
             }
-            else if (xconfigNameCompare(val.str, "serverflags") == 0)
+            else if (xconfigNameCompare(parser->val.str, "serverflags") == 0)
             {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(flags, xconfigParseFlagsSection());
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
+                READ_HANDLE_RETURN(flags, xconfigParseFlagsSection(parser));
             }
-            else if (xconfigNameCompare(val.str, "keyboard") == 0)
+            else if (xconfigNameCompare(parser->val.str, "keyboard") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(inputs, xconfigParseKeyboardSection,
                                  XConfigInputPtr);
             }
-            else if (xconfigNameCompare(val.str, "pointer") == 0)
+            else if (xconfigNameCompare(parser->val.str, "pointer") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(inputs, xconfigParsePointerSection,
                                  XConfigInputPtr);
             }
-            else if (xconfigNameCompare(val.str, "videoadaptor") == 0)
+            else if (xconfigNameCompare(parser->val.str, "videoadaptor") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(videoadaptors,
                             xconfigParseVideoAdaptorSection,
                                  XConfigVideoAdaptorPtr);
             }
-            else if (xconfigNameCompare(val.str, "device") == 0)
+            else if (xconfigNameCompare(parser->val.str, "device") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(devices, xconfigParseDeviceSection,
                                  XConfigDevicePtr);
             }
-            else if (xconfigNameCompare(val.str, "monitor") == 0)
+            else if (xconfigNameCompare(parser->val.str, "monitor") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(monitors, xconfigParseMonitorSection,
                                  XConfigMonitorPtr);
             }
-            else if (xconfigNameCompare(val.str, "modes") == 0)
+            else if (xconfigNameCompare(parser->val.str, "modes") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(modes, xconfigParseModesSection,
                                  XConfigModesPtr);
             }
-            else if (xconfigNameCompare(val.str, "screen") == 0)
+            else if (xconfigNameCompare(parser->val.str, "screen") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(screens, xconfigParseScreenSection,
                                  XConfigScreenPtr);
             }
-            else if (xconfigNameCompare(val.str, "inputdevice") == 0)
+            else if (xconfigNameCompare(parser->val.str, "inputdevice") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(inputs, xconfigParseInputSection,
                                  XConfigInputPtr);
             }
-            else if ((xconfigNameCompare(val.str, "inputclass") == 0))
+            else if ((xconfigNameCompare(parser->val.str, "inputclass") == 0))
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(inputclasses, xconfigParseInputClassSection,
                                  XConfigInputClassPtr);
             }
-            else if (xconfigNameCompare(val.str, "module") == 0)
+            else if (xconfigNameCompare(parser->val.str, "module") == 0)
             {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(modules, xconfigParseModuleSection());
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
+                READ_HANDLE_RETURN(modules, xconfigParseModuleSection(parser));
             }
-            else if (xconfigNameCompare(val.str, "serverlayout") == 0)
+            else if (xconfigNameCompare(parser->val.str, "serverlayout") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(layouts, xconfigParseLayoutSection,
                                  XConfigLayoutPtr);
             }
-            else if (xconfigNameCompare(val.str, "vendor") == 0)
+            else if (xconfigNameCompare(parser->val.str, "vendor") == 0)
             {
-                free(val.str);
-                val.str = NULL;
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
                 READ_HANDLE_LIST(vendors, xconfigParseVendorSection,
                                  XConfigVendorPtr);
             }
-            else if (xconfigNameCompare(val.str, "dri") == 0)
+            else if (xconfigNameCompare(parser->val.str, "dri") == 0)
             {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(dri, xconfigParseDRISection());
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
+                READ_HANDLE_RETURN(dri, xconfigParseDRISection(parser));
             }
-            else if (xconfigNameCompare (val.str, "extensions") == 0)
+            else if (xconfigNameCompare (parser->val.str, "extensions") == 0)
             {
-                free(val.str);
-                val.str = NULL;
-                READ_HANDLE_RETURN(extensions, xconfigParseExtensionsSection());
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
+                READ_HANDLE_RETURN(extensions,
+                                   xconfigParseExtensionsSection(parser));
             }
             else
             {
-                READ_ERROR(INVALID_SECTION_MSG, xconfigTokenString());
-                free(val.str);
-                val.str = NULL;
+                READ_ERROR(INVALID_SECTION_MSG, xconfigTokenString(parser));
+                xconfigFree(parser->val.str);
+                parser->val.str = NULL;
             }
             break;
             
         default:
-            READ_ERROR(INVALID_KEYWORD_MSG, xconfigTokenString());
-            free(val.str);
-            val.str = NULL;
+            READ_ERROR(INVALID_KEYWORD_MSG, xconfigTokenString(parser));
+            xconfigFree(parser->val.str);
+            parser->val.str = NULL;
         }
     }
 
-    if (xconfigValidateConfig(ptr)) {
-        ptr->filename = strdup(xconfigGetConfigFileName());
+    if (xconfigParserValidateConfig(parser, ptr)) {
+        ptr->filename = xconfigStrdup(xconfigGetConfigFileName(parser));
         *configPtr = ptr;
         return XCONFIG_RETURN_SUCCESS;
     } else {
@@ -262,23 +266,72 @@ XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
 #undef CLEANUP
 
 
+/*
+ * xconfigParserReadConfigFile() - read the XConfig file open in
+ * parser, returning the parsed data as XConfigPtr.
+ */
+
+XConfigError xconfigParserReadConfigFile(XConfigParserPtr parser,
+                                         XConfigPtr *configPtr)
+{
+    XConfigArenaPtr arena = NULL, prevArena;
+    XConfigError ret;
+
+    if (parser->useArena) {
+        arena = xconfigNewArena();
+    }
+
+    prevArena = xconfigSetArena(arena);
+    ret = readConfigFile(parser, configPtr, arena);
+    xconfigSetArena(prevArena);
+
+    return ret;
+}
+
+
+/*
+ * xconfigReadConfigFile() - read the XConfig file opened by
+ * xconfigOpenConfigFile(), returning the parsed data as XConfigPtr.
+ */
+
+XConfigError xconfigReadConfigFile(XConfigPtr *configPtr)
+{
+    return xconfigParserReadConfigFile(xconfigGetDefaultParser(), configPtr);
+}
+
+
 /* 
  * This function resolves name references and reports errors if the named
- * objects cannot be found.
+ * objects cannot be found.  The references are looked up through a name
+ * index, so this takes time linear in the size of the config.
  */
 
+int xconfigParserValidateConfig(XConfigParserPtr parser, XConfigPtr p)
+{
+    int builtIndex;
+    int ret = FALSE;
+
+    xconfigResolveScreenIdentifiers(p);
+
+    builtIndex = xconfigBuildNameIndex(p);
+
+    if (xconfigValidateDevice(parser, p) &&
+        xconfigValidateScreen(parser, p) &&
+        xconfigValidateInput(parser, p) &&
+        xconfigValidateLayout(parser, p)) {
+        ret = TRUE;
+    }
+
+    if (builtIndex) {
+        xconfigDropNameIndex(p);
+    }
+
+    return ret;
+}
+
 int xconfigValidateConfig(XConfigPtr p)
 {
-    if (!xconfigValidateDevice(p))
-        return FALSE;
-    if (!xconfigValidateScreen(p))
-        return FALSE;
-    if (!xconfigValidateInput(p))
-        return FALSE;
-    if (!xconfigValidateLayout(p))
-        return FALSE;
-    
-    return(TRUE);
+    return xconfigParserValidateConfig(xconfigGetDefaultParser(), p);
 }
 
 
@@ -292,13 +345,21 @@ int xconfigSanitizeConfig(XConfigPtr p,
                           const char *screenName,
                           GenerateOptions *gop)
 {
-    if (!xconfigSanitizeScreen(p))
-        return FALSE;
-    
-    if (!xconfigSanitizeLayout(p, screenName, gop))
-        return FALSE;
-    
-    return TRUE;
+    XConfigArenaPtr prevArena = xconfigSetArena(p->arena);
+    int builtIndex = xconfigBuildNameIndex(p);
+    int ret = FALSE;
+
+    if (xconfigSanitizeScreen(p) &&
+        xconfigSanitizeLayout(p, screenName, gop)) {
+        ret = TRUE;
+    }
+
+    if (builtIndex) {
+        xconfigDropNameIndex(p);
+    }
+    xconfigSetArena(prevArena);
+
+    return ret;
 }
 
 
@@ -325,6 +386,32 @@ void xconfigAddListItem (GenericListPtr *pHead, GenericListPtr new)
 }
 
 
+/*
+ * like xconfigAddListItem(), but the search for the end of the list
+ * starts at *pTail, which is left pointing at the new last item; so
+ * building a list from a NULL *pTail takes constant time per item.
+ * *pTail must be NULL or an item that is still in the list.
+ */
+void xconfigAppendListItem (GenericListPtr *pHead, GenericListPtr *pTail,
+                            GenericListPtr new)
+{
+    GenericListPtr last = *pTail ? *pTail : *pHead;
+
+    if (last) {
+        while (last->next) {
+            last = last->next;
+        }
+        last->next = new;
+    } else {
+        *pHead = new;
+    }
+
+    for (last = new; last->next; last = last->next);
+
+    *pTail = last;
+}
+
+
 /*
  * removes an item from the linked list (but does not delete it). Any record
  * whose first field is a GenericListRec can be cast to this type and used
@@ -380,6 +467,15 @@ xconfigFreeConfig (XConfigPtr *p)
     if (p == NULL || *p == NULL)
         return;
 
+    /* the whole tree lives in the arena */
+
+    if ((*p)->arena) {
+        XConfigArenaPtr arena = (*p)->arena;
+        *p = NULL;
+        xconfigFreeArena(arena);
+        return;
+    }
+
     xconfigFreeFiles (&((*p)->files));
     xconfigFreeModules (&((*p)->modules));
     xconfigFreeFlags (&((*p)->flags));
@@ -394,6 +490,6 @@ xconfigFreeConfig (XConfigPtr *p)
     xconfigFreeDRI (&((*p)->dri));
     TEST_FREE((*p)->comment);
 
-    free (*p);
+    xconfigFree (*p);
     *p = NULL;
 }
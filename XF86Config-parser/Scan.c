@@ -59,6 +59,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #if !defined(X_NOT_POSIX)
 #if defined(_POSIX_SOURCE)
@@ -88,18 +91,13 @@
 
 static int StringToToken (char *, XConfigSymTabRec *);
 
-static FILE *configFile = NULL;
-static const char **builtinConfig = NULL;
-static int builtinIndex = 0;
-static int configPos = 0;            /* current readers position */
-static char *configBuf, *configRBuf; /* buffer for lines */
-static int pushToken = LOCK_TOKEN;
-static int eol_seen = 0;             /* private state to handle comments */
-LexRec val;
+/*
+ * the parser used by the xconfigOpenConfigFile(), xconfigReadConfigFile()
+ * and xconfigCloseConfigFile() interfaces, which only allow one config
+ * to be parsed at a time
+ */
 
-int configLineNo = 0;         /* linenumber */
-char *configSection = NULL;   /* name of current section being parsed */
-char *configPath;             /* path to config file */
+static XConfigParserRec defaultParser;
 
 
 
@@ -177,74 +175,85 @@ static unsigned int xconfigStrToUL (char *str)
 }
 
 
+/*
+ * xconfigGrowRBuf --
+ *
+ *  make sure the token buffer can hold a token copied out of a line
+ *  of the given length, plus the terminating NUL.  Returns 0 if the
+ *  buffer could not be grown; it is left untouched in that case.
+ */
+
+static int xconfigGrowRBuf(XConfigParserPtr parser, int lineLen)
+{
+    char *tmp;
+    int len = CONFIG_BUF_LEN;
+
+    if (lineLen + 2 <= parser->rbufLen) {
+        return 1;
+    }
+
+    while (len < lineLen + 2) {
+        len += CONFIG_BUF_LEN;
+    }
+
+    tmp = realloc(parser->rbuf, len);
+    if (!tmp) {
+        return 0;
+    }
+
+    parser->rbuf = tmp;
+    parser->rbufLen = len;
+
+    return 1;
+}
+
+
 /*
  * xconfigGetNextLine --
  *
- *  read from the configFile FILE stream until we encounter a new
+ *  read from the parser's FILE stream until we encounter a new
  *  line; this is effectively just a big wrapper for fgets(3).
  *
  *  xconfigGetToken() assumes that we will read up to the next
- *  newline; we need to grow configBuf and configRBuf as needed to
- *  support that.
+ *  newline; we need to grow the line buffer as needed to support that.
  */
 
-static char *xconfigGetNextLine(void)
+static char *xconfigGetNextLine(XConfigParserPtr parser)
 {
-    static int configBufLen = CONFIG_BUF_LEN;
-    char *tmpConfigBuf, *tmpConfigRBuf;
+    char *tmpConfigBuf;
     int c, i, pos = 0, eolFound = 0;
     char *ret = NULL;
     
     /*
      * reallocate the string if it was grown last time (i.e., is no
-     * longer CONFIG_BUF_LEN); we malloc the new strings first, so
-     * that if either of the mallocs fail, we can fall back on the
-     * existing buffer allocations
+     * longer CONFIG_BUF_LEN); we malloc the new string first, so
+     * that if the malloc fails, we can fall back on the existing
+     * buffer allocation
      */
     
-    if (configBufLen != CONFIG_BUF_LEN) {
+    if (parser->lineBufLen != CONFIG_BUF_LEN) {
                  
         tmpConfigBuf = malloc(CONFIG_BUF_LEN);
-        tmpConfigRBuf = malloc(CONFIG_BUF_LEN);
         
-        if (!tmpConfigBuf || !tmpConfigRBuf) {
-            
-            /*
-             * at least one of the mallocs failed; keep the old buffers
-             * and free any partial allocations
-             */
-            
-            free(tmpConfigBuf);
-            free(tmpConfigRBuf);
-            
-        } else {
-            
-            /*
-             * malloc succeeded; free the old buffers and use the new
-             * buffers
-             */
-            
-            configBufLen = CONFIG_BUF_LEN;
-            
-            free(configBuf);
-            free(configRBuf);
-            
-            configBuf = tmpConfigBuf;
-            configRBuf = tmpConfigRBuf;
+        if (tmpConfigBuf) {
+            parser->lineBufLen = CONFIG_BUF_LEN;
+            free(parser->lineBuf);
+            parser->lineBuf = tmpConfigBuf;
         }
     }
 
     /* read in another block of chars */
     
     do {
-        ret = fgets(configBuf + pos, configBufLen - pos - 1, configFile);
+        ret = fgets(parser->lineBuf + pos, parser->lineBufLen - pos - 1,
+                    parser->file);
         
         if (!ret) break;
         
         /* search for EOL in the new block of chars */
         
-        for (i = pos; i < (configBufLen - 1); i++) {
-            c = configBuf[i];
+        for (i = pos; i < (parser->lineBufLen - 1); i++) {
+            c = parser->lineBuf[i];
             
             if (c == '\0') break;
             
@@ -261,49 +270,127 @@ static char *xconfigGetNextLine(void)
         
         if (!eolFound) {
             
-            tmpConfigBuf = realloc(configBuf, configBufLen + CONFIG_BUF_LEN);
-            tmpConfigRBuf = realloc(configRBuf, configBufLen + CONFIG_BUF_LEN);
+            tmpConfigBuf = realloc(parser->lineBuf,
+                                   parser->lineBufLen + CONFIG_BUF_LEN);
             
-            if (!tmpConfigBuf || !tmpConfigRBuf) {
+            if (!tmpConfigBuf) {
                 
                 /*
-                 * at least one of the reallocations failed; use the
-                 * new allocation that succeeded, but we have to
-                 * fallback to the previous configBufLen size and use
-                 * the string we have, even though we don't have an
-                 * EOL
+                 * the reallocation failed; we have to use the string
+                 * we have, even though we don't have an EOL
                  */
                 
-                if (tmpConfigBuf) configBuf = tmpConfigBuf;
-                if (tmpConfigRBuf) configRBuf = tmpConfigRBuf;
-                
                 break;
                 
             } else {
                 
                 /* reallocation succeeded */
 
-                configBuf = tmpConfigBuf;
-                configRBuf = tmpConfigRBuf;
+                parser->lineBuf = tmpConfigBuf;
                 pos = i;
-                configBufLen += CONFIG_BUF_LEN;
+                parser->lineBufLen += CONFIG_BUF_LEN;
             }
         }
         
     } while (!eolFound);
+
+    /* a final line without a newline is still a line */
+
+    if (!ret && (pos > 0)) {
+        ret = parser->lineBuf;
+    }
+
+    if (ret) {
+        parser->buf = parser->lineBuf;
+        parser->lineLen = strlen(parser->lineBuf);
+
+        if (!xconfigGrowRBuf(parser, parser->lineLen)) {
+            parser->lineLen = parser->rbufLen - 2;
+        }
+    }
     
     return ret;
 }
 
 
+/*
+ * xconfigGetNextMemLine --
+ *
+ *  advance parser->buf to the next line of the in-memory config.  The
+ *  line is not copied: parser->buf points directly into parser->mem
+ *  and parser->lineLen bytes of it (including the trailing newline,
+ *  if any) belong to the current line.  Returns 0 at the end of the
+ *  buffer.
+ */
+
+static int xconfigGetNextMemLine(XConfigParserPtr parser)
+{
+    const char *start, *eol;
+    size_t remaining, len;
+
+    if (parser->memPos >= parser->memLen) {
+        return 0;
+    }
+
+    start = parser->mem + parser->memPos;
+    remaining = parser->memLen - parser->memPos;
+
+    eol = memchr(start, '\n', remaining);
+    len = eol ? (eol - start + 1) : remaining;
+
+    /*
+     * if parser->rbuf cannot hold a token from a line this long, split
+     * the line at the size we can handle; the rest will be returned
+     * as the next line
+     */
+
+    if (len > INT_MAX - 2) {
+        len = INT_MAX - 2;
+    }
+
+    if (!xconfigGrowRBuf(parser, len)) {
+        if (parser->rbufLen < 2) {
+            return 0;
+        }
+        len = parser->rbufLen - 2;
+    }
+
+    parser->buf = start;
+    parser->lineLen = len;
+    parser->memPos += len;
+
+    return 1;
+}
+
+
+/*
+ * the current line is not NUL terminated; reads past its end return
+ * '\0', which xconfigGetToken() treats as the end of the line
+ */
+
+static char xconfigPeekChar(XConfigParserPtr parser)
+{
+    return (parser->pos < parser->lineLen) ? parser->buf[parser->pos] : '\0';
+}
+
+static char xconfigNextChar(XConfigParserPtr parser)
+{
+    char c = xconfigPeekChar(parser);
+
+    parser->pos++;
+
+    return c;
+}
+
+
 
 /* 
  * xconfigGetToken --
- *      Read next Token from the config file. Handle the global variable
+ *      Read next Token from the config file. Handle the parser's
  *      pushToken.
  */
 
-int xconfigGetToken (XConfigSymTabRec * tab)
+int xconfigGetToken (XConfigParserPtr parser, XConfigSymTabRec * tab)
 {
     int c, i;
 
@@ -312,16 +399,16 @@ int xconfigGetToken (XConfigSymTabRec * tab)
      * In this case rBuf[] contains a valid STRING/TOKEN/NUMBER. But in the
      * oth * case the next token must be read from the input.
      */
-    if (pushToken == EOF_TOKEN)
+    if (parser->pushToken == EOF_TOKEN)
         return (EOF_TOKEN);
-    else if (pushToken == LOCK_TOKEN)
+    else if (parser->pushToken == LOCK_TOKEN)
     {
         /*
-         * eol_seen is only set for the first token after a newline.
+         * eolSeen is only set for the first token after a newline.
          */
-        eol_seen = 0;
+        parser->eolSeen = 0;
 
-        c = configBuf[configPos];
+        c = xconfigPeekChar(parser);
 
         /* 
          * Get start of next Token. EOF is handled,
@@ -331,31 +418,24 @@ int xconfigGetToken (XConfigSymTabRec * tab)
 again:
         if (!c)
         {
-            char *ret;
-            if (configFile)
-                ret = xconfigGetNextLine();
-            else {
-                if (builtinConfig[builtinIndex] == NULL)
-                    ret = NULL;
-                else {
-                    ret = strncpy(configBuf, builtinConfig[builtinIndex],
-                            CONFIG_BUF_LEN);
-                    builtinIndex++;
-                }
-            }
-            if (ret == NULL)
+            int ret;
+            if (parser->file)
+                ret = (xconfigGetNextLine(parser) != NULL);
+            else
+                ret = xconfigGetNextMemLine(parser);
+            if (!ret)
             {
-                return (pushToken = EOF_TOKEN);
+                return (parser->pushToken = EOF_TOKEN);
             }
-            configLineNo++;
-            configPos = 0;
-            eol_seen = 1;
+            parser->lineNo++;
+            parser->pos = 0;
+            parser->eolSeen = 1;
         }
 
         i = 0;
         for (;;) {
-            c = configBuf[configPos++];
-            configRBuf[i++] = c;
+            c = xconfigNextChar(parser);
+            parser->rbuf[i++] = c;
             switch (c) {
                 case ' ':
                 case '\t':
@@ -374,23 +454,23 @@ again:
         {
             do
             {
-                configRBuf[i++] = (c = configBuf[configPos++]);
+                parser->rbuf[i++] = (c = xconfigNextChar(parser));
             }
             while ((c != '\n') && (c != '\r') && (c != '\0'));
-            configRBuf[i] = '\0';
+            parser->rbuf[i] = '\0';
             /* XXX no private copy.
              * Use xconfigAddComment when setting a comment.
              */
-            val.str = configRBuf;
+            parser->val.str = parser->rbuf;
             return (COMMENT);
         }
 
         /* GJA -- handle '-' and ','  * Be careful: "-hsync" is a keyword. */
-        else if ((c == ',') && !xconfigIsAlpha(configBuf[configPos]))
+        else if ((c == ',') && !xconfigIsAlpha(xconfigPeekChar(parser)))
         {
             return COMMA;
         }
-        else if ((c == '-') && !xconfigIsAlpha(configBuf[configPos]))
+        else if ((c == '-') && !xconfigIsAlpha(xconfigPeekChar(parser)))
         {
             return DASH;
         }
@@ -403,26 +483,26 @@ again:
             int base;
 
             if (c == '0')
-                if ((configBuf[configPos] == 'x') ||
-                    (configBuf[configPos] == 'X'))
+                if ((xconfigPeekChar(parser) == 'x') ||
+                    (xconfigPeekChar(parser) == 'X'))
                     base = 16;
                 else
                     base = 8;
             else
                 base = 10;
 
-            configRBuf[0] = c;
+            parser->rbuf[0] = c;
             i = 1;
-            while (xconfigIsDigit(c = configBuf[configPos++]) ||
+            while (xconfigIsDigit(c = xconfigNextChar(parser)) ||
                    (c == '.') || (c == 'x') || (c == 'X') ||
                    ((base == 16) && (((c >= 'a') && (c <= 'f')) ||
                                      ((c >= 'A') && (c <= 'F')))))
-                configRBuf[i++] = c;
-            configPos--;        /* GJA -- one too far */
-            configRBuf[i] = '\0';
-            val.num = xconfigStrToUL (configRBuf);
-            val.realnum = atof (configRBuf);
-            val.str = configRBuf;
+                parser->rbuf[i++] = c;
+            parser->pos--;        /* GJA -- one too far */
+            parser->rbuf[i] = '\0';
+            parser->val.num = xconfigStrToUL (parser->rbuf);
+            parser->val.realnum = atof (parser->rbuf);
+            parser->val.str = parser->rbuf;
             return (NUMBER);
         }
 
@@ -434,12 +514,12 @@ again:
             i = -1;
             do
             {
-                configRBuf[++i] = (c = configBuf[configPos++]);
+                parser->rbuf[++i] = (c = xconfigNextChar(parser));
             }
             while ((c != '\"') && (c != '\n') && (c != '\r') && (c != '\0'));
-            configRBuf[i] = '\0';
-            val.str = malloc (strlen (configRBuf) + 1);
-            strcpy (val.str, configRBuf);    /* private copy ! */
+            parser->rbuf[i] = '\0';
+            parser->val.str = xconfigAlloc (i + 1);
+            memcpy (parser->val.str, parser->rbuf, i + 1); /* private copy ! */
             return (STRING);
         }
 
@@ -449,11 +529,11 @@ again:
          */
         else
         {
-            configRBuf[0] = c;
+            parser->rbuf[0] = c;
             i = 0;
             do
             {
-                configRBuf[++i] = (c = configBuf[configPos++]);;
+                parser->rbuf[++i] = (c = xconfigNextChar(parser));
             }
             while ((c != ' ')  &&
                    (c != '\t') &&
@@ -462,8 +542,8 @@ again:
                    (c != '\0') &&
                    (c != '#'));
             
-            --configPos;
-            configRBuf[i] = '\0';
+            --parser->pos;
+            parser->rbuf[i] = '\0';
             i = 0;
         }
 
@@ -475,8 +555,8 @@ again:
          * Here we deal with pushed tokens. Reinitialize pushToken again. If
          * the pushed token was NUMBER || STRING return them again ...
          */
-        int temp = pushToken;
-        pushToken = LOCK_TOKEN;
+        int temp = parser->pushToken;
+        parser->pushToken = LOCK_TOKEN;
 
         if (temp == COMMA || temp == DASH)
             return (temp);
@@ -488,27 +568,21 @@ again:
      * Joop, at last we have to lookup the token ...
      */
     if (tab)
-    {
-        i = 0;
-        while (tab[i].token != -1)
-            if (xconfigNameCompare (configRBuf, tab[i].name) == 0)
-                return (tab[i].token);
-            else
-                i++;
-    }
+        return StringToToken (parser->rbuf, tab);
 
     return (ERROR_TOKEN);        /* Error catcher */
 }
 
-int xconfigGetSubToken (char **comment)
+int xconfigGetSubToken (XConfigParserPtr parser, char **comment)
 {
     int token;
 
     for (;;) {
-        token = xconfigGetToken(NULL);
+        token = xconfigGetToken(parser, NULL);
         if (token == COMMENT) {
             if (comment)
-                *comment = xconfigAddComment(*comment, val.str);
+                *comment = xconfigParserAddComment(parser, *comment,
+                                                   parser->val.str);
         }
         else
             return (token);
@@ -516,15 +590,17 @@ int xconfigGetSubToken (char **comment)
     /*NOTREACHED*/
 }
 
-int xconfigGetSubTokenWithTab (char **comment, XConfigSymTabRec *tab)
+int xconfigGetSubTokenWithTab (XConfigParserPtr parser, char **comment,
+                               XConfigSymTabRec *tab)
 {
     int token;
 
     for (;;) {
-        token = xconfigGetToken(tab);
+        token = xconfigGetToken(parser, tab);
         if (token == COMMENT) {
             if (comment)
-                *comment = xconfigAddComment(*comment, val.str);
+                *comment = xconfigParserAddComment(parser, *comment,
+                                                   parser->val.str);
         }
         else
             return (token);
@@ -532,14 +608,14 @@ int xconfigGetSubTokenWithTab (char **comment, XConfigSymTabRec *tab)
     /*NOTREACHED*/
 }
 
-void xconfigUnGetToken (int token)
+void xconfigUnGetToken (XConfigParserPtr parser, int token)
 {
-    pushToken = token;
+    parser->pushToken = token;
 }
 
-char *xconfigTokenString (void)
+char *xconfigTokenString (XConfigParserPtr parser)
 {
-    return configRBuf;
+    return parser->rbuf;
 }
 
 static int pathIsAbsolute(const char *path)
@@ -640,9 +716,9 @@ static char *DoSubstitution(const char *template,
 {
     char *result;
     int i, l;
-    static const char *env = NULL;
-    static char *hostname = NULL;
-    static char majorvers[3] = "";
+    const char *env = NULL;
+    char hostname[MAXHOSTNAMELEN + 1];
+    char majorvers[3] = "";
 
     if (!template)
         return NULL;
@@ -688,18 +764,10 @@ static char *DoSubstitution(const char *template,
                 APPEND_STR(XConfigFile);
                 break;
             case 'H':
-                if (!hostname) {
-                    if ((hostname = malloc(MAXHOSTNAMELEN + 1))) {
-                        if (gethostname(hostname, MAXHOSTNAMELEN) == 0) {
-                            hostname[MAXHOSTNAMELEN] = '\0';
-                        } else {
-                            free(hostname);
-                            hostname = NULL;
-                        }
-                    }
-                }
-                if (hostname)
+                if (gethostname(hostname, MAXHOSTNAMELEN) == 0) {
+                    hostname[MAXHOSTNAMELEN] = '\0';
                     APPEND_STR(hostname);
+                }
                 break;
             case 'E':
                 if (!env)
@@ -826,17 +894,70 @@ static const char __user_configpath[] =
 
 
 
-const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
+/*
+ * xconfigResetScanner() - reset the scanner state before opening a
+ * new config
+ */
+
+static void xconfigResetScanner(XConfigParserPtr parser)
+{
+    parser->file = NULL;
+    parser->mem = NULL;
+    parser->memLen = 0;
+    parser->memPos = 0;
+    parser->memMapped = 0;
+    parser->buf = NULL;
+    parser->lineLen = 0;
+    parser->pos = 0;        /* current readers position */
+    parser->lineNo = 0;    /* linenumber */
+    parser->pushToken = LOCK_TOKEN;
+}
+
+
+/*
+ * xconfigMapConfigFile() - try to mmap the parser's opened file;
+ * returns 1 on success, in which case parser->file is no longer needed
+ */
+
+static int xconfigMapConfigFile(XConfigParserPtr parser)
+{
+    struct stat st;
+    void *mem;
+
+    if (fstat(fileno(parser->file), &st) != 0) {
+        return 0;
+    }
+
+    if (!S_ISREG(st.st_mode) || (st.st_size <= 0) ||
+        ((unsigned long long) st.st_size > (size_t) -1)) {
+        return 0;
+    }
+
+    mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+               fileno(parser->file), 0);
+    if (mem == MAP_FAILED) {
+        return 0;
+    }
+
+    parser->mem = mem;
+    parser->memLen = st.st_size;
+    parser->memPos = 0;
+    parser->memMapped = 1;
+
+    return 1;
+}
+
+
+const char *xconfigParserOpenConfigFile(XConfigParserPtr parser,
+                                        const char *cmdline,
+                                        const char *projroot)
 {
     const char *searchpath;
-    char *pathcopy;
+    char *pathcopy, *saveptr;
     const char *template;
     int cmdlineUsed = 0;
 
-    configFile = NULL;
-    configPos = 0;        /* current readers position */
-    configLineNo = 0;    /* linenumber */
-    pushToken = LOCK_TOKEN;
+    xconfigResetScanner(parser);
 
     /*
      * select the search path: XFree86 uses a slightly different path
@@ -853,95 +974,212 @@ const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
     
     pathcopy = strdup(searchpath);
     
-    template = strtok(pathcopy, ",");
+    template = strtok_r(pathcopy, ",", &saveptr);
 
     /* First, search for a config file. */
-    while (template && !configFile) {
-        if ((configPath = DoSubstitution(template, cmdline, projroot,
-                                         &cmdlineUsed, NULL, XCONFIGFILE))) {
-            if ((configFile = fopen(configPath, "r")) != 0) {
+    while (template && !parser->file) {
+        if ((parser->path = DoSubstitution(template, cmdline, projroot,
+                                           &cmdlineUsed, NULL,
+                                           XCONFIGFILE))) {
+            if ((parser->file = fopen(parser->path, "r")) != 0) {
                 if (cmdline && !cmdlineUsed) {
-                    fclose(configFile);
-                    configFile = NULL;
+                    fclose(parser->file);
+                    parser->file = NULL;
                 }
             }
         }
-        if (configPath && !configFile) {
-            free(configPath);
-            configPath = NULL;
+        if (parser->path && !parser->file) {
+            free(parser->path);
+            parser->path = NULL;
         }
-        template = strtok(NULL, ",");
+        template = strtok_r(NULL, ",", &saveptr);
     }
 
     /* Then search for fallback */
-    if (!configFile) {
+    if (!parser->file) {
         strcpy(pathcopy, searchpath);
-        template = strtok(pathcopy, ",");
+        template = strtok_r(pathcopy, ",", &saveptr);
         
-        while (template && !configFile) {
-            if ((configPath = DoSubstitution(template, cmdline, projroot,
-                                             &cmdlineUsed, NULL,
-                                             XFREE86CFGFILE))) {
-                if ((configFile = fopen(configPath, "r")) != 0) {
+        while (template && !parser->file) {
+            if ((parser->path = DoSubstitution(template, cmdline, projroot,
+                                               &cmdlineUsed, NULL,
+                                               XFREE86CFGFILE))) {
+                if ((parser->file = fopen(parser->path, "r")) != 0) {
                     if (cmdline && !cmdlineUsed) {
-                        fclose(configFile);
-                        configFile = NULL;
+                        fclose(parser->file);
+                        parser->file = NULL;
                     }
                 }
             }
-            if (configPath && !configFile) {
-                free(configPath);
-                configPath = NULL;
+            if (parser->path && !parser->file) {
+                free(parser->path);
+                parser->path = NULL;
             }
-            template = strtok(NULL, ",");
+            template = strtok_r(NULL, ",", &saveptr);
         }
     }
     
     free(pathcopy);
 
-    if (!configFile) {
+    if (!parser->file) {
         return NULL;
     }
 
-    configBuf = malloc(CONFIG_BUF_LEN);
-    configRBuf = malloc(CONFIG_BUF_LEN);
-    configBuf[0] = '\0';
+    /*
+     * map regular files so that xconfigGetToken() can tokenize
+     * directly from the page cache; anything that can't be mapped
+     * (pipes, devices, empty files) is read through parser->file
+     */
+
+    if (xconfigMapConfigFile(parser)) {
+        fclose(parser->file);
+        parser->file = NULL;
+    } else {
+        parser->lineBuf = malloc(CONFIG_BUF_LEN);
+        parser->lineBufLen = CONFIG_BUF_LEN;
+        parser->lineBuf[0] = '\0';
+    }
+
+    parser->rbuf = malloc(CONFIG_BUF_LEN);
+    parser->rbufLen = CONFIG_BUF_LEN;
 
-    return configPath;
+    return parser->path;
 }
 
-void xconfigCloseConfigFile (void)
+
+const char *xconfigOpenConfigFile(const char *cmdline, const char *projroot)
 {
-    free (configPath);
-    configPath = NULL;
-    free (configRBuf);
-    configRBuf = NULL;
-    free (configBuf);
-    configBuf = NULL;
-
-    if (configFile) {
-        fclose (configFile);
-        configFile = NULL;
-    } else {
-        builtinConfig = NULL;
-        builtinIndex = 0;
+    return xconfigParserOpenConfigFile(&defaultParser, cmdline, projroot);
+}
+
+
+/*
+ * xconfigParserOpenConfigBuffer() - prepare to parse a config that is
+ * already in memory; the buffer is owned by the caller and must
+ * remain valid, and unmodified, until xconfigParserCloseConfigFile()
+ * is called.  It need not be NUL terminated.  name is used in place
+ * of the file name in messages and as the filename of the parsed
+ * XConfigRec.
+ */
+
+const char *xconfigParserOpenConfigBuffer(XConfigParserPtr parser,
+                                          const char *buf, size_t len,
+                                          const char *name)
+{
+    xconfigResetScanner(parser);
+
+    parser->mem = buf;
+    parser->memLen = buf ? len : 0;
+    parser->path = strdup(name ? name : "<buffer>");
+
+    parser->rbuf = malloc(CONFIG_BUF_LEN);
+    parser->rbufLen = CONFIG_BUF_LEN;
+
+    return parser->path;
+}
+
+const char *xconfigOpenConfigBuffer(const char *buf, size_t len,
+                                    const char *name)
+{
+    return xconfigParserOpenConfigBuffer(&defaultParser, buf, len, name);
+}
+
+void xconfigParserCloseConfigFile (XConfigParserPtr parser)
+{
+    free (parser->path);
+    parser->path = NULL;
+    free (parser->rbuf);
+    parser->rbuf = NULL;
+    parser->rbufLen = 0;
+    free (parser->lineBuf);
+    parser->lineBuf = NULL;
+
+    if (parser->file) {
+        fclose (parser->file);
+        parser->file = NULL;
+    }
+
+    if (parser->memMapped) {
+        munmap((void *) parser->mem, parser->memLen);
+        parser->memMapped = 0;
     }
+
+    parser->mem = NULL;
+    parser->memLen = 0;
+    parser->memPos = 0;
+    parser->buf = NULL;
+    parser->lineLen = 0;
+}
+
+void xconfigCloseConfigFile (void)
+{
+    xconfigParserCloseConfigFile(&defaultParser);
+}
+
+
+/*
+ * xconfigNewParser() - allocate a parser; each parser holds all of
+ * the state needed to scan one config at a time, so separate parsers
+ * may be used concurrently from different threads.
+ */
+
+XConfigParserPtr xconfigNewParser(void)
+{
+    XConfigParserPtr parser = calloc(1, sizeof(XConfigParserRec));
+
+    if (!parser)
+        return NULL;
+
+    parser->pushToken = LOCK_TOKEN;
+
+    return parser;
+}
+
+
+void xconfigFreeParser(XConfigParserPtr *parser)
+{
+    if (parser == NULL || *parser == NULL)
+        return;
+
+    xconfigParserCloseConfigFile(*parser);
+    TEST_FREE((*parser)->section);
+
+    free(*parser);
+    *parser = NULL;
+}
+
+
+/*
+ * xconfigParserUseArena() - when enabled, each config read by parser
+ * is allocated from an arena of its own (XConfigRec.arena), so that
+ * xconfigFreeConfig() releases it without walking the tree.
+ */
+
+void xconfigParserUseArena(XConfigParserPtr parser, int enable)
+{
+    parser->useArena = enable;
 }
 
 
-char *xconfigGetConfigFileName(void)
+XConfigParserPtr xconfigGetDefaultParser(void)
 {
-    return configPath;
+    return &defaultParser;
+}
+
+
+char *xconfigGetConfigFileName(XConfigParserPtr parser)
+{
+    return parser->path;
 }
 
 
 void
-xconfigSetSection (char *section)
+xconfigSetSection (XConfigParserPtr parser, char *section)
 {
-    if (configSection)
-        free(configSection);
-    configSection = malloc(strlen (section) + 1);
-    strcpy (configSection, section);
+    if (parser->section)
+        free(parser->section);
+    parser->section = malloc(strlen (section) + 1);
+    strcpy (parser->section, section);
 }
 
 /* 
@@ -950,11 +1188,18 @@ xconfigSetSection (char *section)
  */
 
 
+/*
+ * xconfigParserAddComment() - append a comment to cur; when the
+ * comment was just read by parser, the parser's end of line state
+ * decides whether a new comment string starts with a newline.
+ */
+
 char *
-xconfigAddComment(char *cur, char *add)
+xconfigParserAddComment(XConfigParserPtr parser, char *cur, char *add)
 {
     char *str;
     int len, curlen, iscomment, hasnewline = 0, endnewline;
+    int eol_seen = parser ? parser->eolSeen : 0;
 
     if (add == NULL || add[0] == '\0')
         return (cur);
@@ -964,6 +1209,8 @@ xconfigAddComment(char *cur, char *add)
         if (curlen)
             hasnewline = cur[curlen - 1] == '\n';
         eol_seen = 0;
+        if (parser)
+            parser->eolSeen = 0;
     }
     else
         curlen = 0;
@@ -981,10 +1228,7 @@ xconfigAddComment(char *cur, char *add)
     endnewline = add[len - 1] == '\n';
     len +=  1 + iscomment + (!hasnewline) + (!endnewline) + eol_seen;
 
-    if ((str = realloc(cur, len + curlen)) == NULL)
-        return (cur);
-
-    cur = str;
+    cur = xconfigRealloc(cur, len + curlen);
 
     if (eol_seen || (curlen && !hasnewline))
         cur[curlen++] = '\n';
@@ -997,16 +1241,277 @@ xconfigAddComment(char *cur, char *add)
     return (cur);
 }
 
+char *
+xconfigAddComment(char *cur, char *add)
+{
+    return xconfigParserAddComment(NULL, cur, add);
+}
+
 int
-xconfigGetStringToken (XConfigSymTabRec * tab)
+xconfigGetStringToken (XConfigParserPtr parser, XConfigSymTabRec * tab)
+{
+    return StringToToken (parser->val.str, tab);
+}
+
+
+/*
+ * Keyword lookup.
+ *
+ * Each symbol table gets a perfect hash over its normalized names
+ * (lowercase, with '_', ' ' and '\t' removed; see xconfigNameCompare()),
+ * built the first time the table is used.  Resolving a keyword then
+ * costs one normalization, one hash and one strcmp() against the
+ * single candidate, rather than an xconfigNameCompare() against every
+ * entry in the table.
+ *
+ * The indices are kept in a small open addressed registry keyed by
+ * the table address; all the tables are static arrays, so an index
+ * is never invalidated.  Parsers may run concurrently, so slots are
+ * claimed with an atomic compare and swap: if two threads build the
+ * same index at once, one of them wins and the other discards its
+ * copy.
+ */
+
+#define SYMTAB_REGISTRY_SIZE  64   /* power of two, > number of tables */
+#define SYMTAB_SEEDS_PER_SIZE 64
+
+typedef struct {
+    XConfigSymTabRec *tab;
+    int n;                         /* number of entries in tab */
+    unsigned int seed;
+    unsigned int mask;
+    int maxNameLen;
+    short *slots;                  /* index into tab, or -1 */
+    char **names;                  /* normalized name of each tab entry */
+} SymTabIndexRec, *SymTabIndexPtr;
+
+static SymTabIndexPtr symTabRegistry[SYMTAB_REGISTRY_SIZE];
+
+
+/*
+ * xconfigNormalizeName() - write the normalized form of s into buf;
+ * returns the length of the normalized name, or -1 if it does not
+ * fit in bufLen bytes (including the terminating NUL).
+ */
+
+static int xconfigNormalizeName(const char *s, char *buf, int bufLen)
+{
+    int len = 0;
+
+    for (; *s; s++) {
+        if (*s == '_' || *s == ' ' || *s == '\t') {
+            continue;
+        }
+        if (len + 1 >= bufLen) {
+            return -1;
+        }
+        buf[len++] = xconfigToLower(*s);
+    }
+
+    buf[len] = '\0';
+
+    return len;
+}
+
+
+static unsigned int xconfigHashName(const char *s, unsigned int seed)
 {
-    return StringToToken (val.str, tab);
+    unsigned int h = 2166136261U ^ seed;
+
+    while (*s) {
+        h ^= (unsigned char) *s++;
+        h *= 16777619U;
+    }
+
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dU;
+    h ^= h >> 12;
+
+    return h;
 }
 
+
+/*
+ * xconfigTrySeed() - fill index->slots using the given seed and mask;
+ * returns 0 if two names collide.
+ */
+
+static int xconfigTrySeed(SymTabIndexPtr index, int n,
+                          unsigned int seed, unsigned int mask)
+{
+    unsigned int h;
+    int i;
+
+    memset(index->slots, 0xff, (mask + 1) * sizeof(short));
+
+    for (i = 0; i < n; i++) {
+        if (!index->names[i]) {
+            continue;
+        }
+        h = xconfigHashName(index->names[i], seed) & mask;
+        if (index->slots[h] != -1) {
+            return 0;
+        }
+        index->slots[h] = i;
+    }
+
+    index->seed = seed;
+    index->mask = mask;
+
+    return 1;
+}
+
+
+static void xconfigFreeSymTabIndex(SymTabIndexPtr index)
+{
+    int i;
+
+    if (!index) return;
+
+    if (index->names) {
+        for (i = 0; i < index->n; i++) {
+            free(index->names[i]);
+        }
+    }
+    free(index->names);
+    free(index->slots);
+    free(index);
+}
+
+
+/*
+ * xconfigBuildSymTabIndex() - build the perfect hash for tab; returns
+ * NULL if that is not possible, in which case the caller falls back
+ * to a linear search.
+ */
+
+static SymTabIndexPtr xconfigBuildSymTabIndex(XConfigSymTabRec *tab)
+{
+    SymTabIndexPtr index;
+    unsigned int mask, seed;
+    int i, j, n, len;
+
+    for (n = 0; tab[n].token != -1; n++);
+
+    index = calloc(1, sizeof(SymTabIndexRec));
+    if (!index) return NULL;
+
+    index->tab = tab;
+    index->n = n;
+    index->names = calloc(n ? n : 1, sizeof(char *));
+    if (!index->names) goto fail;
+
+    /*
+     * normalize the names; like the linear search, the first of any
+     * entries that normalize to the same name wins, so later
+     * duplicates are left out of the hash
+     */
+
+    for (i = 0; i < n; i++) {
+        len = strlen(tab[i].name);
+        index->names[i] = malloc(len + 1);
+        if (!index->names[i]) goto fail;
+        len = xconfigNormalizeName(tab[i].name, index->names[i], len + 1);
+
+        for (j = 0; j < i; j++) {
+            if (index->names[j] && !strcmp(index->names[j], index->names[i])) {
+                break;
+            }
+        }
+        if (j < i) {
+            free(index->names[i]);
+            index->names[i] = NULL;
+            continue;
+        }
+
+        if (len > index->maxNameLen) {
+            index->maxNameLen = len;
+        }
+    }
+
+    /*
+     * start with a table at least twice the number of names, and
+     * double it whenever a handful of seeds fail to produce a
+     * collision free mapping
+     */
+
+    for (mask = 7; mask + 1 < 2 * n; mask = (mask << 1) | 1);
+
+    for (; mask < 0x7fff; mask = (mask << 1) | 1) {
+        free(index->slots);
+        index->slots = malloc((mask + 1) * sizeof(short));
+        if (!index->slots) goto fail;
+
+        for (seed = 0; seed < SYMTAB_SEEDS_PER_SIZE; seed++) {
+            if (xconfigTrySeed(index, n, seed, mask)) {
+                return index;
+            }
+        }
+    }
+
+ fail:
+    xconfigFreeSymTabIndex(index);
+    return NULL;
+}
+
+
+/*
+ * xconfigGetSymTabIndex() - find, or build and register, the index
+ * for tab
+ */
+
+static SymTabIndexPtr xconfigGetSymTabIndex(XConfigSymTabRec *tab)
+{
+    unsigned int h = ((unsigned long) tab >> 4) & (SYMTAB_REGISTRY_SIZE - 1);
+    unsigned int i = 0;
+    SymTabIndexPtr index, new = NULL;
+
+    while (i < SYMTAB_REGISTRY_SIZE) {
+        index = __atomic_load_n(&symTabRegistry[h], __ATOMIC_ACQUIRE);
+
+        if (!index) {
+            if (!new) {
+                new = xconfigBuildSymTabIndex(tab);
+                if (!new) return NULL;
+            }
+            if (__atomic_compare_exchange_n(&symTabRegistry[h], &index, new,
+                                            0, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                return new;
+            }
+            /* another thread claimed the slot; index is what it stored */
+        }
+        if (index->tab == tab) {
+            xconfigFreeSymTabIndex(new);
+            return index;
+        }
+        h = (h + 1) & (SYMTAB_REGISTRY_SIZE - 1);
+        i++;
+    }
+
+    xconfigFreeSymTabIndex(new);
+    return NULL;
+}
+
+
 static int
 StringToToken (char *str, XConfigSymTabRec * tab)
 {
-    int i;
+    SymTabIndexPtr index = xconfigGetSymTabIndex(tab);
+    char buf[128];
+    int i, len;
+
+    if (index && index->maxNameLen < sizeof(buf)) {
+        len = xconfigNormalizeName(str, buf, index->maxNameLen + 1);
+        if (len < 0) {
+            return (ERROR_TOKEN);
+        }
+        i = index->slots[xconfigHashName(buf, index->seed) & index->mask];
+        if ((i >= 0) && !strcmp(index->names[i], buf)) {
+            return tab[i].token;
+        }
+        return (ERROR_TOKEN);
+    }
 
     for (i = 0; tab[i].token != -1; i++)
     {
@@ -1017,6 +1522,32 @@ StringToToken (char *str, XConfigSymTabRec * tab)
 }
 
 
+/*
+ * Hash a name the way xconfigNameCompare() sees it: names that compare
+ * equal hash equal.  NULL hashes like "".  The seed lets callers keep
+ * names of different kinds apart.
+ */
+unsigned int
+xconfigNameHash (const char *s, unsigned int seed)
+{
+    unsigned int h = 2166136261U ^ seed;
+
+    if (s) {
+        for (; *s; s++) {
+            if (*s == '_' || *s == ' ' || *s == '\t')
+                continue;
+            h ^= (unsigned char) xconfigToLower(*s);
+            h *= 16777619U;
+        }
+    }
+
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dU;
+    h ^= h >> 12;
+
+    return h;
+}
+
 /* 
  * Compare two names.  The characters '_', ' ', and '\t' are ignored
  * in the comparison.
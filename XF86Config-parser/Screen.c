@@ -59,7 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec DisplayTab[] =
 {
@@ -82,111 +81,113 @@ static XConfigSymTabRec DisplayTab[] =
 static int addImpliedScreen(XConfigPtr config);
 
 XConfigDisplayPtr
-xconfigParseDisplaySubSection (void)
+xconfigParseDisplaySubSection (XConfigParserPtr parser)
 {
     int token;
+    GenericListPtr modesTail = NULL;
     PARSE_PROLOGUE (XConfigDisplayPtr, XConfigDisplayRec)
 
     ptr->black.red = ptr->black.green = ptr->black.blue = -1;
     ptr->white.red = ptr->white.green = ptr->white.blue = -1;
     ptr->frameX0 = ptr->frameY0 = -1;
-    while ((token = xconfigGetToken (DisplayTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (parser, DisplayTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case VIEWPORT:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (VIEWPORT_MSG, NULL);
-            ptr->frameX0 = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->frameX0 = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (VIEWPORT_MSG, NULL);
-            ptr->frameY0 = val.num;
+            ptr->frameY0 = parser->val.num;
             break;
         case VIRTUAL:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (VIRTUAL_MSG, NULL);
-            ptr->virtualX = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->virtualX = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (VIRTUAL_MSG, NULL);
-            ptr->virtualY = val.num;
+            ptr->virtualY = parser->val.num;
             break;
         case DEPTH:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Display");
-            ptr->depth = val.num;
+            ptr->depth = parser->val.num;
             break;
         case BPP:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "Display");
-            ptr->bpp = val.num;
+            ptr->bpp = parser->val.num;
             break;
         case VISUAL:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Display");
-            ptr->visual = val.str;
+            ptr->visual = parser->val.str;
             break;
         case WEIGHT:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (WEIGHT_MSG, NULL);
-            ptr->weight.red = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->weight.red = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (WEIGHT_MSG, NULL);
-            ptr->weight.green = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->weight.green = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (WEIGHT_MSG, NULL);
-            ptr->weight.blue = val.num;
+            ptr->weight.blue = parser->val.num;
             break;
         case BLACK_TOK:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (BLACK_MSG, NULL);
-            ptr->black.red = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->black.red = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (BLACK_MSG, NULL);
-            ptr->black.green = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->black.green = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (BLACK_MSG, NULL);
-            ptr->black.blue = val.num;
+            ptr->black.blue = parser->val.num;
             break;
         case WHITE_TOK:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (WHITE_MSG, NULL);
-            ptr->white.red = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->white.red = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (WHITE_MSG, NULL);
-            ptr->white.green = val.num;
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            ptr->white.green = parser->val.num;
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (WHITE_MSG, NULL);
-            ptr->white.blue = val.num;
+            ptr->white.blue = parser->val.num;
             break;
         case MODES:
             {
                 XConfigModePtr mptr;
 
                 while ((token =
-                        xconfigGetSubTokenWithTab(&(ptr->comment),
+                        xconfigGetSubTokenWithTab(parser, &(ptr->comment),
                                                   DisplayTab)) == STRING)
                 {
-                    mptr = calloc (1, sizeof (XConfigModeRec));
-                    mptr->mode_name = val.str;
+                    mptr = xconfigAlloc(sizeof (XConfigModeRec));
+                    mptr->mode_name = parser->val.str;
                     mptr->next = NULL;
-                    xconfigAddListItem((GenericListPtr *)(&ptr->modes),
-                                       (GenericListPtr) mptr);
+                    xconfigAppendListItem((GenericListPtr *)(&ptr->modes),
+                                          &modesTail, (GenericListPtr) mptr);
                 }
-                xconfigUnGetToken (token);
+                xconfigUnGetToken (parser, token);
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
             
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -216,93 +217,102 @@ static XConfigSymTabRec ScreenTab[] =
 
 #define CLEANUP xconfigFreeScreenList
 XConfigScreenPtr
-xconfigParseScreenSection (void)
+xconfigParseScreenSection (XConfigParserPtr parser)
 {
     int has_ident = FALSE;
     int has_driver= FALSE;
     int token;
+    GenericListPtr displaysTail = NULL, adaptorsTail;
 
     PARSE_PROLOGUE (XConfigScreenPtr, XConfigScreenRec)
 
-        while ((token = xconfigGetToken (ScreenTab)) != ENDSECTION)
+        while ((token = xconfigGetToken (parser, ScreenTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = parser->val.str;
             if (has_ident || has_driver)
                 Error (ONLY_ONE_MSG,"Identifier or Driver");
             has_ident = TRUE;
             break;
         case OBSDRIVER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Driver");
-            ptr->obsolete_driver = val.str;
+            ptr->obsolete_driver = parser->val.str;
             if (has_ident || has_driver)
                 Error (ONLY_ONE_MSG,"Identifier or Driver");
             has_driver = TRUE;
             break;
         case DEFAULTDEPTH:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "DefaultDepth");
-            ptr->defaultdepth = val.num;
+            ptr->defaultdepth = parser->val.num;
             break;
         case DEFAULTBPP:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "DefaultBPP");
-            ptr->defaultbpp = val.num;
+            ptr->defaultbpp = parser->val.num;
             break;
         case DEFAULTFBBPP:
-            if (xconfigGetSubToken (&(ptr->comment)) != NUMBER)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != NUMBER)
                 Error (NUMBER_MSG, "DefaultFbBPP");
-            ptr->defaultfbbpp = val.num;
+            ptr->defaultfbbpp = parser->val.num;
             break;
         case MDEVICE:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Device");
-            ptr->device_name = val.str;
+            ptr->device_name = parser->val.str;
             break;
         case MONITOR:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Monitor");
-            ptr->monitor_name = val.str;
+            ptr->monitor_name = parser->val.str;
             break;
         case VIDEOADAPTOR:
             {
                 XConfigAdaptorLinkPtr aptr;
 
-                if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+                if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                     Error (QUOTE_MSG, "VideoAdaptor");
 
-                /* Don't allow duplicates */
+                /*
+                 * Don't allow duplicates; the walk also finds the end
+                 * of the list to append to
+                 */
+                adaptorsTail = NULL;
                 for (aptr = ptr->adaptors; aptr; 
-                    aptr = (XConfigAdaptorLinkPtr) aptr->next)
-                    if (xconfigNameCompare (val.str, aptr->adaptor_name) == 0)
+                    aptr = (XConfigAdaptorLinkPtr) aptr->next) {
+                    if (xconfigNameCompare (parser->val.str,
+                                            aptr->adaptor_name) == 0)
                         break;
+                    adaptorsTail = (GenericListPtr) aptr;
+                }
 
                 if (aptr == NULL)
                 {
-                    aptr = calloc (1, sizeof (XConfigAdaptorLinkRec));
+                    aptr = xconfigAlloc(sizeof (XConfigAdaptorLinkRec));
                     aptr->next = NULL;
-                    aptr->adaptor_name = val.str;
-                    xconfigAddListItem ((GenericListPtr *)(&ptr->adaptors),
-                                        (GenericListPtr) aptr);
+                    aptr->adaptor_name = parser->val.str;
+                    xconfigAppendListItem ((GenericListPtr *)(&ptr->adaptors),
+                                           &adaptorsTail, (GenericListPtr) aptr);
                 }
             }
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "SubSection");
             {
-                free(val.str);
+                xconfigFree(parser->val.str);
                 HANDLE_LIST (displays, xconfigParseDisplaySubSection,
                              XConfigDisplayPtr);
             }
@@ -311,7 +321,7 @@ xconfigParseScreenSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -438,7 +448,7 @@ xconfigFreeScreenList (XConfigScreenPtr *ptr)
         xconfigFreeDisplayList (&((*ptr)->displays));
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -455,7 +465,7 @@ xconfigFreeAdaptorLinkList (XConfigAdaptorLinkPtr *ptr)
         TEST_FREE ((*ptr)->adaptor_name);
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -473,7 +483,7 @@ xconfigFreeDisplayList (XConfigDisplayPtr *ptr)
         xconfigFreeOptionList (&((*ptr)->options));
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -490,12 +500,30 @@ xconfigFreeModeList (XConfigModePtr *ptr)
         TEST_FREE ((*ptr)->mode_name);
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
+    }
+}
+
+/*
+ * xconfigResolveScreenIdentifiers() - a Screen section with only the
+ * obsolete "Driver" line is known by that name.  This is done before
+ * the name index is built, so that such screens are indexed.
+ */
+
+void
+xconfigResolveScreenIdentifiers (XConfigPtr p)
+{
+    XConfigScreenPtr screen;
+
+    for (screen = p->screens; screen; screen = screen->next)
+    {
+        if (screen->obsolete_driver && !screen->identifier)
+            screen->identifier = screen->obsolete_driver;
     }
 }
 
 int
-xconfigValidateScreen (XConfigPtr p)
+xconfigValidateScreen (XConfigParserPtr parser, XConfigPtr p)
 {
     XConfigScreenPtr screen = p->screens;
     XConfigMonitorPtr monitor;
@@ -511,30 +539,31 @@ xconfigValidateScreen (XConfigPtr p)
 
     while (screen)
     {
-        if (screen->obsolete_driver && !screen->identifier)
-            screen->identifier = screen->obsolete_driver;
-
-        monitor = xconfigFindMonitor (screen->monitor_name, p->monitors);
+        monitor = xconfigIndexFind (p, XCONFIG_INDEX_MONITOR,
+                                    screen->monitor_name);
         if (screen->monitor_name)
         {
             if (!monitor)
             {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_MONITOR_MSG,
+                xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                      UNDEFINED_MONITOR_MSG,
                              screen->monitor_name, screen->identifier);
                 return (FALSE);
             }
             else
             {
                 screen->monitor = monitor;
-                if (!xconfigValidateMonitor(p, screen))
+                if (!xconfigValidateMonitor(parser, p, screen))
                     return (FALSE);
             }
         }
 
-        device = xconfigFindDevice (screen->device_name, p->devices);
+        device = xconfigIndexFind (p, XCONFIG_INDEX_DEVICE,
+                                   screen->device_name);
         if (!device)
         {
-            xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_DEVICE_MSG,
+            xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                  UNDEFINED_DEVICE_MSG,
                          screen->device_name, screen->identifier);
             return (FALSE);
         }
@@ -543,15 +572,17 @@ xconfigValidateScreen (XConfigPtr p)
 
         adaptor = screen->adaptors;
         while (adaptor) {
-            adaptor->adaptor = xconfigFindVideoAdaptor(adaptor->adaptor_name,
-                                                       p->videoadaptors);
+            adaptor->adaptor = xconfigIndexFind(p, XCONFIG_INDEX_VIDEOADAPTOR,
+                                                adaptor->adaptor_name);
             if (!adaptor->adaptor) {
-                xconfigErrorMsg(ValidationErrorMsg, UNDEFINED_ADAPTOR_MSG,
+                xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                      UNDEFINED_ADAPTOR_MSG,
                              adaptor->adaptor_name,
                              screen->identifier);
                 return (FALSE);
             } else if (adaptor->adaptor->fwdref) {
-                xconfigErrorMsg(ValidationErrorMsg, ADAPTOR_REF_TWICE_MSG,
+                xconfigParserErrorMsg(parser, ValidationErrorMsg,
+                                      ADAPTOR_REF_TWICE_MSG,
                              adaptor->adaptor_name,
                              adaptor->adaptor->fwdref);
                 return (FALSE);
@@ -595,8 +626,8 @@ int xconfigSanitizeScreen(XConfigPtr p)
             }
 
             if (!monitor && screen->monitor_name) {
-                monitor = xconfigFindMonitor(screen->monitor_name,
-                                             p->monitors);
+                monitor = xconfigIndexFind(p, XCONFIG_INDEX_MONITOR,
+                                           screen->monitor_name);
             }
             
             if (!monitor && p->monitors) {
@@ -611,12 +642,12 @@ int xconfigSanitizeScreen(XConfigPtr p)
                 screen->monitor = monitor;
                 
                 if (screen->monitor_name) {
-                    free(screen->monitor_name);
+                    xconfigFree(screen->monitor_name);
                 }
                 
                 screen->monitor_name = xconfigStrdup(monitor->identifier);
                 
-                if (!xconfigValidateMonitor(p, screen)) {
+                if (!xconfigValidateMonitor(NULL, p, screen)) {
                     return FALSE;
                 }
             }
@@ -682,8 +713,8 @@ xconfigRemoveMode(XConfigModePtr *pHead, const char *name)
             } else {
                 *pHead = p->next;
             }
-            free(p->mode_name);
-            free(p);
+            xconfigFree(p->mode_name);
+            xconfigFree(p);
             return;
         }
         last = p;
@@ -705,7 +736,7 @@ static int addImpliedScreen(XConfigPtr config)
 
     /* allocate the new screen section */
 
-    screen = calloc(1, sizeof(XConfigScreenRec));
+    screen = xconfigAlloc(sizeof(XConfigScreenRec));
     if (!screen) return FALSE;
     
     screen->identifier = xconfigStrdup("Default Screen");
@@ -729,6 +760,7 @@ static int addImpliedScreen(XConfigPtr config)
     }
 
     config->screens = screen;
+    xconfigIndexAdd(config, XCONFIG_INDEX_SCREEN, screen, FALSE);
 
     return TRUE;
 }
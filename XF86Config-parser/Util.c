@@ -24,17 +24,301 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "xf86Parser.h"
 #include "Configint.h"
 
+/*
+ * Arena allocation: while an arena is current for the calling thread
+ * (see xconfigSetArena()), xconfigAlloc(), xconfigStrdup() and
+ * xconfigStrcat() carve their memory out of a few large blocks owned
+ * by that arena.  xconfigFree() of arena memory does nothing; the
+ * memory is released all at once by xconfigFreeArena().
+ *
+ * Each allocation is preceded by its size, so that xconfigRealloc()
+ * can copy it.  The address ranges of all live blocks are kept in a
+ * sorted table, so that xconfigFree() and xconfigRealloc() can tell
+ * arena memory from heap memory, whichever arena is current.
+ *
+ * Allocations are laid out so that the memory handed out starts
+ * ARENA_HDR_SIZE bytes past an ARENA_ALIGN boundary, which is enough
+ * alignment for the config tree.  malloc() returns memory aligned to
+ * ARENA_ALIGN on the platforms we build for, so a pointer that is
+ * ARENA_ALIGN aligned is heap memory, and is freed without searching
+ * the table or taking its lock (see MAYBE_ARENA_MEMORY()).  Where
+ * malloc() aligns less, heap pointers just take the slower path.
+ */
+
+#define ARENA_ALIGN      16
+#define ARENA_HDR_SIZE   8
+#define ARENA_MIN_BLOCK  (16 * 1024)
+#define ARENA_MAX_BLOCK  (1024 * 1024)
+
+#define ARENA_ROUND(x) (((x) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+#define MAYBE_ARENA_MEMORY(p) \
+    (((uintptr_t) (p) & (ARENA_ALIGN - 1)) == ARENA_HDR_SIZE)
+
+typedef struct __xconfigarenablock {
+    struct __xconfigarenablock *next;
+    char *cur;
+    char *end;
+} XConfigArenaBlockRec, *XConfigArenaBlockPtr;
+
+#define ARENA_BLOCK_HDR_SIZE ARENA_ROUND(sizeof(XConfigArenaBlockRec))
+
+struct __xconfigarena {
+    XConfigArenaBlockPtr blocks;
+    size_t nextBlockSize;
+};
+
+typedef struct {
+    char *start;
+    char *end;
+    XConfigArenaPtr arena;
+} ArenaRangeRec, *ArenaRangePtr;
+
+static pthread_mutex_t arenaRangeLock = PTHREAD_MUTEX_INITIALIZER;
+static ArenaRangePtr arenaRanges = NULL;
+static int nArenaRanges = 0;
+static int maxArenaRanges = 0;
+
+static __thread XConfigArenaPtr currentArena = NULL;
+
+
+static void xconfigAllocFailed(void)
+{
+    fprintf(stderr, "memory allocation failure (%s)! \n", strerror(errno));
+    exit(1);
+}
+
+
+/*
+ * findArenaRange() - return the index of the last range starting at
+ * or before p, or -1; arenaRangeLock must be held.
+ */
+
+static int findArenaRange(const char *p)
+{
+    int lo = 0, hi = nArenaRanges - 1, found = -1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (arenaRanges[mid].start <= p) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return found;
+}
+
+
+/*
+ * findArenaOwner() - return the arena that p was allocated from, or
+ * NULL if p is not arena memory.
+ */
+
+static XConfigArenaPtr findArenaOwner(const void *p)
+{
+    XConfigArenaPtr arena = NULL;
+    int i;
+
+    if (!MAYBE_ARENA_MEMORY(p) ||
+        (__atomic_load_n(&nArenaRanges, __ATOMIC_ACQUIRE) == 0)) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&arenaRangeLock);
+    i = findArenaRange(p);
+    if ((i >= 0) && ((const char *) p < arenaRanges[i].end)) {
+        arena = arenaRanges[i].arena;
+    }
+    pthread_mutex_unlock(&arenaRangeLock);
+
+    return arena;
+}
+
+
+static void addArenaRange(XConfigArenaPtr arena, XConfigArenaBlockPtr block)
+{
+    int i;
+
+    pthread_mutex_lock(&arenaRangeLock);
+
+    if (nArenaRanges == maxArenaRanges) {
+        int n = maxArenaRanges ? maxArenaRanges * 2 : 64;
+        ArenaRangePtr tmp = realloc(arenaRanges, n * sizeof(ArenaRangeRec));
+        if (!tmp) {
+            xconfigAllocFailed();
+        }
+        arenaRanges = tmp;
+        maxArenaRanges = n;
+    }
+
+    i = findArenaRange((char *) block) + 1;
+    memmove(&arenaRanges[i + 1], &arenaRanges[i],
+            (nArenaRanges - i) * sizeof(ArenaRangeRec));
+    arenaRanges[i].start = (char *) block;
+    arenaRanges[i].end = block->end;
+    arenaRanges[i].arena = arena;
+
+    __atomic_store_n(&nArenaRanges, nArenaRanges + 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&arenaRangeLock);
+}
+
+
+static void removeArenaRanges(XConfigArenaPtr arena)
+{
+    int i, j;
+
+    pthread_mutex_lock(&arenaRangeLock);
+
+    for (i = j = 0; i < nArenaRanges; i++) {
+        if (arenaRanges[i].arena != arena) {
+            arenaRanges[j++] = arenaRanges[i];
+        }
+    }
+
+    __atomic_store_n(&nArenaRanges, j, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&arenaRangeLock);
+}
+
+
+
+/*
+ * xconfigNewArena() - create an empty arena.
+ */
+
+XConfigArenaPtr xconfigNewArena(void)
+{
+    XConfigArenaPtr arena = calloc(1, sizeof(*arena));
+
+    if (!arena) {
+        xconfigAllocFailed();
+    }
+    arena->nextBlockSize = ARENA_MIN_BLOCK;
+
+    return arena;
+
+} /* xconfigNewArena() */
+
+
+
+/*
+ * xconfigFreeArena() - release an arena and everything allocated
+ * from it.
+ */
+
+void xconfigFreeArena(XConfigArenaPtr arena)
+{
+    XConfigArenaBlockPtr block, next;
+
+    if (!arena) return;
+
+    if (currentArena == arena) {
+        currentArena = NULL;
+    }
+
+    removeArenaRanges(arena);
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+    free(arena);
+
+} /* xconfigFreeArena() */
+
+
+
+/*
+ * xconfigSetArena() - make arena the one that this thread allocates
+ * from (NULL selects the heap); returns the previous arena, so that
+ * callers can restore it.
+ */
+
+XConfigArenaPtr xconfigSetArena(XConfigArenaPtr arena)
+{
+    XConfigArenaPtr prev = currentArena;
+
+    currentArena = arena;
+
+    return prev;
+
+} /* xconfigSetArena() */
+
+
+
+/*
+ * arenaAlloc() - return size bytes of zeroed memory from arena.
+ * Requests that would waste most of a block get a block of their
+ * own, placed behind the block that is being filled.
+ */
+
+static void *arenaAlloc(XConfigArenaPtr arena, size_t size)
+{
+    XConfigArenaBlockPtr block = arena->blocks;
+    size_t need = ARENA_ROUND(ARENA_HDR_SIZE + size);
+    char *m;
+
+    if (!block || (size_t) (block->end - block->cur) < need) {
+        size_t blockSize = arena->nextBlockSize;
+        int ownBlock = (need > blockSize / 4);
+
+        if (ownBlock) {
+            blockSize = need;
+        } else if (arena->nextBlockSize < ARENA_MAX_BLOCK) {
+            arena->nextBlockSize *= 2;
+        }
+
+        block = malloc(ARENA_BLOCK_HDR_SIZE + blockSize);
+        if (!block) {
+            xconfigAllocFailed();
+        }
+        block->cur = (char *) block + ARENA_BLOCK_HDR_SIZE;
+        block->end = block->cur + blockSize;
+
+        if (ownBlock && arena->blocks) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+
+        addArenaRange(arena, block);
+    }
+
+    m = block->cur + ARENA_HDR_SIZE;
+    block->cur += need;
+
+    *(size_t *) (m - sizeof(size_t)) = size;
+    memset(m, 0, size);
+
+    return m;
+}
+
+
+
 void *xconfigAlloc(size_t size)
 {
-    void *m = malloc(size);
+    void *m;
+
+    if (currentArena) {
+        return arenaAlloc(currentArena, size);
+    }
+
+    m = malloc(size);
     
     if (!m) {
-        fprintf(stderr, "memory allocation failure (%s)! \n", strerror(errno));
-        exit(1);
+        xconfigAllocFailed();
     }
     memset((char *) m, 0, size);
     return m;
@@ -42,6 +326,86 @@ void *xconfigAlloc(size_t size)
 } /* xconfigAlloc() */
 
 
+
+/*
+ * xconfigRealloc() - resize memory from xconfigAlloc(); memory that
+ * came from an arena is grown within the same arena.
+ */
+
+void *xconfigRealloc(void *p, size_t size)
+{
+    XConfigArenaPtr arena;
+    void *m;
+
+    if (!p) {
+        return xconfigAlloc(size);
+    }
+
+    arena = findArenaOwner(p);
+
+    if (arena) {
+        size_t old = *(size_t *) ((char *) p - sizeof(size_t));
+        m = arenaAlloc(arena, size);
+        memcpy(m, p, (old < size) ? old : size);
+        return m;
+    }
+
+    m = realloc(p, size);
+
+    if (!m) {
+        xconfigAllocFailed();
+    }
+    return m;
+
+} /* xconfigRealloc() */
+
+
+
+/*
+ * xconfigAllocBeside() - like xconfigAlloc(), but allocate from the
+ * arena that p came from (or the heap, if it did not come from one),
+ * so that the new memory lives as long as p does.
+ */
+
+void *xconfigAllocBeside(const void *p, size_t size)
+{
+    XConfigArenaPtr arena = findArenaOwner(p);
+    void *m;
+
+    if (arena) {
+        return arenaAlloc(arena, size);
+    }
+
+    m = calloc(1, size);
+
+    if (!m) {
+        xconfigAllocFailed();
+    }
+    return m;
+
+} /* xconfigAllocBeside() */
+
+
+
+/*
+ * xconfigFree() - free memory from xconfigAlloc() and friends; arena
+ * memory is left alone until its arena is freed.
+ */
+
+void xconfigFree(void *p)
+{
+    if (!p) return;
+
+    if (findArenaOwner(p)) {
+        return;
+    }
+
+    free(p);
+
+} /* xconfigFree() */
+
+
+
 /*
  * xconfigStrdup() - wrapper for strdup() that checks the return
  * value; if an error occurs, an error is printed to stderr and exit
@@ -51,9 +415,17 @@ void *xconfigAlloc(size_t size)
 char *xconfigStrdup(const char *s)
 {
     char *m;
+    size_t len;
 
     if (!s) return NULL;
 
+    if (currentArena) {
+        len = strlen(s) + 1;
+        m = arenaAlloc(currentArena, len);
+        memcpy(m, s, len);
+        return m;
+    }
+
     m = strdup(s);
     
     if (!m) {
@@ -111,21 +483,23 @@ char *xconfigStrcat(const char *str, ...)
 
 #define NV_FMT_BUF_LEN 64
 
-extern int configLineNo;
-extern char *configSection;
-extern char *configPath;
-
-void xconfigErrorMsg(MsgType t, char *fmt, ...)
+static void xconfigVErrorMsg(XConfigParserPtr parser, MsgType t,
+                             char *fmt, va_list args)
 {
     va_list ap;
     int len, current_len = NV_FMT_BUF_LEN;
     char *b, *pre = NULL, *msg;
     char scratch[64];
+    XConfigArenaPtr prevArena;
+
+    /* the message buffers are transient; keep them off any arena */
+
+    prevArena = xconfigSetArena(NULL);
 
     b = xconfigAlloc(current_len);
     
     while (1) {
-        va_start(ap, fmt);
+        va_copy(ap, args);
         len = vsnprintf(b, current_len, fmt, ap);
         va_end(ap);
 
@@ -143,17 +517,20 @@ void xconfigErrorMsg(MsgType t, char *fmt, ...)
 
     switch (t) {
     case ParseErrorMsg:
-        sprintf(scratch, "%d", configLineNo);
+        sprintf(scratch, "%d", parser->lineNo);
         pre = xconfigStrcat("Parse error on line ", scratch, " of section ",
-                         configSection, " in file ", configPath, ".\n", NULL);
+                         parser->section, " in file ", parser->path, ".\n",
+                         NULL);
         break;
     case ParseWarningMsg:
-        sprintf(scratch, "%d", configLineNo);
+        sprintf(scratch, "%d", parser->lineNo);
         pre = xconfigStrcat("Parse warning on line ", scratch, " of section ",
-                         configSection, " in file ", configPath, ".\n", NULL);
+                         parser->section, " in file ", parser->path, ".\n",
+                         NULL);
         break;
     case ValidationErrorMsg:
-        pre = xconfigStrcat("Data incomplete in file ", configPath, ".\n", NULL);
+        pre = xconfigStrcat("Data incomplete in file ", parser->path, ".\n",
+                            NULL);
         break;
     case InternalErrorMsg: break;
     case WriteErrorMsg: break;
@@ -177,4 +554,37 @@ void xconfigErrorMsg(MsgType t, char *fmt, ...)
     free(b);
     free(msg);
     if (pre) free(pre);
+
+    xconfigSetArena(prevArena);
+}
+
+
+/*
+ * xconfigParserErrorMsg() - print a message; parse and validation
+ * messages are prefixed with the position in the config that parser
+ * is reading.  A NULL parser refers to the process-wide parser used
+ * by xconfigReadConfigFile().
+ */
+
+void xconfigParserErrorMsg(XConfigParserPtr parser, MsgType t, char *fmt, ...)
+{
+    va_list ap;
+
+    if (!parser) {
+        parser = xconfigGetDefaultParser();
+    }
+
+    va_start(ap, fmt);
+    xconfigVErrorMsg(parser, t, fmt, ap);
+    va_end(ap);
+}
+
+
+void xconfigErrorMsg(MsgType t, char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    xconfigVErrorMsg(xconfigGetDefaultParser(), t, fmt, ap);
+    va_end(ap);
 }
@@ -59,7 +59,6 @@
 #include "xf86tokens.h"
 #include "Configint.h"
 
-extern LexRec val;
 
 static XConfigSymTabRec VendorSubTab[] =
 {
@@ -72,36 +71,37 @@ static XConfigSymTabRec VendorSubTab[] =
 #define CLEANUP xconfigFreeVendorSubList
 
 XConfigVendSubPtr
-xconfigParseVendorSubSection (void)
+xconfigParseVendorSubSection (XConfigParserPtr parser)
 {
     int has_ident = FALSE;
     int token;
     PARSE_PROLOGUE (XConfigVendSubPtr, XConfigVendSubRec)
 
-    while ((token = xconfigGetToken (VendorSubTab)) != ENDSUBSECTION)
+    while ((token = xconfigGetToken (parser, VendorSubTab)) != ENDSUBSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)))
+            if (xconfigGetSubToken (parser, &(ptr->comment)))
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = parser->val.str;
             has_ident = TRUE;
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
 
         case EOF_TOKEN:
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
     }
@@ -123,32 +123,34 @@ static XConfigSymTabRec VendorTab[] =
 #define CLEANUP xconfigFreeVendorList
 
 XConfigVendorPtr
-xconfigParseVendorSection (void)
+xconfigParseVendorSection (XConfigParserPtr parser)
 {
     int has_ident = FALSE;
     int token;
+    GenericListPtr subsTail = NULL;
     PARSE_PROLOGUE (XConfigVendorPtr, XConfigVendorRec)
 
-    while ((token = xconfigGetToken (VendorTab)) != ENDSECTION)
+    while ((token = xconfigGetToken (parser, VendorTab)) != ENDSECTION)
     {
         switch (token)
         {
         case COMMENT:
-            ptr->comment = xconfigAddComment(ptr->comment, val.str);
+            ptr->comment = xconfigParserAddComment(parser, ptr->comment,
+                                                   parser->val.str);
             break;
         case IDENTIFIER:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "Identifier");
             if (has_ident == TRUE)
                 Error (MULTIPLE_MSG, "Identifier");
-            ptr->identifier = val.str;
+            ptr->identifier = parser->val.str;
             has_ident = TRUE;
             break;
         case OPTION:
-            ptr->options = xconfigParseOption(ptr->options);
+            ptr->options = xconfigParserParseOption(parser, ptr->options);
             break;
         case SUBSECTION:
-            if (xconfigGetSubToken (&(ptr->comment)) != STRING)
+            if (xconfigGetSubToken (parser, &(ptr->comment)) != STRING)
                 Error (QUOTE_MSG, "SubSection");
             {
                 HANDLE_LIST (subs, xconfigParseVendorSubSection,
@@ -159,7 +161,7 @@ xconfigParseVendorSection (void)
             Error (UNEXPECTED_EOF_MSG, NULL);
             break;
         default:
-            Error (INVALID_KEYWORD_MSG, xconfigTokenString ());
+            Error (INVALID_KEYWORD_MSG, xconfigTokenString (parser));
             break;
         }
 
@@ -212,7 +214,7 @@ xconfigFreeVendorList (XConfigVendorPtr *p)
     TEST_FREE ((*p)->identifier);
     TEST_FREE ((*p)->comment);
     xconfigFreeOptionList (&((*p)->options));
-    free (*p);
+    xconfigFree (*p);
     *p = NULL;
 }
 
@@ -232,7 +234,7 @@ xconfigFreeVendorSubList (XConfigVendSubPtr *ptr)
         xconfigFreeOptionList (&((*ptr)->options));
         prev = *ptr;
         *ptr = (*ptr)->next;
-        free (prev);
+        xconfigFree (prev);
     }
 }
 
@@ -138,7 +138,7 @@ int xconfigWriteConfigFile (const char *filename, XConfigPtr cptr)
 
     if (locale) {
         setlocale(LC_ALL, locale);
-        free(locale);
+        xconfigFree(locale);
     }
 
     return TRUE;
@@ -31,95 +31,127 @@
 
 
 /* Device.c */
-XConfigDevicePtr xconfigParseDeviceSection(void);
+XConfigDevicePtr xconfigParseDeviceSection(XConfigParserPtr parser);
 void xconfigPrintDeviceSection(FILE *cf, XConfigDevicePtr ptr);
-int xconfigValidateDevice(XConfigPtr p);
+int xconfigValidateDevice(XConfigParserPtr parser, XConfigPtr p);
 
 /* Files.c */
-XConfigFilesPtr xconfigParseFilesSection(void);
+XConfigFilesPtr xconfigParseFilesSection(XConfigParserPtr parser);
 void xconfigPrintFileSection(FILE *cf, XConfigFilesPtr ptr);
 
 /* Flags.c */
-XConfigFlagsPtr xconfigParseFlagsSection(void);
+XConfigFlagsPtr xconfigParseFlagsSection(XConfigParserPtr parser);
 void xconfigPrintServerFlagsSection(FILE *f, XConfigFlagsPtr flags);
 
 /* Input.c */
-XConfigInputPtr xconfigParseInputSection(void);
-XConfigInputClassPtr xconfigParseInputClassSection(void);
+XConfigInputPtr xconfigParseInputSection(XConfigParserPtr parser);
+XConfigInputClassPtr xconfigParseInputClassSection(XConfigParserPtr parser);
 void xconfigPrintInputSection(FILE *f, XConfigInputPtr ptr);
 void xconfigPrintInputClassSection(FILE *f, XConfigInputClassPtr ptr);
-int xconfigValidateInput (XConfigPtr p);
+int xconfigValidateInput (XConfigParserPtr parser, XConfigPtr p);
 
 /* Keyboard.c */
-XConfigInputPtr xconfigParseKeyboardSection(void);
+XConfigInputPtr xconfigParseKeyboardSection(XConfigParserPtr parser);
 
 /* Layout.c */
-XConfigLayoutPtr xconfigParseLayoutSection(void);
+XConfigLayoutPtr xconfigParseLayoutSection(XConfigParserPtr parser);
 void xconfigPrintLayoutSection(FILE *cf, XConfigLayoutPtr ptr);
-int xconfigValidateLayout(XConfigPtr p);
+int xconfigValidateLayout(XConfigParserPtr parser, XConfigPtr p);
 int xconfigSanitizeLayout(XConfigPtr p, const char *screenName,
                           GenerateOptions *gop);
 
 /* Module.c */
-XConfigLoadPtr xconfigParseModuleSubSection(XConfigLoadPtr head, char *name);
-XConfigModulePtr xconfigParseModuleSection(void);
+XConfigLoadPtr xconfigParseModuleSubSection(XConfigParserPtr parser,
+                                            XConfigLoadPtr head,
+                                            GenericListPtr *pTail, char *name);
+XConfigModulePtr xconfigParseModuleSection(XConfigParserPtr parser);
+void xconfigParserAddNewLoadDirective(XConfigParserPtr parser,
+                                      XConfigLoadPtr *pHead,
+                                      GenericListPtr *pTail, char *name,
+                                      int type, XConfigOptionPtr opts,
+                                      int do_token);
 void xconfigPrintModuleSection(FILE *cf, XConfigModulePtr ptr);
 
 /* Monitor.c */
-XConfigModeLinePtr xconfigParseModeLine(void);
-XConfigModeLinePtr xconfigParseVerboseMode(void);
-XConfigMonitorPtr xconfigParseMonitorSection(void);
-XConfigModesPtr xconfigParseModesSection(void);
+XConfigModeLinePtr xconfigParseModeLine(XConfigParserPtr parser);
+XConfigModeLinePtr xconfigParseVerboseMode(XConfigParserPtr parser);
+XConfigMonitorPtr xconfigParseMonitorSection(XConfigParserPtr parser);
+XConfigModesPtr xconfigParseModesSection(XConfigParserPtr parser);
 void xconfigPrintMonitorSection(FILE *cf, XConfigMonitorPtr ptr);
 void xconfigPrintModesSection(FILE *cf, XConfigModesPtr ptr);
-int xconfigValidateMonitor(XConfigPtr p, XConfigScreenPtr screen);
+int xconfigValidateMonitor(XConfigParserPtr parser, XConfigPtr p,
+                           XConfigScreenPtr screen);
 
 /* Pointer.c */
-XConfigInputPtr xconfigParsePointerSection(void);
+XConfigInputPtr xconfigParsePointerSection(XConfigParserPtr parser);
 
 /* Screen.c */
-XConfigDisplayPtr xconfigParseDisplaySubSection(void);
-XConfigScreenPtr xconfigParseScreenSection(void);
+XConfigDisplayPtr xconfigParseDisplaySubSection(XConfigParserPtr parser);
+XConfigScreenPtr xconfigParseScreenSection(XConfigParserPtr parser);
 void xconfigPrintScreenSection(FILE *cf, XConfigScreenPtr ptr);
-int xconfigValidateScreen(XConfigPtr p);
+void xconfigResolveScreenIdentifiers(XConfigPtr p);
+int xconfigValidateScreen(XConfigParserPtr parser, XConfigPtr p);
 int xconfigSanitizeScreen(XConfigPtr p);
 
 /* Vendor.c */
-XConfigVendorPtr xconfigParseVendorSection(void);
-XConfigVendSubPtr xconfigParseVendorSubSection (void);
+XConfigVendorPtr xconfigParseVendorSection(XConfigParserPtr parser);
+XConfigVendSubPtr xconfigParseVendorSubSection(XConfigParserPtr parser);
 void xconfigPrintVendorSection(FILE * cf, XConfigVendorPtr ptr);
 
 /* Video.c */
-XConfigVideoPortPtr xconfigParseVideoPortSubSection(void);
-XConfigVideoAdaptorPtr xconfigParseVideoAdaptorSection(void);
+XConfigVideoPortPtr xconfigParseVideoPortSubSection(XConfigParserPtr parser);
+XConfigVideoAdaptorPtr
+xconfigParseVideoAdaptorSection(XConfigParserPtr parser);
 void xconfigPrintVideoAdaptorSection(FILE *cf, XConfigVideoAdaptorPtr ptr);
 
 /* Read.c */
 int xconfigValidateConfig(XConfigPtr p);
+int xconfigParserValidateConfig(XConfigParserPtr parser, XConfigPtr p);
 
 /* Scan.c */
-int xconfigGetToken(XConfigSymTabRec *tab);
-int xconfigGetSubToken(char **comment);
-int xconfigGetSubTokenWithTab(char **comment, XConfigSymTabRec *tab);
-void xconfigUnGetToken(int token);
-char *xconfigTokenString(void);
-void xconfigSetSection(char *section);
-int xconfigGetStringToken(XConfigSymTabRec *tab);
-char *xconfigGetConfigFileName(void);
+int xconfigGetToken(XConfigParserPtr parser, XConfigSymTabRec *tab);
+int xconfigGetSubToken(XConfigParserPtr parser, char **comment);
+int xconfigGetSubTokenWithTab(XConfigParserPtr parser, char **comment,
+                              XConfigSymTabRec *tab);
+void xconfigUnGetToken(XConfigParserPtr parser, int token);
+char *xconfigTokenString(XConfigParserPtr parser);
+void xconfigSetSection(XConfigParserPtr parser, char *section);
+int xconfigGetStringToken(XConfigParserPtr parser, XConfigSymTabRec *tab);
+char *xconfigGetConfigFileName(XConfigParserPtr parser);
+char *xconfigParserAddComment(XConfigParserPtr parser, char *cur, char *add);
+XConfigParserPtr xconfigGetDefaultParser(void);
+unsigned int xconfigNameHash(const char *s, unsigned int seed);
 
 /* Write.c */
 
 /* DRI.c */
-XConfigBuffersPtr xconfigParseBuffers (void);
-XConfigDRIPtr xconfigParseDRISection (void);
+XConfigBuffersPtr xconfigParseBuffers(XConfigParserPtr parser);
+XConfigDRIPtr xconfigParseDRISection(XConfigParserPtr parser);
 void xconfigPrintDRISection (FILE * cf, XConfigDRIPtr ptr);
 
+/* NameIndex.c */
+typedef enum {
+    XCONFIG_INDEX_SCREEN,
+    XCONFIG_INDEX_DEVICE,
+    XCONFIG_INDEX_MONITOR,
+    XCONFIG_INDEX_INPUT,
+    XCONFIG_INDEX_MODES,
+    XCONFIG_INDEX_VIDEOADAPTOR
+} XConfigIndexKind;
+typedef struct __xconfignameindexrec *XConfigNameIndexPtr;
+int xconfigBuildNameIndex(XConfigPtr p);
+void xconfigDropNameIndex(XConfigPtr p);
+void xconfigIndexAdd(XConfigPtr p, XConfigIndexKind kind, void *item,
+                     int atHead);
+void *xconfigIndexFind(XConfigPtr p, XConfigIndexKind kind, const char *name);
+
 /* Util.c */
-void *xconfigAlloc(size_t size);
+void *xconfigAllocBeside(const void *p, size_t size);
 void xconfigErrorMsg(MsgType, char *fmt, ...);
+void xconfigParserErrorMsg(XConfigParserPtr parser, MsgType, char *fmt, ...);
 
 /* Extensions.c */
-XConfigExtensionsPtr xconfigParseExtensionsSection (void);
+XConfigExtensionsPtr xconfigParseExtensionsSection(XConfigParserPtr parser);
 void xconfigPrintExtensionsSection (FILE * cf, XConfigExtensionsPtr ptr);
 
 /* Generate.c */
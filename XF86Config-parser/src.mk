@@ -12,6 +12,7 @@ XCONFIG_PARSER_SRC += Layout.c
 XCONFIG_PARSER_SRC += Merge.c
 XCONFIG_PARSER_SRC += Module.c
 XCONFIG_PARSER_SRC += Monitor.c
+XCONFIG_PARSER_SRC += NameIndex.c
 XCONFIG_PARSER_SRC += Pointer.c
 XCONFIG_PARSER_SRC += Read.c
 XCONFIG_PARSER_SRC += Scan.c
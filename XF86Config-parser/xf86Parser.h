@@ -141,7 +141,10 @@ typedef struct { void *next; } GenericListRec, *GenericListPtr;
 
 
 /*
- * Options are stored in the XConfigOptionRec structure
+ * Options are stored in the XConfigOptionRec structure.  Long option
+ * lists carry a lookup index, which the xconfig*Option*() functions
+ * keep up to date (see Flags.c); options should be removed and freed
+ * through them.
  */
 
 typedef struct __xconfigoptionrec {
@@ -149,6 +152,7 @@ typedef struct __xconfigoptionrec {
     char *name;
     char *val;
     char *comment;
+    struct __xconfigoptionindexrec *index;  /* private; see Flags.c */
 } XConfigOptionRec, *XConfigOptionPtr;
 
 
@@ -578,6 +582,14 @@ typedef struct
 XConfigExtensionsRec, *XConfigExtensionsPtr;
 
 
+/*
+ * An arena hands out the memory of a whole config tree from a few
+ * large blocks; see xconfigSetArena().
+ */
+
+typedef struct __xconfigarena *XConfigArenaPtr;
+
+
 /*
  * Configuration file structure
  */
@@ -599,6 +611,8 @@ typedef struct {
     XConfigExtensionsPtr   extensions;
     char                  *comment;
     char                  *filename;
+    XConfigArenaPtr        arena;     /* NULL if allocated from the heap */
+    struct __xconfignameindexrec *nameIndex; /* private; see NameIndex.c */
 } XConfigRec, *XConfigPtr;
 
 typedef struct {
@@ -626,21 +640,62 @@ typedef struct {
     int autoloads_glx;
     int xinerama_plus_composite_works;
 
+    char *xserver_cache_file; /* where to keep the results of probing the
+                                 X server; NULL to probe every time */
+
+    char *proc_root;          /* where procfs is mounted; used to look
+                                 for a running font server */
+
 } GenerateOptions;
 
 
+/*
+ * An XConfigParser holds the state of one config being read; the
+ * xconfigParser*() functions below can be used from several threads
+ * at once, as long as each thread uses its own parser.  The
+ * functions without a parser argument use a single parser shared by
+ * the whole process.
+ */
+
+typedef struct __xconfigparserrec *XConfigParserPtr;
+
+XConfigParserPtr xconfigNewParser(void);
+void xconfigFreeParser(XConfigParserPtr *parser);
+
 /*
  * Functions for open, reading, and writing XConfig files.
  */
 const char *xconfigOpenConfigFile(const char *, const char *);
+const char *xconfigOpenConfigBuffer(const char *, size_t, const char *);
 XConfigError xconfigReadConfigFile(XConfigPtr *);
 int xconfigSanitizeConfig(XConfigPtr p, const char *screenName,
                           GenerateOptions *gop);
 void xconfigCloseConfigFile(void);
 int xconfigWriteConfigFile(const char *, XConfigPtr);
 
+const char *xconfigParserOpenConfigFile(XConfigParserPtr, const char *,
+                                        const char *);
+const char *xconfigParserOpenConfigBuffer(XConfigParserPtr, const char *,
+                                          size_t, const char *);
+XConfigError xconfigParserReadConfigFile(XConfigParserPtr, XConfigPtr *);
+void xconfigParserCloseConfigFile(XConfigParserPtr);
+void xconfigParserUseArena(XConfigParserPtr, int);
+
 void xconfigFreeConfig(XConfigPtr *p);
 
+/*
+ * Arena allocation.  While an arena is current for a thread, the
+ * allocations the parser makes for config trees on that thread come
+ * from it, and xconfigFreeConfig() of a config read into an arena
+ * (see xconfigParserUseArena()) releases the arena in one step,
+ * rather than walking the tree.  Memory attached to such a config by
+ * other means than the xconfig*() functions is not freed with it.
+ */
+
+XConfigArenaPtr xconfigNewArena(void);
+void xconfigFreeArena(XConfigArenaPtr arena);
+XConfigArenaPtr xconfigSetArena(XConfigArenaPtr arena);
+
 /*
  * Functions for searching for entries in lists
  */
@@ -697,6 +752,8 @@ void xconfigFreeModesLinkList(XConfigModesLinkPtr *ptr);
  */
 
 void xconfigAddListItem(GenericListPtr *pHead, GenericListPtr c_new);
+void xconfigAppendListItem(GenericListPtr *pHead, GenericListPtr *pTail,
+                           GenericListPtr c_new);
 void xconfigRemoveListItem(GenericListPtr *pHead, GenericListPtr item);
 int xconfigItemNotSublist(GenericListPtr list_1, GenericListPtr list_2);
 char *xconfigAddComment(char *cur, char *add);
@@ -732,12 +789,17 @@ XConfigOptionPtr xconfigOptionListMerge(XConfigOptionPtr head,
  * Miscellaneous utility routines
  */
 
+void *xconfigAlloc(size_t size);
+void *xconfigRealloc(void *p, size_t size);
+void xconfigFree(void *p);
 char *xconfigStrdup(const char *s);
 char *xconfigStrcat(const char *str, ...);
 int xconfigNameCompare(const char *s1, const char *s2);
 int xconfigModelineCompare(XConfigModeLinePtr m1, XConfigModeLinePtr m2);
 char *xconfigULongToString(unsigned long i);
 XConfigOptionPtr xconfigParseOption(XConfigOptionPtr head);
+XConfigOptionPtr xconfigParserParseOption(XConfigParserPtr parser,
+                                          XConfigOptionPtr head);
 void xconfigPrintOptionList(FILE *fp, XConfigOptionPtr list, int tabs);
 int xconfigParsePciBusString(const char *busID,
                              int *bus, int *device, int *func);
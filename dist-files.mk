@@ -35,6 +35,9 @@ SRC += util.c
 SRC += nvidia-xconfig.c
 SRC += make_usable.c
 SRC += multiple_screens.c
+SRC += gpu_cache.c
+SRC += pci_sysfs.c
+SRC += probe_trace.c
 SRC += tree.c
 SRC += options.c
 SRC += lscf.c
@@ -92,7 +92,13 @@
 #include <sys/types.h>
 #include <pwd.h>
 #include <stdarg.h>
-#include <strings.h> /* bzero() */
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+
+#if defined(NV_USE_ZLIB)
+#include <zlib.h>
+#endif
 
 #include "nvidia-xconfig.h"
 #include "msg.h"
@@ -100,14 +106,23 @@
 
 #define NIBBLE_TO_HEX(n) (((n) <= 9) ? ('0' + (n)) : ('a' - 0xa + (n)))
 
-#define HEX_TO_NIBBLE(n)                                                \
-    ((((n) >= '0') && ((n) <= '9')) ? ((n) - '0') :                     \
-        ((((n) >= 'a') && ((n) <= 'f')) ? (((n) - 'a') + 10) :          \
-            ((((n) >= 'A') && ((n) <= 'F')) ? (((n) - 'A') + 10) : 0))) \
+/*
+ * The EDID parsers classify every character of the file through
+ * charClass[], which is filled in by initCharClass(): for a hex
+ * digit, the entry is CHAR_HEX plus the value of the digit.
+ */
+
+#define CHAR_NIBBLE_MASK 0x0f
+#define CHAR_HEX         0x10
+#define CHAR_SPACE       0x20
 
-#define IS_HEX(n) ((((n) >= '0') && ((n) <= '9')) || \
-                   (((n) >= 'a') && ((n) <= 'f')) || \
-                   (((n) >= 'A') && ((n) <= 'F')))
+static unsigned char charClass[256];
+
+#define CHAR_CLASS(c) (charClass[(unsigned char) (c)])
+
+#define IS_HEX(c)        (CHAR_CLASS(c) & CHAR_HEX)
+#define IS_SPACE(c)      (CHAR_CLASS(c) & CHAR_SPACE)
+#define HEX_TO_NIBBLE(c) (CHAR_CLASS(c) & CHAR_NIBBLE_MASK)
 
 #define TRUE 1
 #define FALSE 0
@@ -122,6 +137,7 @@ typedef struct {
     int size;
     unsigned char *bytes;
     char *name;
+    char *screen;  /* the X screen label in the log, if any */
 } EdidRec, *EdidPtr;
 
 typedef struct {
@@ -134,6 +150,11 @@ typedef struct {
 static int findFileType(FilePtr pFile);
 
 static EdidPtr findEdidforLogFile(FilePtr pFile);
+static EdidPtr *findEdidsforLogFileThreaded(FilePtr pFile, int nthreads,
+                                            int *nEdids);
+static int isCompressedFile(int fd);
+static int findEdidsinStream(int fd, const char *name,
+                             EdidPtr **pEdids, int *nEdids);
 static EdidPtr findEdidforTextFile(FilePtr pFile);
 
 static int findEdidHeaderforLogFile(FilePtr pFile);
@@ -144,226 +165,1161 @@ static int findEdidfooterforTextFile(FilePtr pFile);
 static int readEdidDataforTextFile(FilePtr pFile, EdidPtr pEdid);
 static int readMonitorNameforTextFile(FilePtr pFile, EdidPtr pEdid);
 
+static int findEdidsinFile(const char *name, int nthreads,
+                           EdidPtr **pEdids, int *nEdids);
+static int extractEdidsBatch(Options *op);
+
 static char *findFileName(char *option);
-static int writeEdidFile(EdidPtr pEdid, char *filename);
+static char *uniqueFileName(const char *filename);
+static int writeEdidFile(EdidPtr pEdid, char *filename, int unique);
 
 static void freeEdid(EdidPtr pEdid);
 
+/*
+ * findString() - return the first occurrence of the len bytes of s
+ * within the size bytes at p, or NULL if there is none.  Log files
+ * can be very large, so rather than comparing at every position,
+ * memchr() skips ahead to each occurrence of the first byte of s.
+ */
+
+static const char *findString(const char *p, size_t size,
+                              const char *s, size_t len)
+{
+    const char *end, *c;
+
+    if (size < len) return NULL;
+    if (len == 0) return p;
+
+    /* the last position at which s can start, plus one */
+
+    end = p + (size - len) + 1;
+
+    while ((c = memchr(p, s[0], end - p)) != NULL) {
+        if (memcmp(c + 1, s + 1, len - 1) == 0) return c;
+        p = c + 1;
+    }
+
+    return NULL;
+
+} // findString()
+
+
 /*
  * Moves FilePtr::current to the end of the next occurrence of the
  * specified string within the file.  Return TRUE if the string is
- * found in the file; return FALSE otherwise.
+ * found in the file; return FALSE otherwise, with FilePtr::current
+ * moved to the first position at which the string no longer fits.
  */
 
 static inline int moveFilePointerPastString(FilePtr pFile, const char *s)
 {
     size_t len = strlen(s);
+    size_t offset = pFile->current - pFile->start;
+    const char *found;
 
-    while (((pFile->current - pFile->start) + len) <= pFile->length) {
+    if (offset + len > pFile->length) return FALSE;
 
-        if (strncmp(pFile->current, s, len) == 0) {
+    found = findString(pFile->current, pFile->length - offset, s, len);
 
-            pFile->current += len;
-            return TRUE;
+    if (!found) {
+        pFile->current = pFile->start + (pFile->length - len) + 1;
+        return FALSE;
+    }
+
+    pFile->current = (char *) found + len;
+    return TRUE;
+}
+
+
+/*
+ * initCharClass() - fill in charClass[]; see above.
+ */
+
+static void initCharClass(void)
+{
+    int c;
+
+    for (c = 0; c < 256; c++) {
+        if ((c >= '0') && (c <= '9')) {
+            charClass[c] = CHAR_HEX | (c - '0');
+        } else if ((c >= 'a') && (c <= 'f')) {
+            charClass[c] = CHAR_HEX | (c - 'a' + 10);
+        } else if ((c >= 'A') && (c <= 'F')) {
+            charClass[c] = CHAR_HEX | (c - 'A' + 10);
+        } else if (isspace(c)) {
+            charClass[c] = CHAR_SPACE;
+        } else {
+            charClass[c] = 0;
         }
-        pFile->current++;
     }
+
+} // initCharClass()
+
+
+/*
+ * extract_edids() - see description at the top of this file
+ */
+
+int extract_edids(Options *op)
+{
+    int funcRet;
+    char *filename;
+    struct stat stat_buf;
+    EdidPtr pEdid, *pEdids;
+    int nEdids, i;
+
+    initCharClass();
+
+    /* several files, or a directory, are extracted as a batch */
+
+    if ((op->extract_edids_files.n > 1) ||
+        ((stat(op->extract_edids_from_file, &stat_buf) == 0) &&
+         S_ISDIR(stat_buf.st_mode))) {
+        return extractEdidsBatch(op);
+    }
+
+    funcRet = findEdidsinFile(op->extract_edids_from_file,
+                              op->extract_edids_threads, &pEdids, &nEdids);
+
+    /* write the EDIDs to file */
+    
+    /*
+     * determine the base filename; this is what we pass to
+     * writeEdidFile; it will unique-ify from there
+     */
+
+    nv_info_msg(NULL, "");
+    nv_info_msg(NULL, "Found %d EDID%s in \"%s\".",
+                nEdids, (nEdids == 1) ? "": "s", op->extract_edids_from_file);
+
+    filename = findFileName(op->extract_edids_output_file);
+    
+    for (i = 0; i < nEdids; i++) {
+        
+        pEdid = pEdids[i];
+
+        funcRet = writeEdidFile(pEdid, filename, TRUE);
+
+        freeEdid(pEdid);
+    }
+    
+    if (pEdids) nvfree(pEdids);
+
+    nvfree(filename);
+    
+    nv_info_msg(NULL, "");
+
+    return funcRet;
+
+} // extract_edids()
+
+
+/*
+ * findEdidsinFile() - find the EDIDs in the named file ("-" is
+ * stdin), using up to nthreads threads for a mapped log file.
+ * Returns the list of EDIDs found in pEdids, and their number in
+ * nEdids; returns FALSE if the file cannot be read.
+ */
+
+static int findEdidsinFile(const char *name, int nthreads,
+                           EdidPtr **pEdids, int *nEdids)
+{
+    int fd = -1, ret, fileType, funcRet = FALSE;
+    
+    struct stat stat_buf;
+ 
+    FileRec file;
+    EdidPtr pEdid;
+    
+    *nEdids = 0;
+    *pEdids = NULL;
+    pEdid = NULL;
+    
+    memset(&file, 0, sizeof(FileRec));
+    file.start = (void *) -1;
+
+    /* open the file ("-" is stdin) and get its length */
+    
+    if (strcmp(name, "-") == 0) {
+        fd = dup(STDIN_FILENO);
+    } else {
+        fd = open(name, O_RDONLY);
+    }
+    
+    if (fd == -1) {
+        nv_error_msg("Unable to open file \"%s\".", name);
+        goto done;
+    }
+    
+    ret = fstat(fd, &stat_buf);
+
+    if (ret == -1) {
+        nv_error_msg("Unable to get length of file \"%s\".", name);
+        goto done;
+    }
+
+    /*
+     * anything that cannot be mapped (e.g., a pipe) or that needs to be
+     * decompressed is read as a stream instead
+     */
+
+    if (!S_ISREG(stat_buf.st_mode) || isCompressedFile(fd)) {
+        funcRet = findEdidsinStream(fd, name, pEdids, nEdids);
+        goto done;
+    }
+    
+    file.length = stat_buf.st_size;
+
+    if (file.length == 0) {
+        nv_error_msg("File \"%s\" is empty.", name);
+        goto done;
+    }
+    
+    /* mmap the file */
+
+    file.start = mmap(0, file.length, PROT_READ,
+                      MAP_SHARED, fd, 0);
+
+    if (file.start == (void *) -1) {
+        nv_error_msg("Unable to map file \"%s\".", name);
+        goto done;
+    }
+    
+    /* start parsing at the start of file */
+
+    file.current = file.start;
+    
+    /* check for the file type(log or .txt) */
+
+    fileType = findFileType(&file);
+    
+    /* if the file does not contain any edid information, goto done */
+  
+    if (fileType == UNKNOWN_FILE) {
+        funcRet = TRUE;
+        goto done;
+    } 
+
+    if (fileType == LOG_FILE) {
+        file.current = file.start;
+
+        if (nthreads > 1) {
+            *pEdids = findEdidsforLogFileThreaded(&file, nthreads, nEdids);
+            funcRet = TRUE;
+            goto done;
+        }
+    }
+
+    /* scan through the whole file, and build a list of pEdids */
+    
+    while(1) {
+    
+        if (fileType == LOG_FILE) {
+    
+            pEdid = findEdidforLogFile(&file);
+    
+        }
+        
+        if (fileType == TEXT_FILE) {
+    
+            pEdid = findEdidforTextFile(&file);
+    
+        }
+   
+        if (!pEdid) break;
+        
+        *pEdids = nvrealloc(*pEdids, sizeof(EdidPtr) * (*nEdids + 1));
+        
+        (*pEdids)[*nEdids] = pEdid;
+        (*nEdids)++;
+
+        /* Only one edid in a .txt file */
+
+        if (fileType == TEXT_FILE) break;
+    }
+    
+    /* fall through to the 'done' label */
+    
+    funcRet = TRUE;
+
+ done:
+    
+    /* unmap and close the file */
+    
+    if (file.start != (void *) -1) {
+        munmap(file.start, file.length);
+    }
+
+    if (fd != -1) {
+        close(fd);
+    }
+
+    return funcRet;
+
+} // findEdidsinFile()
+
+
+/*
+ * When several files, or a directory, are given, the files (for a
+ * directory, the regular files directly within it, in name order)
+ * are claimed one at a time by a pool of --extract-edids-threads
+ * threads, and the EDIDs found in each are kept in memory.
+ *
+ * The EDIDs are then walked in input order, and each is looked up by
+ * a hash of its bytes; only the first of each set of identical EDIDs
+ * is written, to a file named after the hash ("edid.bin.<hash>").  An
+ * index ("edid.bin.index") records, for every EDID found, the file
+ * and X screen it was found for, and the file it was written to.
+ *
+ * Unlike a single EDID, these files are not given a unique name: the
+ * name already tells their contents apart, so that extracting the
+ * same logs again leaves the same set of files.  A file that already
+ * holds the EDID is left alone, and the index is rewritten.
+ */
+
+#define EDID_HASH_BUCKETS 4096
+#define EDID_HASH_LEN     16  /* hex digits in a hash */
+
+typedef struct {
+    char *name;
+    int ok;
+    int nEdids;
+    EdidPtr *pEdids;
+} EdidInputRec, *EdidInputPtr;
+
+typedef struct {
+    EdidInputPtr inputs;
+    int nInputs;
+    int next;
+    pthread_mutex_t lock;
+} EdidBatchRec, *EdidBatchPtr;
+
+typedef struct {
+    uint64_t hash;
+    char *id;            /* the hash, as used in the file name */
+    char *filename;      /* the file the EDID was written to */
+    EdidPtr pEdid;       /* the first EDID with these bytes */
+    int next;            /* the next entry in the bucket, or -1 */
+} EdidHashRec, *EdidHashPtr;
+
+
+/*
+ * hashEdid() - the 64-bit FNV-1a hash of the EDID bytes.
+ */
+
+static uint64_t hashEdid(EdidPtr pEdid)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int i;
+
+    for (i = 0; i < pEdid->size; i++) {
+        hash ^= pEdid->bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+
+} // hashEdid()
+
+
+static int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+
+} // compareNames()
+
+
+/*
+ * addBatchInputs() - add the named file to the list of inputs; for a
+ * directory, add the regular files within it instead.  Returns FALSE
+ * if a directory cannot be read.
+ */
+
+static int addBatchInputs(const char *name, EdidBatchPtr pBatch)
+{
+    struct stat stat_buf;
+    struct dirent *ent;
+    char **names = NULL, *path;
+    int i, n = 0;
+    DIR *dir;
+
+    if ((stat(name, &stat_buf) != 0) || !S_ISDIR(stat_buf.st_mode)) {
+        names = nvalloc(sizeof(char *));
+        names[n++] = nvstrdup(name);
+    } else {
+        dir = opendir(name);
+        if (!dir) {
+            nv_error_msg("Unable to read directory \"%s\".", name);
+            return FALSE;
+        }
+
+        while ((ent = readdir(dir)) != NULL) {
+            if (ent->d_name[0] == '.') continue;
+
+            path = nvstrcat(name, "/", ent->d_name, NULL);
+
+            if ((stat(path, &stat_buf) != 0) ||
+                !S_ISREG(stat_buf.st_mode)) {
+                nvfree(path);
+                continue;
+            }
+
+            names = nvrealloc(names, sizeof(char *) * (n + 1));
+            names[n++] = path;
+        }
+
+        closedir(dir);
+
+        if (n) {
+            qsort(names, n, sizeof(char *), compareNames);
+        }
+    }
+
+    pBatch->inputs = nvrealloc(pBatch->inputs, sizeof(EdidInputRec) *
+                               (pBatch->nInputs + n));
+
+    for (i = 0; i < n; i++) {
+        memset(&pBatch->inputs[pBatch->nInputs], 0, sizeof(EdidInputRec));
+        pBatch->inputs[pBatch->nInputs++].name = names[i];
+    }
+
+    nvfree(names);
+
+    return TRUE;
+
+} // addBatchInputs()
+
+
+static void *edidBatchWorker(void *arg)
+{
+    EdidBatchPtr pBatch = arg;
+    EdidInputPtr pInput;
+    int i;
+
+    while (TRUE) {
+        pthread_mutex_lock(&pBatch->lock);
+        i = pBatch->next++;
+        pthread_mutex_unlock(&pBatch->lock);
+
+        if (i >= pBatch->nInputs) break;
+
+        pInput = &pBatch->inputs[i];
+        pInput->ok = findEdidsinFile(pInput->name, 1, &pInput->pEdids,
+                                     &pInput->nEdids);
+    }
+
+    return NULL;
+
+} // edidBatchWorker()
+
+
+/*
+ * extractEdidsBatch() - extract the EDIDs from all of the files
+ * given, as described above.
+ */
+
+static int extractEdidsBatch(Options *op)
+{
+    EdidBatchRec batch;
+    EdidInputPtr pInput;
+    EdidHashPtr hashes = NULL, pHash;
+    EdidPtr pEdid;
+    pthread_t *threads = NULL;
+    int buckets[EDID_HASH_BUCKETS];
+    int i, j, k, n, nthreads, nHashes = 0, nEdids = 0, funcRet = TRUE;
+    char *filename, *indexFilename;
+    char scratch[EDID_HASH_LEN + 16];
+    uint64_t hash;
+    FILE *index;
+
+    memset(&batch, 0, sizeof(batch));
+
+    for (i = 0; i < op->extract_edids_files.n; i++) {
+        if (!addBatchInputs(op->extract_edids_files.t[i], &batch)) {
+            funcRet = FALSE;
+        }
+    }
+
+    /* scan the files; the calling thread always takes part */
+
+    pthread_mutex_init(&batch.lock, NULL);
+
+    nthreads = NV_MIN(op->extract_edids_threads, batch.nInputs);
+
+    if (nthreads > 1) {
+        threads = nvalloc(sizeof(pthread_t) * (nthreads - 1));
+        for (i = 0; i < nthreads - 1; i++) {
+            if (pthread_create(&threads[i], NULL, edidBatchWorker,
+                               &batch) != 0) {
+                break;
+            }
+        }
+        nthreads = i + 1;
+    }
+
+    edidBatchWorker(&batch);
+
+    for (i = 0; i < nthreads - 1; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    nvfree(threads);
+    pthread_mutex_destroy(&batch.lock);
+
+    /* write each unique EDID, and the index, in input order */
+
+    filename = findFileName(op->extract_edids_output_file);
+    indexFilename = nvstrcat(filename, ".index", NULL);
+
+    index = fopen(indexFilename, "w");
+    if (!index) {
+        nv_error_msg("Unable to open EDID index \"%s\" for writing.",
+                     indexFilename);
+        funcRet = FALSE;
+    } else {
+        fprintf(index, "# file\tscreen\tEDID file\tdisplay device\n");
+    }
+
+    for (i = 0; i < EDID_HASH_BUCKETS; i++) buckets[i] = -1;
+
+    nv_info_msg(NULL, "");
+
+    for (i = 0; i < batch.nInputs; i++) {
+        pInput = &batch.inputs[i];
+
+        if (!pInput->ok) funcRet = FALSE;
+
+        nv_info_msg(NULL, "Found %d EDID%s in \"%s\".", pInput->nEdids,
+                    (pInput->nEdids == 1) ? "": "s", pInput->name);
+
+        for (j = 0; j < pInput->nEdids; j++) {
+            pEdid = pInput->pEdids[j];
+            hash = hashEdid(pEdid);
+
+            for (k = buckets[hash % EDID_HASH_BUCKETS]; k != -1;
+                 k = hashes[k].next) {
+                if ((hashes[k].hash == hash) &&
+                    (hashes[k].pEdid->size == pEdid->size) &&
+                    (memcmp(hashes[k].pEdid->bytes, pEdid->bytes,
+                            pEdid->size) == 0)) {
+                    break;
+                }
+            }
+
+            if (k == -1) {
+
+                /* a new EDID; tell apart EDIDs with the same hash */
+
+                n = 0;
+                for (k = buckets[hash % EDID_HASH_BUCKETS]; k != -1;
+                     k = hashes[k].next) {
+                    if (hashes[k].hash == hash) n++;
+                }
+
+                snprintf(scratch, sizeof(scratch), "%016llx",
+                         (unsigned long long) hash);
+                if (n > 0) {
+                    snprintf(scratch + EDID_HASH_LEN,
+                             sizeof(scratch) - EDID_HASH_LEN, "-%d", n);
+                }
+
+                hashes = nvrealloc(hashes, sizeof(EdidHashRec) *
+                                   (nHashes + 1));
+                pHash = &hashes[nHashes];
+                pHash->hash = hash;
+                pHash->id = nvstrdup(scratch);
+                pHash->filename = nvstrcat(filename, ".", pHash->id, NULL);
+                pHash->pEdid = pEdid;
+                pHash->next = buckets[hash % EDID_HASH_BUCKETS];
+                buckets[hash % EDID_HASH_BUCKETS] = nHashes;
+                k = nHashes++;
+
+                if (!writeEdidFile(pEdid, pHash->filename, FALSE)) {
+                    funcRet = FALSE;
+                }
+            }
+
+            if (index) {
+                fprintf(index, "%s\t%s\t%s\t%s\n", pInput->name,
+                        pEdid->screen ? pEdid->screen : "-",
+                        hashes[k].filename,
+                        pEdid->name ? pEdid->name : "unknown");
+            }
+
+            nEdids++;
+        }
+    }
+
+    nv_info_msg(NULL, "");
+    nv_info_msg(NULL, "Found %d EDID%s (%d unique) in %d file%s.",
+                nEdids, (nEdids == 1) ? "": "s", nHashes,
+                batch.nInputs, (batch.nInputs == 1) ? "": "s");
+
+    if (index) {
+        if (fclose(index) != 0) {
+            nv_error_msg("Unable to write EDID index \"%s\".", indexFilename);
+            funcRet = FALSE;
+        } else {
+            nv_info_msg(NULL, "Wrote EDID index to \"%s\".", indexFilename);
+        }
+    }
+
+    nv_info_msg(NULL, "");
+
+    /* clean up */
+
+    for (i = 0; i < nHashes; i++) {
+        nvfree(hashes[i].id);
+        nvfree(hashes[i].filename);
+    }
+    nvfree(hashes);
+
+    for (i = 0; i < batch.nInputs; i++) {
+        pInput = &batch.inputs[i];
+        for (j = 0; j < pInput->nEdids; j++) {
+            freeEdid(pInput->pEdids[j]);
+        }
+        nvfree(pInput->pEdids);
+        nvfree(pInput->name);
+    }
+    nvfree(batch.inputs);
+
+    nvfree(indexFilename);
+    nvfree(filename);
+
+    return funcRet;
+
+} // extractEdidsBatch()
+
+/*
+ * findFileType() - scan through the pFile to determine the file type
+ * file type can be LOG_FILE, TEXT_FILE, UNKNOWN_FILE(file with no EDID) 
+ */
+
+static int findFileType(FilePtr pFile)
+{ 
+    if (findEdidHeaderforLogFile(pFile)) return LOG_FILE;
+   
+    if (findEdidfooterforTextFile(pFile)) return TEXT_FILE;
+
+    return UNKNOWN_FILE;
+
+} // findFileType()
+
+/*
+ * findEdid() - scan through pFile for an EDID header, if we find one,
+ * parse the EDID data and footer.  On success, return a newly
+ * allocated pEdid data structure.  On failure, return NULL.
+ */
+ 
+static EdidPtr findEdidforLogFile(FilePtr pFile)
+{
+    EdidPtr pEdid = nvalloc(sizeof(EdidRec));
+    
+    if (!findEdidHeaderforLogFile(pFile)) goto fail;
+    
+    if (!readEdidDataforLogFile(pFile, pEdid)) goto fail;
+
+    if (!readEdidFooterforLogFile(pFile, pEdid)) goto fail;
+    
+    return pEdid;
+    
+ fail:
+    
+    freeEdid(pEdid);
+    
+    return NULL;
+    
+} // findEdidforLogFile()
+
+
+/*
+ * With --extract-edids-threads, a log file is split into line-aligned
+ * chunks, which are claimed one at a time by a pool of threads.  For
+ * each EDID header that starts within its chunk, a thread parses the
+ * EDID that follows (which may extend past the end of the chunk, so
+ * that EDIDs crossing a chunk boundary are handled like any other),
+ * and records the result and where parsing ended.
+ *
+ * The results are then walked in file order, just as the
+ * single-threaded scan would have found them: headers within an EDID
+ * that was already taken are skipped, and the first EDID that fails
+ * to parse ends the scan.  The EDIDs found are thus the same as
+ * without threads.
+ */
+
+#define EDID_CHUNK_MIN_SIZE    (1 << 20)
+#define EDID_CHUNKS_PER_THREAD 4
+
+typedef struct {
+    const char *header;  /* where the EDID header starts */
+    const char *end;     /* where parsing the EDID ended */
+    EdidPtr pEdid;       /* NULL if the EDID could not be parsed */
+} EdidScanRec, *EdidScanPtr;
+
+typedef struct {
+    const char *begin;
+    const char *end;
+    int nScans;
+    EdidScanPtr scans;
+} EdidChunkRec, *EdidChunkPtr;
+
+typedef struct {
+    FilePtr pFile;
+    EdidChunkPtr chunks;
+    int nChunks;
+    int next;
+    pthread_mutex_t lock;
+} EdidJobRec, *EdidJobPtr;
+
+
+/*
+ * scanEdidChunk() - parse the EDID following each EDID header that
+ * starts within the given chunk.
+ */
+
+static void scanEdidChunk(FilePtr pFile, EdidChunkPtr pChunk)
+{
+    static const char header[] = "Raw EDID bytes:";
+    const size_t len = sizeof(header) - 1;
+    const char *fileEnd = pFile->start + pFile->length;
+    const char *p = pChunk->begin, *found;
+    EdidScanPtr pScan;
+    FileRec file;
+    size_t size;
+
+    while (p < pChunk->end) {
+
+        /* the header must start within the chunk, but may end past it */
+
+        size = NV_MIN((size_t) (fileEnd - p),
+                      (size_t) (pChunk->end - p) + len - 1);
+
+        found = findString(p, size, header, len);
+        if (!found) break;
+
+        pChunk->scans = nvrealloc(pChunk->scans, sizeof(EdidScanRec) *
+                                  (pChunk->nScans + 1));
+        pScan = &pChunk->scans[pChunk->nScans++];
+
+        file = *pFile;
+        file.current = (char *) found + len;
+
+        pScan->header = found;
+        pScan->pEdid = nvalloc(sizeof(EdidRec));
+
+        if (!readEdidDataforLogFile(&file, pScan->pEdid) ||
+            !readEdidFooterforLogFile(&file, pScan->pEdid)) {
+            freeEdid(pScan->pEdid);
+            pScan->pEdid = NULL;
+        }
+
+        pScan->end = file.current;
+
+        p = found + len;
+    }
+
+} // scanEdidChunk()
+
+
+static void *edidScanWorker(void *arg)
+{
+    EdidJobPtr job = arg;
+    int i;
+
+    while (TRUE) {
+        pthread_mutex_lock(&job->lock);
+        i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (i >= job->nChunks) break;
+
+        scanEdidChunk(job->pFile, &job->chunks[i]);
+    }
+
+    return NULL;
+
+} // edidScanWorker()
+
+
+/*
+ * findEdidsforLogFileThreaded() - find the EDIDs in the log file
+ * using up to nthreads threads, as described above.  Returns the
+ * list of EDIDs found, and their number in nEdids.
+ */
+
+static EdidPtr *findEdidsforLogFileThreaded(FilePtr pFile, int nthreads,
+                                            int *nEdids)
+{
+    const char *fileEnd = pFile->start + pFile->length;
+    const char *p, *end, *current;
+    EdidPtr *pEdids = NULL;
+    EdidChunkPtr pChunk;
+    EdidScanPtr pScan;
+    pthread_t *threads;
+    EdidJobRec job;
+    size_t chunkSize;
+    int i, j, stopped;
+
+    *nEdids = 0;
+
+    /* split the file into chunks that end at a newline */
+
+    memset(&job, 0, sizeof(job));
+    job.pFile = pFile;
+
+    chunkSize = NV_MAX(pFile->length /
+                       ((size_t) nthreads * EDID_CHUNKS_PER_THREAD),
+                       (size_t) EDID_CHUNK_MIN_SIZE);
+
+    for (p = pFile->current; p < fileEnd; p = end) {
+        if ((size_t) (fileEnd - p) <= chunkSize) {
+            end = fileEnd;
+        } else {
+            end = memchr(p + chunkSize, '\n', fileEnd - (p + chunkSize));
+            end = end ? end + 1 : fileEnd;
+        }
+
+        job.chunks = nvrealloc(job.chunks,
+                               sizeof(EdidChunkRec) * (job.nChunks + 1));
+        pChunk = &job.chunks[job.nChunks++];
+        memset(pChunk, 0, sizeof(EdidChunkRec));
+        pChunk->begin = p;
+        pChunk->end = end;
+    }
+
+    /* scan the chunks; the calling thread always takes part */
+
+    pthread_mutex_init(&job.lock, NULL);
+
+    nthreads = NV_MIN(nthreads, job.nChunks);
+    threads = NULL;
+
+    if (nthreads > 1) {
+        threads = nvalloc(sizeof(pthread_t) * (nthreads - 1));
+        for (i = 0; i < nthreads - 1; i++) {
+            if (pthread_create(&threads[i], NULL, edidScanWorker,
+                               &job) != 0) {
+                break;
+            }
+        }
+        nthreads = i + 1;
+    }
+
+    edidScanWorker(&job);
+
+    for (i = 0; i < nthreads - 1; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    nvfree(threads);
+    pthread_mutex_destroy(&job.lock);
+
+    /* collect the EDIDs in file order */
+
+    current = pFile->current;
+    stopped = FALSE;
+
+    for (i = 0; i < job.nChunks; i++) {
+        pChunk = &job.chunks[i];
+
+        for (j = 0; j < pChunk->nScans; j++) {
+            pScan = &pChunk->scans[j];
+
+            if (stopped || (pScan->header < current)) {
+                if (pScan->pEdid) freeEdid(pScan->pEdid);
+                continue;
+            }
+
+            if (!pScan->pEdid) {
+                stopped = TRUE;
+                continue;
+            }
+
+            pEdids = nvrealloc(pEdids, sizeof(EdidPtr) * (*nEdids + 1));
+            pEdids[(*nEdids)++] = pScan->pEdid;
+
+            current = pScan->end;
+        }
+
+        nvfree(pChunk->scans);
+    }
+
+    nvfree(job.chunks);
+
+    return pEdids;
+
+} // findEdidsforLogFileThreaded()
+
+
+/*
+ * When the input cannot be mapped, or is compressed, it is read as a
+ * stream (through zlib, if available, which also reads uncompressed
+ * data as is) into a window of at most EDID_STREAM_WINDOW_SIZE
+ * bytes.  The window is scanned with the same parsers as a mapped
+ * file.  Once no more EDID headers are found in it, all but its last
+ * few bytes (which may hold the start of a header) are discarded, and
+ * it is refilled.
+ *
+ * An EDID is only taken if parsing it ended far enough from the end
+ * of the window that more data could not have changed the result;
+ * otherwise, the window is refilled starting at its header, and the
+ * EDID is parsed again.  An EDID that still cannot be parsed once it
+ * fills the whole window ends the scan, like one that fails to parse.
+ *
+ * If the input has no EDID headers, it is checked for a .txt EDID
+ * dump exactly as findFileType() would check a mapped file; that only
+ * looks at the end of the input, which is still in the window.
+ */
+
+#define EDID_STREAM_WINDOW_SIZE (4 * 1024 * 1024)
+#define EDID_STREAM_READ_SIZE   (128 * 1024)
+#define EDID_STREAM_SLACK       64  /* past a parsed EDID, see above */
+#define EDID_STREAM_PADDING     8   /* zeros past the end of the data */
+
+#define EDID_LOG_HEADER "Raw EDID bytes:"
+
+typedef struct {
+#if defined(NV_USE_ZLIB)
+    gzFile gz;
+#else
+    int fd;
+#endif
+    const char *name;
+    int eof;
+    int error;
+} StreamRec, *StreamPtr;
+
+
+/*
+ * isCompressedFile() - whether the file starts with the gzip magic
+ * number; such files are only read if zlib is available.
+ */
+
+static int isCompressedFile(int fd)
+{
+    unsigned char magic[2];
+
+    if ((pread(fd, magic, sizeof(magic), 0) != sizeof(magic)) ||
+        (magic[0] != 0x1f) || (magic[1] != 0x8b)) {
+        return FALSE;
+    }
+
+#if defined(NV_USE_ZLIB)
+    return TRUE;
+#else
+    nv_warning_msg("nvidia-xconfig was built without zlib, so compressed "
+                   "files cannot be read.");
     return FALSE;
-}
+#endif
+
+} // isCompressedFile()
+
+
+static int openStream(StreamPtr pStream, int fd, const char *name)
+{
+    memset(pStream, 0, sizeof(StreamRec));
+    pStream->name = name;
+
+#if defined(NV_USE_ZLIB)
+    /* gzclose() closes the descriptor given to gzdopen() */
+
+    fd = dup(fd);
+    if (fd == -1) return FALSE;
+
+    pStream->gz = gzdopen(fd, "rb");
+    if (!pStream->gz) {
+        close(fd);
+        return FALSE;
+    }
+    gzbuffer(pStream->gz, EDID_STREAM_READ_SIZE);
+#else
+    pStream->fd = fd;
+#endif
+
+    return TRUE;
+
+} // openStream()
+
+
+/*
+ * readStream() - read up to len bytes into buf; returns the number of
+ * bytes read, setting eof or error once there is no more to read.
+ */
+
+static size_t readStream(StreamPtr pStream, char *buf, size_t len)
+{
+#if defined(NV_USE_ZLIB)
+    int n, errnum;
+
+    n = gzread(pStream->gz, buf, len);
+
+    if (n < 0) {
+        nv_error_msg("Unable to read \"%s\" (%s).", pStream->name,
+                     gzerror(pStream->gz, &errnum));
+        pStream->error = TRUE;
+        return 0;
+    }
+#else
+    ssize_t n;
+
+    do {
+        n = read(pStream->fd, buf, len);
+    } while ((n < 0) && (errno == EINTR));
+
+    if (n < 0) {
+        nv_error_msg("Unable to read \"%s\" (%s).", pStream->name,
+                     strerror(errno));
+        pStream->error = TRUE;
+        return 0;
+    }
+#endif
+
+    if (n == 0) pStream->eof = TRUE;
+
+    return n;
+
+} // readStream()
+
+
+static void closeStream(StreamPtr pStream)
+{
+#if defined(NV_USE_ZLIB)
+    gzclose(pStream->gz);
+#endif
+
+} // closeStream()
+
+
+/*
+ * fillWindow() - discard the first 'discard' bytes of the window, and
+ * read into the rest of it until it is full, or until there is no
+ * more to read.
+ */
+
+static void fillWindow(StreamPtr pStream, FilePtr pWindow, size_t discard)
+{
+    size_t n;
+
+    memmove(pWindow->start, pWindow->start + discard,
+            pWindow->length - discard);
+    pWindow->length -= discard;
+
+    while (!pStream->eof && !pStream->error &&
+           (pWindow->length < EDID_STREAM_WINDOW_SIZE)) {
+        n = NV_MIN(EDID_STREAM_WINDOW_SIZE - pWindow->length,
+                   (size_t) EDID_STREAM_READ_SIZE);
+        pWindow->length += readStream(pStream, pWindow->start +
+                                      pWindow->length, n);
+    }
+
+    /* the parsers may look a few bytes past the end of the data */
+
+    memset(pWindow->start + pWindow->length, 0, EDID_STREAM_PADDING);
+
+} // fillWindow()
 
 
 /*
- * extract_edids() - see description at the top of this file
+ * findEdidsinStream() - find the EDIDs in the input read from fd, as
+ * described above.  Returns FALSE if the input cannot be read; the
+ * EDIDs found until then are still returned.
  */
 
-int extract_edids(Options *op)
+static int findEdidsinStream(int fd, const char *name,
+                             EdidPtr **pEdids, int *nEdids)
 {
-    int fd = -1, ret, fileType, funcRet = FALSE;
-    char *filename;
-    
-    struct stat stat_buf;
- 
-    FileRec file;
-    EdidPtr pEdid, *pEdids;
-    int nEdids, i;
-    
-    nEdids = 0;
-    pEdid = NULL;
-    pEdids = NULL;
-    
-    memset(&file, 0, sizeof(FileRec));
-    file.start = (void *) -1;
-    
-    /* open the file and get its length */
-    
-    fd = open(op->extract_edids_from_file, O_RDONLY);
-    
-    if (fd == -1) {
-        nv_error_msg("Unable to open file \"%s\".", op->extract_edids_from_file);
-        goto done;
+    const size_t len = strlen(EDID_LOG_HEADER);
+    StreamRec stream;
+    FileRec window;
+    EdidPtr pEdid;
+    size_t pos = 0, header;
+    int ok, final, logFile = FALSE;
+
+    *pEdids = NULL;
+    *nEdids = 0;
+
+    if (!openStream(&stream, fd, name)) {
+        nv_error_msg("Unable to read \"%s\".", name);
+        return FALSE;
     }
-    
-    ret = fstat(fd, &stat_buf);
 
-    if (ret == -1) {
-        nv_error_msg("Unable to get length of file \"%s\".",
-                     op->extract_edids_from_file);
-        goto done;
-    }
-    
-    file.length = stat_buf.st_size;
+    memset(&window, 0, sizeof(FileRec));
+    window.start = nvalloc(EDID_STREAM_WINDOW_SIZE + EDID_STREAM_PADDING);
 
-    if (file.length == 0) {
-        nv_error_msg("File \"%s\" is empty.", op->extract_edids_from_file);
-        goto done;
-    }
-    
-    /* mmap the file */
+    fillWindow(&stream, &window, 0);
 
-    file.start = mmap(0, file.length, PROT_READ,
-                      MAP_SHARED, fd, 0);
+    while (!stream.error) {
 
-    if (file.start == (void *) -1) {
-        nv_error_msg("Unable to map file \"%s\".", op->extract_edids_from_file);
-        goto done;
-    }
-    
-    /* start parsing at the start of file */
+        window.current = window.start + pos;
 
-    file.current = file.start;
-    
-    /* check for the file type(log or .txt) */
+        if (!moveFilePointerPastString(&window, EDID_LOG_HEADER)) {
 
-    fileType = findFileType(&file);
-    
-    /* if the file does not contain any edid information, goto done */
-  
-    if (fileType == UNKNOWN_FILE) {
-        funcRet = TRUE;
-        goto done;
-    } 
+            if (stream.eof) break;
 
-    if (fileType == LOG_FILE) {
-        file.current = file.start;
-    }
+            /* keep what may be the start of a header */
 
-    /* scan through the whole file, and build a list of pEdids */
-    
-    while(1) {
-    
-        if (fileType == LOG_FILE) {
-    
-            pEdid = findEdidforLogFile(&file);
-    
-        }
-        
-        if (fileType == TEXT_FILE) {
-    
-            pEdid = findEdidforTextFile(&file);
-    
+            if (window.length - pos >= len) {
+                pos = window.length - (len - 1);
+            }
+            fillWindow(&stream, &window, pos);
+            pos = 0;
+            continue;
         }
-   
-        if (!pEdid) break;
-        
-        pEdids = nvrealloc(pEdids, sizeof(pEdids) * (nEdids + 1));
-        
-        pEdids[nEdids] = pEdid;
-        nEdids++;
-
-        /* Only one edid in a .txt file */
 
-        if (fileType == TEXT_FILE) break;
-    }
-    
-    /* fall through to the 'done' label */
-    
-    funcRet = TRUE;
+        logFile = TRUE;
+        header = (window.current - window.start) - len;
 
- done:
-    
-    /* unmap and close the file */
-    
-    if (file.start != (void *) -1) {
-        munmap(file.start, file.length);
-    }
+        pEdid = nvalloc(sizeof(EdidRec));
 
-    if (fd != -1) {
-        close(fd);
-    }
-    
-    
-    /* write the EDIDs to file */
-    
-    /*
-     * determine the base filename; this is what we pass to
-     * writeEdidFile; it will unique-ify from there
-     */
+        ok = readEdidDataforLogFile(&window, pEdid) &&
+             readEdidFooterforLogFile(&window, pEdid);
 
-    nv_info_msg(NULL, "");
-    nv_info_msg(NULL, "Found %d EDID%s in \"%s\".",
-                nEdids, (nEdids == 1) ? "": "s", op->extract_edids_from_file);
+        final = stream.eof ||
+            (ok && ((window.current - window.start) + EDID_STREAM_SLACK <=
+                    window.length));
 
-    filename = findFileName(op->extract_edids_output_file);
-    
-    for (i = 0; i < nEdids; i++) {
-        
-        pEdid = pEdids[i];
+        if (!final && ((header > 0) ||
+                       (window.length < EDID_STREAM_WINDOW_SIZE))) {
 
-        funcRet = writeEdidFile(pEdid, filename);
+            /* parse the EDID again with more data */
 
-        freeEdid(pEdid);
-    }
-    
-    if (pEdids) nvfree(pEdids);
+            freeEdid(pEdid);
+            fillWindow(&stream, &window, header);
+            pos = 0;
+            continue;
+        }
 
-    nvfree(filename);
-    
-    nv_info_msg(NULL, "");
+        if (!final || !ok) {
+            freeEdid(pEdid);
+            break;
+        }
 
-    return funcRet;
+        *pEdids = nvrealloc(*pEdids, sizeof(EdidPtr) * (*nEdids + 1));
+        (*pEdids)[(*nEdids)++] = pEdid;
 
-} // extract_edids()
+        pos = window.current - window.start;
+    }
 
-/*
- * findFileType() - scan through the pFile to determine the file type
- * file type can be LOG_FILE, TEXT_FILE, UNKNOWN_FILE(file with no EDID) 
- */
+    /* with no EDID headers, check for a .txt EDID dump */
 
-static int findFileType(FilePtr pFile)
-{ 
-    if (findEdidHeaderforLogFile(pFile)) return LOG_FILE;
-   
-    if (findEdidfooterforTextFile(pFile)) return TEXT_FILE;
+    if (!logFile && !stream.error) {
+        window.current = window.start;
 
-    return UNKNOWN_FILE;
+        if ((findFileType(&window) == TEXT_FILE) &&
+            ((pEdid = findEdidforTextFile(&window)) != NULL)) {
+            *pEdids = nvalloc(sizeof(EdidPtr));
+            (*pEdids)[0] = pEdid;
+            *nEdids = 1;
+        }
+    }
 
-} // findFileType()
+    closeStream(&stream);
+    nvfree(window.start);
 
-/*
- * findEdid() - scan through pFile for an EDID header, if we find one,
- * parse the EDID data and footer.  On success, return a newly
- * allocated pEdid data structure.  On failure, return NULL.
- */
- 
-static EdidPtr findEdidforLogFile(FilePtr pFile)
-{
-    EdidPtr pEdid = nvalloc(sizeof(EdidRec));
-    
-    if (!findEdidHeaderforLogFile(pFile)) goto fail;
-    
-    if (!readEdidDataforLogFile(pFile, pEdid)) goto fail;
+    return !stream.error;
 
-    if (!readEdidFooterforLogFile(pFile, pEdid)) goto fail;
-    
-    return pEdid;
-    
- fail:
-    
-    freeEdid(pEdid);
-    
-    return NULL;
-    
-} // findEdidforLogFile()
+} // findEdidsinStream()
 
 /*
  * scan through the pFile for EDID data and Monitor name.
@@ -419,30 +1375,39 @@ static int findEdidHeaderforLogFile(FilePtr pFile)
 
 static int findLogFileLineLabel(FilePtr pFile)
 {
-    while ((pFile->current - pFile->start) <= pFile->length) {
+    static const char screenTag[] = "NVIDIA(";
+    static const char gpuTag[] = "GPU";
 
-        const char *gpuTag = "NVIDIA(GPU";
-        const char *screenTag = "NVIDIA(";
+    const size_t screenLen = sizeof(screenTag) - 1;
+    const size_t gpuLen = sizeof(gpuTag) - 1;
 
-        size_t remainder = pFile->length - (pFile->current - pFile->start);
+    size_t remainder;
+    const char *found;
 
-        if ((remainder > strlen(gpuTag)) &&
-            (strncmp(pFile->current, gpuTag, strlen(gpuTag)) == 0)) {
+    if ((pFile->current - pFile->start) > pFile->length) return FALSE;
 
-            pFile->current += strlen(gpuTag);
-            return TRUE;
-        }
+    remainder = pFile->length - (pFile->current - pFile->start);
 
-        if ((remainder > strlen(screenTag)) &&
-            (strncmp(pFile->current, screenTag, strlen(screenTag)) == 0)) {
+    /* the label must be followed by at least one more character */
 
-            pFile->current += strlen(screenTag);
-            return TRUE;
-        }
-        pFile->current++;
+    found = (remainder > 0) ?
+        findString(pFile->current, remainder - 1, screenTag, screenLen) :
+        NULL;
+
+    if (!found) {
+        pFile->current = pFile->start + pFile->length;
+        return FALSE;
     }
 
-    return FALSE;
+    pFile->current = (char *) found + screenLen;
+    remainder = pFile->length - (pFile->current - pFile->start);
+
+    if ((remainder > gpuLen) &&
+        (strncmp(pFile->current, gpuTag, gpuLen) == 0)) {
+        pFile->current += gpuLen;
+    }
+
+    return TRUE;
 
 } // findLogFileLineLabel()
 
@@ -464,26 +1429,92 @@ static int findLogFileLineLabel(FilePtr pFile)
 
 #define MAX_EDID_SIZE 4096
 
+/*
+ * decodeHexLine() - decode the rest of a line of an EDID dump in the
+ * X log, starting at 'p', if it has the regular "xx xx xx ..." layout
+ * printed by the X driver: pairs of hex digits, each followed by
+ * white space.  At most 'room' bytes are stored in pData.  On
+ * success, the number of bytes decoded is returned and *pNewline is
+ * set to the newline that ends the line.  Otherwise, -1 is returned,
+ * and the line should be decoded a character at a time.
+ */
+
+static int decodeHexLine(const char *p, const char *end,
+                         unsigned char *pData, int room,
+                         const char **pNewline)
+{
+    int n = 0;
+
+    while (p < end) {
+
+        if (*p == '\n') {
+            *pNewline = p;
+            return n;
+        }
+
+        if (IS_SPACE(*p)) {
+            p++;
+            continue;
+        }
+
+        if ((end - p) < 3 || !IS_HEX(p[0]) || !IS_HEX(p[1]) ||
+            !IS_SPACE(p[2]) || (n >= room)) {
+            return -1;
+        }
+
+        pData[n++] = (HEX_TO_NIBBLE(p[0]) << 4) | HEX_TO_NIBBLE(p[1]);
+        p += 2;
+    }
+
+    return -1;
+
+} // decodeHexLine()
+
+
+/*
+ * readScreenLabel() - pFile->current points at the ')' that closes
+ * the label of the first line of an EDID dump; record what is
+ * between the parentheses (e.g., "0" or "GPU-0") as the screen of
+ * the EDID.
+ */
+
+#define MAX_SCREEN_LABEL_LEN 32
+
+static void readScreenLabel(FilePtr pFile, EdidPtr pEdid)
+{
+    const char *end = pFile->current, *p = end;
+
+    while ((p > pFile->start) && (p[-1] != '(') &&
+           ((end - p) < MAX_SCREEN_LABEL_LEN)) {
+        p--;
+    }
+
+    if ((p > pFile->start) && (p[-1] == '(') && (p < end)) {
+        pEdid->screen = nvstrndup(p, end - p);
+    }
+
+} // readScreenLabel()
+
+
 static int readEdidDataforLogFile(FilePtr pFile, EdidPtr pEdid)
 {
     int state;
     
     unsigned char pData[MAX_EDID_SIZE];
-    int k;
+    int k, n, tryLine;
 
+    const char *newline;
     char c;
 
-    /* clear the scratch EDID data */
-
-    bzero(pData, MAX_EDID_SIZE);
-
     /*
      * start the parsing state machine by looking for the upper nibble
-     * of the first byte in the EDID
+     * of the first byte in the EDID; each byte of pData is assigned
+     * as its upper nibble is found, so pData does not need clearing
      */
     
     state = STATE_LOOKING_FOR_TOP_NIBBLE;
     k = 0;
+    tryLine = FALSE;
     
     while(1) {
         
@@ -502,18 +1533,37 @@ static int readEdidDataforLogFile(FilePtr pFile, EdidPtr pEdid)
             
             /* skip white space; keep looking for top nibble */
             
-            if (isspace(c)) {
+            if (IS_SPACE(c)) {
                 state = STATE_LOOKING_FOR_TOP_NIBBLE;
                 goto nextChar;
             }
 
+            /*
+             * at the first byte after a label, try to decode the
+             * whole line at once; continue at its newline if that
+             * worked
+             */
+
+            if (tryLine && IS_HEX(c)) {
+                tryLine = FALSE;
+                n = decodeHexLine(pFile->current,
+                                  pFile->start + pFile->length,
+                                  pData + k, MAX_EDID_SIZE - 1 - k,
+                                  &newline);
+                if (n >= 0) {
+                    k += n;
+                    pFile->current = (char *) newline;
+                    continue;
+                }
+            }
+
             /*
              * if we found a hex value, treat it as upper nibble, then
              * look for lower nibble
              */
 
             if (IS_HEX(c)) {
-                pData[k] |= ((HEX_TO_NIBBLE(c)) << 4);
+                pData[k] = HEX_TO_NIBBLE(c) << 4;
                 state = STATE_LOOKING_FOR_BOTTOM_NIBBLE;
                 goto nextChar;
             }
@@ -534,7 +1584,7 @@ static int readEdidDataforLogFile(FilePtr pFile, EdidPtr pEdid)
              */
             
             if (IS_HEX(c)) {
-                pData[k] |= (HEX_TO_NIBBLE(c));
+                pData[k] |= HEX_TO_NIBBLE(c);
                 state = STATE_LOOKING_FOR_TOP_NIBBLE;
                 k++;
                 if (k >= MAX_EDID_SIZE) goto fail;
@@ -568,7 +1618,7 @@ static int readEdidDataforLogFile(FilePtr pFile, EdidPtr pEdid)
              * continue searching for more of the screen number
              */
 
-            if (isdigit(c)) {
+            if (isdigit((unsigned char) c)) {
                 goto nextChar;
             }
 
@@ -579,6 +1629,7 @@ static int readEdidDataforLogFile(FilePtr pFile, EdidPtr pEdid)
              */
 
             if (c == ')') {
+                if (!pEdid->screen) readScreenLabel(pFile, pEdid);
                 state = STATE_LOOKING_FOR_END_OF_LABEL;
                 goto nextChar;
             }
@@ -597,6 +1648,7 @@ static int readEdidDataforLogFile(FilePtr pFile, EdidPtr pEdid)
             
             if (c == ':') {
                 state = STATE_LOOKING_FOR_TOP_NIBBLE;
+                tryLine = TRUE;
                 goto nextChar;
             }
 
@@ -661,13 +1713,10 @@ static int readEdidDataforTextFile(FilePtr pFile, EdidPtr pEdid)
 
     char c;
 
-    /* clear the scratch EDID data */
-
-    bzero(pData, MAX_EDID_SIZE);
-
     /*
      * start the parsing state machine by looking for the upper nibble
-     * of the first byte in the EDID
+     * of the first byte in the EDID; as for log files, pData does not
+     * need clearing
      */
 
     state = STATE_LOOKING_FOR_TOP_NIBBLE;
@@ -687,7 +1736,7 @@ static int readEdidDataforTextFile(FilePtr pFile, EdidPtr pEdid)
              */
 
             if (IS_HEX(c)) {
-                pData[k] |= ((HEX_TO_NIBBLE(c)) << 4);
+                pData[k] = HEX_TO_NIBBLE(c) << 4;
                 state = STATE_LOOKING_FOR_BOTTOM_NIBBLE;
                 goto nextChar;
             }
@@ -704,9 +1753,9 @@ static int readEdidDataforTextFile(FilePtr pFile, EdidPtr pEdid)
              * if one white space, skip it.
              */
   
-            if (isspace(c)) {
+            if (IS_SPACE(c)) {
                 
-                if (isspace(pFile->current[1])) {
+                if (IS_SPACE(pFile->current[1])) {
                     state = STATE_LOOKING_FOR_END_OF_LABEL;
                     goto nextChar;
                 } else {
@@ -727,7 +1776,7 @@ static int readEdidDataforTextFile(FilePtr pFile, EdidPtr pEdid)
              */
   
             if (IS_HEX(c)) {
-                pData[k] |= (HEX_TO_NIBBLE(c));
+                pData[k] |= HEX_TO_NIBBLE(c);
                 state = STATE_LOOKING_FOR_TOP_NIBBLE;
                 k++;
                 if (k >= MAX_EDID_SIZE) goto fail;
@@ -757,7 +1806,7 @@ static int readEdidDataforTextFile(FilePtr pFile, EdidPtr pEdid)
             
             /* skip the white space */
  
-            if (isspace(c)) {
+            if (IS_SPACE(c)) {
             
                 state = STATE_LOOKING_FOR_END_OF_LABEL;
                 goto nextChar;
@@ -981,38 +2030,99 @@ static char *findFileName(char *option)
 
 
 /*
- * writeEdidFile() - write the EDID to file
+ * uniqueFileName() - expand '~' in the given filename; if the result
+ * isn't already unique, append ".#" until it is unique.
+ *
+ * XXX there is a race between checking the existence of the file,
+ * here, and the caller opening the file
+ */
+
+static char *uniqueFileName(const char *filename)
+{
+    char *working_filename;
+    char scratch[64];
+    int n = 0;
+
+    working_filename = tilde_expansion(filename);
+
+    if (!working_filename) return NULL;
+
+    while (access(working_filename, F_OK) == 0) {
+        snprintf(scratch, 64, "%d", n++);
+        nvfree(working_filename);
+        working_filename = nvstrcat(filename, ".", scratch, NULL);
+    }
+
+    return working_filename;
+
+} // uniqueFileName()
+
+
+
+/*
+ * edidFileMatches() - return TRUE if the file already holds exactly
+ * the bytes of the EDID.
+ */
+
+static int edidFileMatches(EdidPtr pEdid, const char *filename)
+{
+    struct stat stat_buf;
+    char *buf;
+    int fd, ret = FALSE;
+
+    fd = open(filename, O_RDONLY);
+    if (fd == -1) return FALSE;
+
+    if ((fstat(fd, &stat_buf) == 0) && S_ISREG(stat_buf.st_mode) &&
+        (stat_buf.st_size == pEdid->size)) {
+        buf = nvalloc(pEdid->size);
+        if ((read(fd, buf, pEdid->size) == pEdid->size) &&
+            (memcmp(buf, pEdid->bytes, pEdid->size) == 0)) {
+            ret = TRUE;
+        }
+        nvfree(buf);
+    }
+
+    close(fd);
+
+    return ret;
+
+} /* edidFileMatches() */
+
+
+
+/*
+ * writeEdidFile() - write the EDID to file; if unique is TRUE, a
+ * number is appended to the filename if needed to not overwrite an
+ * existing file.  Otherwise, the file is replaced, unless it already
+ * holds this EDID.
  */
 
-static int writeEdidFile(EdidPtr pEdid, char *filename)
+static int writeEdidFile(EdidPtr pEdid, char *filename, int unique)
 {
     int fd = -1, ret = FALSE;
     char *dst = (void *) -1;
     char *msg = "?";
     char *working_filename;
-    char scratch[64];
-    int n;
     
-    /*
-     * create a unique filename; if the given filename isn't already
-     * unique, append ".#" until it is unique.
-     *
-     * XXX there is a race between checking the existence of the file,
-     * here, and opening the file below
-     */
+    /* create a unique filename */
     
-    n = 0;
-    working_filename = tilde_expansion(filename);
+    if (unique) {
+        working_filename = uniqueFileName(filename);
+    } else {
+        working_filename = nvstrdup(filename);
+    }
     
     if (!working_filename) {
         msg = "Memory allocation failure";
         goto done;
     }
 
-    while (access(working_filename, F_OK) == 0) {
-        snprintf(scratch, 64, "%d", n++);
+    if (!unique && edidFileMatches(pEdid, working_filename)) {
+        nv_info_msg(NULL, "  EDID for \"%s\" is already in \"%s\".",
+                    pEdid->name, working_filename);
         nvfree(working_filename);
-        working_filename = nvstrcat(filename, ".", scratch, NULL);
+        return TRUE;
     }
 
     /* open the file */
@@ -1099,6 +2209,7 @@ static void freeEdid(EdidPtr pEdid)
 {
     if (pEdid->bytes) nvfree(pEdid->bytes);
     if (pEdid->name) nvfree(pEdid->name);
+    if (pEdid->screen) nvfree(pEdid->screen);
     
     nvfree(pEdid);
     
@@ -0,0 +1,272 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * gpu_cache.c - keep the GPU information that is fixed for a given
+ * GPU and driver on disk (see --gpu-cache-file), so that later runs do
+ * not have to query it through the nvidia-cfg library again: the order
+ * and PCI location of the GPUs, and the name, UUID and number of CRTCs
+ * of each.  The display devices, and their EDIDs, are not cached, as
+ * displays may be connected or disconnected at any time; they are
+ * queried on every run that needs them, which still means opening
+ * every GPU through the library.
+ *
+ * The cache is only trusted if the PCI inventory of NVIDIA display
+ * devices, as listed in sysfs, and the version of the loaded NVIDIA
+ * kernel module are the same as when it was written.  Reading these
+ * does not touch the GPUs themselves.
+ */
+
+#include "nvidia-xconfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define NVIDIA_VERSION_FILE "driver/nvidia/version"
+
+#define GPU_CACHE_HEADER "# GPU information cached by nvidia-xconfig; " \
+                         "this file may be removed at any time"
+
+#define GPU_CACHE_LINE_LEN 1024
+
+
+/*
+ * read_gpu_inventory() - describe the NVIDIA display devices on the
+ * PCI bus, and the loaded NVIDIA kernel module, as a string; this is
+ * what a GPU cache is validated against.  Returns NULL if there is
+ * nothing to validate against (no sysfs, or no NVIDIA GPUs listed in
+ * it), in which case the cache should not be used.  The version of
+ * the kernel module is read from <proc_root>/driver/nvidia/version.
+ */
+
+char *read_gpu_inventory(const char *sysfs_path, const char *proc_root)
+{
+    char *inventory = NULL, *path, line[GPU_CACHE_LINE_LEN];
+    SysfsGpuPtr gpus;
+    FILE *stream;
+    int i, n;
+
+    gpus = read_sysfs_gpus(sysfs_path, &n);
+    if (!gpus) return NULL;
+
+    /* a driver update may change what the library reports */
+
+    path = nvstrcat(proc_root, "/" NVIDIA_VERSION_FILE, NULL);
+    stream = fopen(path, "r");
+    nvfree(path);
+    if (stream) {
+        if (fgets(line, sizeof(line), stream)) {
+            line[strcspn(line, "\n")] = '\0';
+            nv_append_sprintf(&inventory, "driver %s\n", line);
+        }
+        fclose(stream);
+    }
+
+    /*
+     * the boot VGA device is what the library reports as the primary
+     * device, which decides the order of the cached GPUs
+     */
+
+    for (i = 0; i < n; i++) {
+        nv_append_sprintf(&inventory, "pci %s %04x:%04x:%06x%s\n",
+                          gpus[i].address, gpus[i].vendor, gpus[i].device,
+                          gpus[i].class, gpus[i].boot_vga ? " boot_vga" : "");
+    }
+
+    nvfree(gpus);
+
+    return inventory;
+
+} /* read_gpu_inventory() */
+
+
+
+/*
+ * load_gpu_cache() - read the GPU information from the cache file;
+ * returns NULL if there is no cache, if it was written for a
+ * different inventory (see read_gpu_inventory()), or if it cannot be
+ * parsed.
+ */
+
+DevicesPtr load_gpu_cache(const char *filename, const char *inventory)
+{
+    char line[GPU_CACHE_LINE_LEN], *cached = NULL;
+    DevicesPtr pDevices = NULL;
+    DevicePtr pDevice = NULL;
+    int i, n, crtcs, consumed;
+    NvCfgPciDevice dev;
+    FILE *stream;
+
+    stream = fopen(filename, "r");
+    if (!stream) return NULL;
+
+    if (!fgets(line, sizeof(line), stream) ||
+        strncmp(line, GPU_CACHE_HEADER "\n", sizeof(line)) != 0) {
+        goto fail;
+    }
+
+    while (fgets(line, sizeof(line), stream)) {
+
+        /* every line must be complete */
+
+        n = strlen(line);
+        if (n == 0 || line[n - 1] != '\n') goto fail;
+
+        if (!pDevices) {
+
+            /* the inventory comes first */
+
+            if (strncmp(line, "driver ", 7) == 0 ||
+                strncmp(line, "pci ", 4) == 0) {
+                nv_append_sprintf(&cached, "%s", line);
+                continue;
+            }
+
+            if (!cached || strcmp(cached, inventory) != 0) goto fail;
+
+            pDevices = nvalloc(sizeof(DevicesRec));
+        }
+
+        line[n - 1] = '\0';
+
+        if (strncmp(line, "gpu ", 4) == 0) {
+
+            memset(&dev, 0, sizeof(dev));
+            consumed = 0;
+            if ((sscanf(line, "gpu %d %d %d %d %d%n", &dev.domain, &dev.bus,
+                        &dev.slot, &dev.function, &crtcs, &consumed) != 5) ||
+                (line[consumed] != '\0')) {
+                goto fail;
+            }
+
+            pDevices->devices =
+                nvrealloc(pDevices->devices,
+                          sizeof(DeviceRec) * (pDevices->nDevices + 1));
+            pDevice = &pDevices->devices[pDevices->nDevices++];
+            memset(pDevice, 0, sizeof(DeviceRec));
+
+            pDevice->dev = dev;
+            pDevice->crtcs = crtcs;
+
+        } else if (pDevice && strncmp(line, "name ", 5) == 0) {
+            nvfree(pDevice->name);
+            pDevice->name = nvstrdup(line + 5);
+        } else if (pDevice && strncmp(line, "uuid ", 5) == 0) {
+            nvfree(pDevice->uuid);
+            pDevice->uuid = nvstrdup(line + 5);
+        } else {
+            goto fail;
+        }
+    }
+
+    /* make sure every GPU is complete */
+
+    if (!pDevices || (pDevices->nDevices == 0) || ferror(stream)) {
+        goto fail;
+    }
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+        if (pDevices->devices[i].uuid == NULL) {
+            goto fail;
+        }
+    }
+
+    fclose(stream);
+    nvfree(cached);
+
+    return pDevices;
+
+ fail:
+
+    fclose(stream);
+    nvfree(cached);
+    free_devices(pDevices);
+
+    return NULL;
+
+} /* load_gpu_cache() */
+
+
+
+/*
+ * save_gpu_cache() - write the GPU information to the cache file,
+ * along with the inventory it is valid for.  The file is replaced
+ * atomically, so a concurrent run never reads a partial cache.
+ * Failures are not fatal: the next run will just probe again.
+ */
+
+void save_gpu_cache(const char *filename, const char *inventory,
+                    DevicesPtr pDevices)
+{
+    char *tmpname, *dir, *slash;
+    DevicePtr pDevice;
+    FILE *stream;
+    int i, fd;
+
+    /* create the directory holding the cache, if needed */
+
+    slash = strrchr(filename, '/');
+    if (slash && slash != filename) {
+        dir = nvstrndup(filename, slash - filename);
+        nv_mkdir_recursive(dir, 0755, NULL, NULL);
+        nvfree(dir);
+    }
+
+    tmpname = nvstrcat(filename, ".XXXXXX", NULL);
+
+    if ((fd = mkstemp(tmpname)) == -1) goto done;
+
+    if (!(stream = fdopen(fd, "w"))) {
+        close(fd);
+        unlink(tmpname);
+        goto done;
+    }
+
+    fprintf(stream, "%s\n%s", GPU_CACHE_HEADER, inventory);
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+        pDevice = &pDevices->devices[i];
+
+        fprintf(stream, "gpu %d %d %d %d %d\n",
+                pDevice->dev.domain, pDevice->dev.bus, pDevice->dev.slot,
+                pDevice->dev.function, pDevice->crtcs);
+
+        if (pDevice->name) {
+            fprintf(stream, "name %.*s\n",
+                    (int) strcspn(pDevice->name, "\n"), pDevice->name);
+        }
+        if (pDevice->uuid) {
+            fprintf(stream, "uuid %.*s\n",
+                    (int) strcspn(pDevice->uuid, "\n"), pDevice->uuid);
+        }
+
+    }
+
+    if ((fclose(stream) != 0) || (chmod(tmpname, 0644) != 0) ||
+        (rename(tmpname, filename) != 0)) {
+        unlink(tmpname);
+    }
+
+ done:
+    nvfree(tmpname);
+
+} /* save_gpu_cache() */
@@ -27,6 +27,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
 
 
 static int enable_separate_x_screens(Options *op, XConfigPtr config,
@@ -75,7 +77,7 @@ static int* get_screens_to_clone(Options *op,
 
     /* Detect the number of supported screens per screen candidate */
     devs_found = FALSE;
-    pDevices = find_devices(op);
+    pDevices = find_devices(op, DEVICE_QUERY_HEADS);
     if (pDevices) {
         for (i = 0; i < nscreens; i++) {
             int bus, slot, scratch;
@@ -101,7 +103,6 @@ static int* get_screens_to_clone(Options *op,
                 }
             }
         }
-        free_devices(pDevices);
         devs_found = TRUE;
     }
 
@@ -293,208 +294,699 @@ int apply_multi_screen_options(Options *op, XConfigPtr config,
 
 
 /*
- * find_devices() - dlopen the nvidia-cfg library and query the
- * available information about the GPUs in the system.
+ * The nvidia-cfg library is loaded once, and the list of devices
+ * queried through it is kept for the rest of the run:
+ * find_devices() is called from several places (e.g., for both
+ * --separate-x-screens and --enable-all-gpus), and probing every GPU
+ * is expensive.  invalidate_devices() drops the cached list, so that
+ * the next find_devices() probes the hardware again.
+ */
+
+static NvCfgLibRec nvCfgLib;
+
+static DevicesPtr cachedDevices = NULL;
+static char *devicesInventory = NULL;
+static int devicesQueried = FALSE;
+
+static DevicesPtr pciDevices = NULL;
+static int pciDevicesQueried = FALSE;
+
+
+
+/*
+ * probe_start() and probe_seconds() time the device probes reported
+ * with --gpu-probe-stats.
  */
 
-DevicesPtr find_devices(Options *op)
+static void probe_start(struct timespec *start)
 {
-    DevicesPtr pDevices = NULL;
-    DisplayDevicePtr pDisplayDevice;
-    int i, j, n, count = 0;
-    unsigned int mask, bit;
-    DeviceRec tmpDevice;
-    NvCfgPciDevice *devs = NULL;
-    NvCfgBool is_primary_device;
-    NvCfgBool ret;
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static double probe_seconds(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) (now.tv_sec - start->tv_sec) +
+        (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+
+/*
+ * probe_traced() - whether the calls into the nvidia-cfg library are
+ * recorded or replayed; the GPUs are then always probed through it.
+ */
+
+static int probe_traced(const Options *op)
+{
+    return (op->record_gpu_probe != NULL) || (op->replay_gpu_probe != NULL);
+
+} /* probe_traced() */
+
+
+
+/*
+ * load_nvidia_cfg() - dlopen the nvidia-cfg library and resolve the
+ * functions we use from it; the library stays loaded, so later calls
+ * just return it.  With --replay-gpu-probe, the functions serve the
+ * recorded trace instead, and with --record-gpu-probe, every call is
+ * recorded (see probe_trace.c).  Returns NULL on failure.
+ */
+
+static NvCfgLibPtr load_nvidia_cfg(Options *op)
+{
+    NvCfgLibPtr lib = &nvCfgLib;
     char *lib_path;
     void *lib_handle;
 
-    NvCfgBool (*__getDevices)(int *n, NvCfgDevice **devs);
-    NvCfgBool (*__openDevice)(int bus, int slot, NvCfgDeviceHandle *handle);
-    NvCfgBool (*__getPciDevices)(int *n, NvCfgPciDevice **devs);
-    NvCfgBool (*__openPciDevice)(int domain, int bus, int slot, int function,
-                                 NvCfgDeviceHandle *handle);
-    NvCfgBool (*__getNumCRTCs)(NvCfgDeviceHandle handle, int *crtcs);
-    NvCfgBool (*__getProductName)(NvCfgDeviceHandle handle, char **name);
-    NvCfgBool (*__getDisplayDevices)(NvCfgDeviceHandle handle,
-                                     unsigned int *display_device_mask);
-    NvCfgBool (*__getEDID)(NvCfgDeviceHandle handle,
-                           unsigned int display_device,
-                           NvCfgDisplayDeviceInformation *info);
-    NvCfgBool (*__isPrimaryDevice)(NvCfgDeviceHandle handle,
-                                  NvCfgBool *is_primary_device);
-    NvCfgBool (*__closeDevice)(NvCfgDeviceHandle handle);
-    NvCfgBool (*__getDeviceUUID)(NvCfgDeviceHandle handle, char **uuid);
-    
-    /* dlopen() the nvidia-cfg library */
-    
 #define __LIB_NAME "libnvidia-cfg.so.1"
 
-    if (op->nvidia_cfg_path) {
+    if (op->replay_gpu_probe) {
+        lib_path = nvstrdup(op->replay_gpu_probe);
+    } else if (op->nvidia_cfg_path) {
         lib_path = nvstrcat(op->nvidia_cfg_path, "/", __LIB_NAME, NULL);
     } else {
-        lib_path = strdup(__LIB_NAME);
+        lib_path = nvstrdup(__LIB_NAME);
     }
-    
+
+    /* reuse the library if it is already loaded from this path */
+
+    if (lib->path) {
+        if (strcmp(lib->path, lib_path) == 0) {
+            nvfree(lib_path);
+            return lib;
+        }
+        if (lib->handle) dlclose(lib->handle);
+        nvfree(lib->path);
+        memset(lib, 0, sizeof(NvCfgLibRec));
+    }
+
+    if (op->replay_gpu_probe) {
+        if (!replay_nvidia_cfg(lib, lib_path)) {
+            nvfree(lib_path);
+            return NULL;
+        }
+        lib->path = lib_path;
+        return lib;
+    }
+
     lib_handle = dlopen(lib_path, RTLD_NOW);
-    
-    nvfree(lib_path);
-    
+
     if (!lib_handle) {
         nv_warning_msg("error opening %s: %s.", __LIB_NAME, dlerror());
+        nvfree(lib_path);
         return NULL;
     }
-    
+
 #define __GET_FUNC(proc, name)                                        \
     (proc) = dlsym(lib_handle, (name));                               \
     if (!(proc)) {                                                    \
         nv_warning_msg("error retrieving symbol %s from %s: %s",      \
                        (name), __LIB_NAME, dlerror());                \
         dlclose(lib_handle);                                          \
+        nvfree(lib_path);                                             \
+        memset(lib, 0, sizeof(NvCfgLibRec));                          \
         return NULL;                                                  \
     }
 
     /* required functions */
-    __GET_FUNC(__getDevices, "nvCfgGetDevices");
-    __GET_FUNC(__openDevice, "nvCfgOpenDevice");
-    __GET_FUNC(__getPciDevices, "nvCfgGetPciDevices");
-    __GET_FUNC(__openPciDevice, "nvCfgOpenPciDevice");
-    __GET_FUNC(__getNumCRTCs, "nvCfgGetNumCRTCs");
-    __GET_FUNC(__getProductName, "nvCfgGetProductName");
-    __GET_FUNC(__getDisplayDevices, "nvCfgGetDisplayDevices");
-    __GET_FUNC(__getEDID, "nvCfgGetEDID");
-    __GET_FUNC(__closeDevice, "nvCfgCloseDevice");
-    __GET_FUNC(__getDeviceUUID, "nvCfgGetDeviceUUID");
+    __GET_FUNC(lib->getDevices, "nvCfgGetDevices");
+    __GET_FUNC(lib->openDevice, "nvCfgOpenDevice");
+    __GET_FUNC(lib->getPciDevices, "nvCfgGetPciDevices");
+    __GET_FUNC(lib->openPciDevice, "nvCfgOpenPciDevice");
+    __GET_FUNC(lib->getNumCRTCs, "nvCfgGetNumCRTCs");
+    __GET_FUNC(lib->getProductName, "nvCfgGetProductName");
+    __GET_FUNC(lib->getDisplayDevices, "nvCfgGetDisplayDevices");
+    __GET_FUNC(lib->getEDID, "nvCfgGetEDID");
+    __GET_FUNC(lib->closeDevice, "nvCfgCloseDevice");
+    __GET_FUNC(lib->getDeviceUUID, "nvCfgGetDeviceUUID");
+
+#undef __GET_FUNC
 
     /* optional functions */
-    __isPrimaryDevice = dlsym(lib_handle, "nvCfgIsPrimaryDevice");
-    
-    if (__getPciDevices(&count, &devs) != NVCFG_TRUE) {
+    lib->isPrimaryDevice = dlsym(lib_handle, "nvCfgIsPrimaryDevice");
+
+    if (op->record_gpu_probe &&
+        !record_nvidia_cfg(lib, op->record_gpu_probe)) {
+        dlclose(lib_handle);
+        nvfree(lib_path);
+        memset(lib, 0, sizeof(NvCfgLibRec));
         return NULL;
     }
 
-    if (count == 0) return NULL;
+    lib->handle = lib_handle;
+    lib->path = lib_path;
 
-    pDevices = nvalloc(sizeof(DevicesRec));
-    
-    pDevices->devices = nvalloc(sizeof(DeviceRec) * count);
+    return lib;
 
-    pDevices->nDevices = count;
+} /* load_nvidia_cfg() */
 
-    for (i = 0; i < count; i++) {
-        
-        pDevices->devices[i].dev = devs[i];
-        
-        if (__openPciDevice(devs[i].domain, devs[i].bus, devs[i].slot, 0,
-                            &(pDevices->devices[i].handle)) != NVCFG_TRUE) {
-            goto fail;
-        }
-        
-        if (__getNumCRTCs(pDevices->devices[i].handle,
-                          &pDevices->devices[i].crtcs) != NVCFG_TRUE) {
+
+
+/*
+ * query_edid() - read the EDID of the given display device; reading
+ * it over DDC is the slowest part of probing a GPU, so this is only
+ * done for DEVICE_QUERY_EDIDS, and only once per display device.
+ */
+
+static void query_edid(NvCfgLibPtr lib, NvCfgDeviceHandle handle,
+                       DisplayDevicePtr pDisplayDevice)
+{
+    if (lib->getEDID(handle, pDisplayDevice->mask,
+                     &pDisplayDevice->info) != NVCFG_TRUE) {
+        pDisplayDevice->info_valid = FALSE;
+    } else {
+        pDisplayDevice->info_valid = TRUE;
+    }
+
+    pDisplayDevice->info_queried = TRUE;
+
+} /* query_edid() */
+
+
+
+/*
+ * probe_device() - open the given GPU through the nvidia-cfg library,
+ * fill in pDevice with what we can learn about it (including the
+ * EDIDs if query is DEVICE_QUERY_EDIDS), and close it again.  If
+ * known is non-NULL, the CRTCs, name, and UUID are copied from it
+ * rather than queried, so only the display devices are.  If
+ * is_primary is non-NULL, it is set to whether the GPU is the primary
+ * device.  Returns FALSE on failure; the GPU is closed either way.
+ *
+ * This may be called from several threads at once, each with its own
+ * pDevice.
+ */
+
+static int probe_device(NvCfgLibPtr lib, const NvCfgPciDevice *dev,
+                        const DeviceRec *known, DevicePtr pDevice,
+                        int query, int *is_primary)
+{
+    DisplayDevicePtr pDisplayDevice;
+    NvCfgBool is_primary_device;
+    unsigned int mask, bit;
+    int j, n;
+
+    pDevice->dev = *dev;
+
+    if (is_primary) *is_primary = FALSE;
+
+    if (lib->openPciDevice(dev->domain, dev->bus, dev->slot, 0,
+                           &pDevice->handle) != NVCFG_TRUE) {
+        pDevice->handle = NULL;
+        return FALSE;
+    }
+
+    if (known) {
+        pDevice->crtcs = known->crtcs;
+        pDevice->name = known->name ? nvstrdup(known->name) : NULL;
+        pDevice->uuid = nvstrdup(known->uuid);
+    } else {
+        if (lib->getNumCRTCs(pDevice->handle,
+                             &pDevice->crtcs) != NVCFG_TRUE) {
             goto fail;
         }
 
-        if (__getProductName(pDevices->devices[i].handle,
-                             &pDevices->devices[i].name) != NVCFG_TRUE) {
+        if (lib->getProductName(pDevice->handle,
+                                &pDevice->name) != NVCFG_TRUE) {
             /* This call may fail with little impact to the Device section */
-            pDevices->devices[i].name = NULL;
+            pDevice->name = NULL;
         }
 
-        if (__getDeviceUUID(pDevices->devices[i].handle,
-                            &pDevices->devices[i].uuid) != NVCFG_TRUE) {
+        if (lib->getDeviceUUID(pDevice->handle,
+                               &pDevice->uuid) != NVCFG_TRUE) {
             goto fail;
         }
-        if (__getDisplayDevices(pDevices->devices[i].handle, &mask) !=
-            NVCFG_TRUE) {
-            goto fail;
-        }
-        
-        pDevices->devices[i].displayDeviceMask = mask;
+    }
+    if (lib->getDisplayDevices(pDevice->handle, &mask) != NVCFG_TRUE) {
+        goto fail;
+    }
+
+    pDevice->displayDeviceMask = mask;
+
+    /* count the number of display devices */
+
+    for (n = j = 0; j < 32; j++) {
+        if (mask & (1 << j)) n++;
+    }
+
+    pDevice->nDisplayDevices = n;
+
+    if (n) {
+
+        /* allocate the info array of the right size */
+
+        pDevice->displayDevices = nvalloc(sizeof(DisplayDeviceRec) * n);
+
+        /* fill in the info array */
 
-        /* count the number of display devices */
-        
         for (n = j = 0; j < 32; j++) {
-            if (mask & (1 << j)) n++;
+            bit = 1 << j;
+            if (!(bit & mask)) continue;
+
+            pDisplayDevice = &pDevice->displayDevices[n];
+            pDisplayDevice->mask = bit;
+
+            if (query >= DEVICE_QUERY_EDIDS) {
+                query_edid(lib, pDevice->handle, pDisplayDevice);
+            }
+            n++;
         }
-        
-        pDevices->devices[i].nDisplayDevices = n;
+    } else {
+        pDevice->displayDevices = NULL;
+    }
 
-        if (n) {
+    if (is_primary && (lib->isPrimaryDevice != NULL) &&
+        (lib->isPrimaryDevice(pDevice->handle,
+                              &is_primary_device) == NVCFG_TRUE) &&
+        (is_primary_device == NVCFG_TRUE)) {
+        *is_primary = TRUE;
+    }
 
-            /* allocate the info array of the right size */
-            
-            pDevices->devices[i].displayDevices =
-                nvalloc(sizeof(DisplayDeviceRec) * n);
-            
-            /* fill in the info array */
-            
-            for (n = j = 0; j < 32; j++) {
-                bit = 1 << j;
-                if (!(bit & mask)) continue;
-                
-                pDisplayDevice = &pDevices->devices[i].displayDevices[n];
-                pDisplayDevice->mask = bit;
-
-                if (__getEDID(pDevices->devices[i].handle, bit,
-                              &pDisplayDevice->info) != NVCFG_TRUE) {
-                    pDisplayDevice->info_valid = FALSE;
-                } else {
-                    pDisplayDevice->info_valid = TRUE;
-                }
-                n++;
+    if (lib->closeDevice(pDevice->handle) != NVCFG_TRUE) {
+        pDevice->handle = NULL;
+        return FALSE;
+    }
+    pDevice->handle = NULL;
+
+    return TRUE;
+
+ fail:
+
+    lib->closeDevice(pDevice->handle);
+    pDevice->handle = NULL;
+
+    return FALSE;
+
+} /* probe_device() */
+
+
+
+/*
+ * The GPUs can be probed by a pool of threads (see
+ * --gpu-probe-threads); each thread repeatedly claims the next
+ * unprobed GPU until there are none left, or until a GPU fails to
+ * probe (which fails the whole query).  The results are written
+ * to per-GPU slots, so the device order does not depend on which
+ * thread finished first.
+ */
+
+typedef struct {
+    NvCfgLibPtr lib;
+    const NvCfgPciDevice *devs;
+    const DeviceRec *known;
+    DevicePtr devices;
+    int *is_primary;
+    int query;
+    int count;
+    int next;
+    int failed;
+    pthread_mutex_t lock;
+} ProbeJobRec, *ProbeJobPtr;
+
+
+static void *probe_worker(void *arg)
+{
+    ProbeJobPtr job = arg;
+    int i, ok;
+
+    while (TRUE) {
+        pthread_mutex_lock(&job->lock);
+        i = job->failed ? job->count : job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (i >= job->count) break;
+
+        /* the primary device only matters for GPUs not known yet */
+
+        ok = probe_device(job->lib, &job->devs[i],
+                          job->known ? &job->known[i] : NULL,
+                          &job->devices[i], job->query,
+                          (i != 0 && !job->known) ?
+                          &job->is_primary[i] : NULL);
+
+        if (!ok) {
+            pthread_mutex_lock(&job->lock);
+            job->failed = TRUE;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+
+    return NULL;
+
+} /* probe_worker() */
+
+
+
+/*
+ * query_devices() - query the available information about the GPUs
+ * in the system through the nvidia-cfg library; query is one of the
+ * DEVICE_QUERY values.  If known is non-NULL, it lists the GPUs in
+ * the order to report them, along with the information that does not
+ * change while the driver is loaded (see gpu_cache.c); then only the
+ * display devices (and EDIDs) are queried.
+ */
+
+static DevicesPtr query_devices(Options *op, int query, DevicesPtr known)
+{
+    NvCfgLibPtr lib;
+    DevicesPtr pDevices = NULL;
+    int i, j, count = 0, nthreads, edids;
+    struct timespec start;
+    DeviceRec tmpDevice;
+    NvCfgPciDevice *devs = NULL;
+    ProbeJobRec job;
+    pthread_t *threads;
+
+    probe_start(&start);
+
+    lib = load_nvidia_cfg(op);
+    if (!lib) return NULL;
+
+    if (known) {
+        count = known->nDevices;
+        devs = malloc(sizeof(NvCfgPciDevice) * count);
+        if (!devs) return NULL;
+        for (i = 0; i < count; i++) {
+            devs[i] = known->devices[i].dev;
+        }
+    } else if (lib->getPciDevices(&count, &devs) != NVCFG_TRUE) {
+        return NULL;
+    }
+
+    if (count == 0) {
+        if (devs) free(devs);
+        return NULL;
+    }
+
+    pDevices = nvalloc(sizeof(DevicesRec));
+    
+    pDevices->devices = nvalloc(sizeof(DeviceRec) * count);
+
+    pDevices->nDevices = count;
+
+    /*
+     * probe the GPUs; the calling thread always takes part, so the
+     * probe completes even if no additional threads can be created
+     */
+
+    memset(&job, 0, sizeof(job));
+    job.lib = lib;
+    job.devs = devs;
+    job.known = known ? known->devices : NULL;
+    job.devices = pDevices->devices;
+    job.is_primary = nvalloc(sizeof(int) * count);
+    job.query = query;
+    job.count = count;
+    pthread_mutex_init(&job.lock, NULL);
+
+    nthreads = NV_MIN(op->gpu_probe_threads, count);
+    threads = NULL;
+
+    if (nthreads > 1) {
+        threads = nvalloc(sizeof(pthread_t) * (nthreads - 1));
+        for (i = 0; i < nthreads - 1; i++) {
+            if (pthread_create(&threads[i], NULL, probe_worker, &job) != 0) {
+                break;
             }
-        } else {
-            pDevices->devices[i].displayDevices = NULL;
         }
+        nthreads = i + 1;
+    }
+
+    probe_worker(&job);
 
-        if ((i != 0) && (__isPrimaryDevice != NULL) &&
-            (__isPrimaryDevice(pDevices->devices[i].handle,
-                               &is_primary_device) == NVCFG_TRUE) &&
-            (is_primary_device == NVCFG_TRUE)) {
+    for (i = 0; i < nthreads - 1; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    nvfree(threads);
+    pthread_mutex_destroy(&job.lock);
+
+    /*
+     * move the primary device to the front; this is replayed in GPU
+     * order, so the result is the same as swapping as each GPU is
+     * probed.  The order of known GPUs has already been settled.
+     */
+
+    for (i = 1; !job.failed && !known && i < count; i++) {
+        if (job.is_primary[i]) {
             memcpy(&tmpDevice, &pDevices->devices[0], sizeof(DeviceRec));
-            memcpy(&pDevices->devices[0], &pDevices->devices[i], sizeof(DeviceRec));
+            memcpy(&pDevices->devices[0], &pDevices->devices[i],
+                   sizeof(DeviceRec));
             memcpy(&pDevices->devices[i], &tmpDevice, sizeof(DeviceRec));
         }
-        
-        ret = __closeDevice(pDevices->devices[i].handle);
-        pDevices->devices[i].handle = NULL;
+    }
 
-        if (ret != NVCFG_TRUE) {
-            goto fail;
+    nvfree(job.is_primary);
+
+    if (op->gpu_probe_stats) {
+        for (edids = i = 0; i < count; i++) {
+            for (j = 0; j < pDevices->devices[i].nDisplayDevices; j++) {
+                if (pDevices->devices[i].displayDevices[j].info_queried) {
+                    edids++;
+                }
+            }
         }
+        nv_info_msg(NULL, "GPU probe: opened %d of %d GPU(s) through the "
+                    "nvidia-cfg library with %d thread(s), read %d EDID(s); "
+                    "%.3f seconds.", NV_MIN(job.next, count), count, nthreads,
+                    edids, probe_seconds(&start));
+    }
+
+    if (job.failed) {
+        nv_warning_msg("Unable to use the nvidia-cfg library to query NVIDIA "
+                       "hardware.");
+        free_devices(pDevices);
+        pDevices = NULL;
     }
+
+    if (devs) free(devs);
     
-    goto done;
+    return pDevices;
     
- fail:
+} /* query_devices() */
 
-    nv_warning_msg("Unable to use the nvidia-cfg library to query NVIDIA "
-                   "hardware.");
+
+
+/*
+ * query_missing_edids() - read the EDIDs in pDevices that have not
+ * been queried yet, opening each GPU that has any.  A GPU that
+ * cannot be opened is left as it is, so that its EDIDs are retried on
+ * the next call.
+ */
+
+static void query_missing_edids(Options *op, DevicesPtr pDevices)
+{
+    NvCfgLibPtr lib = NULL;
+    NvCfgDeviceHandle handle;
+    DevicePtr pDevice;
+    int i, j, missing, opened = 0, edids = 0;
+    struct timespec start;
+
+    probe_start(&start);
 
     for (i = 0; i < pDevices->nDevices; i++) {
-        /* close the opened device */
-        if (pDevices->devices[i].handle) {
-            __closeDevice(pDevices->devices[i].handle);
+        pDevice = &pDevices->devices[i];
+
+        for (missing = FALSE, j = 0; j < pDevice->nDisplayDevices; j++) {
+            if (!pDevice->displayDevices[j].info_queried) missing = TRUE;
+        }
+        if (!missing) continue;
+
+        if (!lib && !(lib = load_nvidia_cfg(op))) break;
+
+        opened++;
+
+        if (lib->openPciDevice(pDevice->dev.domain, pDevice->dev.bus,
+                               pDevice->dev.slot, 0,
+                               &handle) != NVCFG_TRUE) {
+            continue;
+        }
+
+        for (j = 0; j < pDevice->nDisplayDevices; j++) {
+            if (!pDevice->displayDevices[j].info_queried) {
+                query_edid(lib, handle, &pDevice->displayDevices[j]);
+                edids++;
+            }
         }
+
+        lib->closeDevice(handle);
     }
 
-    free_devices(pDevices);
-    pDevices = NULL;
+    if (op->gpu_probe_stats && opened) {
+        nv_info_msg(NULL, "GPU probe: opened %d GPU(s) through the "
+                    "nvidia-cfg library to read %d EDID(s); %.3f seconds.",
+                    opened, edids, probe_seconds(&start));
+    }
 
-    /* fall through */
+} /* query_missing_edids() */
+
+
+
+/*
+ * load_cached_devices() - return the GPUs listed in the GPU cache file
+ * (see gpu_cache.c), or NULL if there is no valid cache to use.  Only
+ * the PCI location, name, UUID, and number of CRTCs of each GPU are
+ * filled in.  The inventory the cache was validated against is kept
+ * for writing the cache later.
+ */
+
+static DevicesPtr load_cached_devices(Options *op)
+{
+    DevicesPtr pDevices = NULL;
+    struct timespec start;
+
+    probe_start(&start);
+
+    if (op->gpu_cache_file && !probe_traced(op) && !devicesInventory) {
+        devicesInventory = read_gpu_inventory(op->sysfs_path,
+                                              op->gop.proc_root);
+    }
+
+    if (devicesInventory && !op->refresh_gpu_cache) {
+        pDevices = load_gpu_cache(op->gpu_cache_file, devicesInventory);
+    }
+
+    if (pDevices && op->gpu_probe_stats) {
+        nv_info_msg(NULL, "GPU probe: read %d GPU(s) from '%s'; "
+                    "%.3f seconds.", pDevices->nDevices,
+                    op->gpu_cache_file, probe_seconds(&start));
+    }
 
- done:
-    
-    if (devs) free(devs);
-    
     return pDevices;
-    
+
+} /* load_cached_devices() */
+
+
+
+/*
+ * find_devices() - return the information about the GPUs in the
+ * system; query is DEVICE_QUERY_HEADS if only the CRTCs and display
+ * devices of each GPU are needed, or DEVICE_QUERY_EDIDS if the EDID
+ * of each display device is needed as well.
+ *
+ * The first call queries the nvidia-cfg library.  If a GPU cache file
+ * is given (--gpu-cache-file) and still valid, the GPUs and what does
+ * not change about them are taken from it (see gpu_cache.c), and only
+ * the display devices are queried; otherwise the cache is written
+ * after the query.  The cache is not used while a probe is recorded
+ * or replayed, since every call has to go through the library.  EDIDs
+ * that have not been read yet are read when a later call needs them.
+ * The returned list is shared and must not be freed or modified by
+ * the caller; it remains valid until invalidate_devices() is called.
+ */
+
+DevicesPtr find_devices(Options *op, int query)
+{
+    DevicesPtr staticDevices;
+
+    if (!devicesQueried) {
+
+        staticDevices = load_cached_devices(op);
+
+        if (staticDevices) {
+            cachedDevices = query_devices(op, query, staticDevices);
+        }
+
+        /* a cached GPU that can no longer be opened means a full query */
+
+        if (!cachedDevices) {
+            cachedDevices = query_devices(op, query, NULL);
+
+            if (cachedDevices && devicesInventory) {
+                save_gpu_cache(op->gpu_cache_file, devicesInventory,
+                               cachedDevices);
+            }
+        }
+
+        free_devices(staticDevices);
+
+        devicesQueried = TRUE;
+    }
+
+    if (cachedDevices && (query >= DEVICE_QUERY_EDIDS)) {
+        query_missing_edids(op, cachedDevices);
+    }
+
+    return cachedDevices;
+
 } /* find_devices() */
 
 
 
+/*
+ * find_pci_devices() - like find_devices(), but for callers that only
+ * need the location, name, and UUID of each GPU.  Unless the full
+ * information has already been queried, the GPUs are taken from the
+ * GPU cache if it is valid, or else listed in sysfs (see pci_sysfs.c);
+ * neither loads the nvidia-cfg library or opens any GPU.  The callers
+ * number the X screens and assign BusIDs in the order of the list:
+ * the cache records the order the library reported, and the sysfs
+ * list is put in the same order.  The library is only used if both
+ * fail, or if the probe is recorded or replayed.  The same rules as
+ * for find_devices() apply to the returned list.
+ */
+
+DevicesPtr find_pci_devices(Options *op)
+{
+    struct timespec start;
+
+    if (devicesQueried && cachedDevices) {
+        return cachedDevices;
+    }
+
+    if (!pciDevicesQueried) {
+        pciDevices = load_cached_devices(op);
+        pciDevicesQueried = TRUE;
+
+        if (!pciDevices && !probe_traced(op)) {
+            probe_start(&start);
+
+            pciDevices = find_sysfs_devices(op->sysfs_path,
+                                            op->gop.proc_root);
+
+            if (pciDevices && op->gpu_probe_stats) {
+                nv_info_msg(NULL, "GPU probe: listed %d GPU(s) in '%s'; "
+                            "%.3f seconds.", pciDevices->nDevices,
+                            op->sysfs_path, probe_seconds(&start));
+            }
+        }
+    }
+
+    if (pciDevices) {
+        return pciDevices;
+    }
+
+    return find_devices(op, DEVICE_QUERY_HEADS);
+
+} /* find_pci_devices() */
+
+
+
+/*
+ * invalidate_devices() - discard the lists cached by find_devices()
+ * and find_pci_devices(); the nvidia-cfg library itself stays loaded.
+ */
+
+void invalidate_devices(void)
+{
+    free_devices(cachedDevices);
+    cachedDevices = NULL;
+    nvfree(devicesInventory);
+    devicesInventory = NULL;
+    devicesQueried = FALSE;
+
+    free_devices(pciDevices);
+    pciDevices = NULL;
+    pciDevicesQueried = FALSE;
+
+} /* invalidate_devices() */
+
+
+
 /*
  * free_devices()
  */
@@ -509,6 +1001,8 @@ void free_devices(DevicesPtr pDevices)
         if (pDevices->devices[i].displayDevices) {
             nvfree(pDevices->devices[i].displayDevices);
         }
+        nvfree(pDevices->devices[i].name);
+        nvfree(pDevices->devices[i].uuid);
     }
     
     if (pDevices->devices) {
@@ -563,6 +1057,7 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
 {
     XConfigScreenPtr screen, *screenlist = NULL;
     XConfigAdjacencyPtr adj;
+    XConfigArenaPtr prevArena;
     int* screens_to_clone = NULL;
 
     int i, nscreens = 0;
@@ -617,7 +1112,7 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
     if (!have_busids) {
         DevicesPtr pDevices;
         
-        pDevices = find_devices(op);
+        pDevices = find_pci_devices(op);
         if (!pDevices) {
             nv_error_msg("Unable to determine number or location of "
                          "GPUs in system; cannot "
@@ -643,8 +1138,6 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
 
             screenlist[i]->device->board = nvstrdup(pDevices->devices[i].name);
         }
-
-        free_devices(pDevices);
     }
 
     /* step 3 */
@@ -653,8 +1146,13 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
     /* step 4 */
     screens_to_clone = get_screens_to_clone(op, screenlist, nscreens);
     
-    /* step 5: clone each eligible screen */
+    /*
+     * step 5: clone each eligible screen; the clones are allocated
+     * from the config's arena, if it has one
+     */
     
+    prevArena = xconfigSetArena(config->arena);
+
     for (i = 0; i < nscreens; i++) {
         if (!screenlist[i]) continue;
 
@@ -663,6 +1161,8 @@ static int enable_separate_x_screens(Options *op, XConfigPtr config,
         }
     }
 
+    xconfigSetArena(prevArena);
+
     nvfree(screens_to_clone);
     
     /* step 6: wipe the existing adjacencies and recreate them */
@@ -774,9 +1274,27 @@ static int disable_separate_x_screens(Options *op, XConfigPtr config,
 } /* disable_separate_x_screens() */
 
 
+/*
+ * clone_identifier() - build the identifier of the idx'th clone of a
+ * section: "<identifier> (<idx>)".
+ */
+
+static char *clone_identifier(const char *identifier, int idx)
+{
+    char suffix[16];
+
+    snprintf(suffix, sizeof(suffix), " (%d)", idx);
+
+    return xconfigStrcat(identifier, suffix, NULL);
+
+} /* clone_identifier() */
+
+
+
 /*
  * clone_display_list() - create a duplicate of the specified display
- * subsection.
+ * subsection.  The clone_*() functions allocate with the xconfig*()
+ * allocators, so that they honor the current arena.
  */
 
 static XConfigDisplayPtr clone_display_list(XConfigDisplayPtr display0)
@@ -784,10 +1302,10 @@ static XConfigDisplayPtr clone_display_list(XConfigDisplayPtr display0)
     XConfigDisplayPtr d = NULL, prev = NULL, head = NULL;
     
     while (display0) {
-        d = nvalloc(sizeof(XConfigDisplayRec));
+        d = xconfigAlloc(sizeof(XConfigDisplayRec));
         memcpy(d, display0, sizeof(XConfigDisplayRec));
-        if (display0->visual) d->visual = nvstrdup(display0->visual);
-        if (display0->comment) d->comment = nvstrdup(display0->comment);
+        if (display0->visual) d->visual = xconfigStrdup(display0->visual);
+        if (display0->comment) d->comment = xconfigStrdup(display0->comment);
         d->options = xconfigOptionListDup(display0->options);
         d->next = NULL;
         if (prev) prev->next = d;
@@ -811,18 +1329,18 @@ static XConfigDevicePtr clone_device(XConfigDevicePtr device0, int idx)
 {
     XConfigDevicePtr device;
 
-    device = nvalloc(sizeof(XConfigDeviceRec));
+    device = xconfigAlloc(sizeof(XConfigDeviceRec));
     
-    device->identifier = nvasprintf("%s (%d)", device0->identifier, idx);
+    device->identifier = clone_identifier(device0->identifier, idx);
     
-    if (device0->vendor)  device->vendor  = nvstrdup(device0->vendor);
-    if (device0->board)   device->board   = nvstrdup(device0->board);
-    if (device0->chipset) device->chipset = nvstrdup(device0->chipset);
-    if (device0->busid)   device->busid   = nvstrdup(device0->busid);
-    if (device0->card)    device->card    = nvstrdup(device0->card);
-    if (device0->driver)  device->driver  = nvstrdup(device0->driver);
-    if (device0->ramdac)  device->ramdac  = nvstrdup(device0->ramdac);
-    if (device0->comment) device->comment = nvstrdup(device0->comment);
+    if (device0->vendor)  device->vendor  = xconfigStrdup(device0->vendor);
+    if (device0->board)   device->board   = xconfigStrdup(device0->board);
+    if (device0->chipset) device->chipset = xconfigStrdup(device0->chipset);
+    if (device0->busid)   device->busid   = xconfigStrdup(device0->busid);
+    if (device0->card)    device->card    = xconfigStrdup(device0->card);
+    if (device0->driver)  device->driver  = xconfigStrdup(device0->driver);
+    if (device0->ramdac)  device->ramdac  = xconfigStrdup(device0->ramdac);
+    if (device0->comment) device->comment = xconfigStrdup(device0->comment);
 
     /* these are needed for multiple X screens on one GPU */
 
@@ -853,22 +1371,22 @@ static XConfigDevicePtr clone_device(XConfigDevicePtr device0, int idx)
 
 static XConfigScreenPtr clone_screen(XConfigScreenPtr screen0, int idx)
 {
-    XConfigScreenPtr screen = nvalloc(sizeof(XConfigScreenRec));
+    XConfigScreenPtr screen = xconfigAlloc(sizeof(XConfigScreenRec));
     
-    screen->identifier = nvasprintf("%s (%d)", screen0->identifier, idx);
+    screen->identifier = clone_identifier(screen0->identifier, idx);
     
     screen->device = clone_device(screen0->device, idx);
-    screen->device_name = nvstrdup(screen->device->identifier);
+    screen->device_name = xconfigStrdup(screen->device->identifier);
     
     screen->monitor = screen0->monitor;
-    screen->monitor_name = nvstrdup(screen0->monitor_name);
+    screen->monitor_name = xconfigStrdup(screen0->monitor_name);
     
     screen->defaultdepth = screen0->defaultdepth;
     
     screen->displays = clone_display_list(screen0->displays);
     
     screen->options = xconfigOptionListDup(screen0->options);
-    if (screen0->comment) screen->comment = nvstrdup(screen0->comment);
+    if (screen0->comment) screen->comment = xconfigStrdup(screen0->comment);
 
     /* insert the new screen after the original screen */
 
@@ -935,7 +1453,7 @@ static int enable_all_gpus(Options *op, XConfigPtr config,
     DevicesPtr pDevices;
     int i;
 
-    pDevices = find_devices(op);
+    pDevices = find_pci_devices(op);
     if (!pDevices) {
         nv_error_msg("Unable to determine number of GPUs in system; cannot "
                      "honor '--enable-all-gpus' option.");
@@ -958,8 +1476,6 @@ static int enable_all_gpus(Options *op, XConfigPtr config,
                                  pDevices->devices[i].dev.slot,
                                  pDevices->devices[i].name, i);
     }
-    
-    free_devices(pDevices);
 
     /* create adjacencies for the layout */
     
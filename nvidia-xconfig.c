@@ -41,6 +41,8 @@
 #define ORIG_SUFFIX   ".nvidia-xconfig-original"
 #define BACKUP_SUFFIX ".backup"
 
+#define SYSFS_PATH "/sys"
+
 
 /*
  * print_version() - print version information
@@ -178,6 +180,10 @@ static void parse_commandline(Options *op, int argc, char *argv[])
 
         case X_PREFIX_OPTION: op->gop.x_project_root = strval; break;
 
+        case XSERVER_CACHE_FILE_OPTION:
+            op->gop.xserver_cache_file = strval;
+            break;
+
         case KEYBOARD_OPTION: op->gop.keyboard = strval; break;
         case KEYBOARD_LIST_OPTION: op->keyboard_list = TRUE; break;
         case KEYBOARD_DRIVER_OPTION: op->gop.keyboard_driver = strval; break;
@@ -186,6 +192,26 @@ static void parse_commandline(Options *op, int argc, char *argv[])
         case MOUSE_LIST_OPTION: op->mouse_list = TRUE; break;
             
         case NVIDIA_CFG_PATH_OPTION: op->nvidia_cfg_path = strval; break;
+        case SYSFS_PATH_OPTION: op->sysfs_path = strval; break;
+
+        case GPU_PROBE_THREADS_OPTION:
+
+            if (intval < 1) {
+                fprintf(stderr, "\n");
+                fprintf(stderr, "Invalid number of GPU probe threads: %d.\n",
+                        intval);
+                fprintf(stderr, "\n");
+                goto fail;
+            }
+
+            op->gpu_probe_threads = intval;
+            break;
+
+        case GPU_CACHE_FILE_OPTION: op->gpu_cache_file = strval; break;
+        case REFRESH_GPU_CACHE_OPTION: op->refresh_gpu_cache = TRUE; break;
+        case GPU_PROBE_STATS_OPTION: op->gpu_probe_stats = TRUE; break;
+        case RECORD_GPU_PROBE_OPTION: op->record_gpu_probe = strval; break;
+        case REPLAY_GPU_PROBE_OPTION: op->replay_gpu_probe = strval; break;
 
         case FORCE_GENERATE_OPTION: op->force_generate = TRUE; break;
 
@@ -468,14 +494,43 @@ static void parse_commandline(Options *op, int argc, char *argv[])
         
         case QUERY_GPU_INFO_OPTION: op->query_gpu_info = TRUE; break;
 
+        case QUERY_FORMAT_OPTION:
+            if (strcasecmp(strval, "text") == 0) {
+                op->query_format = QUERY_FORMAT_TEXT;
+            } else if (strcasecmp(strval, "json") == 0) {
+                op->query_format = QUERY_FORMAT_JSON;
+            } else if (strcasecmp(strval, "csv") == 0) {
+                op->query_format = QUERY_FORMAT_CSV;
+            } else {
+                fprintf(stderr, "\n");
+                fprintf(stderr, "Invalid query format: %s.\n", strval);
+                fprintf(stderr, "\n");
+                goto fail;
+            }
+            break;
+
         case 'E':
             op->extract_edids_from_file = strval;
+            nv_text_rows_append(&op->extract_edids_files, strval);
             break;
 
         case EXTRACT_EDIDS_OUTPUT_FILE_OPTION:
             op->extract_edids_output_file = strval;
             break;
 
+        case EXTRACT_EDIDS_THREADS_OPTION:
+
+            if (intval < 1) {
+                fprintf(stderr, "\n");
+                fprintf(stderr, "Invalid number of EDID extraction threads: "
+                        "%d.\n", intval);
+                fprintf(stderr, "\n");
+                goto fail;
+            }
+
+            op->extract_edids_threads = intval;
+            break;
+
         case NVIDIA_XINERAMA_INFO_ORDER_OPTION:
             op->nvidia_xinerama_info_order =
                 disable ? NV_DISABLE_STRING_OPTION : strval;
@@ -672,6 +727,10 @@ static Options *load_default_options(void)
     op->nvidia_3dvision_display_type = -1;
     op->tv_over_scan = -1.0;
     op->num_x_screens = -1;
+    op->gpu_probe_threads = 1;
+    op->extract_edids_threads = 1;
+    op->query_format = QUERY_FORMAT_TEXT;
+    op->sysfs_path = SYSFS_PATH;
 
     xconfigGenerateLoadDefaultOptions(&op->gop);
 
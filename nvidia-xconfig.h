@@ -85,6 +85,11 @@
    GET_BOOL_OPTION_BIT(VAR))
 
 
+/* output formats for --query-gpu-info */
+#define QUERY_FORMAT_TEXT 0
+#define QUERY_FORMAT_JSON 1
+#define QUERY_FORMAT_CSV  2
+
 /* define to store in string options */
 #define NV_DISABLE_STRING_OPTION ((void *) -1)
 
@@ -122,6 +127,11 @@ typedef struct __options {
     int nvidia_3dvision_display_type;
 
     int num_x_screens;
+    int gpu_probe_threads;
+    int extract_edids_threads;
+    int refresh_gpu_cache;
+    int gpu_probe_stats;
+    int query_format;
 
     char *xconfig;
     char *output_xconfig;
@@ -133,6 +143,10 @@ typedef struct __options {
     char *sli;
 
     char *nvidia_cfg_path;
+    char *gpu_cache_file;
+    char *sysfs_path;
+    char *record_gpu_probe;
+    char *replay_gpu_probe;
     char *extract_edids_from_file;
     char *extract_edids_output_file;
     char *nvidia_xinerama_info_order;
@@ -165,6 +179,7 @@ typedef struct __options {
     TextRows add_modes;
     TextRows add_modes_list;
     TextRows remove_modes;
+    TextRows extract_edids_files;
 
     GenerateOptions gop;
 
@@ -175,6 +190,7 @@ typedef struct __options {
 typedef struct _display_device_rec {
     NvCfgDisplayDeviceInformation info;
     int info_valid;
+    int info_queried;   /* whether info_valid and info are filled in */
     unsigned int mask;
 } DisplayDeviceRec, *DisplayDevicePtr;
 
@@ -194,6 +210,44 @@ typedef struct {
     DevicePtr devices;
 } DevicesRec, *DevicesPtr;
 
+/* an NVIDIA GPU found in sysfs */
+
+typedef struct {
+    char address[32];     /* the sysfs name, e.g. "0000:01:00.0" */
+    NvCfgPciDevice dev;
+    unsigned int vendor;
+    unsigned int device;
+    unsigned int class;
+    int boot_vga;
+} SysfsGpuRec, *SysfsGpuPtr;
+
+/*
+ * the functions used from the nvidia-cfg library; handle is NULL if
+ * they replay a trace (see probe_trace.c)
+ */
+
+typedef struct {
+    void *handle;
+    char *path;
+
+    NvCfgBool (*getDevices)(int *n, NvCfgDevice **devs);
+    NvCfgBool (*openDevice)(int bus, int slot, NvCfgDeviceHandle *handle);
+    NvCfgBool (*getPciDevices)(int *n, NvCfgPciDevice **devs);
+    NvCfgBool (*openPciDevice)(int domain, int bus, int slot, int function,
+                               NvCfgDeviceHandle *handle);
+    NvCfgBool (*getNumCRTCs)(NvCfgDeviceHandle handle, int *crtcs);
+    NvCfgBool (*getProductName)(NvCfgDeviceHandle handle, char **name);
+    NvCfgBool (*getDisplayDevices)(NvCfgDeviceHandle handle,
+                                   unsigned int *display_device_mask);
+    NvCfgBool (*getEDID)(NvCfgDeviceHandle handle,
+                         unsigned int display_device,
+                         NvCfgDisplayDeviceInformation *info);
+    NvCfgBool (*isPrimaryDevice)(NvCfgDeviceHandle handle,
+                                 NvCfgBool *is_primary_device);
+    NvCfgBool (*closeDevice)(NvCfgDeviceHandle handle);
+    NvCfgBool (*getDeviceUUID)(NvCfgDeviceHandle handle, char **uuid);
+} NvCfgLibRec, *NvCfgLibPtr;
+
 
 /* util.c */
 
@@ -209,12 +263,36 @@ int update_server_flags(Options *op, XConfigPtr config);
 
 /* multiple_screens.c */
 
-DevicesPtr find_devices(Options *op);
+/* how much find_devices() should find out about each GPU */
+
+#define DEVICE_QUERY_HEADS 1   /* CRTCs and display devices */
+#define DEVICE_QUERY_EDIDS 2   /* ... and the EDID of each display device */
+
+DevicesPtr find_devices(Options *op, int query);
+DevicesPtr find_pci_devices(Options *op);
+void invalidate_devices(void);
 void free_devices(DevicesPtr devs);
 
 int apply_multi_screen_options(Options *op, XConfigPtr config,
                                XConfigLayoutPtr layout);
 
+/* gpu_cache.c */
+
+char *read_gpu_inventory(const char *sysfs_path, const char *proc_root);
+DevicesPtr load_gpu_cache(const char *filename, const char *inventory);
+void save_gpu_cache(const char *filename, const char *inventory,
+                    DevicesPtr pDevices);
+
+/* pci_sysfs.c */
+
+SysfsGpuPtr read_sysfs_gpus(const char *sysfs_path, int *count);
+DevicesPtr find_sysfs_devices(const char *sysfs_path, const char *proc_root);
+
+/* probe_trace.c */
+
+int record_nvidia_cfg(NvCfgLibPtr lib, const char *filename);
+int replay_nvidia_cfg(NvCfgLibPtr lib, const char *filename);
+
 /* tree.c */
 
 int print_tree(Options *op, XConfigPtr config);
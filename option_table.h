@@ -61,6 +61,16 @@ enum {
     FORCE_COMPOSITION_PIPELINE_OPTION,
     FORCE_FULL_COMPOSITION_PIPELINE_OPTION,
     ALLOW_HMD_OPTION,
+    XSERVER_CACHE_FILE_OPTION,
+    GPU_PROBE_THREADS_OPTION,
+    GPU_CACHE_FILE_OPTION,
+    REFRESH_GPU_CACHE_OPTION,
+    SYSFS_PATH_OPTION,
+    GPU_PROBE_STATS_OPTION,
+    RECORD_GPU_PROBE_OPTION,
+    REPLAY_GPU_PROBE_OPTION,
+    QUERY_FORMAT_OPTION,
+    EXTRACT_EDIDS_THREADS_OPTION,
 };
 
 /*
@@ -269,7 +279,17 @@ static const NVGetoptOption __options[] = {
       "\"-logverbose 6\" X server commandline option.  Any extracted EDIDs "
       "are then written as binary data to individual files.  These files "
       "can later be used by the NVIDIA X driver through the \"CustomEDID\" "
-      "X configuration option." },
+      "X configuration option.  If &LOG& is '-', the log is read from "
+      "standard input; logs may also be read from a pipe, or compressed "
+      "with gzip.  This option may be given more than once, and &LOG& may "
+      "be a directory, in which case every file in it is read.  The files "
+      "are then read by up to '--extract-edids-threads' threads at once, "
+      "each distinct EDID is written only once, to a file named after a "
+      "hash of its bytes (e.g., \"edid.bin.0123456789abcdef\"), and an "
+      "index (e.g., \"edid.bin.index\") lists the file, X screen, EDID "
+      "file and display device of every EDID found.  Extracting the same "
+      "files again leaves EDID files that are already there as they are, "
+      "and replaces the index." },
 
     { "extract-edids-output-file",
       EXTRACT_EDIDS_OUTPUT_FILE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILENAME",
@@ -278,7 +298,18 @@ static const NVGetoptOption __options[] = {
       "current directory.  Use this option to specify an alternate "
       "filename.  Note that nvidia-xconfig, if necessary, will append a "
       "unique number to the EDID filename, to avoid overwriting existing "
-      "files (e.g., \"edid.bin.1\" if \"edid.bin\" already exists)." },
+      "files (e.g., \"edid.bin.1\" if \"edid.bin\" already exists); this "
+      "does not apply to the files named after the EDID hash, or the index, "
+      "when several files are extracted." },
+
+    { "extract-edids-threads",
+      EXTRACT_EDIDS_THREADS_OPTION, NVGETOPT_INTEGER_ARGUMENT, "N",
+      "When the '--extract-edids-from-file' option is used with an X log "
+      "file, split the log into pieces and scan up to N of them at once; "
+      "when it is used with several files, read up to N of the files at "
+      "once.  On very large logs this can shorten the extraction "
+      "considerably; the EDIDs found are the same, and are written in the "
+      "same order, as with a single thread.  The default is 1." },
 
     { "flatpanel-properties", FLATPANEL_PROPERTIES_OPTION,
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_ALLOW_DISABLE, NULL,
@@ -398,6 +429,63 @@ static const NVGetoptOption __options[] = {
       "for this library (in case it cannot find it on its own).  This option "
       "should normally not be needed." },
 
+    { "sysfs-path",
+      SYSFS_PATH_OPTION, NVGETOPT_STRING_ARGUMENT, "PATH",
+      "When only the location of each GPU is needed, e.g., to assign BusIDs "
+      "for '--enable-all-gpus', nvidia-xconfig lists the NVIDIA GPUs in "
+      "sysfs rather than querying them through the nvidia-cfg library, "
+      "unless the GPU cache (see '--gpu-cache-file') already lists them; "
+      "the cache is also validated against sysfs.  This option tells "
+      "nvidia-xconfig where sysfs is mounted; the default is /sys.  This "
+      "option should normally not be needed." },
+
+    { "gpu-probe-threads",
+      GPU_PROBE_THREADS_OPTION, NVGETOPT_INTEGER_ARGUMENT, "N",
+      "Query up to N GPUs at once when probing them through the nvidia-cfg "
+      "library.  On systems with many GPUs this can shorten the probe "
+      "considerably.  The default is 1, which queries the GPUs one at a "
+      "time." },
+
+    { "gpu-probe-stats", GPU_PROBE_STATS_OPTION, 0, NULL,
+      "Report where the information about the GPUs in the system came from "
+      "(the nvidia-cfg library, the GPU cache, or sysfs), how many GPUs "
+      "were opened and EDIDs read, and how long it took.  This is useful "
+      "for measuring the cost of probing the GPUs, e.g., together with "
+      "'--nvidia-cfg-path' and a stand-in nvidia-cfg library." },
+
+    { "gpu-cache-file",
+      GPU_CACHE_FILE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Cache the information about the GPUs in the system that does not "
+      "change while the NVIDIA kernel module is loaded (their order, PCI "
+      "location, name, UUID, and number of CRTCs) in FILE, e.g., "
+      "/var/cache/nvidia-xconfig/gpus, until the NVIDIA GPUs in the system "
+      "or the NVIDIA kernel module change.  The display devices connected "
+      "to each GPU, and their EDIDs, are not cached, as displays may be "
+      "connected or disconnected at any time: whenever they are needed, "
+      "e.g., for '--query-gpu-info' or to configure the displays, every GPU "
+      "is still opened through the nvidia-cfg library, and the cache only "
+      "saves enumerating the GPUs and finding the primary one.  By default, "
+      "no GPU cache is used." },
+
+    { "refresh-gpu-cache", REFRESH_GPU_CACHE_OPTION, 0, NULL,
+      "Ignore the GPU cache given with '--gpu-cache-file', query the GPUs "
+      "again, and update the cache." },
+
+    { "record-gpu-probe",
+      RECORD_GPU_PROBE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Write every call made into the nvidia-cfg library while probing the "
+      "GPUs, with its arguments, results, and how long it took, to FILE.  "
+      "The GPUs are always probed through the library in this mode, rather "
+      "than read from the GPU cache or sysfs.  The trace can be replayed "
+      "with '--replay-gpu-probe', e.g., on a system without NVIDIA GPUs." },
+
+    { "replay-gpu-probe",
+      REPLAY_GPU_PROBE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "Instead of loading the nvidia-cfg library, serve the results of the "
+      "calls recorded in FILE with '--record-gpu-probe'.  Each call takes "
+      "as long as it did when it was recorded, so that the GPU probe can "
+      "be reproduced and timed on a different system." },
+
     { "only-one-x-screen", '1', 0, NULL,
       "Disable all but one X screen." },
 
@@ -440,6 +528,14 @@ static const NVGetoptOption __options[] = {
     { "query-gpu-info", QUERY_GPU_INFO_OPTION, 0, NULL,
       "Print information about all recognized NVIDIA GPUs in the system." },
 
+    { "format", QUERY_FORMAT_OPTION, NVGETOPT_STRING_ARGUMENT, "FORMAT",
+      "The format used by '--query-gpu-info': 'text' (the default), 'json', "
+      "or 'csv'.  The 'json' format prints an array with one object per GPU; "
+      "the 'csv' format prints a header row, followed by one row per display "
+      "device (or one row for a GPU without display devices).  EDID values "
+      "are printed in the units reported by the driver (Hz, kHz, pixels, "
+      "and mm), as indicated by the column names." },
+
     { "registry-dwords", REGISTRY_DWORDS_OPTION,
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_ALLOW_DISABLE, NULL,
       "Enable or disable the \"RegistryDwords\" X configuration option." },
@@ -591,6 +687,15 @@ static const NVGetoptOption __options[] = {
     { "xinerama", XCONFIG_BOOL_VAL(XINERAMA_BOOL_OPTION),
       NVGETOPT_IS_BOOLEAN, NULL, "Enable or disable Xinerama." },
 
+    { "xserver-cache-file",
+      XSERVER_CACHE_FILE_OPTION, NVGETOPT_STRING_ARGUMENT, "FILE",
+      "nvidia-xconfig runs `X -version` to find out which features the X "
+      "server supports, and uses pkg-config to find the X library "
+      "directory.  Cache the results in FILE, e.g., "
+      "/var/cache/nvidia-xconfig/xserver, until the X server binary or "
+      "its pkg-config file change.  By default, nothing is cached, and "
+      "the X server is run every time it is needed." },
+
     { "color-space", COLOR_SPACE_OPTION,
       NVGETOPT_STRING_ARGUMENT | NVGETOPT_ALLOW_DISABLE, "COLORSPACE",
       "Enable or disable the \"ColorSpace\" X configuration option. "
@@ -191,32 +191,104 @@ void validate_composite(Options *op, XConfigPtr config)
 
 
 /*
- * remove_option() - make sure the named option does not exist in any
- * of the possible option lists:
+ * OptionEdits - the option changes that update_options() collects
+ * for a screen, so that they can be applied in one pass over the
+ * screen's option lists: 'set' holds the options to set, in the order
+ * they were requested, and 'removed' the names of options to remove
+ * without replacement.
+ */
+
+typedef struct {
+    XConfigOptionPtr set;
+    XConfigOptionPtr removed;
+} OptionEdits;
+
+
+
+/*
+ * remove_option() - record that the named option should not exist in
+ * any of the possible option lists.
+ */
+
+static void remove_option(OptionEdits *edits, const char *name)
+{
+    xconfigRemoveNamedOption(&edits->set, name, NULL);
+
+    if (!xconfigFindOption(edits->removed, name)) {
+        xconfigAddNewOption(&edits->removed, name, NULL);
+    }
+} /* remove_option() */
+
+
+
+/*
+ * remove_edited_options() - remove every option that has been edited
+ * from the given option list; returns the number of options removed.
+ */
+
+static int remove_edited_options(XConfigOptionPtr *list,
+                                 const OptionEdits *edits)
+{
+    XConfigOptionPtr opt, next;
+    int n = 0;
+
+    for (opt = *list; opt; opt = next) {
+        next = opt->next;
+        if (xconfigFindOption(edits->set, opt->name) ||
+            xconfigFindOption(edits->removed, opt->name)) {
+            xconfigRemoveOption(list, opt);
+            n++;
+        }
+    }
+
+    return n;
+
+} /* remove_edited_options() */
+
+
+
+/*
+ * apply_option_edits() - apply the edits to the screen: make sure
+ * none of the edited options exist in any of the possible option
+ * lists, then add the options to set to the screen's option list.
  *
  * Options related to drivers can be present in the Screen, Device and
  * Monitor sections and the Display subsections.  The order of
  * precedence is Display, Screen, Monitor, Device.
  */
 
-static void remove_option(XConfigScreenPtr screen, const char *name)
+static void apply_option_edits(XConfigScreenPtr screen, OptionEdits *edits)
 {
     XConfigDisplayPtr display;
-
-    if (!screen) return;
+    XConfigOptionPtr opt;
+    int removed = 0, set = 0;
 
     if (screen->device) {
-        xconfigRemoveNamedOption(&screen->device->options, name, NULL);
+        removed += remove_edited_options(&screen->device->options, edits);
     }
     if (screen->monitor) {
-        xconfigRemoveNamedOption(&screen->monitor->options, name, NULL);
+        removed += remove_edited_options(&screen->monitor->options, edits);
     }
-    xconfigRemoveNamedOption(&screen->options, name, NULL);
-    
+    removed += remove_edited_options(&screen->options, edits);
+
     for (display = screen->displays; display; display = display->next) {
-        xconfigRemoveNamedOption(&display->options, name, NULL);
+        removed += remove_edited_options(&display->options, edits);
+    }
+
+    for (opt = edits->set; opt; opt = opt->next) {
+        xconfigAddNewOption(&screen->options, opt->name, opt->val);
+        set++;
+    }
+
+    if (removed || set) {
+        nv_info_msg(NULL, "Updated Screen \"%s\": %d option(s) removed, "
+                    "%d option(s) set.", screen->identifier, removed, set);
     }
-} /* remove_option() */
+
+    xconfigFreeOptionList(&edits->set);
+    xconfigFreeOptionList(&edits->removed);
+
+} /* apply_option_edits() */
 
 
 
@@ -257,20 +329,19 @@ static XConfigOptionPtr get_screen_option(XConfigScreenPtr screen,
 
 
 /*
- * set_option_value() - set the given option to the specified value
+ * set_option_value() - record that the given option should be set to
+ * the specified value; this also removes it from the other option
+ * lists, when the edits are applied.  Setting an option again moves
+ * it to the end of the list, as it would be with separate edits.
  */
 
-static void set_option_value(XConfigScreenPtr screen,
+static void set_option_value(OptionEdits *edits,
                              const char *name, const char *val)
 {
-    /* first, remove the option to make sure it doesn't exist
-       elsewhere */
-
-    remove_option(screen, name);
+    xconfigRemoveNamedOption(&edits->removed, name, NULL);
+    xconfigRemoveNamedOption(&edits->set, name, NULL);
 
-    /* then, add the option to the screen's option list */
-
-    xconfigAddNewOption(&screen->options, name, val);
+    xconfigAddNewOption(&edits->set, name, val);
 
 } /* set_option_value() */
 
@@ -480,6 +551,7 @@ void update_options(Options *op, XConfigScreenPtr screen)
     const NvidiaXConfigOption *o;
     char *val;
     char scratch[8];
+    OptionEdits edits = { NULL, NULL };
 
     /* update any boolean options specified on the commandline */
 
@@ -510,7 +582,7 @@ void update_options(Options *op, XConfigScreenPtr screen)
                 val = o->invert ? "True" : "False";
             }
             
-            set_option_value(screen, o->name, val);
+            set_option_value(&edits, o->name, val);
             nv_info_msg(NULL, "Option \"%s\" \"%s\" added to Screen \"%s\".",
                         o->name, val, screen->identifier);
         }
@@ -523,65 +595,65 @@ void update_options(Options *op, XConfigScreenPtr screen)
     /* add the transparent index option */
     
     if (op->transparent_index != -1) {
-        remove_option(screen, "transparentindex");
+        remove_option(&edits, "transparentindex");
         if (op->transparent_index != -2) {
             snprintf(scratch, 8, "%d", op->transparent_index);
-            set_option_value(screen, "TransparentIndex", scratch);
+            set_option_value(&edits, "TransparentIndex", scratch);
         }
     }
 
     /* add the stereo option */
     
     if (op->stereo != -1) {
-        remove_option(screen, "stereo");
+        remove_option(&edits, "stereo");
         if (op->stereo != -2) {
             snprintf(scratch, 8, "%d", op->stereo);
-            set_option_value(screen, "Stereo", scratch);
+            set_option_value(&edits, "Stereo", scratch);
         }
     }
 
     /* add the MultiGPU option */
 
     if (op->multigpu) {
-        remove_option(screen, "MultiGPU");
+        remove_option(&edits, "MultiGPU");
         if (op->multigpu != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "MultiGPU", op->multigpu);
+            set_option_value(&edits, "MultiGPU", op->multigpu);
         }
     }
 
     /* add the SLI option */
 
     if (op->sli) {
-        remove_option(screen, "SLI");
+        remove_option(&edits, "SLI");
         if (op->sli != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "SLI", op->sli);
+            set_option_value(&edits, "SLI", op->sli);
         }
     }
 
     /* add the metamodes option */
 
     if (op->metamodes_str) {
-        remove_option(screen, "MetaModes");
+        remove_option(&edits, "MetaModes");
         if (op->metamodes_str != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "MetaModes", op->metamodes_str);
+            set_option_value(&edits, "MetaModes", op->metamodes_str);
         }
     }
 
     /* add acpid socket path option*/
  
     if (op->acpid_socket_path) {
-        remove_option(screen, "AcpidSocketPath");
+        remove_option(&edits, "AcpidSocketPath");
         if (op->acpid_socket_path != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "AcpidSocketPath", op->acpid_socket_path);
+            set_option_value(&edits, "AcpidSocketPath", op->acpid_socket_path);
         }
     }
 
     /* add the nvidia xinerama info order option */
 
     if (op->nvidia_xinerama_info_order) {
-        remove_option(screen, "nvidiaXineramaInfoOrder");
+        remove_option(&edits, "nvidiaXineramaInfoOrder");
         if (op->nvidia_xinerama_info_order != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "nvidiaXineramaInfoOrder",
+            set_option_value(&edits, "nvidiaXineramaInfoOrder",
                              op->nvidia_xinerama_info_order);
         }
     }
@@ -589,33 +661,19 @@ void update_options(Options *op, XConfigScreenPtr screen)
     /* add the metamode orientation option */
     
     if (op->metamode_orientation) {
-        remove_option(screen, "MetaModeOrientation");
+        remove_option(&edits, "MetaModeOrientation");
         if (op->metamode_orientation != NV_DISABLE_STRING_OPTION) {
-            char *old_metamodes, *new_metamodes;
-            set_option_value(screen, "MetaModeOrientation",
+            set_option_value(&edits, "MetaModeOrientation",
                              op->metamode_orientation);
-            if (remove_metamode_offsets(screen,
-                                        &old_metamodes, &new_metamodes)) {
-                nv_warning_msg("The MetaModes option contained explicit offsets, "
-                               "which would have overridden the specified "
-                               "MetaModeOrientation; in order to honor the "
-                               "requested MetaModeOrientation, the explicit offsets "
-                               "have been removed from the MetaModes option.\n\n"
-                               "Old MetaModes option: \"%s\"\n"
-                               "New MetaModes option: \"%s\".",
-                               old_metamodes, new_metamodes);
-                nvfree(old_metamodes);
-                nvfree(new_metamodes);
-            }
         }
     }
 
     /* add the UseDisplayDevice option */
  
     if (op->use_display_device) {
-        remove_option(screen, "UseDisplayDevice");
+        remove_option(&edits, "UseDisplayDevice");
         if (op->use_display_device != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "UseDisplayDevice",
+            set_option_value(&edits, "UseDisplayDevice",
                              op->use_display_device);
         }
     }
@@ -623,114 +681,114 @@ void update_options(Options *op, XConfigScreenPtr screen)
     /* add the CustomEDID option */
 
     if (op->custom_edid) {
-        remove_option(screen, "CustomEDID");
+        remove_option(&edits, "CustomEDID");
         if (op->custom_edid != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "CustomEDID", op->custom_edid);
+            set_option_value(&edits, "CustomEDID", op->custom_edid);
         }
     }
 
     /* add the TVStandard option */
 
     if (op->tv_standard) {
-        remove_option(screen, "TVStandard");
+        remove_option(&edits, "TVStandard");
         if (op->tv_standard != NV_DISABLE_STRING_OPTION) {
-           set_option_value(screen, "TVStandard", op->tv_standard);
+           set_option_value(&edits, "TVStandard", op->tv_standard);
         }
     }
 
     /* add the TVOutFormat option */
 
     if (op->tv_out_format) {
-        remove_option(screen, "TVOutFormat");
+        remove_option(&edits, "TVOutFormat");
         if (op->tv_out_format != NV_DISABLE_STRING_OPTION) {
-           set_option_value(screen, "TVOutFormat", op->tv_out_format);
+           set_option_value(&edits, "TVOutFormat", op->tv_out_format);
         }
     }
 
     /* add the Coolbits option */
 
     if (op->cool_bits != -1) {
-        remove_option(screen, "Coolbits");
+        remove_option(&edits, "Coolbits");
         if (op->cool_bits != -2) {
             snprintf(scratch, 8, "%d", op->cool_bits);
-            set_option_value(screen, "Coolbits", scratch);
+            set_option_value(&edits, "Coolbits", scratch);
         }
     }
 
     /* add the ConnectedMonitor option */
 
     if (op->connected_monitor) {
-        remove_option(screen, "ConnectedMonitor");
+        remove_option(&edits, "ConnectedMonitor");
         if (op->connected_monitor != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ConnectedMonitor", op->connected_monitor);
+            set_option_value(&edits, "ConnectedMonitor", op->connected_monitor);
         }
     }
 
     if (op->registry_dwords) {
-        remove_option(screen, "RegistryDwords");
+        remove_option(&edits, "RegistryDwords");
         if (op->registry_dwords != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "RegistryDwords", op->registry_dwords);
+            set_option_value(&edits, "RegistryDwords", op->registry_dwords);
         }
     }
 
     /* add the ColorSpace option */
 
     if (op->color_space) {
-        remove_option(screen, "ColorSpace");
+        remove_option(&edits, "ColorSpace");
         if (op->color_space != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ColorSpace", op->color_space);
+            set_option_value(&edits, "ColorSpace", op->color_space);
         }
     }
 
     if (op->color_range) {
-        remove_option(screen, "ColorRange");
+        remove_option(&edits, "ColorRange");
         if (op->color_range != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ColorRange", op->color_range);
+            set_option_value(&edits, "ColorRange", op->color_range);
         }
     }
 
     /* add the flatpanel properties option */
 
     if (op->flatpanel_properties) {
-        remove_option(screen, "FlatPanelProperties");
+        remove_option(&edits, "FlatPanelProperties");
         if (op->flatpanel_properties != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "FlatPanelProperties",
+            set_option_value(&edits, "FlatPanelProperties",
                              op->flatpanel_properties);
         }
     }
 
     /* add the 3DVisionUSBPath option */
     if (op->nvidia_3dvision_usb_path) {
-        remove_option(screen, "3DVisionUSBPath");
+        remove_option(&edits, "3DVisionUSBPath");
         if (op->nvidia_3dvision_usb_path != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "3DVisionUSBPath", op->nvidia_3dvision_usb_path);
+            set_option_value(&edits, "3DVisionUSBPath", op->nvidia_3dvision_usb_path);
         }
     }
 
     /* add the 3DVisionProConfigFile option */
     if (op->nvidia_3dvisionpro_config_file) {
-        remove_option(screen, "3DVisionProConfigFile");
+        remove_option(&edits, "3DVisionProConfigFile");
         if (op->nvidia_3dvisionpro_config_file != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "3DVisionProConfigFile", op->nvidia_3dvisionpro_config_file);
+            set_option_value(&edits, "3DVisionProConfigFile", op->nvidia_3dvisionpro_config_file);
         }
     }
 
     /* add the 3DVisionDisplayType option */
 
     if (op->nvidia_3dvision_display_type != -1) {
-        remove_option(screen, "3DVisionDisplayType");
+        remove_option(&edits, "3DVisionDisplayType");
         if (op->nvidia_3dvision_display_type != -2) {
             snprintf(scratch, 8, "%d", op->nvidia_3dvision_display_type);
-            set_option_value(screen, "3DVisionDisplayType", scratch);
+            set_option_value(&edits, "3DVisionDisplayType", scratch);
         }
     }
 
     /* add the ForceCompositionPipeline option */
 
     if (op->force_composition_pipeline) {
-        remove_option(screen, "ForceCompositionPipeline");
+        remove_option(&edits, "ForceCompositionPipeline");
         if (op->force_composition_pipeline != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ForceCompositionPipeline",
+            set_option_value(&edits, "ForceCompositionPipeline",
                              op->force_composition_pipeline);
         }
     }
@@ -738,9 +796,9 @@ void update_options(Options *op, XConfigScreenPtr screen)
     /* add the ForceFullCompositionPipeline option */
 
     if (op->force_full_composition_pipeline) {
-        remove_option(screen, "ForceFullCompositionPipeline");
+        remove_option(&edits, "ForceFullCompositionPipeline");
         if (op->force_full_composition_pipeline != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "ForceFullCompositionPipeline",
+            set_option_value(&edits, "ForceFullCompositionPipeline",
                              op->force_full_composition_pipeline);
         }
     }
@@ -748,9 +806,35 @@ void update_options(Options *op, XConfigScreenPtr screen)
     /* add the AllowHMD option */
 
     if (op->allow_hmd) {
-        remove_option(screen, "AllowHMD");
+        remove_option(&edits, "AllowHMD");
         if (op->allow_hmd != NV_DISABLE_STRING_OPTION) {
-            set_option_value(screen, "AllowHMD", op->allow_hmd);
+            set_option_value(&edits, "AllowHMD", op->allow_hmd);
+        }
+    }
+
+    apply_option_edits(screen, &edits);
+
+    /*
+     * the MetaModeOrientation is only honored if the MetaModes do not
+     * contain explicit offsets; this has to look at the MetaModes as
+     * they are after the edits above
+     */
+
+    if (op->metamode_orientation &&
+        op->metamode_orientation != NV_DISABLE_STRING_OPTION) {
+        char *old_metamodes, *new_metamodes;
+        if (remove_metamode_offsets(screen,
+                                    &old_metamodes, &new_metamodes)) {
+            nv_warning_msg("The MetaModes option contained explicit offsets, "
+                           "which would have overridden the specified "
+                           "MetaModeOrientation; in order to honor the "
+                           "requested MetaModeOrientation, the explicit offsets "
+                           "have been removed from the MetaModes option.\n\n"
+                           "Old MetaModes option: \"%s\"\n"
+                           "New MetaModes option: \"%s\".",
+                           old_metamodes, new_metamodes);
+            nvfree(old_metamodes);
+            nvfree(new_metamodes);
         }
     }
 
@@ -0,0 +1,281 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * pci_sysfs.c - enumerate the NVIDIA GPUs through Linux sysfs, and
+ * the NVIDIA kernel module's procfs entries, without loading the
+ * nvidia-cfg library or opening the devices.
+ */
+
+#include "nvidia-xconfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#define PCI_DEVICES_DIR "bus/pci/devices"
+#define NVIDIA_GPUS_DIR "driver/nvidia/gpus"
+
+#define PCI_VENDOR_NVIDIA 0x10de
+#define PCI_BASE_CLASS_DISPLAY 0x03
+
+
+/*
+ * read_sysfs_file() - read up to len - 1 bytes from the file 'name'
+ * in the directory 'dirfd' into buf, and NUL-terminate it; returns
+ * FALSE if the file cannot be read.
+ */
+
+static int read_sysfs_file(int dirfd, const char *name, char *buf, int len)
+{
+    ssize_t n;
+    int fd;
+
+    fd = openat(dirfd, name, O_RDONLY);
+    if (fd < 0) return FALSE;
+
+    n = read(fd, buf, len - 1);
+    close(fd);
+
+    if (n <= 0) return FALSE;
+    buf[n] = '\0';
+
+    return TRUE;
+
+} /* read_sysfs_file() */
+
+
+
+static int read_sysfs_hex(int dirfd, const char *name, unsigned int *value)
+{
+    char buf[32];
+
+    return (read_sysfs_file(dirfd, name, buf, sizeof(buf)) &&
+            (sscanf(buf, "%x", value) == 1));
+
+} /* read_sysfs_hex() */
+
+
+
+static int compare_sysfs_gpus(const void *a, const void *b)
+{
+    const NvCfgPciDevice *x = &((const SysfsGpuRec *) a)->dev;
+    const NvCfgPciDevice *y = &((const SysfsGpuRec *) b)->dev;
+
+    if (x->domain != y->domain) return (x->domain < y->domain) ? -1 : 1;
+    if (x->bus != y->bus) return (x->bus < y->bus) ? -1 : 1;
+    if (x->slot != y->slot) return (x->slot < y->slot) ? -1 : 1;
+    if (x->function != y->function) {
+        return (x->function < y->function) ? -1 : 1;
+    }
+    return 0;
+
+} /* compare_sysfs_gpus() */
+
+
+
+/*
+ * read_sysfs_gpus() - list the NVIDIA display-class PCI functions
+ * found in <sysfs_path>/bus/pci/devices, in PCI bus order.  The
+ * number of GPUs found is returned in count; returns NULL if sysfs
+ * cannot be read (count is then -1), or if there are no NVIDIA GPUs.
+ */
+
+SysfsGpuPtr read_sysfs_gpus(const char *sysfs_path, int *count)
+{
+    SysfsGpuPtr gpus = NULL, gpu;
+    unsigned int vendor, device, class, domain, bus, slot, function;
+    int n = 0, dirfd, devfd;
+    struct dirent *ent;
+    char *path, buf[8];
+    DIR *dir;
+
+    *count = -1;
+
+    path = nvstrcat(sysfs_path, "/" PCI_DEVICES_DIR, NULL);
+    dirfd = open(path, O_RDONLY | O_DIRECTORY);
+    nvfree(path);
+
+    if (dirfd < 0) return NULL;
+
+    dir = fdopendir(dirfd);
+    if (!dir) {
+        close(dirfd);
+        return NULL;
+    }
+
+    while ((ent = readdir(dir)) != NULL) {
+
+        /* the entries are named after the PCI address */
+
+        if ((strlen(ent->d_name) >= sizeof(gpus->address)) ||
+            (sscanf(ent->d_name, "%x:%x:%x.%x",
+                    &domain, &bus, &slot, &function) != 4)) {
+            continue;
+        }
+
+        devfd = openat(dirfd, ent->d_name, O_RDONLY | O_DIRECTORY);
+        if (devfd < 0) continue;
+
+        if (read_sysfs_hex(devfd, "vendor", &vendor) &&
+            read_sysfs_hex(devfd, "device", &device) &&
+            read_sysfs_hex(devfd, "class", &class) &&
+            (vendor == PCI_VENDOR_NVIDIA) &&
+            ((class >> 16) == PCI_BASE_CLASS_DISPLAY)) {
+
+            gpus = nvrealloc(gpus, sizeof(SysfsGpuRec) * (n + 1));
+            gpu = &gpus[n++];
+            memset(gpu, 0, sizeof(SysfsGpuRec));
+
+            snprintf(gpu->address, sizeof(gpu->address), "%.*s",
+                     (int) sizeof(gpu->address) - 1, ent->d_name);
+            gpu->dev.domain = domain;
+            gpu->dev.bus = bus;
+            gpu->dev.slot = slot;
+            gpu->dev.function = function;
+            gpu->vendor = vendor;
+            gpu->device = device;
+            gpu->class = class;
+
+            /* the device the firmware initialized as the console */
+
+            gpu->boot_vga =
+                read_sysfs_file(devfd, "boot_vga", buf, sizeof(buf)) &&
+                (buf[0] == '1');
+        }
+
+        close(devfd);
+    }
+
+    closedir(dir);
+
+    if (n) {
+        qsort(gpus, n, sizeof(SysfsGpuRec), compare_sysfs_gpus);
+    }
+
+    *count = n;
+
+    return gpus;
+
+} /* read_sysfs_gpus() */
+
+
+
+/*
+ * read_nvidia_gpu_info() - look up the product name and UUID of the
+ * given GPU in <proc_root>/driver/nvidia/gpus/<address>/information,
+ * which the NVIDIA kernel module provides; returns FALSE if either
+ * cannot be found.
+ */
+
+static int read_nvidia_gpu_info(const char *proc_root, const char *address,
+                                char **name, char **uuid)
+{
+    char line[256], *path, *value;
+    FILE *stream;
+
+    *name = *uuid = NULL;
+
+    path = nvstrcat(proc_root, "/" NVIDIA_GPUS_DIR "/", address,
+                    "/information", NULL);
+    stream = fopen(path, "r");
+    nvfree(path);
+
+    if (!stream) return FALSE;
+
+    while (fgets(line, sizeof(line), stream)) {
+        value = strchr(line, ':');
+        if (!value) continue;
+        *value++ = '\0';
+
+        value = nv_trim_space(value);
+
+        if (strcmp(line, "Model") == 0 && !*name) {
+            *name = nvstrdup(value);
+        } else if (strcmp(line, "GPU UUID") == 0 && !*uuid) {
+            *uuid = nvstrdup(value);
+        }
+    }
+
+    fclose(stream);
+
+    if (!*name || !*uuid) {
+        nvfree(*name);
+        nvfree(*uuid);
+        *name = *uuid = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+
+} /* read_nvidia_gpu_info() */
+
+
+
+/*
+ * find_sysfs_devices() - build a device list for the NVIDIA GPUs
+ * from sysfs; only the PCI location, name and UUID of each device
+ * are filled in.  The GPUs are in PCI bus order, which is the order
+ * the NVIDIA kernel module, and so nvCfgGetPciDevices(), lists them
+ * in; the boot VGA device, which is what nvCfgIsPrimaryDevice()
+ * reports, is swapped to the front, as find_devices() does with the
+ * primary device.  Returns NULL if the GPUs cannot be enumerated this
+ * way.
+ */
+
+DevicesPtr find_sysfs_devices(const char *sysfs_path, const char *proc_root)
+{
+    DevicesPtr pDevices;
+    DeviceRec tmpDevice;
+    SysfsGpuPtr gpus;
+    int i, count;
+
+    gpus = read_sysfs_gpus(sysfs_path, &count);
+    if (!gpus) return NULL;
+
+    pDevices = nvalloc(sizeof(DevicesRec));
+    pDevices->devices = nvalloc(sizeof(DeviceRec) * count);
+    pDevices->nDevices = count;
+
+    for (i = 0; i < count; i++) {
+        pDevices->devices[i].dev = gpus[i].dev;
+
+        if (!read_nvidia_gpu_info(proc_root, gpus[i].address,
+                                  &pDevices->devices[i].name,
+                                  &pDevices->devices[i].uuid)) {
+            free_devices(pDevices);
+            nvfree(gpus);
+            return NULL;
+        }
+
+        if ((i != 0) && gpus[i].boot_vga) {
+            memcpy(&tmpDevice, &pDevices->devices[0], sizeof(DeviceRec));
+            memcpy(&pDevices->devices[0], &pDevices->devices[i],
+                   sizeof(DeviceRec));
+            memcpy(&pDevices->devices[i], &tmpDevice, sizeof(DeviceRec));
+        }
+    }
+
+    nvfree(gpus);
+
+    return pDevices;
+
+} /* find_sysfs_devices() */
@@ -0,0 +1,1078 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2005 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * probe_trace.c - record the calls made into the nvidia-cfg library
+ * (--record-gpu-probe), and serve them back from the recording
+ * without loading the library (--replay-gpu-probe).  This allows the
+ * GPU probe of one system to be reproduced, and timed, on another.
+ *
+ * A trace is a text file with one line per call:
+ *
+ *   <function> <latency in usec> <result> <device> [<values>]
+ *
+ * where <device> is the PCI address of the GPU the call was made on,
+ * or "-" for the calls that enumerate the GPUs.  The values returned
+ * by the call follow, only if it succeeded:
+ *
+ *   nvCfgGetDevices, nvCfgGetPciDevices    <count> <address>...
+ *   nvCfgGetNumCRTCs                       <crtcs>
+ *   nvCfgGetProductName                    <name>
+ *   nvCfgGetDeviceUUID                     <uuid>
+ *   nvCfgGetDisplayDevices                 <mask>
+ *   nvCfgGetEDID                           <display device> <info>
+ *   nvCfgIsPrimaryDevice                   <0 or 1>
+ *
+ * nvCfgGetEDID always records the display device it was called for.
+ */
+
+#include "nvidia-xconfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#define PROBE_TRACE_HEADER "# nvidia-cfg calls recorded by nvidia-xconfig"
+
+enum {
+    TRACE_GET_DEVICES = 0,
+    TRACE_OPEN_DEVICE,
+    TRACE_GET_PCI_DEVICES,
+    TRACE_OPEN_PCI_DEVICE,
+    TRACE_GET_NUM_CRTCS,
+    TRACE_GET_PRODUCT_NAME,
+    TRACE_GET_DISPLAY_DEVICES,
+    TRACE_GET_EDID,
+    TRACE_IS_PRIMARY_DEVICE,
+    TRACE_CLOSE_DEVICE,
+    TRACE_GET_DEVICE_UUID,
+    TRACE_FUNCTION_COUNT
+};
+
+static const char *traceFunctionNames[TRACE_FUNCTION_COUNT] = {
+    "nvCfgGetDevices",
+    "nvCfgOpenDevice",
+    "nvCfgGetPciDevices",
+    "nvCfgOpenPciDevice",
+    "nvCfgGetNumCRTCs",
+    "nvCfgGetProductName",
+    "nvCfgGetDisplayDevices",
+    "nvCfgGetEDID",
+    "nvCfgIsPrimaryDevice",
+    "nvCfgCloseDevice",
+    "nvCfgGetDeviceUUID",
+};
+
+/*
+ * While recording or replaying, the device handles given out are
+ * TraceHandleRecs, which remember the GPU each handle was opened
+ * for; when recording, they wrap the library's own handle.
+ */
+
+typedef struct {
+    NvCfgDeviceHandle handle;
+    NvCfgPciDevice dev;
+} TraceHandleRec, *TraceHandlePtr;
+
+/* a call read from a trace */
+
+typedef struct {
+    int function;
+    unsigned int latency;
+    NvCfgBool result;
+    NvCfgPciDevice dev;
+    unsigned int display_device;
+    unsigned int value;
+    char *string;
+    int nDevs;
+    NvCfgPciDevice *devs;
+    NvCfgDisplayDeviceInformation info;
+    int consumed;
+} TraceEntryRec, *TraceEntryPtr;
+
+
+/* recording state */
+
+static NvCfgLibRec recordLib;
+static FILE *recordStream = NULL;
+
+/* replay state */
+
+static TraceEntryPtr replayEntries = NULL;
+static int nReplayEntries = 0;
+
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*
+ * format_device() - write the PCI address of dev into buf, in the
+ * same form as sysfs uses.
+ */
+
+static void format_device(char *buf, size_t len, const NvCfgPciDevice *dev)
+{
+    snprintf(buf, len, "%04x:%02x:%02x.%x",
+             dev->domain, dev->bus, dev->slot, dev->function);
+
+} /* format_device() */
+
+
+
+static int parse_device(const char *str, NvCfgPciDevice *dev)
+{
+    unsigned int domain, bus, slot, function;
+
+    if (sscanf(str, "%x:%x:%x.%x", &domain, &bus, &slot, &function) != 4) {
+        return FALSE;
+    }
+
+    dev->domain = domain;
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->function = function;
+
+    return TRUE;
+
+} /* parse_device() */
+
+
+
+static unsigned int trace_elapsed_usec(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned int) ((now.tv_sec - start->tv_sec) * 1000000 +
+                           (now.tv_nsec - start->tv_nsec) / 1000);
+
+} /* trace_elapsed_usec() */
+
+
+
+/*
+ * record_call() - append a line for a call to the trace; values, if
+ * non-NULL, is what the call returned.  Calls may be made from
+ * several threads at once, so each line is written under the lock.
+ */
+
+static void record_call(int function, const struct timespec *start,
+                        NvCfgBool result, const NvCfgPciDevice *dev,
+                        const char *values)
+{
+    unsigned int latency = trace_elapsed_usec(start);
+    char address[32];
+
+    if (dev) {
+        format_device(address, sizeof(address), dev);
+    } else {
+        snprintf(address, sizeof(address), "-");
+    }
+
+    pthread_mutex_lock(&traceLock);
+
+    fprintf(recordStream, "%s %u %d %s%s%s\n", traceFunctionNames[function],
+            latency, (result == NVCFG_TRUE), address,
+            values ? " " : "", values ? values : "");
+    fflush(recordStream);
+
+    pthread_mutex_unlock(&traceLock);
+
+} /* record_call() */
+
+
+
+static char *format_device_list(int n, const NvCfgPciDevice *devs)
+{
+    char *values = NULL, address[32];
+    int i;
+
+    nv_append_sprintf(&values, "%d", n);
+
+    for (i = 0; i < n; i++) {
+        format_device(address, sizeof(address), &devs[i]);
+        nv_append_sprintf(&values, " %s", address);
+    }
+
+    return values;
+
+} /* format_device_list() */
+
+
+
+static char *format_edid(unsigned int display_device, NvCfgBool result,
+                         const NvCfgDisplayDeviceInformation *info)
+{
+    char *values = NULL;
+
+    nv_append_sprintf(&values, "0x%08x", display_device);
+
+    if (result != NVCFG_TRUE) return values;
+
+    nv_append_sprintf(&values, " %u %u %u %u %u %u %u %u %u %u %u %u %u %.*s",
+                      info->min_horiz_sync, info->max_horiz_sync,
+                      info->min_vert_refresh, info->max_vert_refresh,
+                      info->max_pixel_clock,
+                      info->max_xres, info->max_yres, info->max_refresh,
+                      info->preferred_xres, info->preferred_yres,
+                      info->preferred_refresh,
+                      info->physical_width, info->physical_height,
+                      (int) strcspn(info->monitor_name, "\n"),
+                      info->monitor_name);
+
+    return values;
+
+} /* format_edid() */
+
+
+
+/*
+ * format_string() - the string returned by a call, up to the first
+ * newline, so that it fits on its line of the trace.
+ */
+
+static char *format_string(const char *str)
+{
+    return nvstrndup(str, strcspn(str, "\n"));
+
+} /* format_string() */
+
+
+
+/*
+ * The record_*() functions call through to the library, and record
+ * each call and its result.
+ */
+
+static NvCfgBool record_get_devices(int *n, NvCfgDevice **devs)
+{
+    NvCfgPciDevice *pciDevs = NULL;
+    struct timespec start;
+    NvCfgBool result;
+    char *values = NULL;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.getDevices(n, devs);
+
+    if (result == NVCFG_TRUE) {
+        pciDevs = nvalloc(sizeof(NvCfgPciDevice) * NV_MAX(*n, 1));
+        for (i = 0; i < *n; i++) {
+            pciDevs[i].bus = (*devs)[i].bus;
+            pciDevs[i].slot = (*devs)[i].slot;
+        }
+        values = format_device_list(*n, pciDevs);
+        nvfree(pciDevs);
+    }
+
+    record_call(TRACE_GET_DEVICES, &start, result, NULL, values);
+    nvfree(values);
+
+    return result;
+
+} /* record_get_devices() */
+
+
+
+static NvCfgBool record_get_pci_devices(int *n, NvCfgPciDevice **devs)
+{
+    struct timespec start;
+    NvCfgBool result;
+    char *values = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.getPciDevices(n, devs);
+
+    if (result == NVCFG_TRUE) {
+        values = format_device_list(*n, *devs);
+    }
+
+    record_call(TRACE_GET_PCI_DEVICES, &start, result, NULL, values);
+    nvfree(values);
+
+    return result;
+
+} /* record_get_pci_devices() */
+
+
+
+static NvCfgBool record_open(int function, const NvCfgPciDevice *dev,
+                             NvCfgDeviceHandle *handle)
+{
+    TraceHandlePtr traceHandle;
+    NvCfgDeviceHandle libHandle;
+    struct timespec start;
+    NvCfgBool result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (function == TRACE_OPEN_DEVICE) {
+        result = recordLib.openDevice(dev->bus, dev->slot, &libHandle);
+    } else {
+        result = recordLib.openPciDevice(dev->domain, dev->bus, dev->slot,
+                                         dev->function, &libHandle);
+    }
+
+    record_call(function, &start, result, dev, NULL);
+
+    if (result == NVCFG_TRUE) {
+        traceHandle = nvalloc(sizeof(TraceHandleRec));
+        traceHandle->handle = libHandle;
+        traceHandle->dev = *dev;
+        *handle = traceHandle;
+    }
+
+    return result;
+
+} /* record_open() */
+
+
+
+static NvCfgBool record_open_device(int bus, int slot,
+                                    NvCfgDeviceHandle *handle)
+{
+    NvCfgPciDevice dev;
+
+    memset(&dev, 0, sizeof(dev));
+    dev.bus = bus;
+    dev.slot = slot;
+
+    return record_open(TRACE_OPEN_DEVICE, &dev, handle);
+
+} /* record_open_device() */
+
+
+
+static NvCfgBool record_open_pci_device(int domain, int bus, int slot,
+                                        int function,
+                                        NvCfgDeviceHandle *handle)
+{
+    NvCfgPciDevice dev;
+
+    dev.domain = domain;
+    dev.bus = bus;
+    dev.slot = slot;
+    dev.function = function;
+
+    return record_open(TRACE_OPEN_PCI_DEVICE, &dev, handle);
+
+} /* record_open_pci_device() */
+
+
+
+static NvCfgBool record_get_num_crtcs(NvCfgDeviceHandle handle, int *crtcs)
+{
+    TraceHandlePtr traceHandle = handle;
+    struct timespec start;
+    NvCfgBool result;
+    char values[32];
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.getNumCRTCs(traceHandle->handle, crtcs);
+
+    if (result == NVCFG_TRUE) {
+        snprintf(values, sizeof(values), "%d", *crtcs);
+    }
+
+    record_call(TRACE_GET_NUM_CRTCS, &start, result, &traceHandle->dev,
+                (result == NVCFG_TRUE) ? values : NULL);
+
+    return result;
+
+} /* record_get_num_crtcs() */
+
+
+
+static NvCfgBool record_get_string(int function, NvCfgDeviceHandle handle,
+                                   char **str)
+{
+    TraceHandlePtr traceHandle = handle;
+    struct timespec start;
+    NvCfgBool result;
+    char *values = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (function == TRACE_GET_PRODUCT_NAME) {
+        result = recordLib.getProductName(traceHandle->handle, str);
+    } else {
+        result = recordLib.getDeviceUUID(traceHandle->handle, str);
+    }
+
+    if ((result == NVCFG_TRUE) && *str) {
+        values = format_string(*str);
+    }
+
+    record_call(function, &start, result, &traceHandle->dev, values);
+    nvfree(values);
+
+    return result;
+
+} /* record_get_string() */
+
+
+
+static NvCfgBool record_get_product_name(NvCfgDeviceHandle handle,
+                                         char **name)
+{
+    return record_get_string(TRACE_GET_PRODUCT_NAME, handle, name);
+
+} /* record_get_product_name() */
+
+
+
+static NvCfgBool record_get_device_uuid(NvCfgDeviceHandle handle,
+                                        char **uuid)
+{
+    return record_get_string(TRACE_GET_DEVICE_UUID, handle, uuid);
+
+} /* record_get_device_uuid() */
+
+
+
+static NvCfgBool record_get_display_devices(NvCfgDeviceHandle handle,
+                                            unsigned int *mask)
+{
+    TraceHandlePtr traceHandle = handle;
+    struct timespec start;
+    NvCfgBool result;
+    char values[32];
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.getDisplayDevices(traceHandle->handle, mask);
+
+    if (result == NVCFG_TRUE) {
+        snprintf(values, sizeof(values), "0x%08x", *mask);
+    }
+
+    record_call(TRACE_GET_DISPLAY_DEVICES, &start, result, &traceHandle->dev,
+                (result == NVCFG_TRUE) ? values : NULL);
+
+    return result;
+
+} /* record_get_display_devices() */
+
+
+
+static NvCfgBool record_get_edid(NvCfgDeviceHandle handle,
+                                 unsigned int display_device,
+                                 NvCfgDisplayDeviceInformation *info)
+{
+    TraceHandlePtr traceHandle = handle;
+    struct timespec start;
+    NvCfgBool result;
+    char *values;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.getEDID(traceHandle->handle, display_device, info);
+
+    values = format_edid(display_device, result, info);
+    record_call(TRACE_GET_EDID, &start, result, &traceHandle->dev, values);
+    nvfree(values);
+
+    return result;
+
+} /* record_get_edid() */
+
+
+
+static NvCfgBool record_is_primary_device(NvCfgDeviceHandle handle,
+                                          NvCfgBool *is_primary_device)
+{
+    TraceHandlePtr traceHandle = handle;
+    struct timespec start;
+    NvCfgBool result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.isPrimaryDevice(traceHandle->handle,
+                                       is_primary_device);
+
+    record_call(TRACE_IS_PRIMARY_DEVICE, &start, result, &traceHandle->dev,
+                (result != NVCFG_TRUE) ? NULL :
+                (*is_primary_device == NVCFG_TRUE) ? "1" : "0");
+
+    return result;
+
+} /* record_is_primary_device() */
+
+
+
+static NvCfgBool record_close_device(NvCfgDeviceHandle handle)
+{
+    TraceHandlePtr traceHandle = handle;
+    struct timespec start;
+    NvCfgBool result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    result = recordLib.closeDevice(traceHandle->handle);
+
+    record_call(TRACE_CLOSE_DEVICE, &start, result, &traceHandle->dev, NULL);
+
+    nvfree(traceHandle);
+
+    return result;
+
+} /* record_close_device() */
+
+
+
+/*
+ * record_nvidia_cfg() - start recording the calls made through lib,
+ * which must have just been loaded, to the given trace file; the
+ * functions in lib are replaced with ones that record each call
+ * before returning its result.  Returns FALSE if the trace file
+ * cannot be written.
+ */
+
+int record_nvidia_cfg(NvCfgLibPtr lib, const char *filename)
+{
+    if (!recordStream) {
+        recordStream = fopen(filename, "w");
+        if (!recordStream) {
+            nv_error_msg("Unable to open '%s' for writing (%s).",
+                         filename, strerror(errno));
+            return FALSE;
+        }
+        fprintf(recordStream, "%s\n", PROBE_TRACE_HEADER);
+        fflush(recordStream);
+    }
+
+    recordLib = *lib;
+
+    lib->getDevices = record_get_devices;
+    lib->openDevice = record_open_device;
+    lib->getPciDevices = record_get_pci_devices;
+    lib->openPciDevice = record_open_pci_device;
+    lib->getNumCRTCs = record_get_num_crtcs;
+    lib->getProductName = record_get_product_name;
+    lib->getDisplayDevices = record_get_display_devices;
+    lib->getEDID = record_get_edid;
+    if (lib->isPrimaryDevice) {
+        lib->isPrimaryDevice = record_is_primary_device;
+    }
+    lib->closeDevice = record_close_device;
+    lib->getDeviceUUID = record_get_device_uuid;
+
+    return TRUE;
+
+} /* record_nvidia_cfg() */
+
+
+
+/*
+ * find_entry() - claim the recorded result of the given call.  Each
+ * recorded call is served once, in the order in which it was
+ * recorded; if all matching calls have been served already, the last
+ * one is served again, so that a replay may query more than the
+ * recording did.  Returns NULL if the call was never recorded.
+ *
+ * The recorded latency is spent before returning, so that a replay
+ * takes about as long as the recorded probe did.
+ */
+
+static TraceEntryPtr find_entry(int function, const NvCfgPciDevice *dev,
+                                unsigned int display_device)
+{
+    TraceEntryPtr entry, found = NULL;
+    struct timespec delay;
+    int i;
+
+    pthread_mutex_lock(&traceLock);
+
+    for (i = 0; i < nReplayEntries; i++) {
+        entry = &replayEntries[i];
+
+        if ((entry->function != function) ||
+            (dev && ((entry->dev.domain != dev->domain) ||
+                     (entry->dev.bus != dev->bus) ||
+                     (entry->dev.slot != dev->slot) ||
+                     (entry->dev.function != dev->function))) ||
+            ((function == TRACE_GET_EDID) &&
+             (entry->display_device != display_device))) {
+            continue;
+        }
+
+        found = entry;
+        if (!entry->consumed) break;
+    }
+
+    if (found) found->consumed = TRUE;
+
+    pthread_mutex_unlock(&traceLock);
+
+    if (found && found->latency) {
+        delay.tv_sec = found->latency / 1000000;
+        delay.tv_nsec = (found->latency % 1000000) * 1000;
+        nanosleep(&delay, NULL);
+    }
+
+    return found;
+
+} /* find_entry() */
+
+
+
+/*
+ * The replay_*() functions serve the results recorded in the trace;
+ * a call that was not recorded fails.
+ */
+
+static NvCfgBool replay_get_devices(int *n, NvCfgDevice **devs)
+{
+    TraceEntryPtr entry = find_entry(TRACE_GET_DEVICES, NULL, 0);
+    int i;
+
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *n = entry->nDevs;
+    *devs = nvalloc(sizeof(NvCfgDevice) * NV_MAX(entry->nDevs, 1));
+
+    for (i = 0; i < entry->nDevs; i++) {
+        (*devs)[i].bus = entry->devs[i].bus;
+        (*devs)[i].slot = entry->devs[i].slot;
+    }
+
+    return NVCFG_TRUE;
+
+} /* replay_get_devices() */
+
+
+
+static NvCfgBool replay_get_pci_devices(int *n, NvCfgPciDevice **devs)
+{
+    TraceEntryPtr entry = find_entry(TRACE_GET_PCI_DEVICES, NULL, 0);
+
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *n = entry->nDevs;
+    *devs = nvalloc(sizeof(NvCfgPciDevice) * NV_MAX(entry->nDevs, 1));
+    memcpy(*devs, entry->devs, sizeof(NvCfgPciDevice) * entry->nDevs);
+
+    return NVCFG_TRUE;
+
+} /* replay_get_pci_devices() */
+
+
+
+static NvCfgBool replay_open(int function, const NvCfgPciDevice *dev,
+                             NvCfgDeviceHandle *handle)
+{
+    TraceEntryPtr entry = find_entry(function, dev, 0);
+    TraceHandlePtr traceHandle;
+
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    traceHandle = nvalloc(sizeof(TraceHandleRec));
+    traceHandle->dev = *dev;
+    *handle = traceHandle;
+
+    return NVCFG_TRUE;
+
+} /* replay_open() */
+
+
+
+static NvCfgBool replay_open_device(int bus, int slot,
+                                    NvCfgDeviceHandle *handle)
+{
+    NvCfgPciDevice dev;
+
+    memset(&dev, 0, sizeof(dev));
+    dev.bus = bus;
+    dev.slot = slot;
+
+    return replay_open(TRACE_OPEN_DEVICE, &dev, handle);
+
+} /* replay_open_device() */
+
+
+
+static NvCfgBool replay_open_pci_device(int domain, int bus, int slot,
+                                        int function,
+                                        NvCfgDeviceHandle *handle)
+{
+    NvCfgPciDevice dev;
+
+    dev.domain = domain;
+    dev.bus = bus;
+    dev.slot = slot;
+    dev.function = function;
+
+    return replay_open(TRACE_OPEN_PCI_DEVICE, &dev, handle);
+
+} /* replay_open_pci_device() */
+
+
+
+static NvCfgBool replay_get_num_crtcs(NvCfgDeviceHandle handle, int *crtcs)
+{
+    TraceHandlePtr traceHandle = handle;
+    TraceEntryPtr entry;
+
+    entry = find_entry(TRACE_GET_NUM_CRTCS, &traceHandle->dev, 0);
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *crtcs = (int) entry->value;
+
+    return NVCFG_TRUE;
+
+} /* replay_get_num_crtcs() */
+
+
+
+static NvCfgBool replay_get_string(int function, NvCfgDeviceHandle handle,
+                                   char **str)
+{
+    TraceHandlePtr traceHandle = handle;
+    TraceEntryPtr entry;
+
+    entry = find_entry(function, &traceHandle->dev, 0);
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *str = entry->string ? nvstrdup(entry->string) : NULL;
+
+    return NVCFG_TRUE;
+
+} /* replay_get_string() */
+
+
+
+static NvCfgBool replay_get_product_name(NvCfgDeviceHandle handle,
+                                         char **name)
+{
+    return replay_get_string(TRACE_GET_PRODUCT_NAME, handle, name);
+
+} /* replay_get_product_name() */
+
+
+
+static NvCfgBool replay_get_device_uuid(NvCfgDeviceHandle handle,
+                                        char **uuid)
+{
+    return replay_get_string(TRACE_GET_DEVICE_UUID, handle, uuid);
+
+} /* replay_get_device_uuid() */
+
+
+
+static NvCfgBool replay_get_display_devices(NvCfgDeviceHandle handle,
+                                            unsigned int *mask)
+{
+    TraceHandlePtr traceHandle = handle;
+    TraceEntryPtr entry;
+
+    entry = find_entry(TRACE_GET_DISPLAY_DEVICES, &traceHandle->dev, 0);
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *mask = entry->value;
+
+    return NVCFG_TRUE;
+
+} /* replay_get_display_devices() */
+
+
+
+static NvCfgBool replay_get_edid(NvCfgDeviceHandle handle,
+                                 unsigned int display_device,
+                                 NvCfgDisplayDeviceInformation *info)
+{
+    TraceHandlePtr traceHandle = handle;
+    TraceEntryPtr entry;
+
+    entry = find_entry(TRACE_GET_EDID, &traceHandle->dev, display_device);
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *info = entry->info;
+
+    return NVCFG_TRUE;
+
+} /* replay_get_edid() */
+
+
+
+static NvCfgBool replay_is_primary_device(NvCfgDeviceHandle handle,
+                                          NvCfgBool *is_primary_device)
+{
+    TraceHandlePtr traceHandle = handle;
+    TraceEntryPtr entry;
+
+    entry = find_entry(TRACE_IS_PRIMARY_DEVICE, &traceHandle->dev, 0);
+    if (!entry || (entry->result != NVCFG_TRUE)) return NVCFG_FALSE;
+
+    *is_primary_device = entry->value ? NVCFG_TRUE : NVCFG_FALSE;
+
+    return NVCFG_TRUE;
+
+} /* replay_is_primary_device() */
+
+
+
+static NvCfgBool replay_close_device(NvCfgDeviceHandle handle)
+{
+    TraceHandlePtr traceHandle = handle;
+    TraceEntryPtr entry;
+
+    entry = find_entry(TRACE_CLOSE_DEVICE, &traceHandle->dev, 0);
+
+    nvfree(traceHandle);
+
+    return (entry && (entry->result == NVCFG_TRUE)) ?
+        NVCFG_TRUE : NVCFG_FALSE;
+
+} /* replay_close_device() */
+
+
+
+/*
+ * parse_device_list() - parse the "<count> <address>..." values of
+ * nvCfgGetDevices and nvCfgGetPciDevices.
+ */
+
+static int parse_device_list(char *values, TraceEntryPtr entry)
+{
+    char *token, *saveptr;
+    int i;
+
+    token = strtok_r(values, " ", &saveptr);
+    if (!token || (sscanf(token, "%d", &entry->nDevs) != 1) ||
+        (entry->nDevs < 0)) {
+        return FALSE;
+    }
+
+    entry->devs = nvalloc(sizeof(NvCfgPciDevice) * NV_MAX(entry->nDevs, 1));
+
+    for (i = 0; i < entry->nDevs; i++) {
+        token = strtok_r(NULL, " ", &saveptr);
+        if (!token || !parse_device(token, &entry->devs[i])) return FALSE;
+    }
+
+    return (strtok_r(NULL, " ", &saveptr) == NULL);
+
+} /* parse_device_list() */
+
+
+
+static int parse_edid(const char *values, TraceEntryPtr entry)
+{
+    NvCfgDisplayDeviceInformation *info = &entry->info;
+    int consumed = 0;
+
+    if (entry->result != NVCFG_TRUE) {
+        return (sscanf(values, "%x %n", &entry->display_device,
+                       &consumed) == 1) && (values[consumed] == '\0');
+    }
+
+    if (sscanf(values, "%x %u %u %u %u %u %u %u %u %u %u %u %u %u %n",
+               &entry->display_device,
+               &info->min_horiz_sync, &info->max_horiz_sync,
+               &info->min_vert_refresh, &info->max_vert_refresh,
+               &info->max_pixel_clock,
+               &info->max_xres, &info->max_yres, &info->max_refresh,
+               &info->preferred_xres, &info->preferred_yres,
+               &info->preferred_refresh,
+               &info->physical_width, &info->physical_height,
+               &consumed) != 14 || consumed == 0) {
+        return FALSE;
+    }
+
+    snprintf(info->monitor_name, sizeof(info->monitor_name), "%s",
+             values + consumed);
+
+    return TRUE;
+
+} /* parse_edid() */
+
+
+
+/*
+ * parse_entry() - parse one line of a trace into entry; returns FALSE
+ * if the line is malformed.
+ */
+
+static int parse_entry(char *line, TraceEntryPtr entry)
+{
+    char function[64], device[32], *values;
+    int result, consumed = 0, i;
+
+    memset(entry, 0, sizeof(TraceEntryRec));
+
+    if (sscanf(line, "%63s %u %d %31s%n", function, &entry->latency,
+               &result, device, &consumed) != 4) {
+        return FALSE;
+    }
+
+    values = line + consumed;
+    if (*values == ' ') values++;
+
+    for (i = 0; i < TRACE_FUNCTION_COUNT; i++) {
+        if (strcmp(function, traceFunctionNames[i]) == 0) break;
+    }
+    if (i == TRACE_FUNCTION_COUNT) return FALSE;
+
+    entry->function = i;
+    entry->result = result ? NVCFG_TRUE : NVCFG_FALSE;
+
+    if ((entry->function == TRACE_GET_DEVICES) ||
+        (entry->function == TRACE_GET_PCI_DEVICES)) {
+        if (strcmp(device, "-") != 0) return FALSE;
+    } else if (!parse_device(device, &entry->dev)) {
+        return FALSE;
+    }
+
+    /* the values are only recorded for successful calls */
+
+    if ((entry->result != NVCFG_TRUE) && (entry->function != TRACE_GET_EDID)) {
+        return (*values == '\0');
+    }
+
+    switch (entry->function) {
+
+    case TRACE_GET_DEVICES:
+    case TRACE_GET_PCI_DEVICES:
+        return parse_device_list(values, entry);
+
+    case TRACE_GET_NUM_CRTCS:
+    case TRACE_IS_PRIMARY_DEVICE:
+        return (sscanf(values, "%u", &entry->value) == 1);
+
+    case TRACE_GET_DISPLAY_DEVICES:
+        return (sscanf(values, "%x", &entry->value) == 1);
+
+    case TRACE_GET_PRODUCT_NAME:
+    case TRACE_GET_DEVICE_UUID:
+        entry->string = nvstrdup(values);
+        return TRUE;
+
+    case TRACE_GET_EDID:
+        return parse_edid(values, entry);
+
+    default:
+        return (*values == '\0');
+    }
+
+} /* parse_entry() */
+
+
+
+static void free_replay_entries(void)
+{
+    int i;
+
+    for (i = 0; i < nReplayEntries; i++) {
+        nvfree(replayEntries[i].string);
+        nvfree(replayEntries[i].devs);
+    }
+
+    nvfree(replayEntries);
+    replayEntries = NULL;
+    nReplayEntries = 0;
+
+} /* free_replay_entries() */
+
+
+
+/*
+ * replay_nvidia_cfg() - read the given trace, written with
+ * --record-gpu-probe, and fill in lib with functions that serve the
+ * recorded results instead of querying the hardware.  Returns FALSE
+ * if the trace cannot be read.
+ */
+
+int replay_nvidia_cfg(NvCfgLibPtr lib, const char *filename)
+{
+    TraceEntryRec entry;
+    int eof = FALSE, lineno = 1, hasPrimary = FALSE;
+    char *line;
+    FILE *stream;
+
+    free_replay_entries();
+
+    stream = fopen(filename, "r");
+    if (!stream) {
+        nv_error_msg("Unable to open GPU probe trace '%s' (%s).",
+                     filename, strerror(errno));
+        return FALSE;
+    }
+
+    line = fget_next_line(stream, &eof);
+
+    if (!line || strcmp(line, PROBE_TRACE_HEADER) != 0) {
+        nv_error_msg("'%s' is not a GPU probe trace.", filename);
+        goto fail;
+    }
+
+    while (!eof) {
+        nvfree(line);
+        line = fget_next_line(stream, &eof);
+        lineno++;
+
+        if (!line || (line[0] == '\0')) continue;
+
+        if (!parse_entry(line, &entry)) {
+            nv_error_msg("Unable to parse line %d of GPU probe trace '%s'.",
+                         lineno, filename);
+            nvfree(entry.string);
+            nvfree(entry.devs);
+            goto fail;
+        }
+
+        if (entry.function == TRACE_IS_PRIMARY_DEVICE) hasPrimary = TRUE;
+
+        replayEntries = nvrealloc(replayEntries,
+                                  sizeof(TraceEntryRec) *
+                                  (nReplayEntries + 1));
+        replayEntries[nReplayEntries++] = entry;
+    }
+
+    nvfree(line);
+    fclose(stream);
+
+    memset(lib, 0, sizeof(NvCfgLibRec));
+
+    lib->getDevices = replay_get_devices;
+    lib->openDevice = replay_open_device;
+    lib->getPciDevices = replay_get_pci_devices;
+    lib->openPciDevice = replay_open_pci_device;
+    lib->getNumCRTCs = replay_get_num_crtcs;
+    lib->getProductName = replay_get_product_name;
+    lib->getDisplayDevices = replay_get_display_devices;
+    lib->getEDID = replay_get_edid;
+    lib->closeDevice = replay_close_device;
+    lib->getDeviceUUID = replay_get_device_uuid;
+
+    /* only if the recorded library provided it */
+
+    if (hasPrimary) {
+        lib->isPrimaryDevice = replay_is_primary_device;
+    }
+
+    return TRUE;
+
+ fail:
+
+    nvfree(line);
+    fclose(stream);
+    free_replay_entries();
+
+    return FALSE;
+
+} /* replay_nvidia_cfg() */
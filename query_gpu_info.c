@@ -22,6 +22,8 @@
 
 #include "nvidia-xconfig.h"
 #include "msg.h"
+#include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 
 static char *display_device_mask_to_display_device_name(unsigned int mask);
@@ -30,6 +32,306 @@ static char *display_device_mask_to_display_device_name(unsigned int mask);
 #define BUS_ID_STRING_LENGTH 32
 
 
+/*
+ * the EDID values printed by --format=json and --format=csv, in the
+ * order of the CSV columns; the names carry the unit of each value
+ */
+
+static const struct {
+    const char *name;
+    size_t offset;
+} EdidFields[] = {
+    { "min_horiz_sync_hz",
+      offsetof(NvCfgDisplayDeviceInformation, min_horiz_sync) },
+    { "max_horiz_sync_hz",
+      offsetof(NvCfgDisplayDeviceInformation, max_horiz_sync) },
+    { "min_vert_refresh_hz",
+      offsetof(NvCfgDisplayDeviceInformation, min_vert_refresh) },
+    { "max_vert_refresh_hz",
+      offsetof(NvCfgDisplayDeviceInformation, max_vert_refresh) },
+    { "max_pixel_clock_khz",
+      offsetof(NvCfgDisplayDeviceInformation, max_pixel_clock) },
+    { "max_width_pixels",
+      offsetof(NvCfgDisplayDeviceInformation, max_xres) },
+    { "max_height_pixels",
+      offsetof(NvCfgDisplayDeviceInformation, max_yres) },
+    { "max_refresh_hz",
+      offsetof(NvCfgDisplayDeviceInformation, max_refresh) },
+    { "preferred_width_pixels",
+      offsetof(NvCfgDisplayDeviceInformation, preferred_xres) },
+    { "preferred_height_pixels",
+      offsetof(NvCfgDisplayDeviceInformation, preferred_yres) },
+    { "preferred_refresh_hz",
+      offsetof(NvCfgDisplayDeviceInformation, preferred_refresh) },
+    { "physical_width_mm",
+      offsetof(NvCfgDisplayDeviceInformation, physical_width) },
+    { "physical_height_mm",
+      offsetof(NvCfgDisplayDeviceInformation, physical_height) },
+};
+
+#define EDID_FIELD_COUNT (sizeof(EdidFields) / sizeof(EdidFields[0]))
+
+#define EDID_FIELD(_info, _i) \
+    (*(const unsigned int *) ((const char *) (_info) + \
+                              EdidFields[_i].offset))
+
+
+
+/*
+ * utf8_sequence_length() - the length of the well-formed UTF-8
+ * sequence at c, or 0 if there is none there.  Overlong encodings,
+ * surrogates and code points beyond U+10FFFF are not well-formed.
+ */
+
+static int utf8_sequence_length(const unsigned char *c)
+{
+    int len, i;
+    unsigned char min = 0x80, max = 0xbf;
+
+    if (c[0] < 0x80) return 1;
+
+    if (c[0] >= 0xc2 && c[0] <= 0xdf) {
+        len = 2;
+    } else if (c[0] >= 0xe0 && c[0] <= 0xef) {
+        len = 3;
+        if (c[0] == 0xe0) min = 0xa0;
+        if (c[0] == 0xed) max = 0x9f;
+    } else if (c[0] >= 0xf0 && c[0] <= 0xf4) {
+        len = 4;
+        if (c[0] == 0xf0) min = 0x90;
+        if (c[0] == 0xf4) max = 0x8f;
+    } else {
+        return 0;
+    }
+
+    /* the range of the second byte depends on the first */
+
+    if (c[1] < min || c[1] > max) return 0;
+
+    for (i = 2; i < len; i++) {
+        if (c[i] < 0x80 || c[i] > 0xbf) return 0;
+    }
+
+    return len;
+
+} /* utf8_sequence_length() */
+
+
+
+/*
+ * print_json_string() - print str as a JSON string literal; a NULL
+ * str is printed as null.  Strings from the driver, such as monitor
+ * names from EDIDs, are not guaranteed to be UTF-8: well-formed UTF-8
+ * is printed as it is, and any other byte is taken as Latin-1 and
+ * escaped as \u00XX, so that the output is always valid JSON.
+ */
+
+static void print_json_string(FILE *stream, const char *str)
+{
+    const unsigned char *c;
+    int len;
+
+    if (!str) {
+        fputs("null", stream);
+        return;
+    }
+
+    fputc('"', stream);
+
+    for (c = (const unsigned char *) str; *c; c += len) {
+        len = 1;
+
+        switch (*c) {
+        case '"':  fputs("\\\"", stream); break;
+        case '\\': fputs("\\\\", stream); break;
+        case '\n': fputs("\\n", stream); break;
+        case '\r': fputs("\\r", stream); break;
+        case '\t': fputs("\\t", stream); break;
+        default:
+            if (*c < 0x20 || *c == 0x7f) {
+                fprintf(stream, "\\u%04x", *c);
+            } else if (*c < 0x80) {
+                fputc(*c, stream);
+            } else if ((len = utf8_sequence_length(c)) > 0) {
+                fwrite(c, 1, len, stream);
+            } else {
+                fprintf(stream, "\\u%04x", *c);
+                len = 1;
+            }
+            break;
+        }
+    }
+
+    fputc('"', stream);
+
+} /* print_json_string() */
+
+
+
+/*
+ * print_csv_field() - print str as a CSV field, quoted if needed; a
+ * NULL str is printed as an empty field.
+ */
+
+static void print_csv_field(FILE *stream, const char *str)
+{
+    const char *c;
+
+    if (!str) return;
+
+    if (!str[strcspn(str, ",\"\r\n")]) {
+        fputs(str, stream);
+        return;
+    }
+
+    fputc('"', stream);
+
+    for (c = str; *c; c++) {
+        if (*c == '"') fputc('"', stream);
+        fputc(*c, stream);
+    }
+
+    fputc('"', stream);
+
+} /* print_csv_field() */
+
+
+
+/*
+ * print_gpu_info_json() - print the GPU information as a JSON array
+ * with one object per GPU, each on its own line.
+ */
+
+static void print_gpu_info_json(FILE *stream, DevicesPtr pDevices)
+{
+    DevicePtr pDevice;
+    DisplayDevicePtr pDisplayDevice;
+    char *name, busid[BUS_ID_STRING_LENGTH];
+    int i, j, k;
+
+    fputs("[\n", stream);
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+        pDevice = &pDevices->devices[i];
+
+        xconfigFormatPciBusString(busid, BUS_ID_STRING_LENGTH,
+                                  pDevice->dev.domain, pDevice->dev.bus,
+                                  pDevice->dev.slot, 0);
+
+        fprintf(stream, "{\"gpu\":%d,\"name\":", i);
+        print_json_string(stream, pDevice->name);
+        fputs(",\"uuid\":", stream);
+        print_json_string(stream, pDevice->uuid);
+        fputs(",\"pci_bus_id\":", stream);
+        print_json_string(stream, busid);
+        fputs(",\"display_devices\":[", stream);
+
+        for (j = 0; j < pDevice->nDisplayDevices; j++) {
+            pDisplayDevice = &pDevice->displayDevices[j];
+
+            name = display_device_mask_to_display_device_name
+                (pDisplayDevice->mask);
+
+            fputs((j == 0) ? "{\"name\":" : ",{\"name\":", stream);
+            print_json_string(stream, name);
+            fputs(",\"edid\":", stream);
+
+            nvfree(name);
+
+            if (!pDisplayDevice->info_valid) {
+                fputs("null}", stream);
+                continue;
+            }
+
+            fputs("{\"monitor_name\":", stream);
+            print_json_string(stream, pDisplayDevice->info.monitor_name);
+
+            for (k = 0; k < EDID_FIELD_COUNT; k++) {
+                fprintf(stream, ",\"%s\":%u", EdidFields[k].name,
+                        EDID_FIELD(&pDisplayDevice->info, k));
+            }
+
+            fputs("}}", stream);
+        }
+
+        fprintf(stream, "]}%s\n", (i + 1 < pDevices->nDevices) ? "," : "");
+    }
+
+    fputs("]\n", stream);
+
+} /* print_gpu_info_json() */
+
+
+
+/*
+ * print_gpu_info_csv() - print the GPU information as CSV, with one
+ * row per display device; a GPU without display devices still gets
+ * a row, with the display device columns left empty.
+ */
+
+static void print_gpu_info_csv(FILE *stream, DevicesPtr pDevices)
+{
+    DevicePtr pDevice;
+    DisplayDevicePtr pDisplayDevice;
+    char *name, busid[BUS_ID_STRING_LENGTH];
+    int i, j, k;
+
+    fputs("gpu,name,uuid,pci_bus_id,display_device,monitor_name", stream);
+    for (k = 0; k < EDID_FIELD_COUNT; k++) {
+        fprintf(stream, ",%s", EdidFields[k].name);
+    }
+    fputc('\n', stream);
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+        pDevice = &pDevices->devices[i];
+
+        xconfigFormatPciBusString(busid, BUS_ID_STRING_LENGTH,
+                                  pDevice->dev.domain, pDevice->dev.bus,
+                                  pDevice->dev.slot, 0);
+
+        for (j = 0; (j == 0) || (j < pDevice->nDisplayDevices); j++) {
+
+            fprintf(stream, "%d,", i);
+            print_csv_field(stream, pDevice->name);
+            fputc(',', stream);
+            print_csv_field(stream, pDevice->uuid);
+            fputc(',', stream);
+            print_csv_field(stream, busid);
+            fputc(',', stream);
+
+            if (j >= pDevice->nDisplayDevices) {
+                pDisplayDevice = NULL;
+            } else {
+                pDisplayDevice = &pDevice->displayDevices[j];
+
+                name = display_device_mask_to_display_device_name
+                    (pDisplayDevice->mask);
+                print_csv_field(stream, name);
+                nvfree(name);
+            }
+
+            fputc(',', stream);
+
+            if (pDisplayDevice && pDisplayDevice->info_valid) {
+                print_csv_field(stream, pDisplayDevice->info.monitor_name);
+            }
+
+            for (k = 0; k < EDID_FIELD_COUNT; k++) {
+                if (pDisplayDevice && pDisplayDevice->info_valid) {
+                    fprintf(stream, ",%u",
+                            EDID_FIELD(&pDisplayDevice->info, k));
+                } else {
+                    fputc(',', stream);
+                }
+            }
+
+            fputc('\n', stream);
+        }
+    }
+
+} /* print_gpu_info_csv() */
+
+
 /*
  * query_gpu_info() - query information about the GPU, and print it
  * out
@@ -44,12 +346,31 @@ int query_gpu_info(Options *op)
 
     /* query the GPU information */
 
-    pDevices = find_devices(op);
+    pDevices = find_devices(op, DEVICE_QUERY_EDIDS);
     
     if (!pDevices) {
         nv_error_msg("Unable to query GPU information");
         return FALSE;
     }
+
+    /*
+     * the machine-readable formats are written straight to stdout,
+     * rather than through nv_info_msg(), which would wrap them
+     */
+
+    if (op->query_format != QUERY_FORMAT_TEXT) {
+        if (op->query_format == QUERY_FORMAT_JSON) {
+            print_gpu_info_json(stdout, pDevices);
+        } else {
+            print_gpu_info_csv(stdout, pDevices);
+        }
+
+        if (fflush(stdout) != 0 || ferror(stdout)) {
+            nv_error_msg("Unable to write GPU information");
+            return FALSE;
+        }
+        return TRUE;
+    }
     
     /* print the GPU information */
 
@@ -146,8 +467,6 @@ int query_gpu_info(Options *op)
         }
     }
     
-    free_devices(pDevices);
-
     return TRUE;
     
 } /* query_gpu_info() */
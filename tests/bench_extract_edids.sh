@@ -0,0 +1,100 @@
+#!/bin/sh
+#
+# bench_extract_edids.sh - time '--extract-edids-from-file' on a
+# synthetic X log of BENCH_LOG_MB megabytes (1024 by default), with
+# one scanning thread and with several.  The log is mostly ordinary
+# NVIDIA driver messages, with a few raw EDID blocks spread through
+# it; every run must find all of them.  Run by "make bench", with
+# NVIDIA_XCONFIG and TESTS_OUTPUTDIR in the environment.
+#
+
+size_mb=${BENCH_LOG_MB:-1024}
+threads=${BENCH_THREADS:-8}
+edids=4
+
+dir="$TESTS_OUTPUTDIR/bench_extract_edids"
+log="$dir/Xorg.0.log"
+
+rm -rf "$dir"
+mkdir -p "$dir" || exit 1
+
+# about 1 MB of the messages the driver logs at -logverbose 6
+
+awk 'BEGIN {
+    for (i = 0; length(s) < 1048576; i++) {
+        t = sprintf("[%8d.%03d] ", i / 50, i % 1000);
+        nv = "NVIDIA(" (i % 4) "): ";
+        s = s t "(II) " nv "Setting mode \"DFP-" (i % 3) \
+            ":nvidia-auto-select\"\n";
+        s = s t "(--) NVIDIA(GPU-" (i % 2) "): DFP-" (i % 3) ": connected\n";
+        s = s t "(II) " nv "Validated MetaModes: \"DFP-0:1920x1200\"\n";
+        s = s t "(II) Loading sub module \"fb\" (compiled for 1." (i % 20) \
+            ")\n";
+        s = s t "(II) " nv "RandR 1.2 Raw EDID checksum valid\n";
+    }
+    printf "%s", s
+}' > "$dir/chunk" || exit 1
+
+# a raw EDID block, logged for a different X screen each time
+
+edid_block() {
+    cat <<EOF
+[    4.123] (--) NVIDIA($1): Raw EDID bytes:
+[    4.123] (--) NVIDIA($1):
+[    4.123] (--) NVIDIA($1):   00 ff ff ff ff ff ff 00  5a 63 47 4b fc 27 00 00
+[    4.123] (--) NVIDIA($1):   0f 0a 01 02 9e 1e 17 64  ee 04 85 a0 57 4a 9b 26
+[    4.123] (--) NVIDIA($1):   12 50 54 00 08 00 01 01  01 01 01 01 01 01 01 01
+[    4.123] (--) NVIDIA($1):   01 01 01 01 01 01 64 19  00 40 41 00 26 30 18 88
+[    4.123] (--) NVIDIA($1):   36 00 30 e4 10 00 00 18  00 00 00 ff 00 47 4b 30
+[    4.123] (--) NVIDIA($1):   31 35 31 30 32 33 36 0a  20 20 00 00 00 fc 00 56
+[    4.123] (--) NVIDIA($1):   69 65 77 53 6f 6e 69 63  20 56 50 44 00 00 00 fc
+[    4.123] (--) NVIDIA($1):   00 31 35 30 0a 20 20 20  20 20 20 20 20 20 00 ce
+[    4.123] (--) NVIDIA($1):
+EOF
+}
+
+chunks=`expr $size_mb / $edids`
+[ $chunks -gt 0 ] || chunks=1
+
+i=0
+while [ $i -lt $edids ]; do
+    edid_block $i
+    yes "$dir/chunk" | head -n $chunks | xargs cat
+    i=`expr $i + 1`
+done > "$log" || exit 1
+
+rm -f "$dir/chunk"
+
+now() {
+    date +%s.%N
+}
+
+status=0
+
+echo "`du -m "$log" | cut -f1` MB log, $edids EDIDs"
+
+for n in 1 $threads; do
+    rm -f "$dir"/edid.bin*
+
+    start=`now`
+    "$NVIDIA_XCONFIG" --extract-edids-from-file="$log" \
+        --extract-edids-output-file="$dir/edid.bin" \
+        --extract-edids-threads=$n > "$dir/output" 2>&1
+    result=$?
+    end=`now`
+
+    found=`ls "$dir"/edid.bin* 2>/dev/null | wc -l`
+
+    echo "$start $end $n $found" | \
+        awk '{ printf "  %2d thread(s): %7.3f seconds, %d EDID file(s)\n",
+               $3, $2 - $1, $4 }'
+
+    if [ $result -ne 0 ] || [ $found -ne $edids ]; then
+        cat "$dir/output"
+        status=1
+    fi
+done
+
+rm -rf "$dir"
+
+exit $status
@@ -0,0 +1,201 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * bench_gpu_probe.c - time nvidia-xconfig on the GPUs described by
+ * tests/fixtures/nvidia-cfg-stub/16-gpus.topology, through the
+ * stand-in nvidia-cfg library (see nvidia_cfg_stub.c), for the
+ * options that probe the GPUs; with one probe thread and with several.
+ * Each run is reported with its wall time and the calls it made into
+ * the library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+#define BENCH_ROUNDS 3
+#define BENCH_TOPOLOGY "nvidia-cfg-stub/16-gpus.topology"
+
+#define MAX_ARGS 16
+
+typedef struct {
+    const char *name;
+    const char *args[4];   /* NULL-terminated */
+} ScenarioRec;
+
+static const ScenarioRec scenarios[] = {
+    { "--query-gpu-info",     { "--query-gpu-info", NULL } },
+    { "--enable-all-gpus",    { "--enable-all-gpus", NULL } },
+    { "--separate-x-screens", { "--separate-x-screens", NULL } },
+};
+
+#define NUM_SCENARIOS (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const int threadCounts[] = { 1, 8 };
+
+#define NUM_THREAD_COUNTS (sizeof(threadCounts) / sizeof(threadCounts[0]))
+
+typedef struct {
+    long total;
+    long opens;
+    long edids;
+} CallCountsRec;
+
+
+static char *join(const char *a, const char *b)
+{
+    char *s = malloc(strlen(a) + strlen(b) + 1);
+
+    if (s) {
+        strcpy(s, a);
+        strcat(s, b);
+    }
+
+    return s;
+
+} /* join() */
+
+
+
+/*
+ * readCounts() - sum up the call counts written by the stub library.
+ */
+
+static int readCounts(const char *filename, CallCountsRec *counts)
+{
+    char function[64];
+    long n;
+    FILE *stream = fopen(filename, "r");
+
+    memset(counts, 0, sizeof(*counts));
+
+    if (!stream) return 0;
+
+    while (fscanf(stream, "%63s %ld", function, &n) == 2) {
+        counts->total += n;
+        if (strcmp(function, "nvCfgOpenPciDevice") == 0) {
+            counts->opens += n;
+        } else if (strcmp(function, "nvCfgGetEDID") == 0) {
+            counts->edids += n;
+        }
+    }
+
+    fclose(stream);
+
+    return 1;
+
+} /* readCounts() */
+
+
+
+int main(void)
+{
+    const char *xconfig = getenv("NVIDIA_XCONFIG");
+    const char *stubDir = getenv("NVIDIA_CFG_STUB_DIR");
+    const char *outDir = getenv("TESTS_OUTPUTDIR");
+    char *topology, *countsFile, *conf, *confBackup, *cfgPath;
+    char threadsArg[32], *argv[MAX_ARGS];
+    CallCountsRec counts;
+    double best, t;
+    int i, j, k, n, round, status;
+
+    if (!xconfig || !stubDir || !outDir) {
+        fprintf(stderr, "NVIDIA_XCONFIG, NVIDIA_CFG_STUB_DIR and "
+                "TESTS_OUTPUTDIR must be set; run through 'make bench'.\n");
+        return 1;
+    }
+
+    topology = test_fixture_path(BENCH_TOPOLOGY);
+    countsFile = join(outDir, "/bench_gpu_probe.counts");
+    conf = join(outDir, "/bench_gpu_probe.conf");
+    confBackup = join(conf, ".backup");
+    cfgPath = join("--nvidia-cfg-path=", stubDir);
+
+    if (!topology || !countsFile || !conf || !confBackup || !cfgPath) {
+        return 1;
+    }
+
+    setenv("NVIDIA_CFG_STUB_TOPOLOGY", topology, 1);
+    setenv("NVIDIA_CFG_STUB_COUNTS", countsFile, 1);
+
+    printf("%s, best of %d rounds\n", BENCH_TOPOLOGY, BENCH_ROUNDS);
+    printf("  %-22s %7s %9s %7s %7s %7s\n", "", "threads", "seconds",
+           "calls", "opens", "EDIDs");
+
+    for (i = 0; i < NUM_SCENARIOS; i++) {
+        for (j = 0; j < NUM_THREAD_COUNTS; j++) {
+
+            snprintf(threadsArg, sizeof(threadsArg),
+                     "--gpu-probe-threads=%d", threadCounts[j]);
+
+            /* every run starts from no config at all */
+
+            n = 0;
+            argv[n++] = (char *) xconfig;
+            argv[n++] = cfgPath;
+            argv[n++] = threadsArg;
+            argv[n++] = "--xconfig=/nonexistent/xorg.conf";
+            argv[n++] = "--output-xconfig";
+            argv[n++] = conf;
+            for (k = 0; scenarios[i].args[k]; k++) {
+                argv[n++] = (char *) scenarios[i].args[k];
+            }
+            argv[n] = NULL;
+
+            best = 0;
+            status = 0;
+
+            for (round = 0; round < BENCH_ROUNDS; round++) {
+                unlink(conf);
+                unlink(confBackup);
+                unlink(countsFile);
+
+                t = test_time();
+                status = test_run_program(argv, NULL);
+                t = test_time() - t;
+
+                if (status != 0) break;
+                if (round == 0 || t < best) best = t;
+            }
+
+            CHECK(status == 0);
+            CHECK(readCounts(countsFile, &counts));
+
+            printf("  %-22s %7d %9.3f %7ld %7ld %7ld\n", scenarios[i].name,
+                   threadCounts[j], best, counts.total, counts.opens,
+                   counts.edids);
+        }
+    }
+
+    unlink(conf);
+    unlink(confBackup);
+    unlink(countsFile);
+
+    free(topology);
+    free(countsFile);
+    free(conf);
+    free(confBackup);
+    free(cfgPath);
+
+    return test_result();
+
+} /* main() */
@@ -0,0 +1,184 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * bench_keywords.c - measure how many keywords per second
+ * xconfigGetToken() resolves against a copy of the Device section's
+ * symbol table: through the table's perfect hash, and through a walk
+ * of the table with xconfigNameCompare(), which is how keywords were
+ * resolved before the hash.  Both scan the same buffer, so they only
+ * differ in the lookup.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Configint.h"
+#include "xf86tokens.h"
+#include "test_utils.h"
+
+/* the same keywords as DeviceTab in Device.c, which is private */
+
+static XConfigSymTabRec DeviceTab[] =
+{
+    {ENDSECTION, "endsection"},
+    {IDENTIFIER, "identifier"},
+    {VENDOR, "vendorname"},
+    {BOARD, "boardname"},
+    {CHIPSET, "chipset"},
+    {RAMDAC, "ramdac"},
+    {DACSPEED, "dacspeed"},
+    {CLOCKS, "clocks"},
+    {OPTION, "option"},
+    {VIDEORAM, "videoram"},
+    {BIOSBASE, "biosbase"},
+    {MEMBASE, "membase"},
+    {IOBASE, "iobase"},
+    {CLOCKCHIP, "clockchip"},
+    {CHIPID, "chipid"},
+    {CHIPREV, "chiprev"},
+    {CARD, "card"},
+    {DRIVER, "driver"},
+    {BUSID, "busid"},
+    {TEXTCLOCKFRQ, "textclockfreq"},
+    {IRQ, "irq"},
+    {SCREEN, "screen"},
+    {-1, ""},
+};
+
+#define BENCH_LINES  200000
+#define BENCH_ROUNDS 5
+
+/* keywords spelled as they are found in real configs */
+
+static const char *keywords[] = {
+    "Identifier", "Driver", "VendorName", "BoardName", "BusID",
+    "Screen", "Option", "VideoRam", "Vendor_Name", "BUSID", "chipset",
+    "TextClockFreq", "IRQ", "Bus_ID", "Board_Name",
+};
+
+#define NUM_KEYWORDS (sizeof(keywords) / sizeof(keywords[0]))
+
+
+static int linearLookup(const char *name)
+{
+    int i;
+
+    for (i = 0; DeviceTab[i].token != -1; i++) {
+        if (!xconfigNameCompare(DeviceTab[i].name, name)) {
+            return DeviceTab[i].token;
+        }
+    }
+
+    return ERROR_TOKEN;
+
+} /* linearLookup() */
+
+
+
+/*
+ * scanBuffer() - tokenize buf, resolving each keyword through the
+ * hash or through linearLookup(); returns the elapsed time, and the
+ * number of tokens and the sum of their values in count and sum.
+ */
+
+static double scanBuffer(XConfigParserPtr parser, const char *buf,
+                         size_t len, int linear, long *count, long *sum)
+{
+    double start;
+    int token;
+
+    xconfigParserOpenConfigBuffer(parser, buf, len, "bench");
+
+    *count = *sum = 0;
+    start = test_time();
+
+    while (1) {
+        if (linear) {
+            token = xconfigGetToken(parser, NULL);
+            if (token == ERROR_TOKEN) {
+                token = linearLookup(xconfigTokenString(parser));
+            }
+        } else {
+            token = xconfigGetToken(parser, DeviceTab);
+        }
+
+        if (token == EOF_TOKEN) break;
+
+        (*count)++;
+        *sum += token;
+    }
+
+    start = test_time() - start;
+
+    xconfigParserCloseConfigFile(parser);
+
+    return start;
+
+} /* scanBuffer() */
+
+
+
+int main(void)
+{
+    XConfigParserPtr parser = xconfigNewParser();
+    double best[2], t;
+    long count[2], sum[2];
+    char *buf, *p;
+    size_t len = 0;
+    int i, mode;
+
+    for (i = 0; i < BENCH_LINES; i++) {
+        len += strlen(keywords[i % NUM_KEYWORDS]) + 5;
+    }
+
+    buf = p = malloc(len + 1);
+    if (!parser || !buf) return 1;
+
+    for (i = 0; i < BENCH_LINES; i++) {
+        p += sprintf(p, "    %s\n", keywords[i % NUM_KEYWORDS]);
+    }
+
+    for (mode = 0; mode < 2; mode++) {
+        best[mode] = 0;
+        for (i = 0; i < BENCH_ROUNDS; i++) {
+            t = scanBuffer(parser, buf, p - buf, mode == 0,
+                           &count[mode], &sum[mode]);
+            if (i == 0 || t < best[mode]) best[mode] = t;
+        }
+    }
+
+    printf("%d keywords, best of %d rounds\n", BENCH_LINES, BENCH_ROUNDS);
+    printf("  linear walk:  %8.2f Mtokens/s\n",
+           count[0] / best[0] / 1e6);
+    printf("  perfect hash: %8.2f Mtokens/s (%.2fx)\n",
+           count[1] / best[1] / 1e6, best[0] / best[1]);
+
+    /* both lookups must resolve every keyword the same way */
+
+    CHECK(count[0] == BENCH_LINES);
+    CHECK(count[0] == count[1]);
+    CHECK(sum[0] == sum[1]);
+
+    free(buf);
+    xconfigFreeParser(&parser);
+
+    return test_result();
+
+} /* main() */
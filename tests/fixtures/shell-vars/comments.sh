@@ -0,0 +1,7 @@
+# '#' starts a comment only at the start of a word
+A=foo#bar
+B=#not-a-comment
+C="quoted"#joined
+D=x #a comment; NOT_SET=1
+E=y#
+G=1;#H=2
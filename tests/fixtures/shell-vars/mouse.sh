@@ -0,0 +1,7 @@
+# /etc/sysconfig/mouse, as written by an old distribution installer
+#
+MOUSETYPE="imps2"
+XMOUSETYPE="IMPS/2"
+FULLNAME="Generic - Wheel Mouse (PS/2)"
+DEVICE=/dev/psaux
+export XEMU3=no
@@ -0,0 +1,9 @@
+SINGLE='a "double" and a \ backslash'
+DOUBLE="a 'single', a \"double\" and a \\ backslash"
+MIXED=one' two '"three"
+ESCAPED=a\ b\"c
+CONTINUED="first \
+second"
+EMPTY=
+	INDENTED=yes # trailing comment
+1NUMBER=ignored
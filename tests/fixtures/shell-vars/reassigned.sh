@@ -0,0 +1,3 @@
+MOUSETYPE=ps2
+XEMU3=yes
+MOUSETYPE=imps2; XEMU3=no
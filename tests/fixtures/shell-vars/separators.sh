@@ -0,0 +1,8 @@
+A=1; B=2
+echo "not; an assignment"; C=3
+echo 'not; either' ; D=4;E=5
+# a comment; NOT_SET=1
+F=6 # a comment; NOT_SET=2
+G='x;y'; H="p;q"
+echo one \; NOT_SET=3
+I=7;
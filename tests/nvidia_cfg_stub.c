@@ -0,0 +1,472 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * nvidia_cfg_stub.c - a stand-in for libnvidia-cfg.so.1, so that the
+ * GPU probe can be tested and timed on a system without NVIDIA GPUs,
+ * through '--nvidia-cfg-path'.
+ *
+ * The GPUs are described by the topology file named by
+ * NVIDIA_CFG_STUB_TOPOLOGY, which has one directive per line ('#'
+ * starts a comment):
+ *
+ *   gpu <domain>:<bus>:<slot>.<function> <crtcs> <display mask>
+ *       <primary (0 or 1)> <product name...>
+ *
+ *     a GPU (on one line); the GPUs are reported by
+ *     nvCfgGetPciDevices() in the order they are listed.  Each display
+ *     device in the mask has an EDID.
+ *
+ *   latency <function> <microseconds>
+ *
+ *     how long each call to the given nvCfg function takes, e.g.,
+ *     "latency nvCfgGetEDID 20000"; "*" sets it for every function
+ *     that is not given explicitly.
+ *
+ *   gpu-latency <domain>:<bus>:<slot>.<function> <microseconds>
+ *
+ *     how much longer each call on the given (already listed) GPU
+ *     takes, including opening it; this makes GPUs that are probed
+ *     at the same time finish in a different order.
+ *
+ * If NVIDIA_CFG_STUB_COUNTS is set, the number of calls made to each
+ * function is written to that file when the library is unloaded, as
+ * "<function> <count>" lines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "nvidia-cfg.h"
+
+#define STUB_MAX_GPUS 64
+
+typedef enum {
+    STUB_GET_DEVICES = 0,
+    STUB_OPEN_DEVICE,
+    STUB_GET_PCI_DEVICES,
+    STUB_OPEN_PCI_DEVICE,
+    STUB_CLOSE_DEVICE,
+    STUB_GET_NUM_CRTCS,
+    STUB_GET_PRODUCT_NAME,
+    STUB_GET_DEVICE_UUID,
+    STUB_GET_DISPLAY_DEVICES,
+    STUB_GET_EDID,
+    STUB_IS_PRIMARY_DEVICE,
+    STUB_NUM_FUNCTIONS,
+} StubFunction;
+
+static const char *functionNames[STUB_NUM_FUNCTIONS] = {
+    "nvCfgGetDevices",
+    "nvCfgOpenDevice",
+    "nvCfgGetPciDevices",
+    "nvCfgOpenPciDevice",
+    "nvCfgCloseDevice",
+    "nvCfgGetNumCRTCs",
+    "nvCfgGetProductName",
+    "nvCfgGetDeviceUUID",
+    "nvCfgGetDisplayDevices",
+    "nvCfgGetEDID",
+    "nvCfgIsPrimaryDevice",
+};
+
+typedef struct {
+    NvCfgPciDevice dev;
+    int crtcs;
+    unsigned int displayMask;
+    int primary;
+    long latency;
+    char name[64];
+} StubGpuRec, *StubGpuPtr;
+
+/* a handle returned by nvCfgOpenPciDevice() */
+
+typedef struct {
+    StubGpuPtr gpu;
+    int open;
+} StubHandleRec, *StubHandlePtr;
+
+static StubGpuRec gpus[STUB_MAX_GPUS];
+static int numGpus;
+
+static long latency[STUB_NUM_FUNCTIONS];
+static long calls[STUB_NUM_FUNCTIONS];
+
+static pthread_once_t loadOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t callsLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*
+ * load_topology() - read the file named by NVIDIA_CFG_STUB_TOPOLOGY;
+ * without one, there are no GPUs.  Malformed lines are reported and
+ * ignored.
+ */
+
+static void load_topology(void)
+{
+    const char *filename = getenv("NVIDIA_CFG_STUB_TOPOLOGY");
+    char line[256], function[64], *name;
+    long defaultLatency = 0, value;
+    int set[STUB_NUM_FUNCTIONS];
+    unsigned int domain, bus, slot, func, mask;
+    int i, crtcs, primary, consumed, lineno = 0;
+    FILE *stream;
+
+    memset(set, 0, sizeof(set));
+
+    if (!filename) return;
+
+    stream = fopen(filename, "r");
+    if (!stream) {
+        fprintf(stderr, "nvidia-cfg stub: cannot open '%s'.\n", filename);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), stream)) {
+        lineno++;
+        line[strcspn(line, "#\n")] = '\0';
+        if (line[strspn(line, " \t")] == '\0') continue;
+
+        if ((sscanf(line, " gpu %x:%x:%x.%x %d %x %d %n", &domain, &bus,
+                    &slot, &func, &crtcs, &mask, &primary,
+                    &consumed) == 7) && (numGpus < STUB_MAX_GPUS)) {
+            StubGpuPtr gpu = &gpus[numGpus++];
+
+            gpu->dev.domain = domain;
+            gpu->dev.bus = bus;
+            gpu->dev.slot = slot;
+            gpu->dev.function = func;
+            gpu->crtcs = crtcs;
+            gpu->displayMask = mask;
+            gpu->primary = primary;
+
+            name = line + consumed;
+            name[strcspn(name, "\r")] = '\0';
+            snprintf(gpu->name, sizeof(gpu->name), "%s", name);
+
+        } else if (sscanf(line, " gpu-latency %x:%x:%x.%x %ld", &domain,
+                          &bus, &slot, &func, &value) == 5) {
+            for (i = 0; i < numGpus; i++) {
+                if ((gpus[i].dev.domain == domain) &&
+                    (gpus[i].dev.bus == bus) && (gpus[i].dev.slot == slot) &&
+                    (gpus[i].dev.function == func)) {
+                    gpus[i].latency = value;
+                    break;
+                }
+            }
+            if (i == numGpus) {
+                fprintf(stderr, "nvidia-cfg stub: %s:%d: unknown GPU.\n",
+                        filename, lineno);
+            }
+        } else if (sscanf(line, " latency %63s %ld", function,
+                          &value) == 2) {
+            if (strcmp(function, "*") == 0) {
+                defaultLatency = value;
+                continue;
+            }
+            for (i = 0; i < STUB_NUM_FUNCTIONS; i++) {
+                if (strcmp(function, functionNames[i]) == 0) {
+                    latency[i] = value;
+                    set[i] = 1;
+                    break;
+                }
+            }
+            if (i == STUB_NUM_FUNCTIONS) {
+                fprintf(stderr, "nvidia-cfg stub: %s:%d: unknown function "
+                        "'%s'.\n", filename, lineno, function);
+            }
+        } else {
+            fprintf(stderr, "nvidia-cfg stub: %s:%d: cannot parse '%s'.\n",
+                    filename, lineno, line);
+        }
+    }
+
+    fclose(stream);
+
+    for (i = 0; i < STUB_NUM_FUNCTIONS; i++) {
+        if (!set[i]) latency[i] = defaultLatency;
+    }
+
+} /* load_topology() */
+
+
+
+/*
+ * stub_call() - account for a call to the given function, on the given
+ * GPU (if any), and take as long as it is configured to.
+ */
+
+static void stub_call(StubFunction function, StubGpuPtr gpu)
+{
+    long us;
+
+    pthread_once(&loadOnce, load_topology);
+
+    pthread_mutex_lock(&callsLock);
+    calls[function]++;
+    pthread_mutex_unlock(&callsLock);
+
+    us = latency[function] + (gpu ? gpu->latency : 0);
+
+    if (us > 0) {
+        usleep(us);
+    }
+
+} /* stub_call() */
+
+
+
+/*
+ * stub_gpu() - the GPU behind an open handle, or NULL if the handle is
+ * not valid.
+ */
+
+static StubGpuPtr stub_gpu(NvCfgDeviceHandle handle)
+{
+    StubHandlePtr h = handle;
+
+    if (!h || !h->open) return NULL;
+
+    return h->gpu;
+
+} /* stub_gpu() */
+
+
+
+/*
+ * write_counts() - write the call counts to NVIDIA_CFG_STUB_COUNTS
+ * when the library is unloaded, either by dlclose() or at exit.
+ */
+
+static void write_counts(void) __attribute__((destructor));
+
+static void write_counts(void)
+{
+    const char *filename = getenv("NVIDIA_CFG_STUB_COUNTS");
+    FILE *stream;
+    int i;
+
+    if (!filename) return;
+
+    stream = fopen(filename, "w");
+    if (!stream) return;
+
+    for (i = 0; i < STUB_NUM_FUNCTIONS; i++) {
+        fprintf(stream, "%s %ld\n", functionNames[i], calls[i]);
+    }
+
+    fclose(stream);
+
+} /* write_counts() */
+
+
+
+NvCfgBool nvCfgGetDevices(int *n, NvCfgDevice **devs)
+{
+    stub_call(STUB_GET_DEVICES, NULL);
+
+    *n = 0;
+    *devs = NULL;
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgOpenDevice(int bus, int slot, NvCfgDeviceHandle *handle)
+{
+    stub_call(STUB_OPEN_DEVICE, NULL);
+
+    return NVCFG_FALSE;
+}
+
+
+NvCfgBool nvCfgGetPciDevices(int *n, NvCfgPciDevice **devs)
+{
+    int i;
+
+    stub_call(STUB_GET_PCI_DEVICES, NULL);
+
+    *n = numGpus;
+    *devs = malloc(sizeof(NvCfgPciDevice) * (numGpus ? numGpus : 1));
+    if (!*devs) return NVCFG_FALSE;
+
+    for (i = 0; i < numGpus; i++) {
+        (*devs)[i] = gpus[i].dev;
+    }
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgOpenPciDevice(int domain, int bus, int device, int function,
+                             NvCfgDeviceHandle *handle)
+{
+    StubHandlePtr h;
+    int i;
+
+    pthread_once(&loadOnce, load_topology);
+
+    for (i = 0; i < numGpus; i++) {
+        if ((gpus[i].dev.domain == domain) && (gpus[i].dev.bus == bus) &&
+            (gpus[i].dev.slot == device)) {
+            break;
+        }
+    }
+
+    stub_call(STUB_OPEN_PCI_DEVICE, (i < numGpus) ? &gpus[i] : NULL);
+
+    if (i == numGpus) return NVCFG_FALSE;
+
+    h = malloc(sizeof(StubHandleRec));
+    if (!h) return NVCFG_FALSE;
+
+    h->gpu = &gpus[i];
+    h->open = 1;
+    *handle = h;
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgCloseDevice(NvCfgDeviceHandle handle)
+{
+    StubHandlePtr h = handle;
+
+    stub_call(STUB_CLOSE_DEVICE, stub_gpu(handle));
+
+    if (!stub_gpu(handle)) return NVCFG_FALSE;
+
+    h->open = 0;
+    free(h);
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgGetNumCRTCs(NvCfgDeviceHandle handle, int *crtcs)
+{
+    StubGpuPtr gpu = stub_gpu(handle);
+
+    stub_call(STUB_GET_NUM_CRTCS, gpu);
+
+    if (!gpu) return NVCFG_FALSE;
+
+    *crtcs = gpu->crtcs;
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgGetProductName(NvCfgDeviceHandle handle, char **name)
+{
+    StubGpuPtr gpu = stub_gpu(handle);
+
+    stub_call(STUB_GET_PRODUCT_NAME, gpu);
+
+    if (!gpu) return NVCFG_FALSE;
+
+    *name = strdup(gpu->name);
+
+    return *name ? NVCFG_TRUE : NVCFG_FALSE;
+}
+
+
+NvCfgBool nvCfgGetDeviceUUID(NvCfgDeviceHandle handle, char **uuid)
+{
+    StubGpuPtr gpu = stub_gpu(handle);
+    char buf[64];
+
+    stub_call(STUB_GET_DEVICE_UUID, gpu);
+
+    if (!gpu) return NVCFG_FALSE;
+
+    snprintf(buf, sizeof(buf), "GPU-stub-%04x-%02x-%02x-%x",
+             gpu->dev.domain, gpu->dev.bus, gpu->dev.slot,
+             gpu->dev.function);
+    *uuid = strdup(buf);
+
+    return *uuid ? NVCFG_TRUE : NVCFG_FALSE;
+}
+
+
+NvCfgBool nvCfgGetDisplayDevices(NvCfgDeviceHandle handle,
+                                 unsigned int *display_device_mask)
+{
+    StubGpuPtr gpu = stub_gpu(handle);
+
+    stub_call(STUB_GET_DISPLAY_DEVICES, gpu);
+
+    if (!gpu) return NVCFG_FALSE;
+
+    *display_device_mask = gpu->displayMask;
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgGetEDID(NvCfgDeviceHandle handle,
+                       unsigned int display_device,
+                       NvCfgDisplayDeviceInformation *info)
+{
+    StubGpuPtr gpu = stub_gpu(handle);
+
+    stub_call(STUB_GET_EDID, gpu);
+
+    if (!gpu || !(gpu->displayMask & display_device)) return NVCFG_FALSE;
+
+    memset(info, 0, sizeof(*info));
+
+    snprintf(info->monitor_name, sizeof(info->monitor_name),
+             "Stub Monitor %02x:%02x 0x%08x", gpu->dev.bus, gpu->dev.slot,
+             display_device);
+
+    info->min_horiz_sync = 30000;
+    info->max_horiz_sync = 83000;
+    info->min_vert_refresh = 56;
+    info->max_vert_refresh = 75;
+    info->max_pixel_clock = 170000;
+    info->max_xres = 1920;
+    info->max_yres = 1200;
+    info->max_refresh = 60;
+    info->preferred_xres = 1920;
+    info->preferred_yres = 1200;
+    info->preferred_refresh = 60;
+    info->physical_width = 518;
+    info->physical_height = 324;
+
+    return NVCFG_TRUE;
+}
+
+
+NvCfgBool nvCfgIsPrimaryDevice(NvCfgDeviceHandle handle,
+                               NvCfgBool *is_primary_device)
+{
+    StubGpuPtr gpu = stub_gpu(handle);
+
+    stub_call(STUB_IS_PRIMARY_DEVICE, gpu);
+
+    if (!gpu) return NVCFG_FALSE;
+
+    *is_primary_device = gpu->primary ? NVCFG_TRUE : NVCFG_FALSE;
+
+    return NVCFG_TRUE;
+}
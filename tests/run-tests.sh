@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# run-tests.sh - run each of the given test programs and scripts
+# (*.sh, run with sh), and report which passed; exits non-zero if any
+# failed.  Used by "make check" and "make bench".
+#
+
+failed=0
+total=0
+
+for test in "$@"; do
+    name=`basename "$test"`
+    total=`expr $total + 1`
+
+    echo "=== $name"
+
+    case "$test" in
+        *.sh) sh "$test" ;;
+        *)    "$test" ;;
+    esac
+
+    if [ $? -eq 0 ]; then
+        echo "PASS: $name"
+    else
+        echo "FAIL: $name"
+        failed=`expr $failed + 1`
+    fi
+done
+
+echo "$total run, $failed failed"
+
+[ $failed -eq 0 ]
@@ -0,0 +1,163 @@
+#!/bin/sh
+#
+# test_extract_edids.sh - run '--extract-edids-from-file' on the X logs
+# in tests/fixtures/extract-edids twice, and check that the second run
+# leaves the EDID files and their index as the first run wrote them,
+# rather than adding numbered copies; that an EDID file which no
+# longer holds the EDID is written again; and that a large log, with
+# EDIDs across the boundaries of the pieces it is split into, gives the
+# same EDIDs with '--extract-edids-threads' as without; and that hex
+# digits in upper case are read like those in lower case.  Run by
+# "make check", with NVIDIA_XCONFIG, TESTS_DIR and TESTS_OUTPUTDIR in
+# the environment.
+#
+
+logs="$TESTS_DIR/fixtures/extract-edids"
+dir="$TESTS_OUTPUTDIR/test_extract_edids"
+out="$dir/edid.bin"
+
+status=0
+
+fail() {
+    echo "$*"
+    status=1
+}
+
+extract() {
+    "$NVIDIA_XCONFIG" --extract-edids-from-file="$logs" \
+        --extract-edids-output-file="$out" > "$dir/output" 2>&1 || {
+        cat "$dir/output"
+        fail "nvidia-xconfig failed"
+    }
+}
+
+# the EDID files listed in the index, one per line
+
+indexed() {
+    grep -v '^#' "$out.index" | cut -f3 | sort -u
+}
+
+rm -rf "$dir"
+mkdir -p "$dir" || exit 1
+
+# the logs hold three EDIDs, two of them the same
+
+extract
+
+[ `ls "$dir" | grep -c '^edid\.bin\.[0-9a-f]*$'` -eq 2 ] ||
+    fail "expected 2 EDID files, found: `ls "$dir"`"
+[ `grep -vc '^#' "$out.index"` -eq 3 ] ||
+    fail "expected 3 EDIDs in the index"
+[ `indexed | wc -l` -eq 2 ] ||
+    fail "expected 2 EDID files in the index"
+
+for f in `indexed`; do
+    [ -f "$f" ] || fail "$f is in the index, but was not written"
+done
+
+mkdir "$dir/first" || exit 1
+cp -p "$dir"/edid.bin* "$dir/first" || exit 1
+
+# a second run writes nothing new
+
+extract
+
+ls "$dir" | grep '\.[0-9][0-9]*$' > /dev/null &&
+    fail "the second run added files: `ls "$dir"`"
+
+for f in "$dir"/first/*; do
+    cmp -s "$f" "$dir/`basename "$f"`" ||
+        fail "`basename "$f"` changed on the second run"
+done
+
+grep -c 'is already in' "$dir/output" | grep -qx 2 ||
+    fail "the second run did not find the existing EDID files"
+
+# an EDID file that no longer matches is overwritten
+
+f=`indexed | head -n 1`
+
+if [ -f "$f" ]; then
+    echo "not an EDID" > "$f"
+
+    extract
+
+    cmp -s "$f" "$dir/first/`basename "$f"`" ||
+        fail "`basename "$f"` was not rewritten"
+fi
+ls "$dir" | grep '\.[0-9][0-9]*$' > /dev/null &&
+    fail "the third run added files: `ls "$dir"`"
+
+# with '--extract-edids-threads', a single large log is scanned in
+# 1 MiB chunks (see extract_edids.c); the EDIDs found must be the same
+# as without threads, including those that cross a chunk boundary
+
+filler() {
+    awk -v n="$1" 'BEGIN { for (i = 0; i < n; i++)
+        printf("[%12.3f] (II) NVIDIA(0): filler %032d\n", i / 1000, i) }'
+}
+
+# put the given log just before the given offset in the large log
+
+place() {
+    size=`wc -c < "$big"`
+    filler $(( ($2 - 300 - size) / line )) >> "$big"
+    cat "$1" >> "$big"
+}
+
+extract_big() {
+    mkdir "$dir/$1" || exit 1
+    "$NVIDIA_XCONFIG" --extract-edids-from-file="$big" \
+        --extract-edids-output-file="$dir/$1/edid.bin" \
+        --extract-edids-threads="$2" > "$dir/$1/output" 2>&1 || {
+        cat "$dir/$1/output"
+        fail "nvidia-xconfig failed with $2 thread(s)"
+    }
+}
+
+big="$dir/big.log"
+line=`filler 1 | wc -c`
+
+: > "$big"
+place "$logs/Xorg.0.log" 1048576
+place "$logs/Xorg.1.log" 2097152
+filler 1000 >> "$big"
+
+extract_big threads-1 1
+extract_big threads-4 4
+
+# every EDID is written to a file of its own, numbered in file order
+
+[ `ls "$dir/threads-1" | grep -c '^edid\.bin'` -eq 3 ] ||
+    fail "expected 3 EDIDs in the large log, found: `ls "$dir/threads-1"`"
+
+[ "`ls "$dir/threads-1"`" = "`ls "$dir/threads-4"`" ] ||
+    fail "different EDIDs found with threads: `ls "$dir/threads-4"`"
+
+for f in `ls "$dir/threads-1" | grep '^edid\.bin'`; do
+    cmp -s "$dir/threads-1/$f" "$dir/threads-4/$f" ||
+        fail "$f differs with threads"
+done
+
+# hex digits are decoded in either case
+
+mkdir "$dir/upper" || exit 1
+sed '/NVIDIA([0-9]*):   [0-9a-f]/y/abcdef/ABCDEF/' "$logs/Xorg.1.log" \
+    > "$dir/upper.log"
+
+grep -q ' 5A 63 47 4B FC 27 ' "$dir/upper.log" ||
+    fail "the log was not converted to upper case"
+
+"$NVIDIA_XCONFIG" --extract-edids-from-file="$dir/upper.log" \
+    --extract-edids-output-file="$dir/upper/edid.bin" \
+    > "$dir/upper/output" 2>&1 || {
+    cat "$dir/upper/output"
+    fail "nvidia-xconfig failed on upper case hex digits"
+}
+
+cmp -s "$dir/upper/edid.bin" "$dir/threads-1/edid.bin.1" ||
+    fail "upper case hex digits give a different EDID"
+
+[ $status -eq 0 ] && rm -rf "$dir"
+
+exit $status
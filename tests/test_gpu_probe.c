@@ -0,0 +1,273 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_gpu_probe.c - check that probing the GPUs with several threads
+ * (--gpu-probe-threads) gives the same result as probing them one at
+ * a time.  nvidia-xconfig is run through the stand-in nvidia-cfg
+ * library (see nvidia_cfg_stub.c) on GPUs that take longer to probe
+ * the earlier they are listed, so that threads finish out of order;
+ * the output, and the calls made into the library, must not change,
+ * and the primary GPU must still come first.  A probe recorded with
+ * --record-gpu-probe must also give the same output when it is
+ * replayed with --replay-gpu-probe, without the library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+#define TEST_TOPOLOGY "nvidia-cfg-stub/probe-order.topology"
+
+#define MAX_ARGS 16
+
+static const char *xconfig;
+static const char *outDir;
+static char *cfgPath;
+static char *topology;
+
+
+static char *join(const char *a, const char *b)
+{
+    char *s = malloc(strlen(a) + strlen(b) + 1);
+
+    if (s) {
+        strcpy(s, a);
+        strcat(s, b);
+    }
+
+    return s;
+
+} /* join() */
+
+
+
+/*
+ * runProbe() - run nvidia-xconfig with the given option (and
+ * '--gpu-probe-threads=threads', and trace if it is not NULL),
+ * generating a new X config file; returns the config file it wrote,
+ * or its standard output if it does not write one, and the library
+ * calls it made, in calls (NULL if the library was not loaded).  The
+ * caller should free() both.
+ */
+
+static char *runProbe(const char *option, int threads, const char *trace,
+                      char **calls)
+{
+    char *conf, *stdoutFile, *countsFile, *result = NULL;
+    char threadsArg[32], *argv[MAX_ARGS];
+    int n = 0, status;
+
+    *calls = NULL;
+
+    conf = join(outDir, "/test_gpu_probe.conf");
+    stdoutFile = join(outDir, "/test_gpu_probe.out");
+    countsFile = join(outDir, "/test_gpu_probe.counts");
+
+    if (!conf || !stdoutFile || !countsFile) goto done;
+
+    setenv("NVIDIA_CFG_STUB_COUNTS", countsFile, 1);
+
+    snprintf(threadsArg, sizeof(threadsArg), "--gpu-probe-threads=%d",
+             threads);
+
+    argv[n++] = (char *) xconfig;
+    argv[n++] = cfgPath;
+    argv[n++] = threadsArg;
+    argv[n++] = "--xconfig=/nonexistent/xorg.conf";
+    argv[n++] = "--output-xconfig";
+    argv[n++] = conf;
+    argv[n++] = (char *) option;
+    if (trace) {
+        argv[n++] = (char *) trace;
+    }
+    argv[n] = NULL;
+
+    unlink(conf);
+    unlink(countsFile);
+
+    status = test_run_program(argv, stdoutFile);
+    CHECK(status == 0);
+
+    result = test_read_file(conf);
+    if (!result) {
+        result = test_read_file(stdoutFile);
+    }
+    *calls = test_read_file(countsFile);
+
+    CHECK(result != NULL);
+
+    unlink(conf);
+    unlink(stdoutFile);
+    unlink(countsFile);
+
+ done:
+    free(conf);
+    free(stdoutFile);
+    free(countsFile);
+
+    return result;
+
+} /* runProbe() */
+
+
+
+/*
+ * testOption() - compare the serial probe with threaded ones, for the
+ * given option; returns the serial result, which the caller should
+ * free().
+ */
+
+static char *testOption(const char *option)
+{
+    static const int threadCounts[] = { 2, 4, 16 };
+    char *serial, *serialCalls, *threaded, *threadedCalls;
+    int i;
+
+    serial = runProbe(option, 1, NULL, &serialCalls);
+    CHECK(serialCalls != NULL);
+
+    for (i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        threaded = runProbe(option, threadCounts[i], NULL, &threadedCalls);
+
+        if (serial && threaded && strcmp(serial, threaded) != 0) {
+            fprintf(stderr, "%s with %d threads:\n%s\ndiffers from the "
+                    "serial probe:\n%s\n", option, threadCounts[i],
+                    threaded, serial);
+            CHECK(strcmp(serial, threaded) == 0);
+        }
+        CHECK(serialCalls && threadedCalls &&
+              strcmp(serialCalls, threadedCalls) == 0);
+
+        free(threaded);
+        free(threadedCalls);
+    }
+
+    free(serialCalls);
+
+    return serial;
+
+} /* testOption() */
+
+
+
+/*
+ * testReplay() - record the probe for the given option, and check
+ * that replaying the recording gives the same result without loading
+ * the library.
+ */
+
+static void testReplay(const char *option)
+{
+    char *trace, *recordArg, *replayArg;
+    char *recorded, *recordedCalls, *replayed, *replayedCalls;
+
+    trace = join(outDir, "/test_gpu_probe.trace");
+    recordArg = trace ? join("--record-gpu-probe=", trace) : NULL;
+    replayArg = trace ? join("--replay-gpu-probe=", trace) : NULL;
+    if (!recordArg || !replayArg) {
+        CHECK(!"out of memory");
+        goto done;
+    }
+
+    unlink(trace);
+
+    recorded = runProbe(option, 1, recordArg, &recordedCalls);
+    CHECK(recordedCalls != NULL);
+
+    /* without a topology, the stub library would find no GPUs */
+
+    unsetenv("NVIDIA_CFG_STUB_TOPOLOGY");
+    replayed = runProbe(option, 1, replayArg, &replayedCalls);
+    setenv("NVIDIA_CFG_STUB_TOPOLOGY", topology, 1);
+
+    CHECK(replayedCalls == NULL);
+
+    if (recorded && replayed && strcmp(recorded, replayed) != 0) {
+        fprintf(stderr, "%s replayed:\n%s\ndiffers from the recorded "
+                "probe:\n%s\n", option, replayed, recorded);
+        CHECK(strcmp(recorded, replayed) == 0);
+    }
+
+    if (test_result() == 0) {
+        unlink(trace);
+    }
+
+    free(recorded);
+    free(recordedCalls);
+    free(replayed);
+    free(replayedCalls);
+
+ done:
+    free(trace);
+    free(recordArg);
+    free(replayArg);
+
+} /* testReplay() */
+
+
+
+int main(void)
+{
+    const char *stubDir = getenv("NVIDIA_CFG_STUB_DIR");
+    char *result;
+
+    xconfig = getenv("NVIDIA_XCONFIG");
+    outDir = getenv("TESTS_OUTPUTDIR");
+
+    if (!xconfig || !stubDir || !outDir) {
+        fprintf(stderr, "NVIDIA_XCONFIG, NVIDIA_CFG_STUB_DIR and "
+                "TESTS_OUTPUTDIR must be set; run through 'make check'.\n");
+        return 1;
+    }
+
+    topology = test_fixture_path(TEST_TOPOLOGY);
+    cfgPath = join("--nvidia-cfg-path=", stubDir);
+    if (!topology || !cfgPath) return 1;
+
+    setenv("NVIDIA_CFG_STUB_TOPOLOGY", topology, 1);
+
+    /* the primary GPU (PCI:11:0:0) comes first, the others in order */
+
+    result = testOption("--query-gpu-info");
+    CHECK(result && strstr(result, "GPU #0:\n  Name      : "
+                           "NVIDIA Stub GPU E\n"));
+    CHECK(result && strstr(result, "GPU #4:\n  Name      : "
+                           "NVIDIA Stub GPU A\n"));
+    free(result);
+
+    result = testOption("--enable-all-gpus");
+    CHECK(result && strstr(result, "BusID          \"PCI:11:0:0\""));
+    free(result);
+
+    free(testOption("--separate-x-screens"));
+
+    /* the recorded probe, replayed */
+
+    testReplay("--query-gpu-info");
+    testReplay("--enable-all-gpus");
+
+    free(topology);
+    free(cfgPath);
+
+    return test_result();
+
+} /* main() */
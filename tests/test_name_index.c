@@ -0,0 +1,135 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_name_index.c - check that references are resolved through the
+ * name index as they were by walking the section lists: a Screen known
+ * only by its obsolete "Driver" line can be referenced, and sections
+ * without an identifier do not get in the way of lookups.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "Configint.h"
+#include "test_utils.h"
+
+
+static const char obsoleteDriverConfig[] =
+    "Section \"ServerLayout\"\n"
+    "    Identifier \"Layout0\"\n"
+    "    Screen 0 \"Screen0\" 0 0\n"
+    "EndSection\n"
+    "\n"
+    "Section \"Device\"\n"
+    "    Identifier \"Device0\"\n"
+    "    Driver \"nvidia\"\n"
+    "EndSection\n"
+    "\n"
+    "Section \"Screen\"\n"
+    "    Driver \"Screen0\"\n"
+    "    Device \"Device0\"\n"
+    "EndSection\n";
+
+
+static XConfigPtr parseConfig(const char *text)
+{
+    XConfigParserPtr parser = xconfigNewParser();
+    XConfigPtr config = NULL;
+
+    if (!parser) return NULL;
+
+    xconfigParserOpenConfigBuffer(parser, text, strlen(text), "test");
+
+    if (xconfigParserReadConfigFile(parser, &config) !=
+        XCONFIG_RETURN_SUCCESS) {
+        config = NULL;
+    }
+
+    xconfigFreeParser(&parser);
+
+    return config;
+
+} /* parseConfig() */
+
+
+
+static void testObsoleteDriver(void)
+{
+    XConfigPtr config = parseConfig(obsoleteDriverConfig);
+
+    CHECK(config != NULL);
+    if (!config) return;
+
+    CHECK(config->screens != NULL);
+    CHECK(config->screens->identifier != NULL &&
+          strcmp(config->screens->identifier, "Screen0") == 0);
+
+    CHECK(config->layouts != NULL && config->layouts->adjacencies != NULL);
+    CHECK(config->layouts->adjacencies->screen == config->screens);
+
+    xconfigFreeConfig(&config);
+
+} /* testObsoleteDriver() */
+
+
+
+static void testUnnamedSections(void)
+{
+    XConfigRec config;
+    XConfigScreenRec unnamed, named;
+    int built;
+
+    memset(&config, 0, sizeof(config));
+    memset(&unnamed, 0, sizeof(unnamed));
+    memset(&named, 0, sizeof(named));
+
+    named.identifier = "Screen0";
+    unnamed.next = &named;
+    config.screens = &unnamed;
+
+    built = xconfigBuildNameIndex(&config);
+    CHECK(built);
+
+    CHECK(xconfigIndexFind(&config, XCONFIG_INDEX_SCREEN, "Screen0") ==
+          &named);
+    CHECK(xconfigIndexFind(&config, XCONFIG_INDEX_SCREEN, "") == NULL);
+
+    /* a section added later without an identifier is not indexed either */
+
+    xconfigIndexAdd(&config, XCONFIG_INDEX_SCREEN, &unnamed, TRUE);
+    CHECK(xconfigIndexFind(&config, XCONFIG_INDEX_SCREEN, "") == NULL);
+
+    if (built) {
+        xconfigDropNameIndex(&config);
+    }
+
+} /* testUnnamedSections() */
+
+
+
+int main(void)
+{
+    testObsoleteDriver();
+    testUnnamedSections();
+
+    return test_result();
+
+} /* main() */
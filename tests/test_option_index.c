@@ -0,0 +1,281 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_option_index.c - check that the index that long option lists
+ * carry (see Flags.c) finds the same option as walking the list would,
+ * while the list is edited through the xconfig*Option*() functions and
+ * by hand, on lists of random names that differ in case, blanks and
+ * underscores and that hold duplicates; and that options parsed from a
+ * config, with or without an arena, are indexed the same way.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xf86Parser.h"
+#include "test_utils.h"
+
+#define NUM_ROUNDS 100
+#define NUM_EDITS 80
+#define NUM_PARSED 300
+
+
+/*
+ * randomName() - one of a small set of names, spelled in one of the
+ * ways xconfigNameCompare() treats as equal.
+ */
+
+static void randomName(char *buf)
+{
+    static const char *names[] = {
+        "Coolbits", "MetaModes", "TwinView", "UseEdid", "ConnectedMonitor",
+        "ModeValidation", "Stereo", "Overlay", "SLI", "BaseMosaic",
+        "NoLogo", "UBB", "RenderAccel", "DPI", "IgnoreEDID", "Xinerama",
+    };
+    const char *name = names[rand() % (sizeof(names) / sizeof(names[0]))];
+    int i;
+
+    for (i = 0; *name; name++) {
+        if (rand() % 8 == 0) buf[i++] = (rand() % 2) ? '_' : ' ';
+        buf[i++] = (rand() % 2) ? *name : (*name ^ ('a' - 'A'));
+    }
+    buf[i] = '\0';
+
+} /* randomName() */
+
+
+
+/*
+ * walkFind() - find the named option by walking the list, as
+ * xconfigFindOption() did before lists were indexed.
+ */
+
+static XConfigOptionPtr walkFind(XConfigOptionPtr list, const char *name)
+{
+    for (; list; list = list->next) {
+        if (xconfigNameCompare(list->name, name) == 0) return list;
+    }
+    return NULL;
+
+} /* walkFind() */
+
+
+
+static void checkLookups(XConfigOptionPtr list)
+{
+    XConfigOptionPtr opt;
+    char name[64];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        randomName(name);
+        CHECK(xconfigFindOption(list, name) == walkFind(list, name));
+    }
+
+    for (opt = list; opt; opt = opt->next) {
+        CHECK(xconfigFindOption(list, opt->name) == walkFind(list, opt->name));
+    }
+
+} /* checkLookups() */
+
+
+
+static XConfigOptionPtr nthOption(XConfigOptionPtr list, int n)
+{
+    for (; list && n > 0; n--) list = list->next;
+    return list;
+
+} /* nthOption() */
+
+
+
+static void testEdits(void)
+{
+    XConfigOptionPtr list, other, opt, last;
+    char name[64];
+    int round, i, len;
+
+    for (round = 0; round < NUM_ROUNDS; round++) {
+        list = NULL;
+
+        for (i = 0; i < NUM_EDITS; i++) {
+            randomName(name);
+
+            for (len = 0, last = list; last && last->next; last = last->next) {
+                len++;
+            }
+
+            switch (rand() % 10) {
+            case 0:
+                /* a duplicate, appended by hand */
+                opt = xconfigNewOption(name, NULL);
+                if (last) last->next = opt;
+                else list = opt;
+                break;
+            case 1:
+                /* prepended by hand */
+                opt = xconfigNewOption(name, NULL);
+                opt->next = list;
+                list = opt;
+                break;
+            case 2:
+                xconfigRemoveNamedOption(&list, name, NULL);
+                break;
+            case 3:
+                opt = nthOption(list, rand() % (len + 1));
+                if (opt) xconfigRemoveOption(&list, opt);
+                break;
+            case 4:
+                other = xconfigOptionListDup(list);
+                checkLookups(other);
+                xconfigFreeOptionList(&list);
+                list = other;
+                break;
+            case 5:
+                other = NULL;
+                xconfigAddNewOption(&other, name, "1");
+                randomName(name);
+                xconfigAddNewOption(&other, name, "2");
+                list = xconfigOptionListMerge(list, other);
+                break;
+            default:
+                xconfigAddNewOption(&list, name, "0");
+                break;
+            }
+
+            checkLookups(list);
+        }
+
+        xconfigFreeOptionList(&list);
+    }
+
+} /* testEdits() */
+
+
+
+static void testHandEdits(void)
+{
+    XConfigOptionPtr list = NULL, opt;
+    char name[16];
+    int i;
+
+    for (i = 0; i < 32; i++) {
+        snprintf(name, sizeof(name), "Option%d", i);
+        xconfigAddNewOption(&list, name, NULL);
+    }
+
+    CHECK(xconfigFindOption(list, "Option31") != NULL);
+
+    /* unlink and free the tail and the head without the helpers */
+
+    for (opt = list; opt->next->next; opt = opt->next);
+    xconfigFreeOptionList(&opt->next);
+
+    opt = list;
+    list = list->next;
+    opt->next = NULL;
+    xconfigFreeOptionList(&opt);
+
+    CHECK(xconfigFindOption(list, "Option0") == NULL);
+    CHECK(xconfigFindOption(list, "Option31") == NULL);
+    CHECK(xconfigFindOption(list, "option_30") != NULL);
+
+    xconfigAddNewOption(&list, "Option31", "1");
+    opt = xconfigFindOption(list, "Option31");
+    CHECK(opt != NULL && opt->next == NULL);
+
+    xconfigFreeOptionList(&list);
+
+} /* testHandEdits() */
+
+
+
+/*
+ * testParse() - parse a ServerFlags section with many options, every
+ * third one repeating the name before it; the first of each name is
+ * kept, in order.
+ */
+
+static void testParse(int arena)
+{
+    XConfigParserPtr parser = xconfigNewParser();
+    XConfigPtr config = NULL;
+    XConfigOptionPtr opt;
+    char *text, *p;
+    int i, n;
+
+    text = malloc(512 + NUM_PARSED * 48);
+    p = text + sprintf(text,
+                       "Section \"Device\"\n"
+                       "    Identifier \"Device0\"\n"
+                       "    Driver \"nvidia\"\n"
+                       "EndSection\n"
+                       "Section \"Screen\"\n"
+                       "    Identifier \"Screen0\"\n"
+                       "    Device \"Device0\"\n"
+                       "EndSection\n"
+                       "Section \"ServerFlags\"\n");
+    for (i = 0; i < NUM_PARSED; i++) {
+        p += sprintf(p, "    Option \"Option_%d\" \"%d\"\n",
+                     (i % 3 == 2) ? i - 1 : i, i);
+    }
+    sprintf(p, "EndSection\n");
+
+    xconfigParserUseArena(parser, arena);
+    xconfigParserOpenConfigBuffer(parser, text, strlen(text), "flags");
+    CHECK(xconfigParserReadConfigFile(parser, &config) ==
+          XCONFIG_RETURN_SUCCESS);
+    xconfigParserCloseConfigFile(parser);
+
+    if (config && config->flags) {
+        for (n = 0, opt = config->flags->options; opt; opt = opt->next, n++) {
+            CHECK(xconfigFindOption(config->flags->options, opt->name) ==
+                  opt);
+        }
+        CHECK(n == NUM_PARSED - NUM_PARSED / 3);
+
+        opt = xconfigFindOption(config->flags->options, "option 4");
+        CHECK(opt && strcmp(opt->val, "4") == 0);
+        CHECK(xconfigFindOption(config->flags->options, "Option_2") == NULL);
+
+        xconfigAddNewOption(&config->flags->options, "Extra", "1");
+        checkLookups(config->flags->options);
+    }
+
+    xconfigFreeConfig(&config);
+    xconfigFreeParser(&parser);
+    free(text);
+
+} /* testParse() */
+
+
+
+int main(void)
+{
+    srand(1);
+
+    testEdits();
+    testHandEdits();
+    testParse(FALSE);
+    testParse(TRUE);
+
+    return test_result();
+
+} /* main() */
@@ -0,0 +1,263 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_parse_threads.c - parse a set of configs on a pool of threads,
+ * each with a parser of its own, and check that every config comes
+ * out exactly as when the configs are parsed one at a time.  Half of
+ * the parses read into an arena, so that both allocation modes run
+ * concurrently.
+ *
+ * The configs are written out after the threads have finished:
+ * xconfigWriteConfigFile() switches the process locale, so it is not
+ * meant to be called from several threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "xf86Parser.h"
+#include "test_utils.h"
+
+#define NUM_CONFIGS 24
+#define NUM_THREADS 8
+#define NUM_ROUNDS  4
+
+typedef struct {
+    char *text;              /* the config to parse */
+    char *expected;          /* as written after a serial parse */
+    XConfigPtr parsed[NUM_ROUNDS];
+} ParseJobRec, *ParseJobPtr;
+
+typedef struct {
+    ParseJobPtr jobs;
+    int next;
+    pthread_mutex_t lock;
+} ParsePoolRec, *ParsePoolPtr;
+
+
+/*
+ * wallConfig() - a config with the given number of screens, each
+ * with its own Device and Monitor, all referenced from one layout.
+ */
+
+static char *wallConfig(int screens)
+{
+    size_t len = 512 + (size_t) screens * 1024;
+    char *buf = malloc(len), *p = buf;
+    int i;
+
+    p += sprintf(p, "Section \"ServerLayout\"\n"
+                 "    Identifier \"Wall\"\n");
+    for (i = 0; i < screens; i++) {
+        p += sprintf(p, "    Screen %d \"Screen%d\" %d 0\n", i, i, i * 1920);
+    }
+    p += sprintf(p, "EndSection\n\n");
+
+    for (i = 0; i < screens; i++) {
+        p += sprintf(p,
+                     "Section \"Monitor\"\n"
+                     "    Identifier \"Monitor%d\"\n"
+                     "    HorizSync 28.0 - 33.0\n"
+                     "    VertRefresh 43.0 - 72.0\n"
+                     "    Option \"DPMS\"\n"
+                     "EndSection\n\n"
+                     "Section \"Device\"\n"
+                     "    Identifier \"Device%d\"\n"
+                     "    Driver \"nvidia\"\n"
+                     "    BusID \"PCI:%d:0:0\"\n"
+                     "    Option \"Coolbits\" \"%d\"\n"
+                     "EndSection\n\n"
+                     "Section \"Screen\"\n"
+                     "    Identifier \"Screen%d\"\n"
+                     "    Device \"Device%d\"\n"
+                     "    Monitor \"Monitor%d\"\n"
+                     "    DefaultDepth 24\n"
+                     "    Option \"metamodes\" \"DFP-%d: nvidia-auto-select\"\n"
+                     "    SubSection \"Display\"\n"
+                     "        Depth 24\n"
+                     "        Modes \"1920x1080\"\n"
+                     "    EndSubSection\n"
+                     "EndSection\n\n",
+                     i, i, i + 1, i, i, i, i, i);
+    }
+
+    return buf;
+
+} /* wallConfig() */
+
+
+
+static XConfigPtr parseConfig(const char *text, int arena)
+{
+    XConfigParserPtr parser = xconfigNewParser();
+    XConfigPtr config = NULL;
+
+    if (!parser) return NULL;
+
+    xconfigParserUseArena(parser, arena);
+    xconfigParserOpenConfigBuffer(parser, text, strlen(text), "test");
+
+    if (xconfigParserReadConfigFile(parser, &config) !=
+        XCONFIG_RETURN_SUCCESS) {
+        config = NULL;
+    }
+
+    xconfigFreeParser(&parser);
+
+    return config;
+
+} /* parseConfig() */
+
+
+
+/*
+ * writeConfig() - return the config as xconfigWriteConfigFile()
+ * writes it.
+ */
+
+static char *writeConfig(XConfigPtr config)
+{
+    const char *dir = getenv("TESTS_OUTPUTDIR");
+    char path[4096], *text = NULL;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/parse_threads.XXXXXX",
+             dir ? dir : "/tmp");
+
+    fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    close(fd);
+
+    if (xconfigWriteConfigFile(path, config)) {
+        text = test_read_file(path);
+    }
+
+    unlink(path);
+
+    return text;
+
+} /* writeConfig() */
+
+
+
+static void *parseWorker(void *arg)
+{
+    ParsePoolPtr pool = arg;
+    ParseJobPtr job;
+    int i, round;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (i >= NUM_CONFIGS * NUM_ROUNDS) break;
+
+        job = &pool->jobs[i % NUM_CONFIGS];
+        round = i / NUM_CONFIGS;
+
+        job->parsed[round] = parseConfig(job->text, round % 2);
+    }
+
+    return NULL;
+
+} /* parseWorker() */
+
+
+
+int main(void)
+{
+    ParseJobRec jobs[NUM_CONFIGS];
+    ParsePoolRec pool;
+    pthread_t threads[NUM_THREADS];
+    XConfigPtr config;
+    char *path, *text;
+    int i, round, nthreads;
+
+    memset(jobs, 0, sizeof(jobs));
+
+    /* the sample config, and walls of different sizes */
+
+    path = test_fixture_path("xorg.conf");
+    jobs[0].text = test_read_file(path);
+    free(path);
+
+    CHECK(jobs[0].text != NULL);
+    if (!jobs[0].text) return test_result();
+
+    for (i = 1; i < NUM_CONFIGS; i++) {
+        jobs[i].text = wallConfig(i * 4);
+    }
+
+    /* parse each config on its own first */
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        config = parseConfig(jobs[i].text, FALSE);
+        CHECK(config != NULL);
+        if (!config) return test_result();
+
+        jobs[i].expected = writeConfig(config);
+        CHECK(jobs[i].expected != NULL);
+        xconfigFreeConfig(&config);
+    }
+
+    /* then all of them, several times over, at once */
+
+    memset(&pool, 0, sizeof(pool));
+    pool.jobs = jobs;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    for (nthreads = 0; nthreads < NUM_THREADS; nthreads++) {
+        if (pthread_create(&threads[nthreads], NULL, parseWorker,
+                           &pool) != 0) {
+            break;
+        }
+    }
+
+    CHECK(nthreads > 1);
+
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool.lock);
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        for (round = 0; round < NUM_ROUNDS; round++) {
+            config = jobs[i].parsed[round];
+            CHECK(config != NULL);
+            if (!config) continue;
+
+            text = writeConfig(config);
+            CHECK(text && jobs[i].expected &&
+                  strcmp(text, jobs[i].expected) == 0);
+
+            free(text);
+            xconfigFreeConfig(&config);
+        }
+        free(jobs[i].text);
+        free(jobs[i].expected);
+    }
+
+    return test_result();
+
+} /* main() */
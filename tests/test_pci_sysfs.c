@@ -0,0 +1,255 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_pci_sysfs.c - check find_sysfs_devices() against a made-up
+ * sysfs and procfs: only NVIDIA display devices are listed, in PCI
+ * bus order with the boot VGA device swapped to the front, and a
+ * GPU the NVIDIA kernel module does not describe makes the whole
+ * list unusable.
+ *
+ * Everything happens in a scratch directory under TESTS_OUTPUTDIR;
+ * pci_sysfs.c is built into this test, as the rest of nvidia-xconfig
+ * is not linked in.
+ */
+
+#include "pci_sysfs.c"
+
+#include <sys/stat.h>
+
+#include "test_utils.h"
+
+static char scratch[4096];
+
+
+/* the one function pci_sysfs.c uses from multiple_screens.c */
+
+void free_devices(DevicesPtr pDevices)
+{
+    int i;
+
+    if (!pDevices) return;
+
+    for (i = 0; i < pDevices->nDevices; i++) {
+        nvfree(pDevices->devices[i].name);
+        nvfree(pDevices->devices[i].uuid);
+    }
+
+    nvfree(pDevices->devices);
+    nvfree(pDevices);
+
+} /* free_devices() */
+
+
+
+static char *scratchPath(const char *name)
+{
+    return nvstrcat(scratch, "/", name, NULL);
+
+} /* scratchPath() */
+
+
+
+static void writeFile(const char *name, const char *text)
+{
+    char *path = scratchPath(name);
+    FILE *stream = fopen(path, "w");
+
+    CHECK(stream != NULL);
+    if (stream) {
+        fputs(text, stream);
+        fclose(stream);
+    }
+    nvfree(path);
+
+} /* writeFile() */
+
+
+
+static void makeDirs(const char *name)
+{
+    char *path = scratchPath(name);
+    char *p;
+
+    for (p = path + strlen(scratch) + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(path, 0755);
+            *p = '/';
+        }
+    }
+    mkdir(path, 0755);
+    nvfree(path);
+
+} /* makeDirs() */
+
+
+
+/*
+ * addPciDevice() - add a PCI function to the made-up sysfs; bootVga
+ * is only written if it is 0 or 1, as not every device has one.
+ */
+
+static void addPciDevice(const char *address, const char *vendor,
+                         const char *class, int bootVga)
+{
+    char *dir = nvstrcat("sys/" PCI_DEVICES_DIR "/", address, NULL);
+    char *file;
+
+    makeDirs(dir);
+
+    file = nvstrcat(dir, "/vendor", NULL);
+    writeFile(file, vendor);
+    nvfree(file);
+
+    file = nvstrcat(dir, "/device", NULL);
+    writeFile(file, "0x1eb8\n");
+    nvfree(file);
+
+    file = nvstrcat(dir, "/class", NULL);
+    writeFile(file, class);
+    nvfree(file);
+
+    if (bootVga == 0 || bootVga == 1) {
+        file = nvstrcat(dir, "/boot_vga", NULL);
+        writeFile(file, bootVga ? "1\n" : "0\n");
+        nvfree(file);
+    }
+
+    nvfree(dir);
+
+} /* addPciDevice() */
+
+
+
+/*
+ * addGpuInformation() - describe a GPU the way the NVIDIA kernel
+ * module does in /proc.
+ */
+
+static void addGpuInformation(const char *address, const char *model,
+                              const char *uuid)
+{
+    char *dir = nvstrcat("proc/" NVIDIA_GPUS_DIR "/", address, NULL);
+    char *file, *text;
+
+    makeDirs(dir);
+
+    file = nvstrcat(dir, "/information", NULL);
+    text = nvstrcat("Model: \t\t ", model, "\n"
+                    "IRQ:   \t\t 42\n"
+                    "GPU UUID: \t ", uuid, "\n"
+                    "Bus Location: \t ", address, "\n", NULL);
+    writeFile(file, text);
+    nvfree(text);
+    nvfree(file);
+    nvfree(dir);
+
+} /* addGpuInformation() */
+
+
+
+static void checkDevice(DevicesPtr pDevices, int i, unsigned int bus,
+                        const char *name, const char *uuid)
+{
+    DevicePtr pDevice = &pDevices->devices[i];
+
+    CHECK(pDevice->dev.domain == 0);
+    CHECK(pDevice->dev.bus == bus);
+    CHECK(pDevice->dev.slot == 0);
+    CHECK(pDevice->dev.function == 0);
+    CHECK(pDevice->name && strcmp(pDevice->name, name) == 0);
+    CHECK(pDevice->uuid && strcmp(pDevice->uuid, uuid) == 0);
+
+} /* checkDevice() */
+
+
+
+int main(void)
+{
+    const char *dir = getenv("TESTS_OUTPUTDIR");
+    char *sys, *proc, *path;
+    DevicesPtr pDevices;
+
+    snprintf(scratch, sizeof(scratch), "%s/pci_sysfs.XXXXXX",
+             dir ? dir : "/tmp");
+    if (!mkdtemp(scratch)) {
+        CHECK(!"mkdtemp");
+        return test_result();
+    }
+
+    sys = scratchPath("sys");
+    proc = scratchPath("proc");
+
+    /* no sysfs at all */
+
+    pDevices = find_sysfs_devices(sys, proc);
+    CHECK(pDevices == NULL);
+
+    /*
+     * three GPUs, the last of which the firmware booted from; an
+     * NVIDIA audio function and another vendor's VGA device are not
+     * listed
+     */
+
+    addPciDevice("0000:03:00.0", "0x10de\n", "0x030000\n", 0);
+    addPciDevice("0000:03:00.1", "0x10de\n", "0x040300\n", -1);
+    addPciDevice("0000:0a:00.0", "0x10de\n", "0x030200\n", -1);
+    addPciDevice("0000:41:00.0", "0x10de\n", "0x030000\n", 1);
+    addPciDevice("0000:00:02.0", "0x8086\n", "0x030000\n", 0);
+    makeDirs("sys/" PCI_DEVICES_DIR "/not-a-device");
+
+    addGpuInformation("0000:03:00.0", "Quadro RTX 4000",
+                      "GPU-00000000-0000-0000-0000-000000000003");
+    addGpuInformation("0000:0a:00.0", "Tesla T4",
+                      "GPU-00000000-0000-0000-0000-00000000000a");
+    addGpuInformation("0000:41:00.0", "NVIDIA RTX A6000",
+                      "GPU-00000000-0000-0000-0000-000000000041");
+
+    pDevices = find_sysfs_devices(sys, proc);
+    CHECK(pDevices != NULL);
+
+    if (pDevices) {
+        CHECK(pDevices->nDevices == 3);
+        if (pDevices->nDevices == 3) {
+            checkDevice(pDevices, 0, 0x41, "NVIDIA RTX A6000",
+                        "GPU-00000000-0000-0000-0000-000000000041");
+            checkDevice(pDevices, 1, 0x0a, "Tesla T4",
+                        "GPU-00000000-0000-0000-0000-00000000000a");
+            checkDevice(pDevices, 2, 0x03, "Quadro RTX 4000",
+                        "GPU-00000000-0000-0000-0000-000000000003");
+        }
+        free_devices(pDevices);
+    }
+
+    /* a GPU without its /proc information */
+
+    path = scratchPath("proc/" NVIDIA_GPUS_DIR "/0000:0a:00.0/information");
+    unlink(path);
+    nvfree(path);
+
+    pDevices = find_sysfs_devices(sys, proc);
+    CHECK(pDevices == NULL);
+    free_devices(pDevices);
+
+    nvfree(sys);
+    nvfree(proc);
+
+    return test_result();
+
+} /* main() */
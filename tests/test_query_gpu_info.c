@@ -0,0 +1,87 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_query_gpu_info.c - check that '--query-gpu-info --format=json'
+ * prints valid JSON for product names that are not UTF-8: the GPUs in
+ * tests/fixtures/nvidia-cfg-stub/names.topology are queried through
+ * the stand-in nvidia-cfg library (see nvidia_cfg_stub.c), and the
+ * output is compared with names.json in the same directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+int main(void)
+{
+    const char *xconfig = getenv("NVIDIA_XCONFIG");
+    const char *stubDir = getenv("NVIDIA_CFG_STUB_DIR");
+    const char *outDir = getenv("TESTS_OUTPUTDIR");
+    char cfgPath[4096], output[4096], *argv[5];
+    char *topology, *expectedFile, *expected, *result;
+
+    if (!xconfig || !stubDir || !outDir) {
+        fprintf(stderr, "NVIDIA_XCONFIG, NVIDIA_CFG_STUB_DIR and "
+                "TESTS_OUTPUTDIR must be set; run through 'make check'.\n");
+        return 1;
+    }
+
+    topology = test_fixture_path("nvidia-cfg-stub/names.topology");
+    expectedFile = test_fixture_path("nvidia-cfg-stub/names.json");
+    if (!topology || !expectedFile) return 1;
+
+    snprintf(cfgPath, sizeof(cfgPath), "--nvidia-cfg-path=%s", stubDir);
+    snprintf(output, sizeof(output), "%s/test_query_gpu_info.json", outDir);
+
+    setenv("NVIDIA_CFG_STUB_TOPOLOGY", topology, 1);
+
+    argv[0] = (char *) xconfig;
+    argv[1] = cfgPath;
+    argv[2] = "--query-gpu-info";
+    argv[3] = "--format=json";
+    argv[4] = NULL;
+
+    CHECK(test_run_program(argv, output) == 0);
+
+    expected = test_read_file(expectedFile);
+    result = test_read_file(output);
+
+    CHECK(expected != NULL);
+    CHECK(result != NULL);
+
+    if (expected && result && strcmp(expected, result) != 0) {
+        fprintf(stderr, "got:\n%s\nexpected:\n%s\n", result, expected);
+        CHECK(strcmp(expected, result) == 0);
+    }
+
+    if (test_result() == 0) {
+        unlink(output);
+    }
+
+    free(expected);
+    free(result);
+    free(topology);
+    free(expectedFile);
+
+    return test_result();
+
+} /* main() */
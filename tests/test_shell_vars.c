@@ -0,0 +1,134 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_shell_vars.c - check the reader of shell variable files (such
+ * as /etc/sysconfig/mouse) in Generate.c against the fixtures in
+ * tests/fixtures/shell-vars: each <name>.sh is parsed, and must set
+ * exactly the variables listed, one NAME=value per line, in
+ * <name>.expected.  The expected values are what sh itself assigns.
+ *
+ * The reader is static, so Generate.c is built into this test.
+ */
+
+#include "Generate.c"
+
+#include "test_utils.h"
+
+static const char *fixtures[] = {
+    "mouse",
+    "quoting",
+    "separators",
+    "reassigned",
+    "comments",
+};
+
+
+#define MAX_VARS 32
+
+static void checkFixture(const char *name)
+{
+    ShellVarPtr vars, var;
+    char file[64], *path, *buf, *expected, *line, *next, *eq, *entry;
+    const char *names[MAX_VARS], *values[MAX_VARS], *value;
+    int i, nExpected = 0, nVars = 0;
+
+    snprintf(file, sizeof(file), "shell-vars/%s.expected", name);
+    path = test_fixture_path(file);
+    expected = test_read_file(path);
+    free(path);
+
+    snprintf(file, sizeof(file), "shell-vars/%s.sh", name);
+    path = test_fixture_path(file);
+    buf = test_read_file(path);
+
+    CHECK(buf != NULL && expected != NULL);
+    if (!buf || !expected) goto done;
+
+    for (line = expected; *line && nExpected < MAX_VARS; line = next) {
+        next = line + strcspn(line, "\n");
+        if (*next) *next++ = '\0';
+
+        if ((eq = strchr(line, '=')) != NULL) {
+            *eq = '\0';
+            names[nExpected] = line;
+            values[nExpected] = eq + 1;
+            nExpected++;
+        }
+    }
+
+    /* the parser itself: the expected variables, and no others */
+
+    vars = parse_shell_vars(buf);
+
+    for (i = 0; i < nExpected; i++) {
+        value = get_shell_var(vars, names[i]);
+        if (!value || strcmp(value, values[i]) != 0) {
+            fprintf(stderr, "%s.sh: %s is \"%s\", expected \"%s\"\n",
+                    name, names[i], value ? value : "(unset)", values[i]);
+            CHECK(value && strcmp(value, values[i]) == 0);
+        }
+    }
+
+    for (var = vars; var; var = var->next) {
+        nVars++;
+    }
+    if (nVars != nExpected) {
+        for (var = vars; var; var = var->next) {
+            fprintf(stderr, "%s.sh: set %s=\"%s\"\n",
+                    name, var->name, var->value);
+        }
+    }
+    CHECK(nVars == nExpected);
+
+    free_shell_vars(vars);
+
+    /*
+     * find_config_entry(), which reads and caches the file itself;
+     * empty values are reported as unset
+     */
+
+    for (i = 0; i < nExpected; i++) {
+        entry = find_config_entry(path, names[i]);
+        CHECK(entry ? strcmp(entry, values[i]) == 0 : values[i][0] == '\0');
+        xconfigFree(entry);
+    }
+
+ done:
+    free(path);
+    free(buf);
+    free(expected);
+
+} /* checkFixture() */
+
+
+
+int main(void)
+{
+    int i;
+
+    for (i = 0; i < (int) (sizeof(fixtures) / sizeof(fixtures[0])); i++) {
+        checkFixture(fixtures[i]);
+    }
+
+    CHECK(find_config_entry("/nonexistent/sysconfig/mouse",
+                            "MOUSETYPE") == NULL);
+
+    return test_result();
+
+} /* main() */
@@ -0,0 +1,179 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_utils.c - helpers shared by the test and benchmark programs,
+ * and the xconfigPrint() that the XF86Config parser expects its user
+ * to provide.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "xf86Parser.h"
+#include "test_utils.h"
+
+static int failures = 0;
+
+
+/*
+ * xconfigPrint() - parser messages are only shown when
+ * TEST_VERBOSE is set, so that tests of invalid configs stay quiet.
+ */
+
+void xconfigPrint(MsgType t, const char *msg)
+{
+    if (getenv("TEST_VERBOSE")) {
+        fprintf(stderr, "%s\n", msg);
+    }
+
+} /* xconfigPrint() */
+
+
+
+void test_failed(const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    failures++;
+
+} /* test_failed() */
+
+
+
+int test_result(void)
+{
+    return failures ? 1 : 0;
+
+} /* test_result() */
+
+
+
+/*
+ * test_time() - a monotonic timestamp, in seconds.
+ */
+
+double test_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+
+} /* test_time() */
+
+
+
+/*
+ * test_fixture_path() - the path of the named file in tests/fixtures;
+ * the caller should free() it.
+ */
+
+char *test_fixture_path(const char *name)
+{
+    const char *dir = getenv("TESTS_DIR");
+    char *path;
+    size_t len;
+
+    if (!dir) dir = "tests";
+
+    len = strlen(dir) + strlen("/fixtures/") + strlen(name) + 1;
+    path = malloc(len);
+    if (path) {
+        snprintf(path, len, "%s/fixtures/%s", dir, name);
+    }
+
+    return path;
+
+} /* test_fixture_path() */
+
+
+
+/*
+ * test_read_file() - read the whole file into a NUL-terminated
+ * buffer, which the caller should free(); returns NULL on failure.
+ */
+
+char *test_read_file(const char *path)
+{
+    FILE *stream = fopen(path, "r");
+    char *buf = NULL, *tmp;
+    size_t len = 0, n;
+
+    if (!stream) return NULL;
+
+    do {
+        tmp = realloc(buf, len + 4096 + 1);
+        if (!tmp) {
+            free(buf);
+            fclose(stream);
+            return NULL;
+        }
+        buf = tmp;
+        n = fread(buf + len, 1, 4096, stream);
+        len += n;
+    } while (n > 0);
+
+    buf[len] = '\0';
+    fclose(stream);
+
+    return buf;
+
+} /* test_read_file() */
+
+
+
+/*
+ * test_run_program() - run argv[0] with the given arguments, with its
+ * standard output and error going to the file output (or discarded,
+ * if output is NULL); returns its exit status, or -1 if it could not
+ * be run or did not exit normally.
+ */
+
+int test_run_program(char *const argv[], const char *output)
+{
+    pid_t pid;
+    int fd, status;
+
+    pid = fork();
+    if (pid < 0) return -1;
+
+    if (pid == 0) {
+        fd = open(output ? output : "/dev/null",
+                  O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execv(argv[0], argv);
+        _exit(127);
+    }
+
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+
+    return WEXITSTATUS(status);
+
+} /* test_run_program() */
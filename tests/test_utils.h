@@ -0,0 +1,44 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_utils.h - helpers shared by the test and benchmark programs
+ */
+
+#ifndef __TEST_UTILS_H__
+#define __TEST_UTILS_H__
+
+/*
+ * CHECK() - report a failed expectation, with its location, and count
+ * it; test_result() returns the exit status for main().
+ */
+
+#define CHECK(expr)                                                     \
+    do {                                                                \
+        if (!(expr)) test_failed(__FILE__, __LINE__, #expr);            \
+    } while (0)
+
+void test_failed(const char *file, int line, const char *expr);
+int test_result(void);
+
+double test_time(void);
+char *test_fixture_path(const char *name);
+char *test_read_file(const char *path);
+int test_run_program(char *const argv[], const char *output);
+
+#endif /* __TEST_UTILS_H__ */
@@ -0,0 +1,272 @@
+/*
+ * nvidia-xconfig: A tool for manipulating X config files,
+ * specifically for use by the NVIDIA Linux graphics driver.
+ *
+ * Copyright (C) 2008 NVIDIA Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>.
+ *
+ *
+ * test_xserver_cache.c - check the X server probe cache in Generate.c:
+ * the cached libdir follows changes to xorg-server.pc and to the
+ * pkg-config environment, $PKG_CONFIG_SYSROOT_DIR is honored, and
+ * re-probing the X server keeps the cached libdir (and the other way
+ * around).  A shell script stands in for the X server.
+ *
+ * Everything happens in a scratch directory under TESTS_OUTPUTDIR;
+ * Generate.c is built into this test, as its cache is static.
+ */
+
+#include "Generate.c"
+
+#include "test_utils.h"
+
+static char scratch[4096];
+
+
+static char *scratchPath(const char *name)
+{
+    return xconfigStrcat(scratch, "/", name, NULL);
+
+} /* scratchPath() */
+
+
+
+static void writeFile(const char *name, const char *text, mode_t mode)
+{
+    char *path = scratchPath(name);
+    FILE *stream = fopen(path, "w");
+
+    CHECK(stream != NULL);
+    if (stream) {
+        fputs(text, stream);
+        fclose(stream);
+        chmod(path, mode);
+    }
+    xconfigFree(path);
+
+} /* writeFile() */
+
+
+
+static void makeDir(const char *name)
+{
+    char *path = scratchPath(name);
+
+    mkdir(path, 0755);
+    xconfigFree(path);
+
+} /* makeDir() */
+
+
+
+/*
+ * writePcFile() - write an xorg-server.pc with the given prefix, and
+ * give it a modification time of its own, so that a rewrite within
+ * the file system's timestamp granularity is still noticed.
+ */
+
+static void writePcFile(const char *dir, const char *prefix)
+{
+    static time_t mtime = 1000000000;
+    struct timespec times[2];
+    char *name, *text, *path;
+
+    name = xconfigStrcat(dir, "/xorg-server.pc", NULL);
+    text = xconfigStrcat("prefix=", prefix, "\n"
+                         "exec_prefix=${prefix}\n"
+                         "libdir=${exec_prefix}/lib\n"
+                         "\n"
+                         "Name: xorg-server\n"
+                         "Version: 1.20.0\n", NULL);
+    writeFile(name, text, 0644);
+
+    path = scratchPath(name);
+    times[0].tv_sec = times[1].tv_sec = mtime++;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    utimensat(AT_FDCWD, path, times, 0);
+
+    xconfigFree(path);
+    xconfigFree(text);
+    xconfigFree(name);
+
+} /* writePcFile() */
+
+
+
+/*
+ * checkLibdir() - check that find_libdir() finds the named directory;
+ * relative names are in the scratch directory.
+ */
+
+static void checkLibdir(GenerateOptions *gop, const char *name)
+{
+    char *expected, *libdir = find_libdir(gop);
+
+    expected = (name[0] == '/') ? xconfigStrdup(name) : scratchPath(name);
+
+    if (!libdir || strcmp(libdir, expected) != 0) {
+        fprintf(stderr, "libdir is \"%s\", expected \"%s\"\n",
+                libdir ? libdir : "(null)", expected);
+    }
+    CHECK(libdir && strcmp(libdir, expected) == 0);
+
+    xconfigFree(libdir);
+    xconfigFree(expected);
+
+} /* checkLibdir() */
+
+
+
+static const char *cachedValue(GenerateOptions *gop, const char *name)
+{
+    static char value[4096];
+    ShellVarPtr cache = load_xserver_cache(gop->xserver_cache_file);
+    const char *s = get_shell_var(cache, name);
+
+    snprintf(value, sizeof(value), "%s", s ? s : "");
+    free_shell_vars(cache);
+
+    return s ? value : NULL;
+
+} /* cachedValue() */
+
+
+
+int main(void)
+{
+    const char *dir = getenv("TESTS_OUTPUTDIR");
+    GenerateOptions gop;
+    char *path, *prefix, *root;
+    const char *value;
+
+    snprintf(scratch, sizeof(scratch), "%s/xserver_cache.XXXXXX",
+             dir ? dir : "/tmp");
+    if (!mkdtemp(scratch)) {
+        CHECK(!"mkdtemp");
+        return test_result();
+    }
+    root = realpath(scratch, NULL);
+    snprintf(scratch, sizeof(scratch), "%s", root);
+    free(root);
+
+    makeDir("pc1");
+    makeDir("pc2");
+    makeDir("root1");
+    makeDir("root1/lib");
+    makeDir("root2");
+    makeDir("root2/lib");
+    makeDir("sysroot");
+    makeDir("sysroot/usr");
+    makeDir("sysroot/usr/lib");
+    makeDir("xroot");
+
+    /* the X server stand-in is only ever run with -version */
+
+    writeFile("xroot/X",
+              "#!/bin/sh\n"
+              "echo 'X.Org X Server 1.20.0'\n", 0755);
+
+    memset(&gop, 0, sizeof(gop));
+    gop.x_project_root = scratchPath("xroot");
+    gop.xserver_cache_file = scratchPath("cache/xserver");
+    makeDir("cache");
+
+    unsetenv("PKG_CONFIG_PATH");
+    unsetenv("PKG_CONFIG_SYSROOT_DIR");
+    path = scratchPath("pc1");
+    setenv("PKG_CONFIG_LIBDIR", path, 1);
+    xconfigFree(path);
+
+    /* a fresh lookup, which is cached */
+
+    prefix = scratchPath("root1");
+    writePcFile("pc1", prefix);
+    xconfigFree(prefix);
+
+    checkLibdir(&gop, "root1/lib");
+    CHECK(cachedValue(&gop, "LIBDIR_STAMP") != NULL);
+
+    /* the .pc file changes */
+
+    prefix = scratchPath("root2");
+    writePcFile("pc1", prefix);
+    xconfigFree(prefix);
+
+    checkLibdir(&gop, "root2/lib");
+
+    /* the pkg-config environment points elsewhere */
+
+    prefix = scratchPath("root1");
+    writePcFile("pc2", prefix);
+    xconfigFree(prefix);
+
+    path = scratchPath("pc1");
+    setenv("PKG_CONFIG_PATH", path, 1);
+    xconfigFree(path);
+    path = scratchPath("pc2");
+    setenv("PKG_CONFIG_LIBDIR", path, 1);
+    xconfigFree(path);
+
+    checkLibdir(&gop, "root2/lib");     /* $PKG_CONFIG_PATH comes first */
+
+    unsetenv("PKG_CONFIG_PATH");
+    checkLibdir(&gop, "root1/lib");
+
+    /* paths in a sysroot: only the environment changes */
+
+    writePcFile("pc2", "/usr");
+    checkLibdir(&gop, "/usr/lib");
+
+    path = scratchPath("sysroot");
+    setenv("PKG_CONFIG_SYSROOT_DIR", path, 1);
+    xconfigFree(path);
+
+    checkLibdir(&gop, "sysroot/usr/lib");
+
+    unsetenv("PKG_CONFIG_SYSROOT_DIR");
+
+    /* probing the X server keeps the cached libdir... */
+
+    value = cachedValue(&gop, "LIBDIR");
+    path = value ? xconfigStrdup(value) : NULL;
+
+    xconfigGetXServerInUse(&gop);
+    CHECK(gop.xserver == X_IS_XORG);
+    CHECK(gop.autoloads_glx);
+    CHECK(cachedValue(&gop, "XSERVER_STAMP") != NULL);
+    CHECK(path && (value = cachedValue(&gop, "LIBDIR")) &&
+          strcmp(value, path) == 0);
+    xconfigFree(path);
+
+    /* ...and looking up the libdir keeps the probe results */
+
+    prefix = scratchPath("root2");
+    writePcFile("pc2", prefix);
+    xconfigFree(prefix);
+
+    checkLibdir(&gop, "root2/lib");
+    CHECK((value = cachedValue(&gop, "IS_XORG")) && strcmp(value, "1") == 0);
+
+    xconfigFree(gop.x_project_root);
+    xconfigFree(gop.xserver_cache_file);
+
+    if (test_result() == 0) {
+        char cmd[4200];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", scratch);
+        CHECK(system(cmd) == 0);
+    }
+
+    return test_result();
+
+} /* main() */
@@ -0,0 +1,113 @@
+#
+# nvidia-xconfig: A tool for manipulating X config files,
+# specifically for use by the NVIDIA Linux graphics driver.
+#
+# Copyright (C) 2008 NVIDIA Corporation.
+#
+# This program is free software; you can redistribute it and/or modify it
+# under the terms and conditions of the GNU General Public License,
+# version 2, as published by the Free Software Foundation.
+#
+# This program is distributed in the hope it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+##############################################################################
+# makefile fragment included by the nvidia-xconfig Makefile; defines
+# the targets for the tests and benchmarks:
+#
+#   make check   build and run the tests
+#   make bench   build and run the benchmarks
+#
+# TEST_PROGRAMS and BENCH_PROGRAMS are built from tests/<name>.c and
+# tests/test_utils.c, and linked with the XF86Config parser and
+# common-utils objects, minus those listed in <name>_EXCLUDE_OBJS.
+# TEST_SCRIPTS and BENCH_SCRIPTS are shell scripts in tests/.
+# NVIDIA_CFG_STUB is a stand-in libnvidia-cfg.so.1 built from
+# tests/nvidia_cfg_stub.c, for running nvidia-xconfig on made-up GPUs
+# with '--nvidia-cfg-path'.
+# Everything is run from the top of the source tree by
+# tests/run-tests.sh, with TEST_ENV in the environment.
+##############################################################################
+
+TESTS_DIR             = tests
+TESTS_OUTPUTDIR       = $(OUTPUTDIR)/tests
+
+TEST_PROGRAMS        += test_parse_threads
+TEST_PROGRAMS        += test_name_index
+TEST_PROGRAMS        += test_option_index
+TEST_PROGRAMS        += test_shell_vars
+TEST_PROGRAMS        += test_xserver_cache
+TEST_PROGRAMS        += test_gpu_probe
+TEST_PROGRAMS        += test_query_gpu_info
+TEST_PROGRAMS        += test_pci_sysfs
+
+TEST_SCRIPTS         += test_extract_edids.sh
+
+BENCH_PROGRAMS       += bench_keywords
+BENCH_PROGRAMS       += bench_gpu_probe
+
+BENCH_SCRIPTS        += bench_extract_edids.sh
+
+# tests of static functions build the file under test into the program
+test_shell_vars_EXCLUDE_OBJS = $(OUTPUTDIR)/Generate.o
+test_xserver_cache_EXCLUDE_OBJS = $(OUTPUTDIR)/Generate.o
+
+TESTS_COMMON_SRC      = $(TESTS_DIR)/test_utils.c
+TESTS_COMMON_OBJS     = \
+  $(call BUILD_OBJECT_LIST_WITH_DIR,$(TESTS_COMMON_SRC),$(TESTS_OUTPUTDIR))
+
+TESTS_LINK_OBJS       = $(call BUILD_OBJECT_LIST, \
+  $(addprefix $(XCONFIG_PARSER_DIR)/,$(XCONFIG_PARSER_SRC)) \
+  $(addprefix $(COMMON_UTILS_DIR)/,$(COMMON_UTILS_SRC)))
+
+TESTS_ALL_PROGRAMS    = $(TEST_PROGRAMS) $(BENCH_PROGRAMS)
+
+TESTS_SRC             = $(TESTS_COMMON_SRC)
+TESTS_SRC            += $(addprefix $(TESTS_DIR)/, \
+                          $(addsuffix .c,$(TESTS_ALL_PROGRAMS)))
+
+$(foreach src, $(TESTS_SRC), \
+  $(eval $(call DEFINE_OBJECT_RULE_WITH_DIR,TARGET,$(src),$(TESTS_OUTPUTDIR))))
+
+define DEFINE_TEST_PROGRAM_RULE
+  $(TESTS_OUTPUTDIR)/$(1): $(TESTS_OUTPUTDIR)/$(1).o $(TESTS_COMMON_OBJS) \
+      $$(filter-out $$($(1)_EXCLUDE_OBJS),$(TESTS_LINK_OBJS))
+	$$(call quiet_cmd,LINK) $$(CFLAGS) $$(LDFLAGS) -o $$@ $$^ $$(LIBS)
+endef
+
+$(foreach prog, $(TESTS_ALL_PROGRAMS), \
+    $(eval $(call DEFINE_TEST_PROGRAM_RULE,$(prog))))
+
+NVIDIA_CFG_STUB_DIR   = $(TESTS_OUTPUTDIR)/nvidia-cfg-stub
+NVIDIA_CFG_STUB       = $(NVIDIA_CFG_STUB_DIR)/libnvidia-cfg.so.1
+
+$(NVIDIA_CFG_STUB): $(TESTS_DIR)/nvidia_cfg_stub.c \
+    $(NVIDIA_CFG_DIR)/nvidia-cfg.h
+	@$(MKDIR) $(NVIDIA_CFG_STUB_DIR)
+	$(call quiet_cmd,LINK) $(CFLAGS) -fPIC -shared $(LDFLAGS) -o $@ $< \
+	  -lpthread
+
+TEST_ENV  = TESTS_DIR=$(TESTS_DIR)
+TEST_ENV += TESTS_OUTPUTDIR=$(TESTS_OUTPUTDIR)
+TEST_ENV += NVIDIA_XCONFIG=$(NVIDIA_XCONFIG)
+TEST_ENV += NVIDIA_CFG_STUB_DIR=$(NVIDIA_CFG_STUB_DIR)
+
+.PHONY: check bench
+
+check: $(addprefix $(TESTS_OUTPUTDIR)/,$(TEST_PROGRAMS)) $(NVIDIA_XCONFIG) \
+    $(NVIDIA_CFG_STUB)
+	@$(TEST_ENV) $(SHELL) $(TESTS_DIR)/run-tests.sh \
+	  $(addprefix $(TESTS_OUTPUTDIR)/,$(TEST_PROGRAMS)) \
+	  $(addprefix $(TESTS_DIR)/,$(TEST_SCRIPTS))
+
+bench: $(addprefix $(TESTS_OUTPUTDIR)/,$(BENCH_PROGRAMS)) $(NVIDIA_XCONFIG) \
+    $(NVIDIA_CFG_STUB)
+	@$(TEST_ENV) $(SHELL) $(TESTS_DIR)/run-tests.sh \
+	  $(addprefix $(TESTS_OUTPUTDIR)/,$(BENCH_PROGRAMS)) \
+	  $(addprefix $(TESTS_DIR)/,$(BENCH_SCRIPTS))